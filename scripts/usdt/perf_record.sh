@@ -0,0 +1,32 @@
+#!/usr/bin/env bash
+#
+# Records the Falco USDT probes system wide with perf, for offline
+# analysis with "perf script". The per-rule probes are left out unless
+# FALCO_USDT_ALL=1 is set, since they fire for every candidate rule.
+#
+# Usage: sudo ./perf_record.sh [seconds] [output file]
+#
+set -euo pipefail
+
+FALCO_BIN=${FALCO_BIN:-/usr/bin/falco}
+DURATION=${1:-10}
+OUTPUT=${2:-falco-usdt.data}
+
+probes=$(readelf -n "$FALCO_BIN" | awk '$1 == "Provider:" && $2 == "falco" { getline; print $2 }' | sort -u)
+if [ -z "$probes" ]; then
+	echo "$FALCO_BIN has no USDT probes, rebuild it with -DBUILD_FALCO_USDT=ON" >&2
+	exit 1
+fi
+
+events=()
+for p in $probes; do
+	if [ "${FALCO_USDT_ALL:-0}" != "1" ] && [[ "$p" == rule_eval* ]]; then
+		continue
+	fi
+	perf probe -q -x "$FALCO_BIN" -d "sdt_falco:$p" >/dev/null 2>&1 || true
+	perf probe -q -x "$FALCO_BIN" -a "%sdt_falco:$p"
+	events+=(-e "sdt_falco:$p")
+done
+
+perf record -a "${events[@]}" -o "$OUTPUT" -- sleep "$DURATION"
+echo "Run 'perf script -i $OUTPUT' to inspect the recorded probes"
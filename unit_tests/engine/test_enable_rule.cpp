@@ -284,3 +284,55 @@ TEST_F(test_falco_engine, enable_rule_name_wildcard)
 	EXPECT_EQ(3, m_engine->num_rules_for_ruleset(ruleset_4));
 }
 
+
+TEST_F(test_falco_engine, skip_event_type)
+{
+	load_rules(single_rule, "single_rule.yaml");
+
+	// nothing is skipped before rule loading is complete
+	EXPECT_FALSE(m_engine->skip_event_type(0, PPME_SYSCALL_OPEN_E));
+
+	m_engine->complete_rule_loading();
+	EXPECT_FALSE(m_engine->skip_event_type(0, PPME_SYSCALL_EXECVE_19_E));
+	EXPECT_FALSE(m_engine->skip_event_type(0, PPME_ASYNCEVENT_E));
+	EXPECT_TRUE(m_engine->skip_event_type(0, PPME_SYSCALL_OPEN_E));
+	EXPECT_EQ(1, m_engine->get_num_skipped_events());
+
+	// changing the enabled rules invalidates the event types
+	m_engine->enable_rule("test rule", false);
+	EXPECT_FALSE(m_engine->skip_event_type(0, PPME_SYSCALL_OPEN_E));
+	EXPECT_EQ(1, m_engine->get_num_skipped_events());
+
+	m_engine->complete_rule_loading();
+	EXPECT_TRUE(m_engine->skip_event_type(0, PPME_SYSCALL_EXECVE_19_E));
+	EXPECT_EQ(2, m_engine->get_num_skipped_events());
+
+	// changes that leave the default ruleset untouched keep them
+	m_engine->enable_rule("test rule", true, "other_ruleset");
+	m_engine->enable_rule("test rule", false);
+	EXPECT_TRUE(m_engine->skip_event_type(0, PPME_SYSCALL_EXECVE_19_E));
+	EXPECT_EQ(3, m_engine->get_num_skipped_events());
+}
+
+TEST_F(test_falco_engine, disable_source_rules)
+{
+	load_rules(multi_rule, "multi_rule.yaml");
+	m_engine->complete_rule_loading();
+	EXPECT_EQ(1, m_engine->num_rules_for_ruleset(default_ruleset));
+
+	// only the rules that were enabled are reported, and the event
+	// types with rules are kept up to date
+	auto disabled = m_engine->disable_source_rules(0, {}, {"process"});
+	EXPECT_EQ(disabled, (std::set<std::string>{"first actual rule"}));
+	EXPECT_EQ(0, m_engine->num_rules_for_ruleset(default_ruleset));
+	EXPECT_TRUE(m_engine->skip_event_type(0, PPME_SYSCALL_EXECVE_19_E));
+
+	// enabling them back doesn't enable the rules disabled in the first place
+	m_engine->enable_source_rules(0, disabled);
+	EXPECT_EQ(1, m_engine->num_rules_for_ruleset(default_ruleset));
+	EXPECT_FALSE(m_engine->skip_event_type(0, PPME_SYSCALL_EXECVE_19_E));
+
+	disabled = m_engine->disable_source_rules(0, {"first*"}, {});
+	EXPECT_EQ(disabled, (std::set<std::string>{"first actual rule"}));
+	EXPECT_TRUE(m_engine->disable_source_rules(0, {"first*", "third*"}, {"exec"}).empty());
+}
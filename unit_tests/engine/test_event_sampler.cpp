@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <gtest/gtest.h>
+#include <engine/event_sampler.h>
+
+#include <algorithm>
+
+#include "../test_falco_engine.h"
+
+static std::string sampled_rules = R"END(
+- rule: open or close
+  desc: A rule matching every open and close event
+  condition: evt.type in (open, close)
+  output: An event matched (evt.type=%evt.type)
+  priority: INFO
+  source: syscall
+)END";
+
+// A minimal event of the given type with no parameters, which is
+// enough to evaluate conditions on evt.type
+class sampled_event
+{
+public:
+	sampled_event(sinsp* inspector, ppm_event_code type)
+	{
+		m_hdr = {};
+		m_hdr.ts = 1;
+		m_hdr.tid = 1;
+		m_hdr.len = sizeof(scap_evt);
+		m_hdr.type = type;
+		m_hdr.nparams = 0;
+		m_evt.set_inspector(inspector);
+		m_evt.set_scap_evt(&m_hdr);
+		m_evt.set_info(&scap_get_event_info_table()[type]);
+	}
+
+	sinsp_evt* get() { return &m_evt; }
+
+private:
+	scap_evt m_hdr;
+	sinsp_evt m_evt;
+};
+
+TEST(EventSampler, deterministic_with_seed)
+{
+	event_sampler a(42), b(42), c(43);
+
+	bool differs = false;
+	for (int i = 0; i < 1000; i++)
+	{
+		auto va = a.next_double();
+		ASSERT_EQ(va, b.next_double());
+		ASSERT_GE(va, 0.0);
+		ASSERT_LT(va, 1.0);
+		differs = differs || va != c.next_double();
+	}
+	ASSERT_TRUE(differs);
+
+	a.set_seed(7);
+	b.set_seed(7);
+	for (int i = 0; i < 1000; i++)
+	{
+		ASSERT_EQ(a.should_drop(0, 0.5), b.should_drop(0, 0.5));
+	}
+}
+
+TEST(EventSampler, uniform_ratio)
+{
+	event_sampler s(1);
+
+	uint64_t kept = 0;
+	const uint64_t total = 100000;
+	for (uint64_t i = 0; i < total; i++)
+	{
+		kept += s.should_drop(0, 0.25) ? 0 : 1;
+	}
+	ASSERT_NEAR((double) kept / total, 0.25, 0.01);
+
+	for (uint64_t i = 0; i < 1000; i++)
+	{
+		ASSERT_FALSE(s.should_drop(0, 1.0));
+		ASSERT_TRUE(s.should_drop(0, 0.0));
+	}
+}
+
+TEST(EventSampler, stratified_preserves_rare_types)
+{
+	event_sampler s(1);
+	s.set_mode(event_sampler::mode::STRATIFIED, 10, 1000);
+	ASSERT_EQ(s.get_mode(), event_sampler::mode::STRATIFIED);
+
+	uint64_t kept_hot = 0;
+	uint64_t kept_rare = 0;
+	for (uint64_t window = 0; window < 5; window++)
+	{
+		for (uint64_t i = 0; i < 1000; i++)
+		{
+			// one rare event every 100 hot ones
+			if (i % 100 == 0)
+			{
+				kept_rare += s.should_drop(2, 0.0) ? 0 : 1;
+			}
+			else
+			{
+				kept_hot += s.should_drop(1, 0.0) ? 0 : 1;
+			}
+		}
+	}
+
+	// all the rare events are kept, while only the first hot events
+	// of each window survive a zero keep probability
+	ASSERT_EQ(kept_rare, 50);
+	ASSERT_EQ(kept_hot, 50);
+}
+
+TEST_F(test_falco_engine, sampling_process_event)
+{
+	ASSERT_TRUE(load_rules(sampled_rules, "sampled_rules.yaml"));
+	m_engine->complete_rule_loading();
+	sampled_event open_evt(&m_inspector, PPME_SYSCALL_OPEN_E);
+	sampled_event close_evt(&m_inspector, PPME_SYSCALL_CLOSE_E);
+
+	auto matches = [&](sampled_event& evt, uint64_t n)
+	{
+		std::vector<bool> ret;
+		for (uint64_t i = 0; i < n; i++)
+		{
+			ret.push_back(m_engine->process_event(0, evt.get(), falco_common::rule_matching::ALL) != nullptr);
+		}
+		return ret;
+	};
+
+	// without sampling, every event is evaluated
+	auto all = matches(open_evt, 100);
+	ASSERT_EQ(std::count(all.begin(), all.end(), true), 100);
+
+	// with a ratio of 4, about one event out of 4 is evaluated, and
+	// the same seed evaluates the same events
+	m_engine->set_sampling_ratio(4);
+	m_engine->set_sampling_multiplier(1);
+	m_engine->set_sampling_seed(42);
+	auto sampled = matches(open_evt, 10000);
+	ASSERT_NEAR((double) std::count(sampled.begin(), sampled.end(), true) / sampled.size(), 0.25, 0.02);
+	m_engine->set_sampling_seed(42);
+	ASSERT_EQ(matches(open_evt, 10000), sampled);
+
+	// in stratified mode, the first events of each type seen in each
+	// window are always evaluated, so the rare types are preserved
+	m_engine->set_sampling_mode(event_sampler::mode::STRATIFIED, 10, 1000);
+	m_engine->set_sampling_ratio(1000000);
+	auto hot = matches(open_evt, 900);
+	auto rare = matches(close_evt, 10);
+	ASSERT_LT(std::count(hot.begin(), hot.end(), true), 20);
+	ASSERT_EQ(std::count(rare.begin(), rare.end(), true), 10);
+}
@@ -101,3 +101,23 @@ TEST(FalcoUtils, matches_wildcard)
 	ASSERT_FALSE(falco::utils::matches_wildcard("*hello*world", "come on hello this world yes"));
 	ASSERT_FALSE(falco::utils::matches_wildcard("*hello*world*", "come on hello this yes"));
 }
+
+TEST(FalcoUtils, append_iso8601)
+{
+	std::string s;
+	falco::utils::append_iso8601(s, 1700000000123456789ULL);
+	ASSERT_EQ(s, "2023-11-14T22:13:20.123456789Z");
+
+	// the cached date and time is reused within the same second
+	s.clear();
+	falco::utils::append_iso8601(s, 1700000000000000001ULL, 6);
+	ASSERT_EQ(s, "2023-11-14T22:13:20.000000Z");
+
+	s = "ts=";
+	falco::utils::append_iso8601(s, 1700000001999000000ULL, 3);
+	ASSERT_EQ(s, "ts=2023-11-14T22:13:21.999Z");
+
+	s.clear();
+	falco::utils::append_iso8601(s, 0, 0);
+	ASSERT_EQ(s, "1970-01-01T00:00:00Z");
+}
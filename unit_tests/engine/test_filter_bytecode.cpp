@@ -0,0 +1,272 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <gtest/gtest.h>
+#include <engine/filter_bytecode.h>
+#include <libsinsp/filter/parser.h>
+
+#include <algorithm>
+
+using namespace libsinsp::filter;
+
+// Reference short-circuit evaluation of the AST, recording the
+// leaves in the order in which they get evaluated
+static bool eval_tree(const ast::expr* e, const filter_bytecode& code, uint64_t values, std::vector<uint32_t>& loads)
+{
+	if(auto a = dynamic_cast<const ast::and_expr*>(e))
+	{
+		for(const auto& c : a->children)
+		{
+			if(!eval_tree(c.get(), code, values, loads))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+	if(auto o = dynamic_cast<const ast::or_expr*>(e))
+	{
+		for(const auto& c : o->children)
+		{
+			if(eval_tree(c.get(), code, values, loads))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+	if(auto n = dynamic_cast<const ast::not_expr*>(e))
+	{
+		return !eval_tree(n->child.get(), code, values, loads);
+	}
+	const auto& leaves = code.leaves();
+	uint32_t idx = std::find(leaves.begin(), leaves.end(), e) - leaves.begin();
+	loads.push_back(idx);
+	return (values >> idx) & 1;
+}
+
+static void check_equivalence(const std::string& cond, size_t expected_leaves)
+{
+	parser p(cond);
+	auto ast = p.parse();
+	filter_bytecode code(ast.get());
+	ASSERT_EQ(code.leaves().size(), expected_leaves) << cond;
+	ASSERT_EQ(code.code().back().op, filter_bytecode::opcode::RETURN);
+
+	for(uint64_t values = 0; values < (1ULL << expected_leaves); values++)
+	{
+		std::vector<uint32_t> tree_loads, code_loads;
+		bool expected = eval_tree(ast.get(), code, values, tree_loads);
+		bool actual = code.run([&](uint32_t idx)
+		{
+			code_loads.push_back(idx);
+			return (bool) ((values >> idx) & 1);
+		});
+		ASSERT_EQ(actual, expected) << cond << " with leaf values " << values;
+		ASSERT_EQ(code_loads, tree_loads) << cond << " with leaf values " << values;
+	}
+}
+
+TEST(FilterBytecode, single_check)
+{
+	check_equivalence("proc.name=cat", 1);
+	check_equivalence("not proc.name=cat", 1);
+	check_equivalence("proc.name exists", 1);
+}
+
+TEST(FilterBytecode, short_circuit_equivalence)
+{
+	check_equivalence("evt.type=open and evt.dir=< and proc.name=cat", 3);
+	check_equivalence("evt.type=open or evt.dir=< or proc.name=cat", 3);
+	check_equivalence("evt.type=open and (proc.name=cat or proc.name=ls) and not fd.name=/etc/passwd", 4);
+	check_equivalence("(evt.type=open or evt.type=openat) and not (proc.name=cat and (fd.name=/a or not fd.name=/b))", 5);
+	check_equivalence("not (not evt.type=open or (evt.dir=< and not proc.name in (cat, ls))) or fd.name exists", 4);
+	check_equivalence("(a.b=1 and (c.d=2 or (e.f=3 and (g.h=4 or i.j=5)))) or (k.l=6 and not m.n=7)", 7);
+}
+
+TEST(FilterBytecode, compile_leaves)
+{
+	sinsp inspector;
+	sinsp_filter_check_list filterlist;
+	auto factory = std::make_shared<sinsp_filter_factory>(&inspector, filterlist);
+
+	parser p("evt.type=open and (proc.name=cat or not fd.name startswith /etc)");
+	auto ast = p.parse();
+	bytecode_filter filter(factory, ast.get());
+	ASSERT_EQ(filter.program().leaves().size(), 3);
+
+	parser bad("evt.type=open and not.a.field=1");
+	ast = bad.parse();
+	ASSERT_THROW(bytecode_filter(factory, ast.get()), sinsp_exception);
+}
+
+TEST(FilterBytecode, reordered_operands_equivalence)
+{
+	parser p("(evt.type=open or evt.type=openat) and not (proc.name=cat and (fd.name=/a or not fd.name=/b)) and evt.dir=<");
+	auto ast = p.parse();
+	filter_bytecode original(ast.get());
+
+	auto root = dynamic_cast<const ast::and_expr*>(ast.get());
+	ASSERT_NE(root, nullptr);
+	auto inner = dynamic_cast<const ast::not_expr*>(root->children[1].get());
+	ASSERT_NE(inner, nullptr);
+
+	filter_bytecode::operand_order order;
+	order[root] = {2, 1, 0};
+	order[root->children[0].get()] = {1, 0};
+	order[inner->child.get()] = {1, 0};
+	filter_bytecode reordered(ast.get(), &order);
+	ASSERT_EQ(reordered.leaves().size(), original.leaves().size());
+	ASSERT_EQ(reordered.leaves()[0], original.leaves().back());
+
+	// leaves have no side effects, so each one has a fixed value
+	// regardless of when (and whether) it gets evaluated
+	for(uint64_t values = 0; values < (1ULL << original.leaves().size()); values++)
+	{
+		auto value_of = [&](const ast::expr* leaf)
+		{
+			const auto& leaves = original.leaves();
+			auto idx = std::find(leaves.begin(), leaves.end(), leaf) - leaves.begin();
+			return (bool) ((values >> idx) & 1);
+		};
+		bool expected = original.run([&](uint32_t idx) { return value_of(original.leaves()[idx]); });
+		bool actual = reordered.run([&](uint32_t idx) { return value_of(reordered.leaves()[idx]); });
+		ASSERT_EQ(actual, expected) << "with leaf values " << values;
+	}
+}
+
+TEST(FilterBytecode, best_order)
+{
+	parser p("proc.aname[3]=sh and fd.name contains /etc and evt.dir=< and proc.name=cat");
+	auto ast = p.parse();
+	auto root = dynamic_cast<const ast::and_expr*>(ast.get());
+	ASSERT_NE(root, nullptr);
+	const auto& c = root->children;
+
+	bytecode_filter::operand_stats_map stats;
+	// expensive and rarely false
+	stats[c[0].get()] = {1000, 900, 1000 * 500};
+	// expensive and selective
+	stats[c[1].get()] = {100, 10, 100 * 400};
+	// cheap and selective
+	stats[c[2].get()] = {1000, 500, 1000 * 10};
+	// no stats, kept last
+
+	auto order = bytecode_filter::best_order(ast.get(), stats, {});
+	ASSERT_EQ(order.size(), 1);
+	ASSERT_EQ(order[root], std::vector<uint32_t>({2, 1, 0, 3}));
+
+	// the operands of or nodes are sorted by cost / P(true)
+	parser p2("fd.name contains /etc or evt.dir=<");
+	auto ast2 = p2.parse();
+	auto root2 = dynamic_cast<const ast::or_expr*>(ast2.get());
+	ASSERT_NE(root2, nullptr);
+	stats.clear();
+	stats[root2->children[0].get()] = {1000, 500, 1000 * 100};
+	stats[root2->children[1].get()] = {1000, 10, 1000 * 10};
+	ASSERT_TRUE(bytecode_filter::best_order(ast2.get(), stats, {}).empty());
+	stats[root2->children[1].get()] = {1000, 900, 1000 * 10};
+	ASSERT_EQ(bytecode_filter::best_order(ast2.get(), stats, {})[root2], std::vector<uint32_t>({1, 0}));
+}
+
+TEST(FilterBytecode, same_results_as_sinsp_filter)
+{
+	sinsp inspector;
+	sinsp_filter_check_list filterlist;
+	auto factory = std::make_shared<sinsp_filter_factory>(&inspector, filterlist);
+
+	std::vector<std::string> conditions = {
+		"evt.type=open",
+		"evt.type in (open, close) and evt.dir=>",
+		"(evt.type=open or evt.type=execve) and not evt.dir=<",
+		"not (evt.type=close and evt.dir=>) or evt.num=2",
+		"evt.category=file and (evt.num>1 or evt.type=close)",
+		"evt.type=open and proc.name=cat",
+		"proc.name exists or evt.type=execve",
+	};
+	std::vector<ppm_event_code> types = {
+		PPME_SYSCALL_OPEN_E, PPME_SYSCALL_OPEN_X, PPME_SYSCALL_CLOSE_E,
+		PPME_SYSCALL_CLOSE_X, PPME_SYSCALL_EXECVE_19_E, PPME_GENERIC_E,
+	};
+
+	for(const auto& cond : conditions)
+	{
+		parser p(cond);
+		auto ast = p.parse();
+		sinsp_filter_compiler compiler(factory, ast.get());
+		std::unique_ptr<sinsp_filter> tree(compiler.compile());
+		bytecode_filter code(factory, ast.get());
+		bytecode_filter adaptive(factory, ast.get());
+		adaptive.set_adaptive(2, 2);
+
+		uint64_t num = 0;
+		for(int round = 0; round < 4; round++)
+		{
+			for(auto type : types)
+			{
+				scap_evt hdr = {};
+				hdr.ts = 1;
+				hdr.tid = 1;
+				hdr.len = sizeof(scap_evt);
+				hdr.type = type;
+				hdr.nparams = 0;
+				sinsp_evt evt;
+				evt.set_inspector(&inspector);
+				evt.set_scap_evt(&hdr);
+				evt.set_info(&scap_get_event_info_table()[type]);
+				evt.set_num(++num);
+
+				bool expected = tree->run(&evt);
+				ASSERT_EQ(code.run(&evt), expected) << cond << " on event " << num;
+				ASSERT_EQ(adaptive.run(&evt), expected) << cond << " on event " << num;
+			}
+		}
+	}
+}
+
+TEST(FilterBytecode, leaves_use_the_filter_cache)
+{
+	sinsp inspector;
+	sinsp_filter_check_list filterlist;
+	auto factory = std::make_shared<sinsp_filter_factory>(&inspector, filterlist);
+	auto metrics = std::make_shared<sinsp_filter_cache_metrics>();
+	auto cache_factory = std::make_shared<exprstr_sinsp_filter_cache_factory>(metrics);
+
+	// the leaf shared by the two conditions is evaluated only once
+	parser p1("evt.type=open and evt.dir=>");
+	auto ast1 = p1.parse();
+	parser p2("evt.type=open and evt.num>0");
+	auto ast2 = p2.parse();
+	bytecode_filter code1(factory, ast1.get(), cache_factory);
+	bytecode_filter code2(factory, ast2.get(), cache_factory);
+
+	scap_evt hdr = {};
+	hdr.ts = 1;
+	hdr.tid = 1;
+	hdr.len = sizeof(scap_evt);
+	hdr.type = PPME_SYSCALL_OPEN_E;
+	hdr.nparams = 0;
+	sinsp_evt evt;
+	evt.set_inspector(&inspector);
+	evt.set_scap_evt(&hdr);
+	evt.set_info(&scap_get_event_info_table()[PPME_SYSCALL_OPEN_E]);
+	evt.set_num(1);
+
+	ASSERT_TRUE(code1.run(&evt));
+	ASSERT_TRUE(code2.run(&evt));
+	ASSERT_GT(metrics->m_num_extract_cache + metrics->m_num_compare_cache, 0u);
+}
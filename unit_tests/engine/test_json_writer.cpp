@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <engine/json_writer.h>
+
+#include <gtest/gtest.h>
+#include <limits>
+#include <string>
+
+using falco::json_writer;
+
+static std::string escaped(std::string_view s)
+{
+	std::string res;
+	json_writer::append_string(res, s);
+	return res;
+}
+
+TEST(JsonWriter, documents)
+{
+	std::string out;
+	json_writer w(out);
+	w.begin_object();
+	w.key("a").value("x");
+	w.key("b").begin_array().value(1).value(-2).value(true).null().end_array();
+	w.key("c").begin_object().end_object();
+	w.key("d").raw("{\"k\":1}");
+	w.key("e").value(std::numeric_limits<uint64_t>::max());
+	w.end_object();
+	ASSERT_EQ(out, "{\"a\":\"x\",\"b\":[1,-2,true,null],\"c\":{},\"d\":{\"k\":1},\"e\":18446744073709551615}");
+
+	// the buffer is appended to, and can be reused once cleared
+	out.clear();
+	json_writer w2(out);
+	w2.begin_array().value(std::numeric_limits<int64_t>::min()).end_array();
+	ASSERT_EQ(out, "[-9223372036854775808]");
+}
+
+TEST(JsonWriter, escaping)
+{
+	ASSERT_EQ(escaped(""), "\"\"");
+	ASSERT_EQ(escaped("plain"), "\"plain\"");
+	ASSERT_EQ(escaped("a\"b\\c/d"), "\"a\\\"b\\\\c/d\"");
+	ASSERT_EQ(escaped("\b\f\n\r\t"), "\"\\b\\f\\n\\r\\t\"");
+	ASSERT_EQ(escaped(std::string("\x01\x1f\x00", 3)), "\"\\u0001\\u001f\\u0000\"");
+
+	// special characters are found at any position of long strings
+	std::string s(100, 'x');
+	for(size_t i = 0; i < s.size(); i++)
+	{
+		std::string t = s;
+		t[i] = '"';
+		std::string expected = "\"" + s.substr(0, i) + "\\\"" + s.substr(i + 1) + "\"";
+		ASSERT_EQ(escaped(t), expected);
+	}
+}
+
+TEST(JsonWriter, utf8)
+{
+	// valid sequences are kept as they are
+	ASSERT_EQ(escaped("caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80"), "\"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80\"");
+	ASSERT_EQ(escaped(std::string(20, 'x') + "\xc3\xa9"), "\"" + std::string(20, 'x') + "\xc3\xa9\"");
+
+	// invalid ones are replaced
+	ASSERT_EQ(escaped("a\xff" "b"), "\"a\\ufffdb\"");
+	ASSERT_EQ(escaped("\xc3"), "\"\\ufffd\"");
+	ASSERT_EQ(escaped("\xc0\xaf"), "\"\\ufffd\\ufffd\"");
+	ASSERT_EQ(escaped("\xed\xa0\x80"), "\"\\ufffd\\ufffd\\ufffd\"");
+	ASSERT_EQ(escaped("\xf4\x90\x80\x80"), "\"\\ufffd\\ufffd\\ufffd\\ufffd\"");
+}
+
+TEST(JsonWriter, doubles)
+{
+	auto str = [](double d)
+	{
+		std::string res;
+		json_writer::append_double(res, d);
+		return res;
+	};
+	ASSERT_EQ(str(0.1), "0.1");
+	ASSERT_EQ(str(1.0), "1.0");
+	ASSERT_EQ(str(-2.5), "-2.5");
+	ASSERT_EQ(str(1e300), "1e+300");
+	ASSERT_EQ(std::stod(str(0.1 + 0.2)), 0.1 + 0.2);
+	// round-trips, but with 17 digits rather than the 16 of the shortest representation
+	ASSERT_EQ(str(1.0 / 3), "0.33333333333333331");
+	ASSERT_EQ(str(std::numeric_limits<double>::quiet_NaN()), "null");
+	ASSERT_EQ(str(std::numeric_limits<double>::infinity()), "null");
+}
+
+TEST(JsonWriter, nlohmann_documents)
+{
+	auto j = nlohmann::json::parse(R"({"b":[1,-2,3.5,"s",null,false],"a":{"x":"y\n"},"c":18446744073709551615})");
+	std::string out;
+	json_writer(out).value(j);
+	ASSERT_EQ(out, j.dump());
+	ASSERT_EQ(nlohmann::json::parse(out), j);
+}
+
+TEST(JsonWriter, time)
+{
+	std::string out;
+	json_writer(out).begin_object().key("time").time(1700000000123456789ULL).end_object();
+	ASSERT_EQ(out, "{\"time\":\"2023-11-14T22:13:20.123456789Z\"}");
+}
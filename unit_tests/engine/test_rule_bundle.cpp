@@ -0,0 +1,142 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "../test_falco_engine.h"
+
+static std::string bundle_rules = R"END(
+- list: shell_binaries
+  items: [bash, sh, zsh]
+
+- macro: spawned_shell
+  condition: evt.type = execve and proc.name in (shell_binaries)
+
+- rule: shell spawned
+  desc: A shell was spawned
+  condition: spawned_shell and proc.pname != "my launcher"
+  output: Shell spawned (proc.name=%proc.name)
+  priority: WARNING
+  tags: [process, shell]
+
+- rule: disabled rule
+  desc: A disabled rule
+  condition: evt.type = open
+  output: Open (fd.name=%fd.name)
+  priority: INFO
+  enabled: false
+)END";
+
+static const std::string s_rules_key = "rules.yaml:0123456789abcdef";
+
+TEST_F(test_falco_engine, rule_bundle_roundtrip)
+{
+	ASSERT_TRUE(load_rules(bundle_rules, "rules.yaml")) << m_load_result_string;
+
+	std::stringstream bundle;
+	m_engine->write_rules_bundle(bundle, s_rules_key);
+
+	auto engine = std::make_shared<falco_engine>();
+	engine->add_source(m_sample_source, m_filter_factory, m_formatter_factory);
+	ASSERT_TRUE(engine->load_rules_bundle(bundle.str(), s_rules_key));
+
+	ASSERT_EQ(engine->get_rules().size(), 2);
+	EXPECT_EQ(engine->num_rules_for_ruleset("falco-default-ruleset"), 1);
+
+	auto rule = engine->get_rules().at("shell spawned");
+	ASSERT_NE(rule, nullptr);
+	EXPECT_EQ(rule->description, "A shell was spawned");
+	EXPECT_EQ(rule->priority, falco_common::PRIORITY_WARNING);
+	EXPECT_EQ(rule->tags, (std::set<std::string>{"process", "shell"}));
+	EXPECT_NE(rule->filter, nullptr);
+
+	auto orig = m_engine->get_rules().at("shell spawned");
+	EXPECT_EQ(libsinsp::filter::ast::as_string(rule->condition.get()),
+		  libsinsp::filter::ast::as_string(orig->condition.get()));
+	EXPECT_EQ(rule->output, orig->output);
+
+	EXPECT_EQ(engine->sc_codes_for_ruleset(m_sample_source),
+		  m_engine->sc_codes_for_ruleset(m_sample_source));
+}
+
+TEST_F(test_falco_engine, rule_bundle_stale)
+{
+	ASSERT_TRUE(load_rules(bundle_rules, "rules.yaml")) << m_load_result_string;
+
+	std::stringstream bundle;
+	m_engine->write_rules_bundle(bundle, s_rules_key);
+
+	auto engine = std::make_shared<falco_engine>();
+	engine->add_source(m_sample_source, m_filter_factory, m_formatter_factory);
+	EXPECT_FALSE(engine->load_rules_bundle(bundle.str(), "rules.yaml:fedcba9876543210"));
+	EXPECT_EQ(engine->get_rules().size(), 0);
+
+	engine->set_extra("extra=%proc.pid", false);
+	EXPECT_FALSE(engine->load_rules_bundle(bundle.str(), s_rules_key));
+	EXPECT_EQ(engine->get_rules().size(), 0);
+}
+
+TEST_F(test_falco_engine, rule_bundle_malformed)
+{
+	ASSERT_TRUE(load_rules(bundle_rules, "rules.yaml")) << m_load_result_string;
+
+	std::stringstream bundle;
+	m_engine->write_rules_bundle(bundle, s_rules_key);
+
+	auto engine = std::make_shared<falco_engine>();
+	engine->add_source(m_sample_source, m_filter_factory, m_formatter_factory);
+	EXPECT_THROW(engine->load_rules_bundle("not a bundle", s_rules_key), falco_exception);
+
+	auto truncated = bundle.str();
+	truncated.resize(truncated.size() - 4);
+	EXPECT_THROW(engine->load_rules_bundle(truncated, s_rules_key), falco_exception);
+}
+
+TEST_F(test_falco_engine, rule_bundle_plugin_requirements)
+{
+	std::string rules = R"END(
+- required_plugin_versions:
+  - name: k8saudit
+    version: 0.7.0
+    alternatives:
+    - name: k8saudit-eks
+      version: 0.4.0
+)END" + bundle_rules;
+	ASSERT_TRUE(load_rules(rules, "rules.yaml")) << m_load_result_string;
+
+	std::stringstream bundle;
+	m_engine->write_rules_bundle(bundle, s_rules_key);
+
+	auto engine = std::make_shared<falco_engine>();
+	engine->add_source(m_sample_source, m_filter_factory, m_formatter_factory);
+	ASSERT_TRUE(engine->load_rules_bundle(bundle.str(), s_rules_key));
+
+	// the requirements are checked as if the rules files were loaded
+	std::string err;
+	EXPECT_TRUE(engine->check_plugin_requirements({{"k8saudit", "0.7.1"}}, err)) << err;
+	EXPECT_TRUE(engine->check_plugin_requirements({{"k8saudit-eks", "0.4.0"}}, err)) << err;
+	EXPECT_FALSE(engine->check_plugin_requirements({{"k8saudit", "0.6.0"}}, err));
+	EXPECT_FALSE(engine->check_plugin_requirements({}, err));
+	EXPECT_FALSE(err.empty());
+
+	// and are forgotten along with the rules
+	engine->clear_rules();
+	EXPECT_TRUE(engine->check_plugin_requirements({}, err)) << err;
+}
@@ -1178,3 +1178,115 @@ TEST_F(test_falco_engine, exceptions_fields_transformer_space_quoted)
   ASSERT_FALSE(has_warnings());
   EXPECT_EQ(get_compiled_rule_condition("test_rule"), "(evt.type = open and not tolower(proc.name) = test)");
 }
+
+TEST_F(test_falco_engine, recompile_reuses_unaffected_filters)
+{
+	std::string rules_content = R"END(
+- macro: interactive
+  condition: proc.name = login
+
+- rule: rule_with_macro
+  desc: rule with macro
+  condition: evt.type=open and interactive
+  output: user=%user.name command=%proc.cmdline file=%fd.name
+  priority: INFO
+
+- rule: rule_without_macro
+  desc: rule without macro
+  condition: evt.type=execve and proc.name = bash
+  output: user=%user.name command=%proc.cmdline
+  priority: INFO
+)END";
+
+	std::string override_content = R"END(
+- macro: interactive
+  condition: or proc.name = ssh
+  override:
+    condition: append
+)END";
+
+	ASSERT_TRUE(load_rules(rules_content, "rules.yaml")) << m_load_result_string;
+	auto with_macro = m_engine->get_rules().at("rule_with_macro")->filter;
+	auto without_macro = m_engine->get_rules().at("rule_without_macro")->filter;
+
+	// the second file only affects the rule that depends on the macro
+	ASSERT_TRUE(load_rules(override_content, "override.yaml")) << m_load_result_string;
+	EXPECT_NE(m_engine->get_rules().at("rule_with_macro")->filter, with_macro);
+	EXPECT_EQ(m_engine->get_rules().at("rule_without_macro")->filter, without_macro);
+	ASSERT_EQ(get_compiled_rule_condition("rule_with_macro"), "(evt.type = open and (proc.name = login or proc.name = ssh))");
+}
+
+TEST_F(test_falco_engine, clear_rules)
+{
+	std::string rules_content = R"END(
+- macro: interactive
+  condition: proc.name = login
+
+- rule: rule_with_macro
+  desc: rule with macro
+  condition: evt.type=open and interactive
+  output: user=%user.name command=%proc.cmdline file=%fd.name
+  priority: INFO
+)END";
+
+	std::string other_content = R"END(
+- rule: rule_without_macro
+  desc: rule without macro
+  condition: evt.type=execve and proc.name = bash
+  output: user=%user.name command=%proc.cmdline
+  priority: INFO
+)END";
+
+	ASSERT_TRUE(load_rules(rules_content, "rules.yaml")) << m_load_result_string;
+	ASSERT_EQ(m_engine->get_rules().size(), 1);
+
+	// the rules in use are kept until new ones are loaded
+	m_engine->clear_rules();
+	ASSERT_EQ(m_engine->get_rules().size(), 1);
+
+	ASSERT_TRUE(load_rules(other_content, "other.yaml")) << m_load_result_string;
+	ASSERT_EQ(m_engine->get_rules().size(), 1);
+	EXPECT_NE(m_engine->get_rules().at("rule_without_macro"), nullptr);
+
+	// macros loaded before clearing are forgotten too
+	m_engine->clear_rules();
+	ASSERT_FALSE(load_rules(other_content + R"END(
+- rule: rule_with_macro
+  desc: rule with macro
+  condition: evt.type=open and interactive
+  output: user=%user.name command=%proc.cmdline file=%fd.name
+  priority: INFO
+)END", "rules.yaml"));
+}
+
+TEST_F(test_falco_engine, rules_memory_usage)
+{
+	auto empty = m_engine->get_rules_memory_usage();
+	EXPECT_EQ(empty.rules, 0);
+	EXPECT_EQ(empty.filters, 0);
+
+	std::string rule = R"END(
+- rule: small_rule
+  desc: small rule
+  condition: evt.type=open
+  output: user=%user.name
+  priority: INFO
+)END";
+
+	ASSERT_TRUE(load_rules(rule, "rules.yaml")) << m_load_result_string;
+	auto small = m_engine->get_rules_memory_usage();
+	EXPECT_GT(small.rules, 0);
+	EXPECT_GT(small.filters, 0);
+
+	m_engine->clear_rules();
+	ASSERT_TRUE(load_rules(rule + R"END(
+- rule: large_rule
+  desc: large rule
+  condition: evt.type=execve and proc.name in (bash, sh, zsh, ksh, csh) and not user.name = root
+  output: user=%user.name command=%proc.cmdline
+  priority: INFO
+)END", "rules.yaml")) << m_load_result_string;
+	auto large = m_engine->get_rules_memory_usage();
+	EXPECT_GT(large.rules, small.rules);
+	EXPECT_GT(large.filters, small.filters);
+}
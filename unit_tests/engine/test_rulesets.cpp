@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <gtest/gtest.h>
 #include <engine/evttype_index_ruleset.h>
+#include <libsinsp/filter_cache.h>
 
 #define RULESET_0 0
 #define RULESET_1 1
@@ -47,6 +48,64 @@ static std::shared_ptr<sinsp_filter> create_filter(
 	return std::shared_ptr<sinsp_filter>(compiler.compile());
 }
 
+// A minimal event of the given type with no parameters, which is
+// enough to evaluate conditions on evt.type
+class test_event
+{
+public:
+	test_event(sinsp* inspector, ppm_event_code type)
+	{
+		m_hdr = {};
+		m_hdr.ts = 1;
+		m_hdr.tid = 1;
+		m_hdr.len = sizeof(scap_evt);
+		m_hdr.type = type;
+		m_hdr.nparams = 0;
+		m_evt.set_inspector(inspector);
+		m_evt.set_scap_evt(&m_hdr);
+		m_evt.set_info(&scap_get_event_info_table()[type]);
+	}
+
+	sinsp_evt* get() { return &m_evt; }
+
+private:
+	scap_evt m_hdr;
+	sinsp_evt m_evt;
+};
+
+static void add_rule(std::shared_ptr<sinsp_filter_factory> f, std::shared_ptr<filter_ruleset> r,
+	const std::string& name, const std::string& cond)
+{
+	libsinsp::filter::parser parser(cond);
+	std::shared_ptr<libsinsp::filter::ast::expr> ast = parser.parse();
+	falco_rule rule = {};
+	rule.name = name;
+	rule.source = falco_common::syscall_source;
+	r->add(rule, create_filter(f, ast.get()), ast);
+}
+
+static std::set<std::string> rule_names(const std::vector<falco_rule>& rules)
+{
+	std::set<std::string> ret;
+	for(const auto& rule : rules)
+	{
+		ret.insert(rule.name);
+	}
+	return ret;
+}
+
+static std::map<std::string, uint64_t> rule_masks(const std::vector<std::pair<falco_rule, uint64_t>>& rules)
+{
+	std::map<std::string, uint64_t> ret;
+	for(const auto& rule : rules)
+	{
+		// each rule must be reported at most once
+		EXPECT_EQ(ret.count(rule.first.name), 0);
+		ret[rule.first.name] = rule.second;
+	}
+	return ret;
+}
+
 TEST(Ruleset, enable_disable_rules_using_names)
 {
 	sinsp inspector;
@@ -202,3 +261,312 @@ TEST(Ruleset, enable_disable_rules_using_tags)
 	ASSERT_EQ(r->enabled_count(RULESET_1), 0);
 	ASSERT_EQ(r->enabled_count(RULESET_2), 0);
 }
+
+TEST(Ruleset, shared_predicates)
+{
+	sinsp inspector;
+
+	sinsp_filter_check_list filterlist;
+	auto f = create_factory(&inspector, filterlist);
+	auto r = std::make_shared<evttype_index_ruleset>(f);
+
+	auto add_rule = [&](const std::string& name, const std::string& cond)
+	{
+		libsinsp::filter::parser parser(cond);
+		std::shared_ptr<libsinsp::filter::ast::expr> ast = parser.parse();
+		falco_rule rule = {};
+		rule.name = name;
+		rule.source = falco_common::syscall_source;
+		r->add(rule, create_filter(f, ast.get()), ast);
+	};
+
+	add_rule("rule_A", "(evt.type=open and evt.dir=<) and proc.name=cat");
+	add_rule("rule_B", "(evt.type=open and evt.dir=<) and proc.name=ls and fd.name=/etc/passwd");
+	add_rule("rule_C", "evt.type=open and proc.name=ls");
+
+	/* Only the enabled rules are considered */
+	r->enable("rule_A", filter_ruleset::match_type::exact, RULESET_0);
+	r->enable("rule_C", filter_ruleset::match_type::exact, RULESET_1);
+	r->on_loading_complete();
+	ASSERT_EQ(r->num_shared_predicates(), 0);
+
+	/* The inlined macro-like group is shared by rule_A and rule_B,
+	 * proc.name=ls by rule_B and rule_C */
+	r->enable("rule_B", filter_ruleset::match_type::exact, RULESET_2);
+	r->on_loading_complete();
+	ASSERT_EQ(r->num_shared_predicates(), 2);
+
+	r->disable("rule_C", filter_ruleset::match_type::exact, RULESET_1);
+	r->on_loading_complete();
+	ASSERT_EQ(r->num_shared_predicates(), 1);
+}
+
+TEST(Ruleset, shared_predicates_evaluated_once)
+{
+	sinsp inspector;
+
+	sinsp_filter_check_list filterlist;
+	auto f = create_factory(&inspector, filterlist);
+	auto r = std::make_shared<evttype_index_ruleset>(f);
+	auto metrics = std::make_shared<sinsp_filter_cache_metrics>();
+	std::shared_ptr<sinsp_filter_cache_factory> cache_factory =
+		std::make_shared<exprstr_sinsp_filter_cache_factory>(metrics);
+	filter_ruleset::engine_state_funcs engine_state;
+	engine_state.get_filter_cache_factory = [&](const std::string&)
+	{
+		return cache_factory;
+	};
+	r->set_engine_state(engine_state);
+
+	auto add_rule = [&](const std::string& name, const std::string& cond)
+	{
+		libsinsp::filter::parser parser(cond);
+		std::shared_ptr<libsinsp::filter::ast::expr> ast = parser.parse();
+		falco_rule rule = {};
+		rule.name = name;
+		rule.source = falco_common::syscall_source;
+		sinsp_filter_compiler compiler(f, ast.get(), cache_factory);
+		r->add(rule, std::shared_ptr<sinsp_filter>(compiler.compile()), ast);
+	};
+
+	add_rule("rule_A", "(evt.type=open and evt.dir=>) and evt.num>0");
+	add_rule("rule_B", "(evt.type=open and evt.dir=>) and evt.num>5");
+	r->enable("", filter_ruleset::match_type::substring, RULESET_0);
+
+	auto lookups = [&]()
+	{
+		return metrics->m_num_extract + metrics->m_num_extract_cache +
+			metrics->m_num_compare + metrics->m_num_compare_cache;
+	};
+
+	test_event evt(&inspector, PPME_SYSCALL_OPEN_E);
+	std::set<std::string> expected = {"rule_A"};
+
+	/* Without the dispatch table, the whole filter of each rule runs,
+	 * evaluating the shared predicate once per rule */
+	evt.get()->set_num(1);
+	std::vector<falco_rule> matches;
+	ASSERT_TRUE(r->run(evt.get(), matches, RULESET_0));
+	EXPECT_EQ(rule_names(matches), expected);
+	uint64_t whole_filters = lookups();
+
+	/* With it, the shared predicate is evaluated once, and only
+	 * the rest of each condition runs for each rule */
+	r->on_loading_complete();
+	ASSERT_EQ(r->num_shared_predicates(), 1);
+	evt.get()->set_num(2);
+	uint64_t before = lookups();
+	matches.clear();
+	ASSERT_TRUE(r->run(evt.get(), matches, RULESET_0));
+	EXPECT_EQ(rule_names(matches), expected);
+	EXPECT_LT(lookups() - before, whole_filters);
+
+	/* Rules made only of shared predicates match without a residual */
+	add_rule("rule_C", "(evt.type=open and evt.dir=>) and evt.num>0");
+	r->enable("rule_C", filter_ruleset::match_type::exact, RULESET_0);
+	r->on_loading_complete();
+	ASSERT_EQ(r->num_shared_predicates(), 2);
+	evt.get()->set_num(3);
+	matches.clear();
+	ASSERT_TRUE(r->run(evt.get(), matches, RULESET_0));
+	expected = {"rule_A", "rule_C"};
+	EXPECT_EQ(rule_names(matches), expected);
+}
+
+TEST(Ruleset, dispatch_table_consistent_with_fallback)
+{
+	sinsp inspector;
+
+	sinsp_filter_check_list filterlist;
+	auto f = create_factory(&inspector, filterlist);
+	auto r = create_ruleset(f);
+
+	add_rule(f, r, "rule_A", "evt.type=open");
+	add_rule(f, r, "rule_B", "evt.type in (open, close)");
+	add_rule(f, r, "rule_C", "evt.type=close");
+	r->enable("", filter_ruleset::match_type::substring, RULESET_0);
+
+	test_event open_evt(&inspector, PPME_SYSCALL_OPEN_E);
+	test_event close_evt(&inspector, PPME_SYSCALL_CLOSE_E);
+	std::set<std::string> expected_open = {"rule_A", "rule_B"};
+	std::set<std::string> expected_close = {"rule_B", "rule_C"};
+
+	/* With an up to date dispatch table */
+	r->on_loading_complete();
+	std::vector<falco_rule> matches;
+	ASSERT_TRUE(r->run(open_evt.get(), matches, RULESET_0));
+	EXPECT_EQ(rule_names(matches), expected_open);
+	matches.clear();
+	ASSERT_TRUE(r->run(close_evt.get(), matches, RULESET_0));
+	EXPECT_EQ(rule_names(matches), expected_close);
+
+	/* Enabling rules outdates the dispatch table, the same
+	 * rules match with the fallback path */
+	r->enable("rule_A", filter_ruleset::match_type::exact, RULESET_0);
+	matches.clear();
+	ASSERT_TRUE(r->run(open_evt.get(), matches, RULESET_0));
+	EXPECT_EQ(rule_names(matches), expected_open);
+	matches.clear();
+	ASSERT_TRUE(r->run(close_evt.get(), matches, RULESET_0));
+	EXPECT_EQ(rule_names(matches), expected_close);
+
+	/* The first match is the same, too */
+	falco_rule fallback_match;
+	ASSERT_TRUE(r->run(open_evt.get(), fallback_match, RULESET_0));
+	r->on_loading_complete();
+	falco_rule dispatch_match;
+	ASSERT_TRUE(r->run(open_evt.get(), dispatch_match, RULESET_0));
+	EXPECT_EQ(fallback_match.name, dispatch_match.name);
+}
+
+TEST(Ruleset, run_rulesets_mask)
+{
+	sinsp inspector;
+
+	sinsp_filter_check_list filterlist;
+	auto f = create_factory(&inspector, filterlist);
+	auto r = create_ruleset(f);
+
+	add_rule(f, r, "rule_A", "evt.type=open");
+	add_rule(f, r, "rule_B", "evt.type in (open, close)");
+	r->enable("rule_A", filter_ruleset::match_type::exact, RULESET_0);
+	r->enable("rule_B", filter_ruleset::match_type::exact, RULESET_1);
+	r->on_loading_complete();
+
+	test_event open_evt(&inspector, PPME_SYSCALL_OPEN_E);
+	std::vector<std::pair<falco_rule, uint64_t>> matches;
+
+	ASSERT_TRUE(r->run_rulesets(open_evt.get(), matches, 1ULL << RULESET_0));
+	EXPECT_EQ(rule_masks(matches), (std::map<std::string, uint64_t>{{"rule_A", 1ULL << RULESET_0}}));
+
+	matches.clear();
+	ASSERT_TRUE(r->run_rulesets(open_evt.get(), matches, 1ULL << RULESET_1));
+	EXPECT_EQ(rule_masks(matches), (std::map<std::string, uint64_t>{{"rule_B", 1ULL << RULESET_1}}));
+
+	matches.clear();
+	ASSERT_TRUE(r->run_rulesets(open_evt.get(), matches, (1ULL << RULESET_0) | (1ULL << RULESET_1)));
+	EXPECT_EQ(rule_masks(matches), (std::map<std::string, uint64_t>{
+		{"rule_A", 1ULL << RULESET_0},
+		{"rule_B", 1ULL << RULESET_1}}));
+
+	/* No rule is enabled in the selected rulesets */
+	matches.clear();
+	ASSERT_FALSE(r->run_rulesets(open_evt.get(), matches, 1ULL << RULESET_2));
+	ASSERT_TRUE(matches.empty());
+	ASSERT_FALSE(r->run_rulesets(open_evt.get(), matches, 0));
+	ASSERT_TRUE(matches.empty());
+}
+
+TEST(Ruleset, run_rulesets_rule_in_many_rulesets)
+{
+	sinsp inspector;
+
+	sinsp_filter_check_list filterlist;
+	auto f = create_factory(&inspector, filterlist);
+	auto r = create_ruleset(f);
+
+	add_rule(f, r, "rule_A", "evt.type=open");
+	add_rule(f, r, "rule_B", "evt.type in (open, close)");
+	r->enable("rule_A", filter_ruleset::match_type::exact, RULESET_0);
+	r->enable("rule_B", filter_ruleset::match_type::exact, RULESET_0);
+	r->enable("rule_B", filter_ruleset::match_type::exact, RULESET_1);
+	r->enable("rule_B", filter_ruleset::match_type::exact, RULESET_2);
+	r->on_loading_complete();
+
+	test_event open_evt(&inspector, PPME_SYSCALL_OPEN_E);
+	test_event close_evt(&inspector, PPME_SYSCALL_CLOSE_E);
+	std::vector<std::pair<falco_rule, uint64_t>> matches;
+
+	/* rule_B is reported once, with the OR of the selected rulesets */
+	uint64_t all = (1ULL << RULESET_0) | (1ULL << RULESET_1) | (1ULL << RULESET_2);
+	ASSERT_TRUE(r->run_rulesets(open_evt.get(), matches, all));
+	EXPECT_EQ(matches.size(), 2);
+	EXPECT_EQ(rule_masks(matches), (std::map<std::string, uint64_t>{
+		{"rule_A", 1ULL << RULESET_0},
+		{"rule_B", all}}));
+
+	uint64_t some = (1ULL << RULESET_0) | (1ULL << RULESET_2);
+	matches.clear();
+	ASSERT_TRUE(r->run_rulesets(close_evt.get(), matches, some));
+	EXPECT_EQ(matches.size(), 1);
+	EXPECT_EQ(rule_masks(matches), (std::map<std::string, uint64_t>{{"rule_B", some}}));
+}
+
+TEST(Ruleset, run_rulesets_high_ruleset_ids)
+{
+	sinsp inspector;
+
+	sinsp_filter_check_list filterlist;
+	auto f = create_factory(&inspector, filterlist);
+	auto r = create_ruleset(f);
+
+	add_rule(f, r, "rule_A", "evt.type=open");
+	add_rule(f, r, "rule_B", "evt.type in (open, close)");
+	r->enable("rule_A", filter_ruleset::match_type::exact, 64);
+	r->enable("rule_B", filter_ruleset::match_type::exact, 100);
+	r->enable("rule_B", filter_ruleset::match_type::exact, RULESET_0);
+	r->on_loading_complete();
+	ASSERT_EQ(r->enabled_count(64), 1);
+	ASSERT_EQ(r->enabled_count(100), 1);
+
+	test_event open_evt(&inspector, PPME_SYSCALL_OPEN_E);
+
+	/* Rulesets beyond the first 64 can still be run one at a time */
+	std::vector<falco_rule> single;
+	ASSERT_TRUE(r->run(open_evt.get(), single, 64));
+	EXPECT_EQ(rule_names(single), (std::set<std::string>{"rule_A"}));
+	single.clear();
+	ASSERT_TRUE(r->run(open_evt.get(), single, 100));
+	EXPECT_EQ(rule_names(single), (std::set<std::string>{"rule_B"}));
+
+	/* but can't be selected by a mask, and don't leak in its bits */
+	std::vector<std::pair<falco_rule, uint64_t>> matches;
+	ASSERT_TRUE(r->run_rulesets(open_evt.get(), matches, ~0ULL));
+	EXPECT_EQ(rule_masks(matches), (std::map<std::string, uint64_t>{{"rule_B", 1ULL << RULESET_0}}));
+}
+
+TEST(Ruleset, run_rulesets_fallback)
+{
+	sinsp inspector;
+
+	sinsp_filter_check_list filterlist;
+	auto f = create_factory(&inspector, filterlist);
+	auto r = create_ruleset(f);
+
+	add_rule(f, r, "rule_A", "evt.type=open");
+	add_rule(f, r, "rule_B", "evt.type in (open, close)");
+	r->enable("rule_B", filter_ruleset::match_type::exact, RULESET_0);
+	r->enable("rule_B", filter_ruleset::match_type::exact, RULESET_1);
+	r->on_loading_complete();
+
+	test_event open_evt(&inspector, PPME_SYSCALL_OPEN_E);
+	uint64_t mask = (1ULL << RULESET_0) | (1ULL << RULESET_1);
+	std::vector<std::pair<falco_rule, uint64_t>> matches;
+	ASSERT_TRUE(r->run_rulesets(open_evt.get(), matches, mask));
+	EXPECT_EQ(rule_masks(matches), (std::map<std::string, uint64_t>{{"rule_B", mask}}));
+
+	/* Enabling a rule after loading outdates the dispatch table, the
+	 * rulesets must be run through the fallback with the same results */
+	r->enable("rule_A", filter_ruleset::match_type::exact, RULESET_1);
+	matches.clear();
+	ASSERT_TRUE(r->run_rulesets(open_evt.get(), matches, mask));
+	EXPECT_EQ(rule_masks(matches), (std::map<std::string, uint64_t>{
+		{"rule_A", 1ULL << RULESET_1},
+		{"rule_B", mask}}));
+
+	/* and the same happens once the table is rebuilt */
+	r->on_loading_complete();
+	matches.clear();
+	ASSERT_TRUE(r->run_rulesets(open_evt.get(), matches, mask));
+	EXPECT_EQ(rule_masks(matches), (std::map<std::string, uint64_t>{
+		{"rule_A", 1ULL << RULESET_1},
+		{"rule_B", mask}}));
+
+	/* Disabling works the same way */
+	r->disable("rule_B", filter_ruleset::match_type::exact, RULESET_0);
+	matches.clear();
+	ASSERT_TRUE(r->run_rulesets(open_evt.get(), matches, mask));
+	EXPECT_EQ(rule_masks(matches), (std::map<std::string, uint64_t>{
+		{"rule_A", 1ULL << RULESET_1},
+		{"rule_B", 1ULL << RULESET_1}}));
+}
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "app_action_helpers.h"
+
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+static uint64_t autotune_runs(const std::string& state_file, const std::string& profile)
+{
+	if(!std::filesystem::exists(state_file))
+	{
+		return 0;
+	}
+	std::ifstream in(state_file);
+	auto j = nlohmann::json::parse(in);
+	return j["profiles"][profile].value("runs", (uint64_t)0);
+}
+
+TEST(ActionCloseInspectors, complete_syscall_buffer_autotune_run)
+{
+	syscall_buffer_autotune_config c;
+	c.enabled = true;
+	c.min_preset = 2;
+	c.max_preset = 6;
+	c.shrink_after_runs = 2;
+	c.state_file = (std::filesystem::temp_directory_path() / ("falco_close_inspectors_test_" + std::to_string(getpid())) / "state.json").string();
+	std::filesystem::remove_all(std::filesystem::path(c.state_file).parent_path());
+
+	falco::app::state s;
+	s.buffer_autotune = std::make_shared<syscall_buffer_autotune>(c, "kmod/test");
+	s.buffer_autotune->select_preset(4);
+	s.loaded_sources = {falco_common::syscall_source};
+	falco::app::state::source_info src_info;
+	src_info.inspector = std::make_shared<sinsp>();
+	s.source_infos.insert(src_info, falco_common::syscall_source);
+
+	// no run if the inspector has never been opened
+	EXPECT_ACTION_OK(falco::app::actions::close_inspectors(s));
+	ASSERT_EQ(autotune_runs(c.state_file, "kmod/test"), 0);
+
+	// a run is completed once the opened inspector gets closed
+	s.source_infos.at(falco_common::syscall_source)->opened = true;
+	EXPECT_ACTION_OK(falco::app::actions::close_inspectors(s));
+	ASSERT_FALSE(s.source_infos.at(falco_common::syscall_source)->opened);
+	ASSERT_EQ(autotune_runs(c.state_file, "kmod/test"), 1);
+
+	// and only once
+	EXPECT_ACTION_OK(falco::app::actions::close_inspectors(s));
+	ASSERT_EQ(autotune_runs(c.state_file, "kmod/test"), 1);
+
+	std::filesystem::remove_all(std::filesystem::path(c.state_file).parent_path());
+}
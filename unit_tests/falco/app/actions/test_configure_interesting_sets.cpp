@@ -21,6 +21,7 @@ limitations under the License.
 #include <utility>
 
 #include <falco/app/app.h>
+#include <falco/app/actions/helpers.h>
 #include "app_action_helpers.h"
 
 #define ASSERT_NAMES_EQ(a, b) { \
@@ -421,6 +422,40 @@ TEST_F(test_falco_engine, selection_empty_custom_base_set_repair)
 	ASSERT_EQ(s7.selected_sc_set.size(), s7_state_set.size());
 }
 
+TEST_F(test_falco_engine, selection_shadow_rules)
+{
+	load_rules(ruleset_from_filters(s_sample_filters), "dummy_ruleset.yaml");
+
+	auto shadow_engine = std::make_shared<falco_engine>();
+	shadow_engine->add_source(s_sample_source, m_filter_factory, m_formatter_factory);
+	auto res = shadow_engine->load_rules(ruleset_from_filters({"evt.type in (chmod, fchmod)"}), "shadow_ruleset.yaml");
+	ASSERT_TRUE(res->successful());
+
+	falco::app::state s8;
+	s8.engine = m_engine;
+	s8.shadow_engine = shadow_engine;
+
+	// the shadow rules are only considered once loaded successfully
+	auto result = falco::app::actions::configure_interesting_sets(s8);
+	ASSERT_TRUE(result.success);
+	auto selected_sc_names = libsinsp::events::sc_set_to_event_names(s8.selected_sc_set);
+	ASSERT_NAMES_NOCONTAIN(selected_sc_names, strset_t({"chmod", "fchmod"}));
+
+	// the syscalls of both the active and the shadow rules are selected
+	s8.shadow_rules = std::make_shared<shadow_ruleset>(m_engine, shadow_engine, 1, 1);
+	result = falco::app::actions::configure_interesting_sets(s8);
+	ASSERT_TRUE(result.success);
+	selected_sc_names = libsinsp::events::sc_set_to_event_names(s8.selected_sc_set);
+	ASSERT_NAMES_CONTAIN(selected_sc_names, strset_t({"chmod", "fchmod", "connect", "execve"}));
+
+	// the syscalls of the shadow rules are still needed when all the
+	// active rules are disabled, e.g. by load shedding
+	m_engine->enable_rule_wildcard("*", false);
+	auto rules_sc_names = libsinsp::events::sc_set_to_event_names(falco::app::actions::rules_sc_set(s8));
+	ASSERT_NAMES_CONTAIN(rules_sc_names, strset_t({"chmod", "fchmod"}));
+	ASSERT_NAMES_NOCONTAIN(rules_sc_names, strset_t({"connect", "execve"}));
+}
+
 TEST(ConfigureInterestingSets, ignored_set_expected_size)
 {
 	// unit test fence to make sure we don't have unexpected regressions
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "app_action_helpers.h"
+
+#include <filesystem>
+
+TEST(ActionLoadRulesFiles, compile_rules_without_rules_files)
+{
+	auto dir = std::filesystem::temp_directory_path() / "falco_test_empty_rules_dir";
+	std::filesystem::create_directories(dir);
+
+	// an empty rules directory leaves nothing to put in the bundle
+	falco::app::state s = {};
+	s.options.rules_filenames = {dir.string()};
+	s.options.compile_rules_filename = (dir / "rules.bundle").string();
+	auto res = falco::app::actions::load_rules_files(s);
+	EXPECT_FALSE(res.success);
+	EXPECT_NE(res.errstr.find("No rules files to bundle"), std::string::npos);
+	EXPECT_FALSE(std::filesystem::exists(dir / "rules.bundle"));
+
+	std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <falco/app/actions/helpers.h>
+#include "app_action_helpers.h"
+
+#include <map>
+
+TEST(ActionReloadRulesFiles, apply_sc_set_delta)
+{
+	libsinsp::events::set<ppm_sc_code> from = {PPM_SC_OPEN, PPM_SC_READ, PPM_SC_EXECVE};
+	libsinsp::events::set<ppm_sc_code> to = {PPM_SC_READ, PPM_SC_EXECVE, PPM_SC_CLOSE, PPM_SC_CONNECT};
+
+	// only the syscalls that differ are changed, each once
+	std::map<ppm_sc_code, bool> marked;
+	size_t num_calls = 0;
+	auto mark = [&](ppm_sc_code sc, bool enable)
+	{
+		marked[sc] = enable;
+		num_calls++;
+	};
+	falco::app::actions::apply_sc_set_delta(from, to, mark);
+	ASSERT_EQ(num_calls, 3);
+	ASSERT_EQ(marked, (std::map<ppm_sc_code, bool>{
+		{PPM_SC_OPEN, false},
+		{PPM_SC_CLOSE, true},
+		{PPM_SC_CONNECT, true}}));
+
+	// applying the reverse delta restores the initial set
+	libsinsp::events::set<ppm_sc_code> current = to;
+	falco::app::actions::apply_sc_set_delta(to, from, [&](ppm_sc_code sc, bool enable)
+	{
+		if(enable)
+		{
+			current.insert(sc);
+		}
+		else
+		{
+			current.remove(sc);
+		}
+	});
+	ASSERT_EQ(current, from);
+
+	// nothing to do between identical sets
+	num_calls = 0;
+	falco::app::actions::apply_sc_set_delta(from, from, mark);
+	ASSERT_EQ(num_calls, 0);
+}
+
+TEST(ActionReloadRulesFiles, is_rules_only_restart)
+{
+	std::string config = R"(
+json_output: false
+rules_files:
+  - /etc/falco/falco_rules.yaml
+)";
+
+	falco_configuration current;
+	ASSERT_NO_THROW(current.init_from_content(config, {}));
+
+	// same configuration, only the content of the rules files may differ
+	falco_configuration same;
+	ASSERT_NO_THROW(same.init_from_content(config, {}));
+	ASSERT_TRUE(falco::app::actions::is_rules_only_restart(current, same));
+
+	// any configuration change requires a full restart
+	falco_configuration changed;
+	ASSERT_NO_THROW(changed.init_from_content(config + "buffered_outputs: true\n", {}));
+	ASSERT_FALSE(falco::app::actions::is_rules_only_restart(current, changed));
+
+	// including the list of rules files
+	falco_configuration other_rules;
+	ASSERT_NO_THROW(other_rules.init_from_content(R"(
+json_output: false
+rules_files:
+  - /etc/falco/falco_rules.local.yaml
+)", {}));
+	ASSERT_FALSE(falco::app::actions::is_rules_only_restart(current, other_rules));
+
+	// and command line options
+	falco_configuration cmdline;
+	ASSERT_NO_THROW(cmdline.init_from_content(config, {"json_output=true"}));
+	ASSERT_FALSE(falco::app::actions::is_rules_only_restart(current, cmdline));
+}
@@ -182,3 +182,209 @@ TEST(Configuration, configuration_webserver_ip)
         EXPECT_ANY_THROW(falco_config.init_from_content("", cmdline_config_options));
     }
 }
+
+TEST(Configuration, configuration_syscall_event_drops_load_shedding)
+{
+	falco_configuration falco_config;
+	ASSERT_NO_THROW(falco_config.init_from_content(R"(
+syscall_event_drops:
+  threshold: .1
+  actions:
+    - alert
+    - shed
+  load_shedding:
+    steps:
+      - tags: [mitre_discovery, network]
+      - rules: ['Read sensitive file*']
+        tags: [T1059]
+    recovery_seconds: 10
+	)", {}));
+
+	EXPECT_TRUE(falco_config.m_syscall_evt_drop_actions.count(syscall_evt_drop_action::SHED));
+	ASSERT_EQ(falco_config.m_syscall_evt_drop_shedding.steps.size(), 2);
+	EXPECT_EQ(falco_config.m_syscall_evt_drop_shedding.steps[0].tags, (std::set<std::string>{"mitre_discovery", "network"}));
+	EXPECT_TRUE(falco_config.m_syscall_evt_drop_shedding.steps[0].rules.empty());
+	EXPECT_EQ(falco_config.m_syscall_evt_drop_shedding.steps[1].rules, (std::set<std::string>{"Read sensitive file*"}));
+	EXPECT_EQ(falco_config.m_syscall_evt_drop_shedding.steps[1].tags, (std::set<std::string>{"T1059"}));
+	EXPECT_EQ(falco_config.m_syscall_evt_drop_shedding.step_seconds, 5);
+	EXPECT_EQ(falco_config.m_syscall_evt_drop_shedding.recovery_seconds, 10);
+
+	// shedding needs at least one step, and a recovery threshold below the drop threshold
+	EXPECT_ANY_THROW(falco_config.init_from_content(R"(
+syscall_event_drops:
+  actions: [shed]
+	)", {}));
+	EXPECT_ANY_THROW(falco_config.init_from_content(R"(
+syscall_event_drops:
+  threshold: .1
+  actions: [shed]
+  load_shedding:
+    steps:
+      - tags: [network]
+    recovery_threshold: .5
+	)", {}));
+}
+
+TEST(Configuration, configuration_syscall_buffer_autotune)
+{
+	falco_configuration falco_config;
+	ASSERT_NO_THROW(falco_config.init_from_content("", {}));
+	EXPECT_FALSE(falco_config.m_syscall_buffer_autotune.enabled);
+
+	ASSERT_NO_THROW(falco_config.init_from_content(R"(
+syscall_buffer_autotune:
+  enabled: true
+  state_file: /tmp/autotune.json
+  max_buf_size_preset: 8
+  max_lag_ms: 250
+	)", {}));
+	EXPECT_TRUE(falco_config.m_syscall_buffer_autotune.enabled);
+	EXPECT_EQ(falco_config.m_syscall_buffer_autotune.state_file, "/tmp/autotune.json");
+	EXPECT_EQ(falco_config.m_syscall_buffer_autotune.min_preset, 1);
+	EXPECT_EQ(falco_config.m_syscall_buffer_autotune.max_preset, 8);
+	EXPECT_EQ(falco_config.m_syscall_buffer_autotune.max_lag_ns, 250000000u);
+	EXPECT_EQ(falco_config.m_syscall_buffer_autotune.shrink_after_runs, 5u);
+
+	// presets must be valid buf_size_preset values
+	EXPECT_ANY_THROW(falco_config.init_from_content(R"(
+syscall_buffer_autotune:
+  enabled: true
+  max_buf_size_preset: 11
+	)", {}));
+	EXPECT_ANY_THROW(falco_config.init_from_content(R"(
+syscall_buffer_autotune:
+  enabled: true
+  min_buf_size_preset: 6
+  max_buf_size_preset: 5
+	)", {}));
+}
+
+TEST(Configuration, configuration_thread_affinity)
+{
+	falco_configuration falco_config;
+	ASSERT_NO_THROW(falco_config.init_from_content("", {}));
+	EXPECT_TRUE(falco_config.m_thread_affinity.m_sources.empty());
+	EXPECT_TRUE(falco_config.m_thread_affinity.m_outputs.empty());
+
+	ASSERT_NO_THROW(falco_config.init_from_content(R"(
+thread_affinity:
+  sources: auto
+  outputs: "0-1,4"
+	)", {}));
+	EXPECT_EQ(falco_config.m_thread_affinity.m_sources, "auto");
+	EXPECT_EQ(falco_config.m_thread_affinity.m_outputs, "0-1,4");
+	EXPECT_TRUE(falco_config.m_thread_affinity.m_stats.empty());
+
+	// "auto" is only supported for the event sources
+	EXPECT_ANY_THROW(falco_config.init_from_content(R"(
+thread_affinity:
+  outputs: auto
+	)", {}));
+	EXPECT_ANY_THROW(falco_config.init_from_content(R"(
+thread_affinity:
+  grpc: "3-1"
+	)", {}));
+}
+
+TEST(Configuration, configuration_memory_soft_limits)
+{
+	falco_configuration falco_config;
+	ASSERT_NO_THROW(falco_config.init_from_content("", {}));
+	EXPECT_EQ(falco_config.m_memory_soft_limits.total, 0u);
+	for (auto limit : falco_config.m_memory_soft_limits.subsystems)
+	{
+		EXPECT_EQ(limit, 0u);
+	}
+
+	ASSERT_NO_THROW(falco_config.init_from_content(R"(
+memory_soft_limits:
+  total_mb: 512
+  outputs_queue_mb: 64
+  thread_table_mb: 128
+	)", {}));
+	const auto& limits = falco_config.m_memory_soft_limits;
+	EXPECT_EQ(limits.total, 512u << 20);
+	EXPECT_EQ(limits.subsystems[(size_t)falco::memory::subsystem::OUTPUTS_QUEUE], 64u << 20);
+	EXPECT_EQ(limits.subsystems[(size_t)falco::memory::subsystem::GRPC_QUEUE], 0u);
+	EXPECT_EQ(limits.subsystems[(size_t)falco::memory::subsystem::THREAD_TABLE], 128u << 20);
+}
+
+TEST(Configuration, configuration_shadow_rules)
+{
+	falco_configuration falco_config;
+	ASSERT_NO_THROW(falco_config.init_from_content("", {}));
+	EXPECT_FALSE(falco_config.m_shadow_rules.enabled);
+	EXPECT_TRUE(falco_config.m_shadow_rules.rules_files.empty());
+	EXPECT_EQ(falco_config.m_shadow_rules.sampling_ratio, 100u);
+
+	ASSERT_NO_THROW(falco_config.init_from_content(R"(
+shadow_rules:
+  enabled: true
+  rules_files:
+    - /etc/falco/next/falco_rules.yaml
+    - /etc/falco/next/rules.d
+  sampling_ratio: 10
+	)", {}));
+	EXPECT_TRUE(falco_config.m_shadow_rules.enabled);
+	std::list<std::string> expected = {"/etc/falco/next/falco_rules.yaml", "/etc/falco/next/rules.d"};
+	EXPECT_EQ(falco_config.m_shadow_rules.rules_files, expected);
+	EXPECT_EQ(falco_config.m_shadow_rules.sampling_ratio, 10u);
+
+	// reloading the config doesn't accumulate the rules files
+	ASSERT_NO_THROW(falco_config.init_from_content(R"(
+shadow_rules:
+  rules_files: [/etc/falco/next/falco_rules.yaml]
+	)", {}));
+	EXPECT_FALSE(falco_config.m_shadow_rules.enabled);
+	EXPECT_EQ(falco_config.m_shadow_rules.rules_files.size(), 1u);
+
+	EXPECT_ANY_THROW(falco_config.init_from_content(R"(
+shadow_rules:
+  enabled: true
+	)", {}));
+	EXPECT_ANY_THROW(falco_config.init_from_content(R"(
+shadow_rules:
+  enabled: true
+  rules_files: [/etc/falco/next/falco_rules.yaml]
+  sampling_ratio: 0
+	)", {}));
+}
+
+TEST(Configuration, configuration_event_sampling)
+{
+	falco_configuration falco_config;
+	ASSERT_NO_THROW(falco_config.init_from_content("", {}));
+	EXPECT_EQ(falco_config.m_event_sampling.m_ratio, 1u);
+	EXPECT_FALSE(falco_config.m_event_sampling.m_has_seed);
+	EXPECT_EQ(falco_config.m_event_sampling.m_mode, event_sampler::mode::UNIFORM);
+
+	ASSERT_NO_THROW(falco_config.init_from_content(R"(
+event_sampling:
+  ratio: 10
+  seed: 42
+  mode: stratified
+  min_evts_per_type: 4
+  window_evts: 1000
+	)", {}));
+	EXPECT_EQ(falco_config.m_event_sampling.m_ratio, 10u);
+	EXPECT_TRUE(falco_config.m_event_sampling.m_has_seed);
+	EXPECT_EQ(falco_config.m_event_sampling.m_seed, 42u);
+	EXPECT_EQ(falco_config.m_event_sampling.m_mode, event_sampler::mode::STRATIFIED);
+	EXPECT_EQ(falco_config.m_event_sampling.m_min_evts_per_type, 4u);
+	EXPECT_EQ(falco_config.m_event_sampling.m_window_evts, 1000u);
+
+	EXPECT_ANY_THROW(falco_config.init_from_content(R"(
+event_sampling:
+  ratio: 0
+	)", {}));
+	EXPECT_ANY_THROW(falco_config.init_from_content(R"(
+event_sampling:
+  mode: random
+	)", {}));
+	EXPECT_ANY_THROW(falco_config.init_from_content(R"(
+event_sampling:
+  mode: stratified
+  min_evts_per_type: 16
+  window_evts: 8
+	)", {}));
+}
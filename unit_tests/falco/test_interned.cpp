@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <falco/interned.h>
+
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using falco::interned;
+
+TEST(Interned, equal_values_are_shared)
+{
+	std::string rule = "Terminal shell in container";
+	interned<std::string> a = rule;
+	interned<std::string> b = "Terminal shell in container";
+	interned<std::string> c = "Read sensitive file untrusted";
+
+	EXPECT_EQ(a.id(), b.id());
+	EXPECT_NE(a.id(), c.id());
+	EXPECT_EQ(&a.get(), &b.get());
+	EXPECT_TRUE(a == b);
+	EXPECT_TRUE(a != c);
+	EXPECT_TRUE(a == rule);
+	EXPECT_EQ(a, "Terminal shell in container");
+	EXPECT_EQ(a->size(), rule.size());
+
+	// copies share the value too
+	interned<std::string> d = a;
+	EXPECT_EQ(d.id(), a.id());
+}
+
+TEST(Interned, empty_values)
+{
+	interned<std::string> a;
+	interned<std::string> b = "";
+	interned<std::set<std::string>> tags;
+
+	EXPECT_EQ(a.id(), nullptr);
+	EXPECT_EQ(b.id(), nullptr);
+	EXPECT_TRUE(a->empty());
+	EXPECT_TRUE(a == b);
+	EXPECT_TRUE(tags->empty());
+}
+
+TEST(Interned, sets)
+{
+	std::set<std::string> s = {"container", "shell"};
+	interned<std::set<std::string>> a = s;
+	interned<std::set<std::string>> b = {"shell", "container"};
+
+	EXPECT_EQ(a.id(), b.id());
+	EXPECT_EQ(b->count("shell"), 1u);
+	EXPECT_EQ(a.get(), s);
+}
+
+TEST(Interned, unreferenced_values_are_released)
+{
+	size_t initial = interned<std::string>::table_size();
+	{
+		std::vector<interned<std::string>> values;
+		for(int i = 0; i < 1000; i++)
+		{
+			values.emplace_back("released-" + std::to_string(i));
+		}
+		EXPECT_GE(interned<std::string>::table_size(), 1000u);
+	}
+
+	// the table is purged as it grows again
+	for(int i = 0; i < 1000; i++)
+	{
+		interned<std::string> v = "transient-" + std::to_string(i);
+	}
+	EXPECT_LT(interned<std::string>::table_size(), initial + 1000);
+
+	// values still referenced survive purging
+	interned<std::string> kept = "kept";
+	const void* id = kept.id();
+	for(int i = 0; i < 1000; i++)
+	{
+		interned<std::string> v = "transient-" + std::to_string(i);
+	}
+	EXPECT_EQ(interned<std::string>("kept").id(), id);
+}
+
+TEST(Interned, concurrent_interning)
+{
+	interned<std::string> shared = "concurrent";
+	std::vector<std::thread> threads;
+	std::vector<bool> same(4, true);
+	for(size_t i = 0; i < same.size(); i++)
+	{
+		threads.emplace_back([&, i]()
+		{
+			for(int j = 0; j < 1000; j++)
+			{
+				interned<std::string> v = "concurrent-" + std::to_string(j);
+				interned<std::string> c = "concurrent";
+				same[i] = same[i] && c.id() == shared.id();
+			}
+		});
+	}
+	for(auto& t : threads)
+	{
+		t.join();
+	}
+	for(bool s : same)
+	{
+		EXPECT_TRUE(s);
+	}
+}
@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <falco/latency_histogram.h>
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+TEST(LatencyHistogram, buckets)
+{
+	using h = falco::latency_histogram;
+
+	ASSERT_EQ(h::bucket_index(0), 0);
+	ASSERT_EQ(h::bucket_index(1023), 0);
+	ASSERT_EQ(h::bucket_index(1024), 1);
+	ASSERT_EQ(h::bucket_index(UINT64_MAX), h::num_buckets - 1);
+
+	// every value falls within the bounds of its bucket, and bucket
+	// bounds are contiguous
+	for(uint64_t v = 1; v < ((uint64_t) 1 << 42); v = v * 3 / 2 + 1)
+	{
+		size_t i = h::bucket_index(v);
+		ASSERT_LT(v, h::bucket_upper_bound(i)) << v;
+		if(i > 0)
+		{
+			ASSERT_GE(v, h::bucket_upper_bound(i - 1)) << v;
+		}
+	}
+
+	// the relative error is bounded by the sub-bucket width
+	for(uint64_t v = 1024; v < ((uint64_t) 1 << 40); v = v * 5 / 4 + 7)
+	{
+		size_t i = h::bucket_index(v);
+		uint64_t lower = h::bucket_upper_bound(i - 1);
+		ASSERT_LE(h::bucket_upper_bound(i) - lower, lower / 4) << v;
+	}
+}
+
+TEST(LatencyHistogram, snapshot)
+{
+	falco::latency_histogram h;
+	for(uint64_t i = 1; i <= 1000; i++)
+	{
+		h.record(i * 1000);
+	}
+	auto s = h.get();
+	ASSERT_EQ(s.count, 1000);
+	ASSERT_EQ(s.sum, 500500000);
+	ASSERT_EQ(s.max, 1000000);
+
+	ASSERT_EQ(s.count_below(1 << 10), 1);
+	ASSERT_EQ(s.count_below(1 << 20), 1000);
+	ASSERT_EQ(s.count_below(1 << 16), 65);
+
+	auto p50 = s.percentile(0.5);
+	ASSERT_GE(p50, 500000);
+	ASSERT_LE(p50, 500000 * 5 / 4);
+	ASSERT_EQ(s.percentile(1), 1000000);
+	ASSERT_EQ(falco::latency_histogram().get().percentile(0.99), 0);
+}
+
+TEST(LatencyHistogram, concurrent_record)
+{
+	falco::latency_histogram h;
+	std::vector<std::thread> threads;
+	for(int t = 0; t < 4; t++)
+	{
+		threads.emplace_back([&h]()
+		{
+			for(uint64_t i = 0; i < 100000; i++)
+			{
+				h.record(i);
+			}
+		});
+	}
+	for(auto& t : threads)
+	{
+		t.join();
+	}
+	auto s = h.get();
+	ASSERT_EQ(s.count, 400000);
+	ASSERT_EQ(s.max, 99999);
+	ASSERT_EQ(s.count_below(UINT64_MAX), 400000);
+}
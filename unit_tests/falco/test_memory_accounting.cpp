@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <falco/memory_accounting.h>
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace falco::memory;
+
+TEST(MemoryAccounting, add_and_set)
+{
+	set(subsystem::GRPC_QUEUE, 0);
+	set(subsystem::RULES, 0);
+
+	add(subsystem::GRPC_QUEUE, 100);
+	add(subsystem::GRPC_QUEUE, -40);
+	EXPECT_EQ(get(subsystem::GRPC_QUEUE), 60u);
+
+	// concurrent updates never lose bytes
+	std::vector<std::thread> threads;
+	for(int i = 0; i < 4; i++)
+	{
+		threads.emplace_back([]()
+		{
+			for(int j = 0; j < 1000; j++)
+			{
+				add(subsystem::GRPC_QUEUE, 2);
+				add(subsystem::GRPC_QUEUE, -1);
+			}
+		});
+	}
+	for(auto& t : threads)
+	{
+		t.join();
+	}
+	EXPECT_EQ(get(subsystem::GRPC_QUEUE), 4060u);
+
+	set(subsystem::RULES, 1000);
+	EXPECT_EQ(get(subsystem::RULES), 1000u);
+	EXPECT_GE(total(), 5060u);
+
+	// a transiently negative balance is reported as zero
+	set(subsystem::GRPC_QUEUE, 0);
+	add(subsystem::GRPC_QUEUE, -10);
+	EXPECT_EQ(get(subsystem::GRPC_QUEUE), 0u);
+	set(subsystem::GRPC_QUEUE, 0);
+	set(subsystem::RULES, 0);
+}
+
+TEST(MemoryAccounting, soft_limits)
+{
+	soft_limits limits;
+	limits.subsystems[(size_t)subsystem::THREAD_TABLE] = 1000;
+	set_soft_limits(limits);
+
+	EXPECT_EQ(soft_limit(subsystem::THREAD_TABLE), 1000u);
+	EXPECT_EQ(soft_limit(subsystem::OUTPUTS_QUEUE), 0u);
+	EXPECT_EQ(total_soft_limit(), 0u);
+
+	set(subsystem::THREAD_TABLE, 1000);
+	EXPECT_FALSE(over_soft_limit(subsystem::THREAD_TABLE));
+	set(subsystem::THREAD_TABLE, 1001);
+	EXPECT_TRUE(over_soft_limit(subsystem::THREAD_TABLE));
+	EXPECT_FALSE(over_total_soft_limit());
+
+	// subsystems without a limit are never over it
+	set(subsystem::OUTPUTS_QUEUE, 1 << 30);
+	EXPECT_FALSE(over_soft_limit(subsystem::OUTPUTS_QUEUE));
+
+	limits.total = 2000;
+	set_soft_limits(limits);
+	EXPECT_TRUE(over_total_soft_limit());
+
+	auto hits = limit_hits(subsystem::THREAD_TABLE);
+	count_limit_hit(subsystem::THREAD_TABLE);
+	EXPECT_EQ(limit_hits(subsystem::THREAD_TABLE), hits + 1);
+
+	set_soft_limits({});
+	set(subsystem::THREAD_TABLE, 0);
+	set(subsystem::OUTPUTS_QUEUE, 0);
+}
@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <falco/outputs_queue.h>
+
+#include <chrono>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using queue_t = falco::outputs::priority_queue<std::string>;
+
+static std::vector<std::string> pop_all(queue_t& q)
+{
+	std::vector<std::string> res;
+	while(q.size() > 0)
+	{
+		std::string s;
+		q.pop(s);
+		res.push_back(s);
+	}
+	return res;
+}
+
+TEST(OutputsQueue, fifo_across_levels)
+{
+	std::vector<std::string> dropped;
+	queue_t q(8, 10, 0, 0, [&](const std::string& s, size_t) { dropped.push_back(s); });
+
+	ASSERT_TRUE(q.push("a", 7));
+	ASSERT_TRUE(q.push("b", 0));
+	ASSERT_TRUE(q.push("c", 3));
+	ASSERT_TRUE(q.push("d", 7));
+	ASSERT_EQ(pop_all(q), std::vector<std::string>({"a", "b", "c", "d"}));
+	ASSERT_TRUE(dropped.empty());
+}
+
+TEST(OutputsQueue, evict_lower_priority_first)
+{
+	std::vector<std::pair<std::string, size_t>> dropped;
+	queue_t q(8, 3, 0, 0, [&](const std::string& s, size_t l) { dropped.push_back({s, l}); });
+
+	ASSERT_TRUE(q.push("info1", 6));
+	ASSERT_TRUE(q.push("debug1", 7));
+	ASSERT_TRUE(q.push("info2", 6));
+
+	// full: the debug alert is evicted first, then the oldest info one
+	ASSERT_FALSE(q.push("crit1", 2));
+	ASSERT_FALSE(q.push("crit2", 2));
+	ASSERT_EQ(dropped, (std::vector<std::pair<std::string, size_t>>{{"debug1", 7}, {"info1", 6}}));
+
+	// an alert with the same or lower priority than all queued ones is dropped
+	ASSERT_FALSE(q.push("info3", 6));
+	ASSERT_EQ(dropped.back().first, "info3");
+	ASSERT_FALSE(q.push("emerg", 0));
+	ASSERT_EQ(dropped.back().first, "info2");
+	ASSERT_FALSE(q.push("crit3", 2));
+	ASSERT_EQ(dropped.back().first, "crit3");
+
+	ASSERT_EQ(pop_all(q), std::vector<std::string>({"crit1", "crit2", "emerg"}));
+}
+
+TEST(OutputsQueue, reserved_capacity)
+{
+	size_t num_dropped = 0;
+	queue_t q(8, 4, 2, 3, [&](const std::string&, size_t) { num_dropped++; });
+
+	// low priorities can only use 2 slots
+	ASSERT_TRUE(q.push("warn1", 4));
+	ASSERT_TRUE(q.push("warn2", 4));
+	ASSERT_FALSE(q.push("warn3", 4));
+	ASSERT_EQ(num_dropped, 1);
+
+	// critical and above can use the reserved ones
+	ASSERT_TRUE(q.push("crit1", 2));
+	ASSERT_TRUE(q.push("alert1", 1));
+	ASSERT_EQ(q.size(), 4);
+	ASSERT_FALSE(q.push("crit2", 2));
+	ASSERT_EQ(num_dropped, 2);
+	ASSERT_EQ(pop_all(q), std::vector<std::string>({"warn2", "crit1", "alert1", "crit2"}));
+}
+
+TEST(OutputsQueue, forced_items)
+{
+	size_t num_dropped = 0;
+	queue_t q(8, 1, 0, 0, [&](const std::string&, size_t) { num_dropped++; });
+
+	ASSERT_TRUE(q.push("debug", 7));
+	ASSERT_TRUE(q.push("ctrl", 0, true));
+	ASSERT_EQ(q.size(), 1);
+	q.clear();
+	ASSERT_TRUE(q.push("emerg", 0));
+	ASSERT_FALSE(q.push("emerg2", 0));
+	ASSERT_EQ(num_dropped, 1);
+
+	// forced items are never dropped and wake up consumers
+	std::string popped;
+	std::thread consumer([&]()
+	{
+		std::string s;
+		q.pop(s);
+		q.pop(popped);
+	});
+	ASSERT_TRUE(q.push("stop", 0, true));
+	consumer.join();
+	ASSERT_EQ(popped, "stop");
+	ASSERT_EQ(num_dropped, 1);
+}
+
+TEST(OutputsQueue, max_bytes)
+{
+	std::vector<std::string> dropped;
+	queue_t q(8, 100, 0, 0,
+		[&](const std::string& s, size_t) { dropped.push_back(s); },
+		10, [](const std::string& s) { return s.size(); });
+
+	// an item bigger than the limit is accepted if the queue is empty
+	ASSERT_TRUE(q.push("debug-too-big", 7));
+	ASSERT_EQ(q.bytes(), 13u);
+	ASSERT_EQ(pop_all(q), std::vector<std::string>({"debug-too-big"}));
+	ASSERT_EQ(q.bytes(), 0u);
+
+	// more important items evict as many less important ones as needed
+	ASSERT_TRUE(q.push("dbg1", 7));
+	ASSERT_TRUE(q.push("dbg2", 7));
+	ASSERT_FALSE(q.push("crit-alert", 2));
+	ASSERT_EQ(dropped, std::vector<std::string>({"dbg1", "dbg2"}));
+	ASSERT_EQ(q.bytes(), 10u);
+	ASSERT_FALSE(q.push("dbg3", 7));
+	ASSERT_EQ(dropped.back(), "dbg3");
+
+	// forced items are not subject to the limit
+	ASSERT_TRUE(q.push("stop", 0, true));
+	ASSERT_EQ(q.bytes(), 14u);
+	q.clear();
+	ASSERT_EQ(q.bytes(), 0u);
+}
+
+TEST(OutputsQueue, move_only_items)
+{
+	size_t num_dropped = 0;
+	falco::outputs::priority_queue<std::unique_ptr<int>> q(8, 1, 0, 0,
+		[&](const std::unique_ptr<int>&, size_t) { num_dropped++; });
+
+	auto first = std::make_unique<int>(1);
+	ASSERT_TRUE(q.push(std::move(first), 3));
+	ASSERT_EQ(first, nullptr);
+
+	// a dropped item is left to the caller
+	auto second = std::make_unique<int>(2);
+	ASSERT_FALSE(q.push(std::move(second), 5));
+	ASSERT_NE(second, nullptr);
+	ASSERT_EQ(num_dropped, 1u);
+
+	std::unique_ptr<int> popped;
+	q.pop(popped);
+	ASSERT_EQ(*popped, 1);
+}
+
+TEST(OutputsQueue, pop_for)
+{
+	queue_t q(8, 10, 0, 0, [](const std::string&, size_t) {});
+
+	std::string s;
+	ASSERT_FALSE(q.pop_for(s, std::chrono::milliseconds(10)));
+	ASSERT_TRUE(s.empty());
+
+	ASSERT_TRUE(q.push("a", 3));
+	ASSERT_TRUE(q.push("b", 0, true));
+	ASSERT_TRUE(q.pop_for(s, std::chrono::milliseconds(10)));
+	ASSERT_EQ(s, "a");
+	ASSERT_TRUE(q.pop_for(s, std::chrono::milliseconds(10)));
+	ASSERT_EQ(s, "b");
+	ASSERT_EQ(q.size(), 0u);
+
+	// items pushed while waiting are popped before the timeout
+	std::thread t([&q] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		q.push("c", 3);
+	});
+	ASSERT_TRUE(q.pop_for(s, std::chrono::seconds(10)));
+	ASSERT_EQ(s, "c");
+	t.join();
+}
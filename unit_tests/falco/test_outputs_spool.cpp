@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <falco/outputs_spool.h>
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+static falco::outputs::message make_msg(const std::string& rule)
+{
+	falco::outputs::message msg;
+	msg.ts = 1;
+	msg.priority = falco_common::PRIORITY_WARNING;
+	msg.rule = rule;
+	msg.source = "syscall";
+	msg.msg = "some output for " + rule;
+	msg.fields = nlohmann::json::object();
+	msg.fields["proc.name"] = "cat";
+	msg.tags = {"tag"};
+	return msg;
+}
+
+static std::vector<std::string> drain(falco::outputs::spool& s, size_t sink)
+{
+	std::vector<std::string> res;
+	falco::outputs::message msg;
+	while(s.peek(sink, msg))
+	{
+		res.push_back(msg.rule);
+		s.ack(sink);
+	}
+	return res;
+}
+
+class OutputsSpool : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		m_config.enabled = true;
+		m_config.directory = (std::filesystem::temp_directory_path() / ("falco_spool_test_" + std::to_string(getpid()))).string();
+		m_config.segment_size = 256;
+		m_config.max_size = 1024 * 1024;
+		std::filesystem::remove_all(m_config.directory);
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(m_config.directory);
+	}
+
+	falco::outputs::spool_config m_config;
+};
+
+TEST_F(OutputsSpool, independent_sinks)
+{
+	falco::outputs::spool s(m_config, {"a", "b"});
+	ASSERT_TRUE(s.empty());
+	for(int i = 0; i < 10; i++)
+	{
+		ASSERT_EQ(s.append(make_msg("r" + std::to_string(i))), 0);
+	}
+	ASSERT_FALSE(s.empty());
+
+	auto all = drain(s, 0);
+	ASSERT_EQ(all.size(), 10);
+	ASSERT_EQ(all.front(), "r0");
+	ASSERT_EQ(all.back(), "r9");
+	ASSERT_FALSE(s.pending(0));
+	ASSERT_TRUE(s.pending(1));
+	ASSERT_FALSE(s.empty());
+
+	// a message is delivered again until acknowledged
+	falco::outputs::message msg;
+	ASSERT_TRUE(s.peek(1, msg));
+	ASSERT_TRUE(s.peek(1, msg));
+	ASSERT_EQ(msg.rule, "r0");
+	ASSERT_EQ(msg.fields["proc.name"], "cat");
+	ASSERT_EQ(msg.tags->count("tag"), 1);
+	ASSERT_EQ(drain(s, 1), all);
+	ASSERT_TRUE(s.empty());
+}
+
+TEST_F(OutputsSpool, replay_after_restart)
+{
+	{
+		falco::outputs::spool s(m_config, {"a", "b"});
+		for(int i = 0; i < 10; i++)
+		{
+			s.append(make_msg("r" + std::to_string(i)));
+		}
+		drain(s, 0);
+		falco::outputs::message msg;
+		for(int i = 0; i < 4; i++)
+		{
+			ASSERT_TRUE(s.peek(1, msg));
+			s.ack(1);
+		}
+	}
+
+	falco::outputs::spool s(m_config, {"a", "b"});
+	ASSERT_FALSE(s.pending(0));
+	auto rest = drain(s, 1);
+	ASSERT_EQ(rest.size(), 6);
+	ASSERT_EQ(rest.front(), "r4");
+	ASSERT_TRUE(s.empty());
+
+	s.append(make_msg("new"));
+	ASSERT_EQ(drain(s, 0), std::vector<std::string>{"new"});
+}
+
+TEST_F(OutputsSpool, max_size)
+{
+	m_config.max_size = 1024;
+	falco::outputs::spool s(m_config, {"a"});
+	uint64_t discarded = 0;
+	for(int i = 0; i < 100; i++)
+	{
+		discarded += s.append(make_msg("r" + std::to_string(i)));
+	}
+	ASSERT_GT(discarded, 0);
+
+	// the oldest messages are the ones discarded
+	auto left = drain(s, 0);
+	ASSERT_EQ(left.size() + discarded, 100);
+	ASSERT_EQ(left.back(), "r99");
+	ASSERT_EQ(left.front(), "r" + std::to_string(discarded));
+}
+
+TEST_F(OutputsSpool, buffered_appends)
+{
+	falco::outputs::spool s(m_config, {"a"});
+	auto disk_size = [this]()
+	{
+		uint64_t res = 0;
+		for(const auto& entry : std::filesystem::directory_iterator(m_config.directory))
+		{
+			if(entry.path().filename().string().rfind("segment.", 0) == 0)
+			{
+				res += entry.file_size();
+			}
+		}
+		return res;
+	};
+
+	// appended messages are written to disk by the reader
+	s.append(make_msg("r0"));
+	ASSERT_EQ(disk_size(), 0);
+	ASSERT_TRUE(s.pending(0));
+	ASSERT_FALSE(s.empty());
+	ASSERT_EQ(drain(s, 0), std::vector<std::string>{"r0"});
+	ASSERT_GT(disk_size(), 0);
+
+	s.append(make_msg("r1"));
+	s.sync();
+	ASSERT_EQ(drain(s, 0), std::vector<std::string>{"r1"});
+}
@@ -0,0 +1,250 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <falco/outputs_syslog.h>
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static falco::outputs::message make_msg(const std::string& rule, const std::string& output)
+{
+	falco::outputs::message msg;
+	msg.ts = 1700000000123456789;
+	msg.priority = falco_common::PRIORITY_WARNING;
+	msg.rule = rule;
+	msg.source = "syscall";
+	msg.msg = output;
+	msg.fields = nlohmann::json::object();
+	msg.fields["proc.name"] = "cat";
+	msg.fields["proc.aname[2]"] = "a\"b]";
+	msg.tags = {"t1", "t2"};
+	return msg;
+}
+
+static falco::outputs::config make_config(const std::string& endpoint, size_t batch_size, size_t backlog_size)
+{
+	falco::outputs::config oc;
+	oc.name = "syslog";
+	oc.options["endpoint"] = endpoint;
+	oc.options["facility"] = "local0";
+	oc.options["batch_size"] = std::to_string(batch_size);
+	oc.options["backlog_size"] = std::to_string(backlog_size);
+	return oc;
+}
+
+static std::string recv_all(int fd)
+{
+	char buf[4096];
+	ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+	return n > 0 ? std::string(buf, n) : "";
+}
+
+TEST(OutputSyslog, unix_dgram_frames)
+{
+	auto path = (std::filesystem::temp_directory_path() / ("falco_syslog_test_" + std::to_string(getpid()))).string();
+	unlink(path.c_str());
+	int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	ASSERT_GE(fd, 0);
+	struct sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+	ASSERT_EQ(bind(fd, (sockaddr*) &addr, sizeof(addr)), 0);
+
+	falco::outputs::output_syslog o;
+	falco::outputs::abstract_output& ao = o;
+	std::string err;
+	ASSERT_TRUE(ao.init(make_config("unix://" + path, 2, 3), false, "host", false, err)) << err;
+
+	// messages are sent when the batch is full or on flush
+	auto msg = make_msg("r1", "some output");
+	ao.output(&msg);
+	ASSERT_EQ(o.get_backlog(), 1);
+	ASSERT_EQ(recv_all(fd), "");
+	msg.rule = "r2";
+	ao.output(&msg);
+	ASSERT_EQ(o.get_backlog(), 0);
+
+	auto frame = recv_all(fd);
+	auto pid = std::to_string(getpid());
+	ASSERT_EQ(frame, "<132>1 2023-11-14T22:13:20.123456Z host falco " + pid + " - "
+		"[falco@32473 rule=\"r1\" source=\"syscall\" priority=\"Warning\" tags=\"t1,t2\"]"
+		"[fields@32473 proc.aname[2_=\"a\\\"b\\]\" proc.name=\"cat\"] some output");
+	ASSERT_NE(recv_all(fd).find("rule=\"r2\""), std::string::npos);
+
+	msg.rule = "r3";
+	ao.output(&msg);
+	ao.flush();
+	ASSERT_NE(recv_all(fd).find("rule=\"r3\""), std::string::npos);
+	ASSERT_EQ(o.get_num_drops(), 0);
+
+	// without a reader, the messages accepted before noticing it are kept
+	// in the backlog, then the next ones are refused until reconnected
+	close(fd);
+	unlink(path.c_str());
+	ASSERT_NO_THROW(ao.output(&msg));
+	ASSERT_NO_THROW(ao.output(&msg));
+	for(int i = 0; i < 3; i++)
+	{
+		ASSERT_THROW(ao.output(&msg), falco_exception);
+	}
+	ASSERT_EQ(o.get_backlog(), 2);
+	ASSERT_EQ(o.get_num_drops(), 3);
+}
+
+TEST(OutputSyslog, unsendable_frames_are_dropped)
+{
+	auto path = (std::filesystem::temp_directory_path() / ("falco_syslog_test_" + std::to_string(getpid()))).string();
+	unlink(path.c_str());
+	int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	ASSERT_GE(fd, 0);
+	struct sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+	ASSERT_EQ(bind(fd, (sockaddr*) &addr, sizeof(addr)), 0);
+
+	falco::outputs::output_syslog o;
+	falco::outputs::abstract_output& ao = o;
+	std::string err;
+	ASSERT_TRUE(ao.init(make_config("unix://" + path, 2, 10), false, "host", false, err)) << err;
+
+	// a frame too large for a datagram fails with EMSGSIZE, and it
+	// must not stay at the head of the backlog
+	auto big = make_msg("big", std::string(16 * 1024 * 1024, 'x'));
+	auto msg = make_msg("r1", "some output");
+	ao.output(&big);
+	ao.output(&msg);
+	ASSERT_EQ(o.get_backlog(), 0);
+	ASSERT_EQ(o.get_num_drops(), 1);
+	ASSERT_NE(recv_all(fd).find("rule=\"r1\""), std::string::npos);
+
+	close(fd);
+	unlink(path.c_str());
+}
+
+TEST(OutputSyslog, full_backlog_is_refused)
+{
+	auto path = (std::filesystem::temp_directory_path() / ("falco_syslog_test_" + std::to_string(getpid()))).string();
+	unlink(path.c_str());
+	int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	ASSERT_GE(fd, 0);
+	struct sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+	ASSERT_EQ(bind(fd, (sockaddr*) &addr, sizeof(addr)), 0);
+
+	falco::outputs::output_syslog o;
+	falco::outputs::abstract_output& ao = o;
+	std::string err;
+	ASSERT_TRUE(ao.init(make_config("unix://" + path, 1, 4), false, "host", false, err)) << err;
+
+	// the reader never reads, so the frames pile up in the backlog once
+	// its socket queue is full, and are refused once the backlog is full
+	auto msg = make_msg("r1", "some output");
+	bool refused = false;
+	for(int i = 0; i < 100000 && !refused; i++)
+	{
+		try
+		{
+			ao.output(&msg);
+		}
+		catch(const falco_exception&)
+		{
+			refused = true;
+		}
+	}
+	ASSERT_TRUE(refused);
+	ASSERT_EQ(o.get_backlog(), 4);
+	ASSERT_EQ(o.get_num_drops(), 1);
+
+	close(fd);
+	unlink(path.c_str());
+}
+
+TEST(OutputSyslog, tcp_octet_counting)
+{
+	int srv = socket(AF_INET, SOCK_STREAM, 0);
+	ASSERT_GE(srv, 0);
+	struct sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	ASSERT_EQ(bind(srv, (sockaddr*) &addr, sizeof(addr)), 0);
+	socklen_t len = sizeof(addr);
+	ASSERT_EQ(getsockname(srv, (sockaddr*) &addr, &len), 0);
+	ASSERT_EQ(listen(srv, 1), 0);
+
+	falco::outputs::output_syslog o;
+	falco::outputs::abstract_output& ao = o;
+	std::string err;
+	auto endpoint = "tcp://127.0.0.1:" + std::to_string(ntohs(addr.sin_port));
+	ASSERT_TRUE(ao.init(make_config(endpoint, 8, 100), false, "", false, err)) << err;
+	int fd = accept(srv, nullptr, nullptr);
+	ASSERT_GE(fd, 0);
+
+	auto msg = make_msg("r1", "first");
+	ao.output(&msg);
+	msg.msg = "second";
+	ao.output(&msg);
+	ao.flush();
+	ASSERT_EQ(o.get_backlog(), 0);
+
+	std::string data;
+	while(data.find("second") == std::string::npos)
+	{
+		char buf[4096];
+		ssize_t n = recv(fd, buf, sizeof(buf), 0);
+		ASSERT_GT(n, 0);
+		data.append(buf, n);
+	}
+
+	// each frame is prefixed by its length
+	std::vector<std::string> frames;
+	size_t pos = 0;
+	while(pos < data.size())
+	{
+		auto sp = data.find(' ', pos);
+		ASSERT_NE(sp, std::string::npos);
+		size_t flen = std::stoul(data.substr(pos, sp - pos));
+		frames.push_back(data.substr(sp + 1, flen));
+		pos = sp + 1 + flen;
+	}
+	ASSERT_EQ(pos, data.size());
+	ASSERT_EQ(frames.size(), 2);
+	ASSERT_EQ(frames[0].find("<132>1 2023-11-14T22:13:20.123456Z - falco "), 0);
+	ASSERT_EQ(frames[0].substr(frames[0].size() - 6), " first");
+	ASSERT_EQ(frames[1].substr(frames[1].size() - 7), " second");
+
+	close(fd);
+	close(srv);
+}
+
+TEST(OutputSyslog, invalid_endpoint)
+{
+	falco::outputs::output_syslog o;
+	falco::outputs::abstract_output& ao = o;
+	std::string err;
+	ASSERT_FALSE(ao.init(make_config("http://localhost:514", 8, 100), false, "", false, err));
+	ASSERT_FALSE(err.empty());
+
+	auto oc = make_config("udp://localhost:514", 8, 100);
+	oc.options["facility"] = "nope";
+	ASSERT_FALSE(ao.init(oc, false, "", false, err));
+}
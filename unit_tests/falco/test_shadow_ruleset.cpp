@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "../test_falco_engine.h"
+
+#include <falco/shadow_ruleset.h>
+
+static std::string s_active_rules = R"END(
+- rule: rule A
+  desc: A rule only in the active ruleset
+  condition: evt.type=execve
+  output: rule A matched
+  priority: INFO
+
+- rule: rule B
+  desc: A rule in both rulesets
+  condition: evt.type=open
+  output: rule B matched
+  priority: INFO
+)END";
+
+static std::string s_shadow_rules = R"END(
+- macro: shadow_macro
+  condition: evt.type in (open, openat)
+
+- rule: rule B
+  desc: A new version of the rule
+  condition: shadow_macro
+  output: rule B matched
+  priority: INFO
+
+- rule: rule C
+  desc: A rule only in the shadow ruleset
+  condition: evt.type=chmod
+  output: rule C matched
+  priority: INFO
+)END";
+
+TEST_F(test_falco_engine, shadow_ruleset_rules_by_name)
+{
+	ASSERT_TRUE(load_rules(s_active_rules, "active.yaml"));
+
+	auto shadow = std::make_shared<falco_engine>();
+	shadow->add_source(m_sample_source, m_filter_factory, m_formatter_factory);
+	auto res = shadow->load_rules(s_shadow_rules, "shadow.yaml");
+	ASSERT_TRUE(res->successful());
+
+	shadow_ruleset sr(m_engine, shadow, 1, 10);
+	EXPECT_EQ(sr.num_sampled(), 0u);
+
+	auto stats = sr.get_rule_stats();
+	ASSERT_EQ(stats.size(), 3u);
+	EXPECT_EQ(stats[0].name, "rule A");
+	EXPECT_TRUE(stats[0].active.defined);
+	EXPECT_FALSE(stats[0].shadow.defined);
+	EXPECT_EQ(stats[1].name, "rule B");
+	EXPECT_TRUE(stats[1].active.defined);
+	EXPECT_TRUE(stats[1].shadow.defined);
+	EXPECT_EQ(stats[2].name, "rule C");
+	EXPECT_FALSE(stats[2].active.defined);
+	EXPECT_TRUE(stats[2].shadow.defined);
+	for (const auto& rule : stats)
+	{
+		EXPECT_EQ(rule.source, m_sample_source);
+		EXPECT_EQ(rule.active.evaluations + rule.shadow.evaluations, 0u);
+		EXPECT_EQ(rule.active.matches + rule.shadow.matches, 0u);
+		EXPECT_EQ(rule.active.cost_ns + rule.shadow.cost_ns, 0u);
+	}
+}
+
+TEST_F(test_falco_engine, shadow_ruleset_sampling)
+{
+	ASSERT_TRUE(load_rules(s_active_rules, "active.yaml"));
+
+	// each source is sampled independently
+	shadow_ruleset sr(m_engine, m_engine, 2, 3);
+	EXPECT_EQ(sr.sampling_ratio(), 3u);
+	std::vector<bool> sampled;
+	for (int i = 0; i < 6; i++)
+	{
+		sampled.push_back(sr.sample(0));
+		if (i < 2)
+		{
+			EXPECT_FALSE(sr.sample(1));
+		}
+	}
+	EXPECT_EQ(sampled, std::vector<bool>({false, false, true, false, false, true}));
+	EXPECT_TRUE(sr.sample(1));
+
+	// all the events are sampled with a ratio of 1, or 0
+	shadow_ruleset all(m_engine, m_engine, 1, 0);
+	EXPECT_EQ(all.sampling_ratio(), 1u);
+	EXPECT_TRUE(all.sample(0));
+	EXPECT_TRUE(all.sample(0));
+}
+
+TEST_F(test_falco_engine, shadow_ruleset_evaluate)
+{
+	ASSERT_TRUE(load_rules(s_active_rules, "active.yaml"));
+
+	auto shadow = std::make_shared<falco_engine>();
+	shadow->add_source(m_sample_source, m_filter_factory, m_formatter_factory);
+	auto res = shadow->load_rules(s_shadow_rules, "shadow.yaml");
+	ASSERT_TRUE(res->successful());
+	shadow->complete_rule_loading();
+
+	scap_evt hdr = {};
+	hdr.ts = 1;
+	hdr.tid = 1;
+	hdr.len = sizeof(scap_evt);
+	hdr.type = PPME_SYSCALL_OPEN_E;
+	hdr.nparams = 0;
+	sinsp_evt evt;
+	evt.set_inspector(&m_inspector);
+	evt.set_scap_evt(&hdr);
+	evt.set_info(&scap_get_event_info_table()[PPME_SYSCALL_OPEN_E]);
+	evt.set_num(42);
+
+	shadow_ruleset sr(m_engine, shadow, 1, 1);
+	sr.evaluate(0, &evt);
+	sr.evaluate(0, &evt);
+	EXPECT_EQ(sr.num_sampled(), 2u);
+
+	// the event is evaluated with cold caches, but keeps its number
+	EXPECT_EQ(evt.get_num(), 42u);
+
+	// rule B is the only candidate for the event in both rulesets
+	auto stats = sr.get_rule_stats();
+	ASSERT_EQ(stats.size(), 3u);
+	EXPECT_EQ(stats[1].name, "rule B");
+	EXPECT_EQ(stats[1].active.evaluations, 2u);
+	EXPECT_EQ(stats[1].active.matches, 2u);
+	EXPECT_EQ(stats[1].shadow.evaluations, 2u);
+	EXPECT_EQ(stats[1].shadow.matches, 2u);
+	EXPECT_EQ(stats[0].active.evaluations, 0u);
+	EXPECT_EQ(stats[2].shadow.evaluations, 0u);
+}
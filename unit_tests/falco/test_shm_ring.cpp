@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <falco/shm_ring.h>
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+
+class ShmRing : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		m_path = (std::filesystem::temp_directory_path() / ("falco_shm_ring_test_" + std::to_string(getpid()))).string();
+	}
+
+	void TearDown() override
+	{
+		unlink(m_path.c_str());
+	}
+
+	std::string m_path;
+};
+
+TEST_F(ShmRing, write_read)
+{
+	falco::shm_ring::producer p(m_path, 4096);
+	falco::shm_ring::consumer c(m_path);
+	falco::shm_ring::alert a;
+
+	ASSERT_FALSE(c.next(a, std::chrono::milliseconds(1)));
+	ASSERT_TRUE(p.write(42, 4, "rule", "syscall", "some output"));
+	ASSERT_TRUE(c.next(a, std::chrono::milliseconds(1)));
+	ASSERT_EQ(a.ts, 42);
+	ASSERT_EQ(a.priority, 4);
+	ASSERT_EQ(a.rule, "rule");
+	ASSERT_EQ(a.source, "syscall");
+	ASSERT_EQ(a.msg, "some output");
+
+	// the alert is returned again until released
+	ASSERT_TRUE(c.next(a, std::chrono::milliseconds(1)));
+	ASSERT_EQ(a.ts, 42);
+	c.release();
+	ASSERT_FALSE(c.next(a, std::chrono::milliseconds(1)));
+}
+
+TEST_F(ShmRing, full_and_wrap_around)
+{
+	falco::shm_ring::producer p(m_path, 4096);
+	falco::shm_ring::consumer c(m_path);
+	falco::shm_ring::alert a;
+	std::string msg(1000, 'x');
+
+	// each record takes 1040 bytes, so only 3 fit in the ring
+	uint64_t written = 0;
+	while(p.write(written, 0, "r", "s", msg))
+	{
+		written++;
+	}
+	ASSERT_EQ(written, 3);
+	ASSERT_EQ(p.num_drops(), 1);
+	ASSERT_EQ(c.num_drops(), 1);
+
+	// records never wrap around the end of the ring
+	for(uint64_t i = 0; i < 100; i++)
+	{
+		ASSERT_TRUE(c.next(a, std::chrono::milliseconds(1)));
+		ASSERT_EQ(a.ts, i);
+		ASSERT_EQ(a.msg, msg);
+		c.release();
+		ASSERT_TRUE(p.write(written++, 0, "r", "s", msg));
+	}
+}
+
+TEST_F(ShmRing, cross_process)
+{
+	const uint64_t num_alerts = 100000;
+	falco::shm_ring::producer p(m_path, 64 * 1024);
+
+	pid_t pid = fork();
+	ASSERT_GE(pid, 0);
+	if(pid == 0)
+	{
+		// the consumer checks that it receives all the alerts in order
+		falco::shm_ring::consumer c(m_path);
+		falco::shm_ring::alert a;
+		for(uint64_t i = 0; i < num_alerts; i++)
+		{
+			if(!c.next(a, std::chrono::seconds(10)) || a.ts != i || a.msg != std::to_string(i))
+			{
+				_exit(1);
+			}
+			c.release();
+		}
+		_exit(0);
+	}
+
+	for(uint64_t i = 0; i < num_alerts; i++)
+	{
+		while(!p.write(i, 0, "rule", "syscall", std::to_string(i)))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	int status;
+	ASSERT_EQ(waitpid(pid, &status, 0), pid);
+	ASSERT_TRUE(WIFEXITED(status));
+	ASSERT_EQ(WEXITSTATUS(status), 0);
+}
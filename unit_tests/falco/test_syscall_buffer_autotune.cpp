@@ -0,0 +1,177 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <falco/syscall_buffer_autotune.h>
+
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+using autotune = syscall_buffer_autotune;
+
+static syscall_buffer_autotune_config make_config()
+{
+	syscall_buffer_autotune_config c;
+	c.enabled = true;
+	c.min_preset = 2;
+	c.max_preset = 6;
+	c.grow_drop_ratio = 0;
+	c.max_lag_ns = 100 * 1000000ULL;
+	c.shrink_after_runs = 2;
+	c.min_run_seconds = 10;
+	return c;
+}
+
+static autotune::observation clean_run(uint64_t seconds)
+{
+	autotune::observation obs;
+	obs.seconds = seconds;
+	obs.n_evts = 1000 * seconds;
+	return obs;
+}
+
+TEST(SyscallBufferAutotune, grow_on_drops)
+{
+	auto c = make_config();
+	autotune::profile_state state;
+	state.preset = 4;
+	state.min_safe_preset = 2;
+
+	auto obs = clean_run(1);
+	obs.drop_seconds = 1;
+	auto next = autotune::recommend(c, state, 4, obs, false);
+	ASSERT_EQ(next.preset, 5);
+	ASSERT_EQ(next.min_safe_preset, 5);
+	ASSERT_EQ(next.last_decision, autotune::decision::GROW);
+	ASSERT_EQ(next.runs, 0u);
+
+	// growing only happens once per run
+	next = autotune::recommend(c, next, 4, obs, true);
+	ASSERT_EQ(next.preset, 5);
+	ASSERT_EQ(next.runs, 1u);
+
+	// never above the max preset
+	state.preset = 6;
+	next = autotune::recommend(c, state, 6, obs, true);
+	ASSERT_EQ(next.preset, 6);
+	ASSERT_EQ(next.last_decision, autotune::decision::KEEP);
+}
+
+TEST(SyscallBufferAutotune, shrink_after_clean_runs)
+{
+	auto c = make_config();
+	autotune::profile_state state;
+	state.preset = 4;
+	state.min_safe_preset = 2;
+
+	// short runs and unfinished runs don't count
+	auto next = autotune::recommend(c, state, 4, clean_run(5), true);
+	ASSERT_EQ(next.clean_runs, 0u);
+	next = autotune::recommend(c, next, 4, clean_run(20), false);
+	ASSERT_EQ(next.clean_runs, 0u);
+
+	next = autotune::recommend(c, next, 4, clean_run(20), true);
+	ASSERT_EQ(next.clean_runs, 1u);
+	ASSERT_EQ(next.preset, 4);
+	next = autotune::recommend(c, next, 4, clean_run(20), true);
+	ASSERT_EQ(next.preset, 3);
+	ASSERT_EQ(next.clean_runs, 0u);
+	ASSERT_EQ(next.last_decision, autotune::decision::SHRINK);
+
+	// a lagging consumer resets the count
+	state.clean_runs = 1;
+	auto obs = clean_run(20);
+	obs.max_lag_ns = 200 * 1000000ULL;
+	next = autotune::recommend(c, state, 4, obs, true);
+	ASSERT_EQ(next.preset, 4);
+	ASSERT_EQ(next.clean_runs, 0u);
+}
+
+TEST(SyscallBufferAutotune, never_shrink_to_a_preset_that_dropped)
+{
+	auto c = make_config();
+	autotune::profile_state state;
+	state.preset = 5;
+	state.min_safe_preset = 5;
+	state.clean_runs = 1;
+
+	auto next = autotune::recommend(c, state, 5, clean_run(20), true);
+	ASSERT_EQ(next.preset, 5);
+	ASSERT_EQ(next.last_decision, autotune::decision::KEEP);
+
+	state.min_safe_preset = 2;
+	state.preset = 2;
+	next = autotune::recommend(c, state, 2, clean_run(20), true);
+	ASSERT_EQ(next.preset, 2);
+}
+
+TEST(SyscallBufferAutotune, persist_across_runs)
+{
+	auto c = make_config();
+	c.state_file = (std::filesystem::temp_directory_path() / ("falco_autotune_test_" + std::to_string(getpid())) / "state.json").string();
+	std::filesystem::remove_all(std::filesystem::path(c.state_file).parent_path());
+
+	// no recommendation yet, the configured preset is used
+	{
+		autotune at(c, "kmod/test");
+		ASSERT_EQ(at.select_preset(4), 4);
+		at.observe(1000, 0, 0);
+		ASSERT_EQ(at.recommended_preset(), 4);
+		ASSERT_FALSE(std::filesystem::exists(c.state_file));
+
+		// drops are persisted right away
+		at.observe(1000, 10, 0);
+		ASSERT_EQ(at.drop_seconds(), 1u);
+		ASSERT_EQ(at.recommended_preset(), 5);
+		ASSERT_EQ(at.last_decision(), autotune::decision::GROW);
+		ASSERT_TRUE(std::filesystem::exists(c.state_file));
+		at.complete_run();
+	}
+
+	// profiles don't share their recommendations
+	{
+		autotune at(c, "kmod/other");
+		ASSERT_EQ(at.select_preset(3), 3);
+		at.complete_run();
+	}
+
+	{
+		autotune at(c, "kmod/test");
+		ASSERT_EQ(at.select_preset(4), 5);
+		ASSERT_EQ(at.preset(), 5);
+	}
+
+	std::ifstream in(c.state_file);
+	auto j = nlohmann::json::parse(in);
+	ASSERT_EQ(j["profiles"]["kmod/test"]["preset"], 5);
+	ASSERT_EQ(j["profiles"]["kmod/test"]["min_safe_preset"], 5);
+	ASSERT_EQ(j["profiles"]["kmod/test"]["runs"], 1);
+	ASSERT_EQ(j["profiles"]["kmod/other"]["preset"], 3);
+
+	std::filesystem::remove_all(std::filesystem::path(c.state_file).parent_path());
+}
+
+TEST(SyscallBufferAutotune, host_profile)
+{
+	auto p = autotune::host_profile("modern_ebpf", 2);
+	ASSERT_EQ(p.rfind("modern_ebpf/cpus=", 0), 0u);
+	ASSERT_NE(p.find("/mem_gib="), std::string::npos);
+	ASSERT_NE(p.find("/cpus_for_each_buffer=2"), std::string::npos);
+	ASSERT_EQ(autotune::host_profile("kmod").find("cpus_for_each_buffer"), std::string::npos);
+}
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <falco/thread_affinity.h>
+
+#include <gtest/gtest.h>
+
+using namespace falco::threads;
+
+TEST(ThreadAffinity, parse_cpu_list)
+{
+	cpu_set cpus;
+	std::string err;
+
+	ASSERT_TRUE(parse_cpu_list("0-3,8,10-11", cpus, err)) << err;
+	ASSERT_EQ(cpus, cpu_set({0, 1, 2, 3, 8, 10, 11}));
+
+	ASSERT_TRUE(parse_cpu_list(" 5 , 2-2 ", cpus, err)) << err;
+	ASSERT_EQ(cpus, cpu_set({2, 5}));
+
+	// empty items are skipped, as in the cpulist of CPU-less NUMA nodes
+	ASSERT_TRUE(parse_cpu_list("", cpus, err)) << err;
+	ASSERT_TRUE(cpus.empty());
+	ASSERT_TRUE(parse_cpu_list("1,,2\n", cpus, err)) << err;
+	ASSERT_EQ(cpus, cpu_set({1, 2}));
+
+	ASSERT_FALSE(parse_cpu_list("3-1", cpus, err));
+	ASSERT_FALSE(parse_cpu_list("a-b", cpus, err));
+	ASSERT_FALSE(parse_cpu_list("-1", cpus, err));
+	ASSERT_FALSE(err.empty());
+}
+
+TEST(ThreadAffinity, to_cpu_list)
+{
+	ASSERT_EQ(to_cpu_list({}), "");
+	ASSERT_EQ(to_cpu_list({4}), "4");
+	ASSERT_EQ(to_cpu_list({0, 1, 2, 3, 8, 10, 11}), "0-3,8,10-11");
+
+	cpu_set cpus;
+	std::string err;
+	ASSERT_TRUE(parse_cpu_list(to_cpu_list({1, 3, 4, 5, 9}), cpus, err)) << err;
+	ASSERT_EQ(cpus, cpu_set({1, 3, 4, 5, 9}));
+}
+
+TEST(ThreadAffinity, ring_buffers_numa_cpus)
+{
+	std::map<uint32_t, cpu_set> nodes = {
+		{0, {0, 1, 2, 3}},
+		{1, {4, 5, 6, 7}},
+	};
+
+	// one buffer per CPU, two online CPUs on node 0 and three on node 1
+	ASSERT_EQ(ring_buffers_numa_cpus(nodes, {0, 1, 4, 5, 6}, 1), cpu_set({4, 5, 6}));
+
+	// buffers owned by CPUs 0, 2 and 4
+	ASSERT_EQ(ring_buffers_numa_cpus(nodes, {0, 1, 2, 3, 4, 5}, 2), cpu_set({0, 1, 2, 3}));
+
+	// a single buffer shared by all the CPUs
+	ASSERT_EQ(ring_buffers_numa_cpus(nodes, {2, 3, 4, 5, 6, 7}, 0), cpu_set({2, 3}));
+
+	// ties go to the lowest node
+	ASSERT_EQ(ring_buffers_numa_cpus(nodes, {0, 4}, 1), cpu_set({0}));
+
+	// unknown topology
+	ASSERT_EQ(ring_buffers_numa_cpus({}, {0, 1}, 1), cpu_set({0, 1}));
+}
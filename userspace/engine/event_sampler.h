@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*!
+	\brief Decides which events to drop when the engine samples events.
+	Each instance holds its own xorshift64* generator, so that no state
+	is shared between the threads processing events of different
+	sources, and its sequence is fully determined by its seed.
+	In stratified mode, the first events of each event type seen within
+	each window are always kept and only the remaining ones are subject
+	to sampling, so that rare event types are preserved while the most
+	frequent ones get thinned.
+	This class is not thread-safe.
+*/
+class event_sampler
+{
+public:
+	enum class mode
+	{
+		UNIFORM = 0,
+		STRATIFIED = 1,
+	};
+
+	explicit event_sampler(uint64_t seed = 1)
+	{
+		set_seed(seed);
+	}
+
+	/*!
+		\brief Resets the generator with the given seed. The same seed
+		always produces the same sequence of decisions.
+	*/
+	inline void set_seed(uint64_t seed)
+	{
+		// splitmix64 scrambling, so that close seeds produce unrelated
+		// sequences and the xorshift state is never zero
+		uint64_t z = seed + 0x9e3779b97f4a7c15ULL;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		z = z ^ (z >> 31);
+		m_state = z != 0 ? z : 0x9e3779b97f4a7c15ULL;
+		reset_window();
+	}
+
+	/*!
+		\brief Sets the sampling mode. In stratified mode, up to
+		min_evts_per_type events of each type are kept for every
+		window_evts events seen.
+	*/
+	inline void set_mode(mode m, uint32_t min_evts_per_type, uint64_t window_evts)
+	{
+		m_mode = m;
+		m_min_evts_per_type = min_evts_per_type;
+		m_window_evts = window_evts;
+		reset_window();
+	}
+
+	inline mode get_mode() const
+	{
+		return m_mode;
+	}
+
+	/*!
+		\brief Returns a uniformly distributed value in [0, 1)
+	*/
+	inline double next_double()
+	{
+		m_state ^= m_state >> 12;
+		m_state ^= m_state << 25;
+		m_state ^= m_state >> 27;
+		return ((m_state * 0x2545f4914f6cdd1dULL) >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	/*!
+		\brief Returns true if an event of the given type should be
+		dropped, given the probability of keeping a sampled event.
+	*/
+	inline bool should_drop(uint16_t etype, double keep_probability)
+	{
+		if(m_mode == mode::STRATIFIED)
+		{
+			if(++m_window_count > m_window_evts)
+			{
+				reset_window();
+				m_window_count = 1;
+			}
+			if(etype >= m_type_counts.size())
+			{
+				m_type_counts.resize(etype + 1, 0);
+			}
+			if(m_type_counts[etype] < m_min_evts_per_type)
+			{
+				m_type_counts[etype]++;
+				return false;
+			}
+		}
+		return next_double() >= keep_probability;
+	}
+
+private:
+	inline void reset_window()
+	{
+		m_window_count = 0;
+		m_type_counts.assign(m_type_counts.size(), 0);
+	}
+
+	uint64_t m_state = 0;
+	mode m_mode = mode::UNIFORM;
+	uint32_t m_min_evts_per_type = 0;
+	uint64_t m_window_evts = 0;
+	uint64_t m_window_count = 0;
+	std::vector<uint32_t> m_type_counts;
+};
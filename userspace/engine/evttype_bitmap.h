@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include <libsinsp/event.h>
+
+/*!
+	\brief A bitmap indexed by event type, that can be invalidated and
+	rebuilt by one thread while other threads read it. While invalid,
+	no event type is reported as missing. While rebuilding, readers see
+	either the previous or the new bit of each event type, and never a
+	cleared bitmap. Copies are not atomic.
+*/
+class evttype_bitmap
+{
+public:
+	evttype_bitmap() = default;
+
+	evttype_bitmap(const evttype_bitmap& b)
+	{
+		*this = b;
+	}
+
+	evttype_bitmap& operator = (const evttype_bitmap& b)
+	{
+		for(size_t i = 0; i < m_words.size(); i++)
+		{
+			m_words[i].store(b.m_words[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+		m_valid.store(b.m_valid.load(std::memory_order_acquire), std::memory_order_release);
+		return *this;
+	}
+
+	/*!
+		\brief Returns true if the bitmap is valid and the given event
+		type is not set in it
+	*/
+	inline bool missing(uint16_t etype) const
+	{
+		if(!m_valid.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		if(etype >= s_num_bits)
+		{
+			return true;
+		}
+		uint64_t word = m_words[etype / 64].load(std::memory_order_relaxed);
+		return (word & (1ULL << (etype % 64))) == 0;
+	}
+
+	/*!
+		\brief Marks the bitmap as outdated, until it's assigned again
+	*/
+	inline void invalidate()
+	{
+		m_valid.store(false, std::memory_order_release);
+	}
+
+	/*!
+		\brief Sets exactly the given event types, and marks the bitmap
+		as valid. Must not be called by multiple threads at once.
+	*/
+	template<typename Iterable>
+	inline void assign(const Iterable& etypes)
+	{
+		std::array<uint64_t, s_num_words> words = {};
+		for(const auto& e : etypes)
+		{
+			if((size_t) e < s_num_bits)
+			{
+				words[e / 64] |= 1ULL << (e % 64);
+			}
+		}
+		for(size_t i = 0; i < words.size(); i++)
+		{
+			m_words[i].store(words[i], std::memory_order_relaxed);
+		}
+		m_valid.store(true, std::memory_order_release);
+	}
+
+private:
+	static constexpr size_t s_num_bits = PPM_EVENT_MAX;
+	static constexpr size_t s_num_words = (s_num_bits + 63) / 64;
+
+	std::atomic<bool> m_valid = false;
+	std::array<std::atomic<uint64_t>, s_num_words> m_words = {};
+};
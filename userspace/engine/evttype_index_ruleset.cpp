@@ -20,10 +20,23 @@ limitations under the License.
 #include "logger.h"
 
 #include <algorithm>
+#include <chrono>
+#include <unordered_set>
+
+// with the adaptive backend, one evaluation of each rule out of
+// s_adaptive_sampling_period is profiled, and its operands are
+// reordered every s_adaptive_samples_per_update profiled evaluations
+static const uint32_t s_adaptive_sampling_period = 1024;
+static const uint32_t s_adaptive_samples_per_update = 256;
 
 evttype_index_ruleset::evttype_index_ruleset(
-	std::shared_ptr<sinsp_filter_factory> f):
-	m_filter_factory(f)
+	std::shared_ptr<sinsp_filter_factory> f,
+	falco_common::condition_backend backend):
+	m_filter_factory(f),
+	m_backend(backend),
+	m_pred_epoch(0),
+	m_dispatch_version(0),
+	m_dispatch_valid(false)
 {
 }
 
@@ -41,6 +54,15 @@ void evttype_index_ruleset::add(
 		auto wrap = std::make_shared<evttype_index_wrapper>();
 		wrap->m_rule = rule;
 		wrap->m_filter = filter;
+		wrap->m_condition = condition;
+		if(m_backend != falco_common::condition_backend::TREE && condition)
+		{
+			wrap->m_bytecode = std::make_shared<bytecode_filter>(m_filter_factory, condition.get(), filter_cache_factory(rule.source));
+			if(m_backend == falco_common::condition_backend::ADAPTIVE)
+			{
+				wrap->m_bytecode->set_adaptive(s_adaptive_sampling_period, s_adaptive_samples_per_update);
+			}
+		}
 		if(rule.source == falco_common::syscall_source)
 		{
 			wrap->m_sc_codes = libsinsp::filter::ast::ppm_sc_codes(condition.get());
@@ -61,16 +83,418 @@ void evttype_index_ruleset::add(
 	}
 }
 
+std::shared_ptr<sinsp_filter_cache_factory> evttype_index_ruleset::filter_cache_factory(const std::string& source)
+{
+	const auto& get = get_engine_state().get_filter_cache_factory;
+	return get ? get(source) : nullptr;
+}
+
 void evttype_index_ruleset::on_loading_complete()
 {
+	build_dispatch_tables();
 	print_enabled_rules_falco_logger();
 }
 
+void evttype_index_ruleset::build_shared_predicates()
+{
+	m_shared_preds.clear();
+	m_pred_refs.clear();
+	m_residuals.clear();
+	m_wrapper_preds.clear();
+
+	// collect the distinct rules enabled in any ruleset
+	std::vector<const evttype_index_wrapper*> enabled;
+	std::unordered_set<const evttype_index_wrapper*> seen;
+	auto collect = [&](const filter_wrapper_list &wrappers)
+	{
+		for(const auto &wrap : wrappers)
+		{
+			if(seen.insert(wrap.get()).second)
+			{
+				enabled.push_back(wrap.get());
+			}
+		}
+	};
+	for(size_t id = 0; id < num_rulesets(); id++)
+	{
+		for(const auto &wrappers : wrappers_by_event_type(id))
+		{
+			collect(wrappers);
+		}
+		collect(wrappers_all_event_types(id));
+	}
+
+	// count how many rules use each top-level conjunct, identified
+	// by its string representation after macro resolution
+	using conjunct = std::pair<std::string, libsinsp::filter::ast::expr*>;
+	std::unordered_map<const evttype_index_wrapper*, std::vector<conjunct>> conjuncts;
+	std::unordered_map<std::string, uint32_t> uses;
+	for(const auto *wrap : enabled)
+	{
+		auto and_expr = dynamic_cast<libsinsp::filter::ast::and_expr*>(wrap->m_condition.get());
+		if(!and_expr)
+		{
+			continue;
+		}
+
+		std::set<std::string> distinct;
+		for(const auto &child : and_expr->children)
+		{
+			auto str = libsinsp::filter::ast::as_string(child.get());
+			if(distinct.insert(str).second)
+			{
+				uses[str]++;
+				conjuncts[wrap].emplace_back(str, child.get());
+			}
+		}
+	}
+
+	// the shared conjuncts are compiled once, with the same caches as
+	// the rule filters, and each rule using any of them also gets
+	// its remaining conjuncts compiled as a residual filter, so that
+	// the shared ones are not evaluated again as part of its filter
+	std::unordered_map<std::string, uint32_t> pred_ids;
+	for(const auto *wrap : enabled)
+	{
+		auto &span = m_wrapper_preds[wrap];
+		span.preds_begin = m_pred_refs.size();
+		std::vector<libsinsp::filter::ast::expr*> residual;
+		for(const auto &c : conjuncts[wrap])
+		{
+			auto it = pred_ids.find(c.first);
+			if(it == pred_ids.end() && uses[c.first] >= 2)
+			{
+				try
+				{
+					sinsp_filter_compiler compiler(m_filter_factory, c.second, filter_cache_factory(wrap->m_rule.source));
+					m_shared_preds.emplace_back(compiler.compile());
+					it = pred_ids.emplace(c.first, m_shared_preds.size() - 1).first;
+				}
+				catch (const sinsp_exception&)
+				{
+					// the whole condition compiled with the same
+					// factory, but in case keep it in the residual
+				}
+			}
+
+			if(it == pred_ids.end())
+			{
+				residual.push_back(c.second);
+				continue;
+			}
+			m_pred_refs.push_back(it->second);
+		}
+
+		if(m_pred_refs.size() > span.preds_begin)
+		{
+			auto res = compile_residual(wrap, residual);
+			if(!res)
+			{
+				// fall back to the whole filter of the rule
+				m_pred_refs.resize(span.preds_begin);
+			}
+			else
+			{
+				span.residual = res.get();
+				m_residuals.push_back(std::move(res));
+			}
+		}
+		span.preds_end = m_pred_refs.size();
+	}
+
+	m_pred_epochs.assign(m_shared_preds.size(), 0);
+	m_pred_results.assign(m_shared_preds.size(), 0);
+	m_pred_epoch = 0;
+}
+
+std::unique_ptr<evttype_index_ruleset::residual_filter> evttype_index_ruleset::compile_residual(
+	const evttype_index_wrapper *wrap,
+	const std::vector<libsinsp::filter::ast::expr*> &conjuncts)
+{
+	auto res = std::make_unique<residual_filter>();
+	if(conjuncts.empty())
+	{
+		return res;
+	}
+
+	if(conjuncts.size() == 1)
+	{
+		res->condition = libsinsp::filter::ast::clone(conjuncts[0]);
+	}
+	else
+	{
+		std::vector<std::unique_ptr<libsinsp::filter::ast::expr>> children;
+		for(const auto *c : conjuncts)
+		{
+			children.push_back(libsinsp::filter::ast::clone(c));
+		}
+		res->condition = libsinsp::filter::ast::and_expr::create(children);
+	}
+
+	auto cache_factory = filter_cache_factory(wrap->m_rule.source);
+	try
+	{
+		if(m_backend != falco_common::condition_backend::TREE)
+		{
+			res->bytecode = std::make_shared<bytecode_filter>(m_filter_factory, res->condition.get(), cache_factory);
+			if(m_backend == falco_common::condition_backend::ADAPTIVE)
+			{
+				res->bytecode->set_adaptive(s_adaptive_sampling_period, s_adaptive_samples_per_update);
+			}
+		}
+		else
+		{
+			sinsp_filter_compiler compiler(m_filter_factory, res->condition.get(), cache_factory);
+			res->filter = std::shared_ptr<sinsp_filter>(compiler.compile());
+		}
+	}
+	catch (const sinsp_exception&)
+	{
+		return nullptr;
+	}
+	return res;
+}
+
+void evttype_index_ruleset::build_dispatch_tables()
+{
+	build_shared_predicates();
+
+	auto entry = [this](const std::shared_ptr<evttype_index_wrapper> &wrap, uint64_t rulesets)
+	{
+		const auto &span = m_wrapper_preds[wrap.get()];
+		return dispatch_entry{wrap.get(), &wrap->m_rule, span.preds_begin, span.preds_end, span.residual, rulesets, wrap->event_codes().empty()};
+	};
+
+	m_dispatch_tables.clear();
+	m_dispatch_tables.resize(num_rulesets());
+	for(size_t id = 0; id < num_rulesets(); id++)
+	{
+		auto &table = m_dispatch_tables[id];
+		uint64_t bit = id < 64 ? 1ULL << id : 0;
+		const auto &by_type = wrappers_by_event_type(id);
+		const auto &all_types = wrappers_all_event_types(id);
+
+		for(const auto &wrap : all_types)
+		{
+			table.entries.push_back(entry(wrap, bit));
+		}
+
+		// rules for all event types are evaluated after the ones
+		// specific to the event type, so we merge them at the end
+		// of each span. Note: every rule of this ruleset has at least
+		// one event code, so in practice no rule runs for all event types
+		table.offsets.reserve(by_type.size() + 1);
+		for(const auto &wrappers : by_type)
+		{
+			table.offsets.push_back(table.entries.size());
+			for(const auto &wrap : wrappers)
+			{
+				table.entries.push_back(entry(wrap, bit));
+			}
+			for(const auto &wrap : all_types)
+			{
+				table.entries.push_back(entry(wrap, bit));
+			}
+		}
+		table.offsets.push_back(table.entries.size());
+	}
+
+	// the union table merges, for each event type, the spans of all
+	// the rulesets that can be selected by a mask, in ruleset id order
+	size_t num_selectable = std::min<size_t>(num_rulesets(), 64);
+	size_t num_types = 0;
+	for(size_t id = 0; id < num_selectable; id++)
+	{
+		num_types = std::max(num_types, wrappers_by_event_type(id).size());
+	}
+
+	auto &table = m_union_table;
+	table = dispatch_table();
+	std::unordered_map<const evttype_index_wrapper*, size_t> positions;
+	auto merge = [&](const filter_wrapper_list &wrappers, uint64_t bit)
+	{
+		for(const auto &wrap : wrappers)
+		{
+			auto it = positions.find(wrap.get());
+			if(it == positions.end())
+			{
+				positions[wrap.get()] = table.entries.size();
+				table.entries.push_back(entry(wrap, bit));
+			}
+			else
+			{
+				table.entries[it->second].rulesets |= bit;
+			}
+		}
+	};
+
+	for(size_t id = 0; id < num_selectable; id++)
+	{
+		merge(wrappers_all_event_types(id), 1ULL << id);
+	}
+	table.offsets.reserve(num_types + 1);
+	for(size_t etype = 0; etype < num_types; etype++)
+	{
+		table.offsets.push_back(table.entries.size());
+		positions.clear();
+		for(size_t id = 0; id < num_selectable; id++)
+		{
+			const auto &by_type = wrappers_by_event_type(id);
+			if(etype < by_type.size())
+			{
+				merge(by_type[etype], 1ULL << id);
+			}
+		}
+		for(size_t id = 0; id < num_selectable; id++)
+		{
+			merge(wrappers_all_event_types(id), 1ULL << id);
+		}
+	}
+	table.offsets.push_back(table.entries.size());
+
+	m_dispatch_version = version();
+	m_dispatch_valid = true;
+}
+
+bool evttype_index_ruleset::run(sinsp_evt *evt, falco_rule &match, uint16_t ruleset_id)
+{
+	if(!m_dispatch_valid || m_dispatch_version != version())
+	{
+		return indexable_ruleset::run(evt, match, ruleset_id);
+	}
+
+	if(ruleset_id >= m_dispatch_tables.size())
+	{
+		return false;
+	}
+
+	// shared predicates are evaluated at most once per run
+	m_pred_epoch++;
+
+	FALCO_USDT3(ruleset_run, evt->get_ts(), evt->get_type(), ruleset_id);
+	auto span = m_dispatch_tables[ruleset_id].candidates(evt->get_type());
+	for(auto e = span.first; e != span.second; e++)
+	{
+		if(run_candidate(*e, evt))
+		{
+			match = *e->rule;
+			FALCO_USDT2(ruleset_run_done, evt->get_ts(), true);
+			return true;
+		}
+	}
+
+	FALCO_USDT2(ruleset_run_done, evt->get_ts(), false);
+	return false;
+}
+
+bool evttype_index_ruleset::run(sinsp_evt *evt, std::vector<falco_rule> &matches, uint16_t ruleset_id)
+{
+	if(!m_dispatch_valid || m_dispatch_version != version())
+	{
+		return indexable_ruleset::run(evt, matches, ruleset_id);
+	}
+
+	if(ruleset_id >= m_dispatch_tables.size())
+	{
+		return false;
+	}
+
+	bool match_found = false;
+	// shared predicates are evaluated at most once per run
+	m_pred_epoch++;
+
+	FALCO_USDT3(ruleset_run, evt->get_ts(), evt->get_type(), ruleset_id);
+	auto span = m_dispatch_tables[ruleset_id].candidates(evt->get_type());
+	for(auto e = span.first; e != span.second; e++)
+	{
+		// the rules for all event types come last, and only run if
+		// none of the ones specific to the event type matched
+		if(e->all_types && match_found)
+		{
+			break;
+		}
+		if(run_candidate(*e, evt))
+		{
+			matches.push_back(*e->rule);
+			match_found = true;
+		}
+	}
+
+	FALCO_USDT2(ruleset_run_done, evt->get_ts(), match_found);
+	return match_found;
+}
+
+bool evttype_index_ruleset::run_rulesets(sinsp_evt *evt, std::vector<std::pair<falco_rule, uint64_t>> &matches, uint64_t ruleset_mask)
+{
+	if(!m_dispatch_valid || m_dispatch_version != version())
+	{
+		return filter_ruleset::run_rulesets(evt, matches, ruleset_mask);
+	}
+
+	// shared predicates are evaluated at most once per run
+	m_pred_epoch++;
+
+	// each rule is evaluated once, no matter how many of the
+	// selected rulesets it's enabled in. The rules for all event types
+	// are skipped for the rulesets in which a rule specific to the
+	// event type already matched, as in run()
+	uint64_t matched_rulesets = 0;
+	bool match_found = false;
+	FALCO_USDT3(rulesets_run, evt->get_ts(), evt->get_type(), ruleset_mask);
+	auto span = m_union_table.candidates(evt->get_type());
+	for(auto e = span.first; e != span.second; e++)
+	{
+		uint64_t rulesets = e->rulesets & ruleset_mask;
+		if(e->all_types)
+		{
+			rulesets &= ~matched_rulesets;
+		}
+		if(rulesets != 0 && run_candidate(*e, evt))
+		{
+			matches.emplace_back(*e->rule, rulesets);
+			matched_rulesets |= rulesets;
+			match_found = true;
+		}
+	}
+
+	FALCO_USDT2(ruleset_run_done, evt->get_ts(), match_found);
+	return match_found;
+}
+
+void evttype_index_ruleset::run_profiled(sinsp_evt *evt, uint16_t ruleset_id, const profile_callback_t &on_rule)
+{
+	if(!m_dispatch_valid || m_dispatch_version != version())
+	{
+		return filter_ruleset::run_profiled(evt, ruleset_id, on_rule);
+	}
+
+	if(ruleset_id >= m_dispatch_tables.size())
+	{
+		return;
+	}
+
+	// the whole filter of each rule, rather than its shared predicates
+	// and residual, is profiled so that the cost of the predicates
+	// is accounted to every rule using them
+	auto span = m_dispatch_tables[ruleset_id].candidates(evt->get_type());
+	for(auto e = span.first; e != span.second; e++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		bool res = e->wrap->run(evt);
+		uint64_t cost_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count();
+		on_rule(*e->rule, res, cost_ns);
+	}
+}
+
 bool evttype_index_ruleset::run_wrappers(sinsp_evt *evt, filter_wrapper_list &wrappers, uint16_t ruleset_id, falco_rule &match)
 {
 	for(auto &wrap : wrappers)
 	{
-		if(wrap->m_filter->run(evt))
+		FALCO_USDT2(rule_eval, evt->get_ts(), wrap->m_rule.id);
+		bool res = wrap->run(evt);
+		FALCO_USDT3(rule_eval_done, evt->get_ts(), wrap->m_rule.id, res);
+		if(res)
 		{
 			match = wrap->m_rule;
 			return true;
@@ -86,7 +510,10 @@ bool evttype_index_ruleset::run_wrappers(sinsp_evt *evt, filter_wrapper_list &wr
 
 	for(auto &wrap : wrappers)
 	{
-		if(wrap->m_filter->run(evt))
+		FALCO_USDT2(rule_eval, evt->get_ts(), wrap->m_rule.id);
+		bool res = wrap->run(evt);
+		FALCO_USDT3(rule_eval_done, evt->get_ts(), wrap->m_rule.id, res);
+		if(res)
 		{
 			matches.push_back(wrap->m_rule);
 			match_found = true;
@@ -18,9 +18,13 @@ limitations under the License.
 #pragma once
 
 #include "indexable_ruleset.h"
+#include "filter_bytecode.h"
+#include "falco_usdt.h"
 
+#include <memory>
 #include <string>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 /*!
@@ -39,12 +43,22 @@ struct evttype_index_wrapper
 	libsinsp::events::set<ppm_sc_code> m_sc_codes;
 	libsinsp::events::set<ppm_event_code> m_event_codes;
 	std::shared_ptr<sinsp_filter> m_filter;
+	std::shared_ptr<libsinsp::filter::ast::expr> m_condition;
+	std::shared_ptr<bytecode_filter> m_bytecode;
+
+	// Evaluates the condition with the configured backend
+	inline bool run(sinsp_evt *evt) const
+	{
+		return m_bytecode ? m_bytecode->run(evt) : m_filter->run(evt);
+	}
 };
 
 class evttype_index_ruleset : public indexable_ruleset<evttype_index_wrapper>
 {
 public:
-	explicit evttype_index_ruleset(std::shared_ptr<sinsp_filter_factory> factory);
+	explicit evttype_index_ruleset(
+		std::shared_ptr<sinsp_filter_factory> factory,
+		falco_common::condition_backend backend = falco_common::condition_backend::TREE);
 	virtual ~evttype_index_ruleset();
 
 	// From filter_ruleset
@@ -55,6 +69,13 @@ public:
 
 	void on_loading_complete() override;
 
+	// From filter_ruleset, these use the dispatch table when it is
+	// up to date and fall back to indexable_ruleset::run otherwise
+	bool run(sinsp_evt *evt, falco_rule &match, uint16_t ruleset_id) override;
+	bool run(sinsp_evt *evt, std::vector<falco_rule> &matches, uint16_t ruleset_id) override;
+	bool run_rulesets(sinsp_evt *evt, std::vector<std::pair<falco_rule, uint64_t>> &matches, uint64_t ruleset_mask) override;
+	void run_profiled(sinsp_evt *evt, uint16_t ruleset_id, const profile_callback_t &on_rule) override;
+
 	// From indexable_ruleset
 	bool run_wrappers(sinsp_evt *evt, filter_wrapper_list &wrappers, uint16_t ruleset_id, falco_rule &match) override;
 	bool run_wrappers(sinsp_evt *evt, filter_wrapper_list &wrappers, uint16_t ruleset_id, std::vector<falco_rule> &matches) override;
@@ -63,22 +84,171 @@ public:
 	// log_level=debug; invoked within on_loading_complete()
 	void print_enabled_rules_falco_logger();
 
+	// Returns the number of distinct top-level condition terms
+	// shared by two or more enabled rules, which are evaluated at
+	// most once per event; computed within on_loading_complete()
+	inline size_t num_shared_predicates() const
+	{
+		return m_shared_preds.size();
+	}
+
 private:
+	// The conjuncts of a rule condition that are not shared predicates,
+	// compiled with the configured backend. A null filter and bytecode
+	// stand for a condition made only of shared predicates.
+	struct residual_filter
+	{
+		std::unique_ptr<libsinsp::filter::ast::expr> condition;
+		std::shared_ptr<sinsp_filter> filter;
+		std::shared_ptr<bytecode_filter> bytecode;
+
+		inline bool run(sinsp_evt *evt) const
+		{
+			if(bytecode)
+			{
+				return bytecode->run(evt);
+			}
+			return !filter || filter->run(evt);
+		}
+	};
+
+	// The shared predicates of an enabled rule, as a span of
+	// m_pred_refs, and its residual filter if the span is not empty
+	struct shared_preds_span
+	{
+		uint32_t preds_begin = 0;
+		uint32_t preds_end = 0;
+		const residual_filter *residual = nullptr;
+	};
+
+	// An enabled rule, pointing to its evttype_index_wrapper. When the
+	// rule has shared predicates, referenced by
+	// m_pred_refs[preds_begin, preds_end), its condition is evaluated
+	// as those predicates and then its residual filter, instead of
+	// its whole filter.
+	// In the union table, rulesets holds the mask of the rulesets
+	// in which the rule is enabled (among the first 64). all_types
+	// is set for the rules that run for all event types.
+	struct dispatch_entry
+	{
+		const evttype_index_wrapper *wrap;
+		const falco_rule *rule;
+		uint32_t preds_begin;
+		uint32_t preds_end;
+		const residual_filter *residual;
+		uint64_t rulesets;
+		bool all_types;
+	};
+
+	// Immutable snapshot of the rules enabled for a ruleset, with all
+	// the candidates of an event type stored contiguously, in the same
+	// order in which indexable_ruleset::run would evaluate them: the
+	// rules specific to the event type first, then the ones running for
+	// all event types, which are skipped like in indexable_ruleset::run
+	// if any of the former matched. The first span (before offsets[0])
+	// holds the rules running for all event types, which is used for
+	// event types beyond the table.
+	struct dispatch_table
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<dispatch_entry> entries;
+
+		inline std::pair<const dispatch_entry*, const dispatch_entry*> candidates(uint16_t etype) const
+		{
+			const dispatch_entry* base = entries.data();
+			if((size_t)etype + 1 < offsets.size())
+			{
+				return {base + offsets[etype], base + offsets[etype + 1]};
+			}
+			return {base, base + (offsets.empty() ? entries.size() : offsets[0])};
+		}
+	};
+
+	// The cache factory the engine uses for the conditions of the
+	// given source, or null if there is none
+	std::shared_ptr<sinsp_filter_cache_factory> filter_cache_factory(const std::string& source);
+
+	// Rebuild the dispatch tables from the currently enabled rules
+	void build_dispatch_tables();
+
+	// Find the top-level conjuncts of the rule conditions (typically
+	// inlined macros, such as spawned_process or container) that are
+	// shared across enabled rules, and compile each of them once,
+	// along with the rest of the condition of each rule using them
+	void build_shared_predicates();
+
+	// Compiles a condition made of the given conjuncts for a rule,
+	// with the same backend and caches as its whole filter
+	std::unique_ptr<residual_filter> compile_residual(
+		const evttype_index_wrapper *wrap,
+		const std::vector<libsinsp::filter::ast::expr*> &conjuncts);
+
+	// Returns false if any of the shared predicates of the entry is
+	// false for the current event, evaluating each at most once per run
+	inline bool run_shared_predicates(const dispatch_entry& e, sinsp_evt *evt)
+	{
+		for(uint32_t i = e.preds_begin; i < e.preds_end; i++)
+		{
+			uint32_t p = m_pred_refs[i];
+			if(m_pred_epochs[p] != m_pred_epoch)
+			{
+				m_pred_epochs[p] = m_pred_epoch;
+				m_pred_results[p] = m_shared_preds[p]->run(evt);
+			}
+			if(!m_pred_results[p])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Evaluates the condition of a dispatch entry, as its shared
+	// predicates and then its residual filter if it has any, firing
+	// the per-rule USDT probes around it
+	inline bool run_candidate(const dispatch_entry& e, sinsp_evt *evt)
+	{
+		FALCO_USDT2(rule_eval, evt->get_ts(), e.rule->id);
+		bool res = e.preds_begin == e.preds_end
+			? e.wrap->run(evt)
+			: run_shared_predicates(e, evt) && e.residual->run(evt);
+		FALCO_USDT3(rule_eval_done, evt->get_ts(), e.rule->id, res);
+		return res;
+	}
+
 	std::shared_ptr<sinsp_filter_factory> m_filter_factory;
+	falco_common::condition_backend m_backend;
+
+	std::vector<std::shared_ptr<sinsp_filter>> m_shared_preds;
+	std::vector<uint32_t> m_pred_refs;
+	std::vector<std::unique_ptr<residual_filter>> m_residuals;
+	std::unordered_map<const evttype_index_wrapper*, shared_preds_span> m_wrapper_preds;
+	std::vector<uint64_t> m_pred_epochs;
+	std::vector<uint8_t> m_pred_results;
+	uint64_t m_pred_epoch;
+
+	std::vector<dispatch_table> m_dispatch_tables;
+	// Union of the rules enabled in the first 64 rulesets, each
+	// appearing once per event type
+	dispatch_table m_union_table;
+	uint64_t m_dispatch_version;
+	bool m_dispatch_valid;
 };
 
 class evttype_index_ruleset_factory: public filter_ruleset_factory
 {
 public:
 	inline explicit evttype_index_ruleset_factory(
-		std::shared_ptr<sinsp_filter_factory> factory
-	): m_filter_factory(factory) { }
+		std::shared_ptr<sinsp_filter_factory> factory,
+		falco_common::condition_backend backend = falco_common::condition_backend::TREE
+	): m_filter_factory(factory), m_backend(backend) { }
 
 	inline std::shared_ptr<filter_ruleset> new_ruleset() override
 	{
-		return std::make_shared<evttype_index_ruleset>(m_filter_factory);
+		return std::make_shared<evttype_index_ruleset>(m_filter_factory, m_backend);
 	}
 
 private:
 	std::shared_ptr<sinsp_filter_factory> m_filter_factory;
+	falco_common::condition_backend m_backend;
 };
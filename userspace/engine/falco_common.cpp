@@ -33,6 +33,12 @@ static std::vector<std::string> rule_matching_names = {
 	"all"
 };
 
+static std::vector<std::string> condition_backend_names = {
+	"tree",
+	"bytecode",
+	"adaptive"
+};
+
 bool falco_common::parse_priority(const std::string& v, priority_type& out)
 {
 	for (size_t i = 0; i < priority_names.size(); i++)
@@ -99,3 +105,16 @@ bool falco_common::parse_rule_matching(const std::string& v, rule_matching& out)
 	}
 	return false;
 }
+
+bool falco_common::parse_condition_backend(const std::string& v, condition_backend& out)
+{
+	for (size_t i = 0; i < condition_backend_names.size(); i++)
+	{
+		if (!strcasecmp(v.c_str(), condition_backend_names[i].c_str()))
+		{
+			out = (condition_backend) i;
+			return true;
+		}
+	}
+	return false;
+}
@@ -71,4 +71,13 @@ namespace falco_common
 	};
 
 	bool parse_rule_matching(const std::string& v, rule_matching& out);
+
+	enum condition_backend
+	{
+		TREE = 0,
+		BYTECODE = 1,
+		ADAPTIVE = 2
+	};
+
+	bool parse_condition_backend(const std::string& v, condition_backend& out);
 };
@@ -21,9 +21,9 @@ limitations under the License.
 #else
 #include <stdlib.h>
 #include <io.h>
-#define srandom srand
-#define random rand
 #endif
+#include <algorithm>
+#include <random>
 #include <string>
 #include <fstream>
 #include <functional>
@@ -44,6 +44,7 @@ limitations under the License.
 #include "formats.h"
 
 #include "evttype_index_ruleset.h"
+#include "falco_usdt.h"
 
 const std::string falco_engine::s_default_ruleset = "falco-default-ruleset";
 
@@ -58,11 +59,17 @@ falco_engine::falco_engine(bool seed_rng)
 	  m_next_ruleset_id(0),
 	  m_min_priority(falco_common::PRIORITY_DEBUG),
 	  m_sampling_ratio(1), m_sampling_multiplier(0),
+	  m_sampling_seed(0),
+	  m_sampling_mode(event_sampler::mode::UNIFORM),
+	  m_sampling_min_evts_per_type(0),
+	  m_sampling_window_evts(0),
+	  m_condition_backend(falco_common::condition_backend::TREE),
 	  m_replace_container_info(false)
 {
 	if(seed_rng)
 	{
-		srandom((unsigned) getpid());
+		std::random_device rd;
+		m_sampling_seed = (((uint64_t) rd()) << 32) | rd();
 	}
 
 	m_default_ruleset_id = find_ruleset_id(s_default_ruleset);
@@ -197,6 +204,10 @@ std::unique_ptr<load_result> falco_engine::load_rules(const std::string &rules_c
 	cfg.output_extra = m_extra;
 	cfg.replace_output_container_info = m_replace_container_info;
 
+	// the rules loaded from a bundle, if any, are replaced by the ones
+	// compiled from the collected definitions
+	m_bundle_required_plugin_versions.clear();
+
 	// read rules YAML file and collect its definitions
 	if(m_rule_reader->read(cfg, *m_rule_collector))
 	{
@@ -209,51 +220,16 @@ std::unique_ptr<load_result> falco_engine::load_rules(const std::string &rules_c
 			return std::move(cfg.res);
 		}
 
-		// clear the rules known by the engine and each ruleset
-		m_rules.clear();
-		for (auto &src : m_sources)
-		// add rules to each ruleset
-		{
-			src.ruleset = create_ruleset(src.ruleset_factory);
-			src.ruleset->add_compile_output(*m_last_compile_output,
-							m_min_priority,
-							src.name);
-		}
-
-		// add rules to the engine and the rulesets
-		for (const auto& rule : m_last_compile_output->rules)
+		load_compile_output([this](const falco_rule& rule)
 		{
 			auto info = m_rule_collector->rules().at(rule.name);
 			if (!info)
 			{
 				// this is just defensive, it should never happen
-				throw falco_exception("can't find internal rule info at name: " + name);
-			}
-
-			auto source = find_source(rule.source);
-			auto rule_id = m_rules.insert(rule, rule.name);
-			if (rule_id != rule.id)
-			{
-				throw falco_exception("Incompatible ID for rule: " + rule.name +
-						      " | compiled ID: " + std::to_string(rule.id) +
-						      " | stats_mgr ID: " + std::to_string(rule_id));
-			}
-
-			// By default rules are enabled/disabled for the default ruleset
-			// skip the rule if below the minimum priority
-			if (rule.priority > m_min_priority)
-			{
-				continue;
-			}
-			if(info->enabled)
-			{
-				source->ruleset->enable(rule.name, filter_ruleset::match_type::exact, m_default_ruleset_id);
-			}
-			else
-			{
-				source->ruleset->disable(rule.name, filter_ruleset::match_type::exact, m_default_ruleset_id);
+				throw falco_exception("can't find internal rule info at name: " + rule.name);
 			}
-		}
+			return info->enabled;
+		});
 	}
 
 	if (cfg.res->successful())
@@ -268,6 +244,112 @@ std::unique_ptr<load_result> falco_engine::load_rules(const std::string &rules_c
 	return std::move(cfg.res);
 }
 
+void falco_engine::load_compile_output(const std::function<bool(const falco_rule&)>& is_enabled)
+{
+	invalidate_evttypes_with_rules();
+
+	// clear the rules known by the engine and each ruleset
+	m_rules.clear();
+	for (auto &src : m_sources)
+	// add rules to each ruleset
+	{
+		src.ruleset = create_ruleset(src.ruleset_factory);
+		src.ruleset->add_compile_output(*m_last_compile_output,
+						m_min_priority,
+						src.name);
+	}
+
+	// add rules to the engine and the rulesets
+	for (const auto& rule : m_last_compile_output->rules)
+	{
+		auto source = find_source(rule.source);
+		auto rule_id = m_rules.insert(rule, rule.name);
+		if (rule_id != rule.id)
+		{
+			throw falco_exception("Incompatible ID for rule: " + rule.name +
+					      " | compiled ID: " + std::to_string(rule.id) +
+					      " | stats_mgr ID: " + std::to_string(rule_id));
+		}
+
+		// By default rules are enabled/disabled for the default ruleset
+		// skip the rule if below the minimum priority
+		if (rule.priority > m_min_priority)
+		{
+			continue;
+		}
+		if(is_enabled(rule))
+		{
+			source->ruleset->enable(rule.name, filter_ruleset::match_type::exact, m_default_ruleset_id);
+		}
+		else
+		{
+			source->ruleset->disable(rule.name, filter_ruleset::match_type::exact, m_default_ruleset_id);
+		}
+	}
+}
+
+rule_loader::bundle::header falco_engine::rules_bundle_header(const std::string& rules_key) const
+{
+	rule_loader::bundle::header hdr;
+	hdr.engine_version = FALCO_ENGINE_VERSION;
+	hdr.rules_key = rules_key;
+	hdr.output_extra = m_extra;
+	hdr.replace_output_container_info = m_replace_container_info;
+	hdr.required_plugin_versions = m_rule_collector->required_plugin_versions();
+	hdr.required_plugin_versions.insert(hdr.required_plugin_versions.end(),
+		m_bundle_required_plugin_versions.begin(), m_bundle_required_plugin_versions.end());
+	return hdr;
+}
+
+void falco_engine::write_rules_bundle(std::ostream& out, const std::string& rules_key) const
+{
+	if (!m_last_compile_output)
+	{
+		throw falco_exception("No rules loaded, can't write a rules bundle");
+	}
+
+	rule_loader::bundle::write(out, rules_bundle_header(rules_key), *m_last_compile_output,
+		[this](const falco_rule& rule)
+		{
+			auto info = m_rule_collector->rules().at(rule.name);
+			return info == nullptr || info->enabled;
+		});
+}
+
+bool falco_engine::load_rules_bundle(const std::string& content, const std::string& rules_key)
+{
+	if (rule_loader::bundle::read_header(content) != rules_bundle_header(rules_key))
+	{
+		return false;
+	}
+
+	auto compiled = m_rule_compiler->new_compile_output();
+	std::set<std::string> disabled;
+	auto hdr = rule_loader::bundle::read(content, m_sources, *compiled, disabled);
+
+	// the bundle replaces any definition loaded before
+	m_rule_collector->clear();
+	m_bundle_required_plugin_versions = std::move(hdr.required_plugin_versions);
+	m_last_compile_output = std::move(compiled);
+	load_compile_output([&disabled](const falco_rule& rule)
+	{
+		return disabled.find(rule.name) == disabled.end();
+	});
+
+	m_rule_stats_manager.clear();
+	for (const auto &r : m_rules)
+	{
+		m_rule_stats_manager.on_rule_loaded(r);
+	}
+	return true;
+}
+
+void falco_engine::clear_rules()
+{
+	m_rule_collector->clear();
+	m_bundle_required_plugin_versions.clear();
+}
+
 void falco_engine::enable_rule(const std::string &substring, bool enabled, const std::string &ruleset)
 {
 	uint16_t ruleset_id = find_ruleset_id(ruleset);
@@ -277,17 +359,17 @@ void falco_engine::enable_rule(const std::string &substring, bool enabled, const
 
 void falco_engine::enable_rule(const std::string &substring, bool enabled, const uint16_t ruleset_id)
 {
-	for(const auto &it : m_sources)
+	enable_disable_rules(ruleset_id, [&](filter_ruleset& ruleset)
 	{
 		if(enabled)
 		{
-			it.ruleset->enable(substring, filter_ruleset::match_type::substring, ruleset_id);
+			ruleset.enable(substring, filter_ruleset::match_type::substring, ruleset_id);
 		}
 		else
 		{
-			it.ruleset->disable(substring, filter_ruleset::match_type::substring, ruleset_id);
+			ruleset.disable(substring, filter_ruleset::match_type::substring, ruleset_id);
 		}
-	}
+	});
 }
 
 void falco_engine::enable_rule_exact(const std::string &rule_name, bool enabled, const std::string &ruleset)
@@ -299,17 +381,17 @@ void falco_engine::enable_rule_exact(const std::string &rule_name, bool enabled,
 
 void falco_engine::enable_rule_exact(const std::string &rule_name, bool enabled, const uint16_t ruleset_id)
 {
-	for(const auto &it : m_sources)
+	enable_disable_rules(ruleset_id, [&](filter_ruleset& ruleset)
 	{
 		if(enabled)
 		{
-			it.ruleset->enable(rule_name, filter_ruleset::match_type::exact, ruleset_id);
+			ruleset.enable(rule_name, filter_ruleset::match_type::exact, ruleset_id);
 		}
 		else
 		{
-			it.ruleset->disable(rule_name, filter_ruleset::match_type::exact, ruleset_id);
+			ruleset.disable(rule_name, filter_ruleset::match_type::exact, ruleset_id);
 		}
-	}
+	});
 }
 
 void falco_engine::enable_rule_wildcard(const std::string &rule_name, bool enabled, const std::string &ruleset)
@@ -321,17 +403,17 @@ void falco_engine::enable_rule_wildcard(const std::string &rule_name, bool enabl
 
 void falco_engine::enable_rule_wildcard(const std::string &rule_name, bool enabled, const uint16_t ruleset_id)
 {
-	for(const auto &it : m_sources)
+	enable_disable_rules(ruleset_id, [&](filter_ruleset& ruleset)
 	{
 		if(enabled)
 		{
-			it.ruleset->enable(rule_name, filter_ruleset::match_type::wildcard, ruleset_id);
+			ruleset.enable(rule_name, filter_ruleset::match_type::wildcard, ruleset_id);
 		}
 		else
 		{
-			it.ruleset->disable(rule_name, filter_ruleset::match_type::wildcard, ruleset_id);
+			ruleset.disable(rule_name, filter_ruleset::match_type::wildcard, ruleset_id);
 		}
-	}
+	});
 }
 
 void falco_engine::enable_rule_by_tag(const std::set<std::string> &tags, bool enabled, const std::string &ruleset)
@@ -343,15 +425,31 @@ void falco_engine::enable_rule_by_tag(const std::set<std::string> &tags, bool en
 
 void falco_engine::enable_rule_by_tag(const std::set<std::string> &tags, bool enabled, const uint16_t ruleset_id)
 {
-	for(const auto &it : m_sources)
+	enable_disable_rules(ruleset_id, [&](filter_ruleset& ruleset)
 	{
 		if(enabled)
 		{
-			it.ruleset->enable_tags(tags, ruleset_id);
+			ruleset.enable_tags(tags, ruleset_id);
 		}
 		else
 		{
-			it.ruleset->disable_tags(tags, ruleset_id);
+			ruleset.disable_tags(tags, ruleset_id);
+		}
+	});
+}
+
+void falco_engine::enable_disable_rules(uint16_t ruleset_id, const std::function<void(filter_ruleset&)>& apply)
+{
+	for(const auto &src : m_sources)
+	{
+		// the bitmaps only depend on the default ruleset, and enabling
+		// or disabling rules changes the number of enabled ones, if any
+		bool is_default = ruleset_id == m_default_ruleset_id;
+		uint64_t enabled = is_default ? src.ruleset->enabled_count(ruleset_id) : 0;
+		apply(*src.ruleset);
+		if(is_default && src.ruleset->enabled_count(ruleset_id) != enabled)
+		{
+			src.m_evttypes_with_rules.invalidate();
 		}
 	}
 }
@@ -388,6 +486,64 @@ void falco_engine::evttypes_for_ruleset(const std::string &source, std::set<uint
 	find_source(source)->ruleset->enabled_evttypes(evttypes, find_ruleset_id(ruleset));
 }
 
+std::set<std::string> falco_engine::disable_source_rules(std::size_t source_idx,
+							const std::set<std::string> &rule_names,
+							const std::set<std::string> &tags)
+{
+	const falco_source *source = find_source(source_idx);
+	if(!source)
+	{
+		throw falco_exception("Unknown event source index " + std::to_string(source_idx));
+	}
+
+	// rules are disabled one at a time, so that the ones that were
+	// already disabled can be told apart and won't be enabled back
+	std::set<std::string> disabled;
+	for(const auto &rule : m_rules)
+	{
+		if(rule.source != source->name)
+		{
+			continue;
+		}
+
+		bool matches = std::any_of(tags.begin(), tags.end(),
+			[&rule](const std::string &tag) { return rule.tags.count(tag) > 0; });
+		for(auto it = rule_names.begin(); !matches && it != rule_names.end(); it++)
+		{
+			matches = falco::utils::matches_wildcard(*it, rule.name);
+		}
+
+		if(matches)
+		{
+			uint64_t enabled = source->ruleset->enabled_count(m_default_ruleset_id);
+			source->ruleset->disable(rule.name, filter_ruleset::match_type::exact, m_default_ruleset_id);
+			if(source->ruleset->enabled_count(m_default_ruleset_id) < enabled)
+			{
+				disabled.insert(rule.name);
+			}
+		}
+	}
+
+	complete_source_rule_loading(*source);
+	return disabled;
+}
+
+void falco_engine::enable_source_rules(std::size_t source_idx, const std::set<std::string> &rule_names)
+{
+	const falco_source *source = find_source(source_idx);
+	if(!source)
+	{
+		throw falco_exception("Unknown event source index " + std::to_string(source_idx));
+	}
+
+	for(const auto &name : rule_names)
+	{
+		source->ruleset->enable(name, filter_ruleset::match_type::exact, m_default_ruleset_id);
+	}
+
+	complete_source_rule_loading(*source);
+}
+
 libsinsp::events::set<ppm_sc_code> falco_engine::sc_codes_for_ruleset(const std::string &source, const std::string &ruleset)
 {
 	return find_source(source)->ruleset->enabled_sc_codes(find_ruleset_id(ruleset));
@@ -415,7 +571,7 @@ std::unique_ptr<std::vector<falco_engine::rule_result>> falco_engine::process_ev
 
 	const falco_source *source = find_source(source_idx);
 
-	if(should_drop_evt() || !source)
+	if(!source || should_drop_evt(source, ev))
 	{
 		return nullptr;
 	}
@@ -455,7 +611,46 @@ std::unique_ptr<std::vector<falco_engine::rule_result>> falco_engine::process_ev
 		rule_result.priority_num = rule.priority;
 		rule_result.tags = rule.tags;
 		rule_result.exception_fields = rule.exception_fields;
+		rule_result.rulesets = ruleset_id < 64 ? 1ULL << ruleset_id : 0;
+		m_rule_stats_manager.on_event(rule);
+		FALCO_USDT4(rule_match, ev->get_ts(), rule.id, (int)rule.priority, rule.name.c_str());
+		res->push_back(rule_result);
+	}
+
+	return res;
+}
+
+std::unique_ptr<std::vector<falco_engine::rule_result>> falco_engine::process_event_rulesets(std::size_t source_idx,
+	sinsp_evt *ev, uint64_t ruleset_mask)
+{
+	const falco_source *source = find_source(source_idx);
+
+	if(!source || should_drop_evt(source, ev))
+	{
+		return nullptr;
+	}
+
+	source->m_ruleset_matches.clear();
+	if (!source->ruleset->run_rulesets(ev, source->m_ruleset_matches, ruleset_mask))
+	{
+		return nullptr;
+	}
+
+	auto res = std::make_unique<std::vector<falco_engine::rule_result>>();
+	for(const auto& match : source->m_ruleset_matches)
+	{
+		const auto& rule = match.first;
+		rule_result rule_result;
+		rule_result.evt = ev;
+		rule_result.rule = rule.name;
+		rule_result.source = rule.source;
+		rule_result.format = rule.output;
+		rule_result.priority_num = rule.priority;
+		rule_result.tags = rule.tags;
+		rule_result.exception_fields = rule.exception_fields;
+		rule_result.rulesets = match.second;
 		m_rule_stats_manager.on_event(rule);
+		FALCO_USDT4(rule_match, ev->get_ts(), rule.id, (int)rule.priority, rule.name.c_str());
 		res->push_back(rule_result);
 	}
 
@@ -468,13 +663,31 @@ std::unique_ptr<std::vector<falco_engine::rule_result>> falco_engine::process_ev
 	return process_event(source_idx, ev, m_default_ruleset_id, strategy);
 }
 
+void falco_engine::profile_event(std::size_t source_idx, sinsp_evt *ev,
+	const filter_ruleset::profile_callback_t& on_rule)
+{
+	const falco_source *source = find_source(source_idx);
+
+	if(!source)
+	{
+		return;
+	}
+
+	source->ruleset->run_profiled(ev, m_default_ruleset_id, on_rule);
+}
+
+void falco_engine::set_condition_backend(falco_common::condition_backend backend)
+{
+	m_condition_backend = backend;
+}
+
 std::size_t falco_engine::add_source(const std::string &source,
 				     std::shared_ptr<sinsp_filter_factory> filter_factory,
 				     std::shared_ptr<sinsp_evt_formatter_factory> formatter_factory)
 {
 	// evttype_index_ruleset is the default ruleset implementation
 	size_t idx = add_source(source, filter_factory, formatter_factory,
-	                        std::make_shared<evttype_index_ruleset_factory>(filter_factory));
+	                        std::make_shared<evttype_index_ruleset_factory>(filter_factory, m_condition_backend));
 
 	if(source == falco_common::syscall_source)
 	{
@@ -494,8 +707,18 @@ std::size_t falco_engine::add_source(const std::string &source,
 	src.filter_factory = filter_factory;
 	src.formatter_factory = formatter_factory;
 	src.ruleset_factory = ruleset_factory;
+	src.filter_cache_metrics = std::make_shared<sinsp_filter_cache_metrics>();
+	src.filter_cache_factory = std::make_shared<exprstr_sinsp_filter_cache_factory>(src.filter_cache_metrics);
 	src.ruleset = create_ruleset(src.ruleset_factory);
-	return m_sources.insert(src, source);
+	auto idx = m_sources.insert(src, source);
+	auto &sampler = m_sources.at(idx)->m_sampler;
+	sampler.set_mode(m_sampling_mode, m_sampling_min_evts_per_type, m_sampling_window_evts);
+	sampler.set_seed(m_sampling_seed + idx);
+	while (m_num_skipped_evts_by_source.size() <= idx)
+	{
+		m_num_skipped_evts_by_source.emplace_back(std::make_unique<std::atomic<uint64_t>>(0));
+	}
+	return idx;
 }
 
 template <typename T> inline nlohmann::json sequence_to_json_array(const T& seq)
@@ -1020,7 +1243,10 @@ bool falco_engine::check_plugin_requirements(
 		std::string& err) const
 {
 	err = "";
-	for(const auto &alternatives : m_rule_collector->required_plugin_versions())
+	auto required_plugin_versions = m_rule_collector->required_plugin_versions();
+	required_plugin_versions.insert(required_plugin_versions.end(),
+		m_bundle_required_plugin_versions.begin(), m_bundle_required_plugin_versions.end());
+	for(const auto &alternatives : required_plugin_versions)
 	{
 		if (!check_plugin_requirement_alternatives(plugins, alternatives, err))
 		{
@@ -1062,16 +1288,176 @@ void falco_engine::fill_engine_state_funcs(filter_ruleset::engine_state_funcs &e
 
 		return true;
 	};
+
+	engine_state.get_filter_cache_factory = [this](const std::string &source_name) -> std::shared_ptr<sinsp_filter_cache_factory>
+	{
+		const falco_source *src = m_sources.at(source_name);
+		return src != nullptr ? src->filter_cache_factory : nullptr;
+	};
 };
 
 void falco_engine::complete_rule_loading() const
 {
 	for (const auto &src : m_sources)
 	{
-		src.ruleset->on_loading_complete();
+		complete_source_rule_loading(src);
+	}
+}
+
+void falco_engine::complete_source_rule_loading(const falco_source &src) const
+{
+	src.ruleset->on_loading_complete();
+
+	// the bitmap is never cleared while rebuilding it, as it may be
+	// read by the thread processing the events of the source
+	src.m_evttypes_with_rules.assign(src.ruleset->enabled_event_codes(m_default_ruleset_id));
+}
+
+void falco_engine::invalidate_evttypes_with_rules() const
+{
+	for (const auto &src : m_sources)
+	{
+		src.m_evttypes_with_rules.invalidate();
 	}
 }
 
+sinsp_filter_cache_metrics falco_engine::get_filter_cache_metrics() const
+{
+	sinsp_filter_cache_metrics ret;
+	for (const auto &src : m_sources)
+	{
+		if (src.filter_cache_metrics)
+		{
+			ret.m_num_extract += src.filter_cache_metrics->m_num_extract;
+			ret.m_num_extract_cache += src.filter_cache_metrics->m_num_extract_cache;
+			ret.m_num_compare += src.filter_cache_metrics->m_num_compare;
+			ret.m_num_compare_cache += src.filter_cache_metrics->m_num_compare_cache;
+		}
+	}
+	return ret;
+}
+
+// Approximates the bytes of a condition AST, and of the filter compiled
+// from it, where every field check becomes a filtercheck
+struct ast_memory_visitor : public libsinsp::filter::ast::expr_visitor
+{
+	// a filtercheck with its field info, arguments and comparison state
+	static constexpr size_t compiled_check_bytes = 512;
+
+	size_t ast = 0;
+	size_t filter = 0;
+
+	void visit(libsinsp::filter::ast::and_expr* e) override
+	{
+		ast += sizeof(*e) + e->children.capacity() * sizeof(void*);
+		filter += e->children.size() * sizeof(void*);
+		for(auto& c : e->children)
+		{
+			c->accept(this);
+		}
+	}
+
+	void visit(libsinsp::filter::ast::or_expr* e) override
+	{
+		ast += sizeof(*e) + e->children.capacity() * sizeof(void*);
+		filter += e->children.size() * sizeof(void*);
+		for(auto& c : e->children)
+		{
+			c->accept(this);
+		}
+	}
+
+	void visit(libsinsp::filter::ast::not_expr* e) override
+	{
+		ast += sizeof(*e);
+		e->child->accept(this);
+	}
+
+	void visit(libsinsp::filter::ast::identifier_expr* e) override
+	{
+		ast += sizeof(*e) + e->identifier.capacity();
+	}
+
+	void visit(libsinsp::filter::ast::value_expr* e) override
+	{
+		ast += sizeof(*e) + e->value.capacity();
+		filter += e->value.size();
+	}
+
+	void visit(libsinsp::filter::ast::list_expr* e) override
+	{
+		ast += sizeof(*e) + e->values.capacity() * sizeof(std::string);
+		for(const auto& v : e->values)
+		{
+			ast += v.capacity();
+			// values are kept in a hash set for the "in" operators
+			filter += v.size() + 2 * sizeof(void*);
+		}
+	}
+
+	void visit(libsinsp::filter::ast::unary_check_expr* e) override
+	{
+		ast += sizeof(*e);
+		filter += compiled_check_bytes;
+		e->left->accept(this);
+	}
+
+	void visit(libsinsp::filter::ast::binary_check_expr* e) override
+	{
+		ast += sizeof(*e);
+		filter += compiled_check_bytes;
+		e->left->accept(this);
+		e->right->accept(this);
+	}
+
+	void visit(libsinsp::filter::ast::field_expr* e) override
+	{
+		ast += sizeof(*e) + e->field.capacity() + e->arg.capacity();
+	}
+
+	void visit(libsinsp::filter::ast::field_transformer_expr* e) override
+	{
+		ast += sizeof(*e) + e->transformer.capacity();
+		e->value->accept(this);
+	}
+};
+
+falco_engine::rules_memory_usage falco_engine::get_rules_memory_usage() const
+{
+	rules_memory_usage ret;
+	for (const auto &rule : m_rules)
+	{
+		ret.rules += sizeof(falco_rule) + rule.name.capacity() + rule.source.capacity()
+			+ rule.description.capacity() + rule.output.capacity();
+		for (const auto &s : rule.tags)
+		{
+			ret.rules += sizeof(std::string) + s.capacity();
+		}
+		for (const auto &s : rule.exception_fields)
+		{
+			ret.rules += sizeof(std::string) + s.capacity();
+		}
+		if (rule.condition)
+		{
+			ast_memory_visitor v;
+			rule.condition->accept(&v);
+			ret.rules += v.ast;
+			ret.filters += v.filter;
+		}
+	}
+	return ret;
+}
+
+uint64_t falco_engine::get_num_skipped_events() const
+{
+	uint64_t ret = 0;
+	for (const auto &n : m_num_skipped_evts_by_source)
+	{
+		ret += n->load(std::memory_order_relaxed);
+	}
+	return ret;
+}
+
 void falco_engine::set_sampling_ratio(uint32_t sampling_ratio)
 {
 	m_sampling_ratio = sampling_ratio;
@@ -1082,13 +1468,33 @@ void falco_engine::set_sampling_multiplier(double sampling_multiplier)
 	m_sampling_multiplier = sampling_multiplier;
 }
 
+void falco_engine::set_sampling_seed(uint64_t seed)
+{
+	m_sampling_seed = seed;
+	for (std::size_t i = 0; i < m_sources.size(); i++)
+	{
+		m_sources.at(i)->m_sampler.set_seed(m_sampling_seed + i);
+	}
+}
+
+void falco_engine::set_sampling_mode(event_sampler::mode mode, uint32_t min_evts_per_type, uint64_t window_evts)
+{
+	m_sampling_mode = mode;
+	m_sampling_min_evts_per_type = min_evts_per_type;
+	m_sampling_window_evts = window_evts;
+	for (auto &src : m_sources)
+	{
+		src.m_sampler.set_mode(mode, min_evts_per_type, window_evts);
+	}
+}
+
 void falco_engine::set_extra(const std::string &extra, bool replace_container_info)
 {
 	m_extra = extra;
 	m_replace_container_info = replace_container_info;
 }
 
-inline bool falco_engine::should_drop_evt() const
+inline bool falco_engine::should_drop_evt(const falco_source* source, const sinsp_evt* ev) const
 {
 	if(m_sampling_multiplier == 0)
 	{
@@ -1100,6 +1506,5 @@ inline bool falco_engine::should_drop_evt() const
 		return false;
 	}
 
-	double coin = (random() * (1.0/RAND_MAX));
-	return (coin >= (1.0/(m_sampling_multiplier * m_sampling_ratio)));
+	return source->m_sampler.should_drop(ev->get_type(), 1.0/(m_sampling_multiplier * m_sampling_ratio));
 }
@@ -34,6 +34,7 @@ limitations under the License.
 #include "falco_source.h"
 #include "falco_load_result.h"
 #include "filter_details_resolver.h"
+#include "rule_bundle.h"
 
 //
 // This class acts as the primary interface between a program and the
@@ -82,6 +83,37 @@ public:
 	//
 	std::unique_ptr<falco::load_result> load_rules(const std::string &rules_content, const std::string &name);
 
+	//
+	// Write a precompiled rules bundle containing all the definitions
+	// compiled by the last successful call to load_rules(). The
+	// rules_key is an opaque identifier of the rules content the
+	// definitions were loaded from (e.g. its sha256 digest), and
+	// must be provided again to load the bundle.
+	// Throws falco_exception if no rules have been loaded yet.
+	//
+	void write_rules_bundle(std::ostream& out, const std::string& rules_key) const;
+
+	//
+	// Load a precompiled rules bundle previously written with
+	// write_rules_bundle(), replacing any rule loaded before. Returns
+	// false without loading anything if the bundle has been written
+	// by another engine version, with another output configuration,
+	// or with a rules_key different from the provided one.
+	// Throws falco_exception if the bundle is malformed.
+	// The plugin requirements of the rules are restored from the
+	// bundle, and are checked by check_plugin_requirements() as usual.
+	// Note: rules loaded from a bundle carry no YAML definition
+	// details, so they can't be described with describe_rule().
+	//
+	bool load_rules_bundle(const std::string& content, const std::string& rules_key);
+
+	//
+	// Forget all the rules, macros, and lists read by previous calls to
+	// load_rules(), so that the next call starts from scratch. The rules
+	// currently in use are kept until new ones are loaded.
+	//
+	void clear_rules();
+
 	//
 	// Enable/Disable any rules matching the provided substring.
 	// If the substring is "", all rules are enabled/disabled.
@@ -116,6 +148,24 @@ public:
 	// Same as above but providing a ruleset id instead
 	void enable_rule_by_tag(const std::set<std::string> &tags, bool enabled, const uint16_t ruleset_id);
 
+	//
+	// Disable, in the default ruleset of a single source, the enabled
+	// rules matching any of the provided names (wildcards are supported)
+	// or having any of the provided tags, and return the names of the
+	// rules that were disabled. Unlike the methods above, this leaves
+	// the other sources untouched and keeps the source ready to process
+	// events, so it can be invoked at runtime by the same thread that
+	// invokes process_event() for the source.
+	//
+	std::set<std::string> disable_source_rules(std::size_t source_idx,
+						   const std::set<std::string> &rule_names,
+						   const std::set<std::string> &tags);
+
+	// Enable back, with the same guarantees, the rules of a single source
+	// having exactly the provided names, such as the ones returned by
+	// disable_source_rules()
+	void enable_source_rules(std::size_t source_idx, const std::set<std::string> &rule_names);
+
 	//
 	// Must be called after the engine has been configured and all rulesets
 	// have been loaded and enabled/disabled.
@@ -176,6 +226,26 @@ public:
 	//
 	void set_sampling_multiplier(double sampling_multiplier);
 
+	//
+	// Set the seed used to sample events. Each event source samples
+	// its events independently, with a sequence of decisions fully
+	// determined by this seed. By default, the seed is random unless
+	// the engine is created with seed_rng=false.
+	// This must not be called while processing events.
+	//
+	void set_sampling_seed(uint64_t seed);
+
+	//
+	// Set how events are sampled. In STRATIFIED mode, the first
+	// min_evts_per_type events of each event type seen every
+	// window_evts events are never dropped, so that rare event types
+	// are preserved and only the most frequent ones are thinned.
+	// This must not be called while processing events.
+	//
+	void set_sampling_mode(event_sampler::mode mode,
+			       uint32_t min_evts_per_type = 16,
+			       uint64_t window_evts = 100000);
+
 	//
 	// You can optionally add "extra" formatting fields to the end
 	// of all output expressions. You can also choose to replace
@@ -196,6 +266,9 @@ public:
 		std::string format;
 		std::set<std::string> exception_fields;
 		std::set<std::string> tags;
+		// Mask of the evaluated rulesets in which the rule is enabled,
+		// where bit i stands for the ruleset with id i
+		uint64_t rulesets;
 	};
 
 	//
@@ -233,6 +306,94 @@ public:
 	std::unique_ptr<std::vector<rule_result>> process_event(std::size_t source_idx,
 		sinsp_evt *ev, falco_common::rule_matching strategy);
 
+	//
+	// Given an event, check it once against the union of the rules
+	// enabled in the selected rulesets, and return all the rules that
+	// matched, each tagged with the mask of the selected rulesets in
+	// which it is enabled. Bit i of ruleset_mask selects the ruleset
+	// with id i (as returned by find_ruleset_id), so only the first 64
+	// rulesets can be selected. A rule enabled in several rulesets is
+	// evaluated only once, which makes the cost of each additional
+	// ruleset proportional to the rules that are unique to it.
+	// If no rule matched, returns nullptr.
+	//
+	// This inherits the same thread-safety guarantees of process_event().
+	//
+	std::unique_ptr<std::vector<rule_result>> process_event_rulesets(std::size_t source_idx,
+		sinsp_evt *ev, uint64_t ruleset_mask);
+
+	//
+	// Given an event, evaluate each candidate rule of the default
+	// ruleset in isolation, invoking on_rule with the outcome and the
+	// cost of each evaluation. Unlike process_event(), this ignores
+	// the event drop sampling, does not update the rule counters and
+	// produces no results, and it's
+	// much slower, so it's only meant for profiling a sample of
+	// the events.
+	//
+	// This inherits the same thread-safety guarantees of process_event().
+	//
+	void profile_event(std::size_t source_idx, sinsp_evt *ev,
+		const filter_ruleset::profile_callback_t& on_rule);
+
+	//
+	// Returns true if no rule of the default ruleset can match events
+	// of the given type for the given source, in which case invoking
+	// process_event() for them can be skipped altogether. Events
+	// for which this returns true are counted as skipped.
+	// This relies on data computed by complete_rule_loading(), and
+	// always returns false if the rules have changed since then.
+	//
+	// This inherits the same thread-safety guarantees of process_event(),
+	// and can run while the rules of other sources are enabled or disabled.
+	//
+	inline bool skip_event_type(std::size_t source_idx, uint16_t etype)
+	{
+		const falco_source *source = find_source(source_idx);
+		if(!source->m_evttypes_with_rules.missing(etype))
+		{
+			return false;
+		}
+		m_num_skipped_evts_by_source[source_idx]->fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	//
+	// Returns the number of events skipped by skip_event_type() across
+	// all sources. This is thread-safe.
+	//
+	uint64_t get_num_skipped_events() const;
+
+	//
+	// Returns the metrics of the caches used by the rule conditions of
+	// all sources, counting the field extractions and comparisons
+	// that were performed and the ones served by the cache instead.
+	//
+	sinsp_filter_cache_metrics get_filter_cache_metrics() const;
+
+	//
+	// Returns an approximation of the memory used by the loaded rules,
+	// split between their definitions including the condition ASTs, and
+	// the filters compiled from the conditions.
+	//
+	struct rules_memory_usage
+	{
+		size_t rules = 0;
+		size_t filters = 0;
+	};
+	rules_memory_usage get_rules_memory_usage() const;
+
+	//
+	// Set the backend used by the default ruleset implementation to
+	// evaluate rule conditions: either the tree of sinsp_filter nodes
+	// (the default), a flat bytecode program, or a bytecode program
+	// whose and/or operands get periodically reordered based on
+	// sampled runtime cost and pass rate. This only affects the
+	// sources added afterwards with the add_source() variant that
+	// doesn't take a ruleset factory.
+	//
+	void set_condition_backend(falco_common::condition_backend backend);
+
 	//
 	// Configure the engine to support events with the provided
 	// source, with the provided filter factory and formatter factory.
@@ -337,6 +498,27 @@ private:
 	// Functions to retrieve state from this engine
 	void fill_engine_state_funcs(filter_ruleset::engine_state_funcs& engine_state);
 
+	// Populates the engine and the rulesets of each source with the
+	// rules of m_last_compile_output, enabling in the default ruleset
+	// the ones for which is_enabled returns true
+	void load_compile_output(const std::function<bool(const falco_rule&)>& is_enabled);
+
+	// Mark the per-source bitmaps of event types with enabled rules
+	// as outdated, until complete_rule_loading() is invoked again
+	void invalidate_evttypes_with_rules() const;
+
+	// Enables or disables rules in the given ruleset of each source,
+	// only marking as outdated the bitmaps of the sources whose default
+	// ruleset actually changed
+	void enable_disable_rules(uint16_t ruleset_id, const std::function<void(filter_ruleset&)>& apply);
+
+	// The part of complete_rule_loading() related to a single source
+	void complete_source_rule_loading(const falco_source &src) const;
+
+	// Returns the header a rules bundle must have to be compatible
+	// with this engine and with the given rules key
+	rule_loader::bundle::header rules_bundle_header(const std::string& rules_key) const;
+
 	filter_ruleset::engine_state_funcs m_engine_state;
 
 	// Throws falco_exception if the file can not be read
@@ -394,7 +576,7 @@ private:
 	// against the set of rules, given the current sampling
 	// ratio/multiplier.
 	//
-	inline bool should_drop_evt() const;
+	inline bool should_drop_evt(const falco_source* source, const sinsp_evt* ev) const;
 
 	// Retrieve json details from rules, macros, lists
 	void get_json_details(
@@ -426,6 +608,9 @@ private:
 	indexed_vector<falco_rule> m_rules;
 	std::shared_ptr<rule_loader::reader> m_rule_reader;
 	std::shared_ptr<rule_loader::collector> m_rule_collector;
+	// plugin requirements of the rules loaded from a rules bundle,
+	// which the rule collector doesn't know about
+	std::vector<rule_loader::plugin_version_info::requirement_alternatives> m_bundle_required_plugin_versions;
 	std::shared_ptr<rule_loader::compiler> m_rule_compiler;
 	stats_manager m_rule_stats_manager;
 
@@ -435,6 +620,9 @@ private:
 
 	std::unique_ptr<rule_loader::compile_output> m_last_compile_output;
 
+	// Number of events skipped by skip_event_type(), indexed by source
+	std::vector<std::unique_ptr<std::atomic<uint64_t>>> m_num_skipped_evts_by_source;
+
 	//
 	// Here's how the sampling ratio and multiplier influence
 	// whether or not an event is dropped in
@@ -457,6 +645,12 @@ private:
 
 	uint32_t m_sampling_ratio;
 	double m_sampling_multiplier;
+	uint64_t m_sampling_seed;
+	event_sampler::mode m_sampling_mode;
+	uint32_t m_sampling_min_evts_per_type;
+	uint64_t m_sampling_window_evts;
+
+	falco_common::condition_backend m_condition_backend;
 
 	static const std::string s_default_ruleset;
 	uint32_t m_default_ruleset_id;
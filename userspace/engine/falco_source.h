@@ -18,7 +18,10 @@ limitations under the License.
 #pragma once
 
 #include <string>
+#include <libsinsp/filter_cache.h>
 #include "filter_ruleset.h"
+#include "event_sampler.h"
+#include "evttype_bitmap.h"
 
 /*!
 	\brief Represents a given data source used by the engine.
@@ -35,7 +38,11 @@ struct falco_source
 		ruleset(s.ruleset),
 		ruleset_factory(s.ruleset_factory),
 		filter_factory(s.filter_factory),
-		formatter_factory(s.formatter_factory) { };
+		formatter_factory(s.formatter_factory),
+		filter_cache_factory(s.filter_cache_factory),
+		filter_cache_metrics(s.filter_cache_metrics),
+		m_evttypes_with_rules(s.m_evttypes_with_rules),
+		m_sampler(s.m_sampler) { };
 	falco_source& operator = (const falco_source& s)
 	{
 		name = s.name;
@@ -43,6 +50,10 @@ struct falco_source
 		ruleset_factory = s.ruleset_factory;
 		filter_factory = s.filter_factory;
 		formatter_factory = s.formatter_factory;
+		filter_cache_factory = s.filter_cache_factory;
+		filter_cache_metrics = s.filter_cache_metrics;
+		m_evttypes_with_rules = s.m_evttypes_with_rules;
+		m_sampler = s.m_sampler;
 		return *this;
 	};
 
@@ -52,10 +63,31 @@ struct falco_source
 	std::shared_ptr<sinsp_filter_factory> filter_factory;
 	std::shared_ptr<sinsp_evt_formatter_factory> formatter_factory;
 
+	// Used when compiling the rule conditions of this source, so that
+	// each field extraction and comparison shared by multiple rules is
+	// performed at most once per event. The metrics count how many of
+	// them were actually performed and how many were served by the cache.
+	std::shared_ptr<sinsp_filter_cache_factory> filter_cache_factory;
+	std::shared_ptr<sinsp_filter_cache_metrics> filter_cache_metrics;
+
 	// Used by the filter_ruleset interface. Filled in when a rule
 	// matches an event.
 	mutable std::vector<falco_rule> m_rules;
 
+	// Used by the filter_ruleset interface when running multiple
+	// rulesets at once. Filled in when a rule matches an event.
+	mutable std::vector<std::pair<falco_rule, uint64_t>> m_ruleset_matches;
+
+	// Bitmap indexed by event type, telling whether at least one rule
+	// is enabled for that event type in the default ruleset. Filled in
+	// when rule loading completes, and invalid when not up to date.
+	mutable evttype_bitmap m_evttypes_with_rules;
+
+	// Used to sample events when the engine's sampling is active. Each
+	// source has its own, as events of different sources are processed
+	// by different threads.
+	mutable event_sampler m_sampler;
+
 	inline bool is_valid_lhs_field(const std::string& field) const
 	{
 		// if there's at least one parenthesis we may be parsing a field
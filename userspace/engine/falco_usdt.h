@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+/*!
+	\brief USDT (user-level statically defined tracing) probes exposed by
+	the "falco" provider. They are only compiled in when building with
+	BUILD_FALCO_USDT=ON; otherwise every probe expands to nothing. When
+	compiled in but not attached, each probe site is a single nop and the
+	arguments are only computed into registers, so arguments must stay
+	cheap (integers and already available pointers only).
+
+	The probes and their arguments are:
+	- event_receive(ts, type): an event was read from the inspector
+	- ruleset_run(ts, type, ruleset_id): rules are about to be evaluated
+	- rulesets_run(ts, type, ruleset_mask): rules are about to be
+	  evaluated for all the rulesets selected by the mask
+	- ruleset_run_done(ts, matched): follows both of the above
+	- rule_eval(ts, rule_id): a single rule filter is about to be evaluated
+	- rule_eval_done(ts, rule_id, result)
+	- rule_match(ts, rule_id, priority, rule_name): a match is returned to the caller
+	- format(ts, priority, rule_name): an alert is about to be formatted
+	- format_done(ts)
+	- queue_push(ts, queue_bytes): an alert was pushed to the outputs queue,
+	  which now holds queue_bytes bytes of alerts
+	- queue_pop(ts): the outputs worker picked up an alert
+	- output(ts, output_name): an alert is about to be sent to an output
+	- output_done(ts, output_name)
+
+	"ts" is always the timestamp of the originating event, which lets
+	tracers correlate the probes of the same alert across threads.
+	See scripts/usdt for ready-to-use bpftrace scripts.
+*/
+
+#ifdef HAS_USDT
+#include <sys/sdt.h>
+
+#define FALCO_USDT(name) DTRACE_PROBE(falco, name)
+#define FALCO_USDT1(name, a1) DTRACE_PROBE1(falco, name, a1)
+#define FALCO_USDT2(name, a1, a2) DTRACE_PROBE2(falco, name, a1, a2)
+#define FALCO_USDT3(name, a1, a2, a3) DTRACE_PROBE3(falco, name, a1, a2, a3)
+#define FALCO_USDT4(name, a1, a2, a3, a4) DTRACE_PROBE4(falco, name, a1, a2, a3, a4)
+#else
+#define FALCO_USDT(name) do {} while(0)
+#define FALCO_USDT1(name, a1) do {} while(0)
+#define FALCO_USDT2(name, a1, a2) do {} while(0)
+#define FALCO_USDT3(name, a1, a2, a3) do {} while(0)
+#define FALCO_USDT4(name, a1, a2, a3, a4) do {} while(0)
+#endif
@@ -26,6 +26,7 @@ limitations under the License.
 #include <openssl/sha.h>
 #endif
 #include <cstring>
+#include <ctime>
 #include <fstream>
 #include <iomanip>
 #include <thread>
@@ -192,6 +193,42 @@ uint32_t hardware_concurrency()
 	return hc ? hc : 1;
 }
 
+void append_iso8601(std::string& out, uint64_t ts_ns, uint32_t frac_digits)
+{
+	static thread_local uint64_t cached_sec = UINT64_MAX;
+	static thread_local char cached[32];
+	static thread_local size_t cached_len = 0;
+
+	uint64_t sec = ts_ns / 1000000000;
+	if(sec != cached_sec)
+	{
+		time_t t = (time_t) sec;
+		struct tm tm = {};
+#ifdef _WIN32
+		gmtime_s(&tm, &t);
+#else
+		gmtime_r(&t, &tm);
+#endif
+		cached_len = strftime(cached, sizeof(cached), "%Y-%m-%dT%H:%M:%S", &tm);
+		cached_sec = sec;
+	}
+	out.append(cached, cached_len);
+
+	if(frac_digits > 0)
+	{
+		char frac[10];
+		uint64_t ns = ts_ns % 1000000000;
+		for(int i = 8; i >= 0; i--)
+		{
+			frac[i + 1] = '0' + (ns % 10);
+			ns /= 10;
+		}
+		frac[0] = '.';
+		out.append(frac, 1 + (frac_digits < 9 ? frac_digits : 9));
+	}
+	out += 'Z';
+}
+
 void readfile(const std::string& filename, std::string& data)
 {
 	std::ifstream file(filename, std::ios::in);
@@ -39,6 +39,12 @@ void readfile(const std::string& filename, std::string& data);
 
 uint32_t hardware_concurrency();
 
+// Appends the ISO 8601 UTC representation of a timestamp in nanoseconds,
+// e.g. 2024-01-01T00:00:00.123456789Z, with the given number of fractional
+// digits (up to 9). The date and time part is cached per thread and only
+// formatted again when the second changes.
+void append_iso8601(std::string& out, uint64_t ts_ns, uint32_t frac_digits = 9);
+
 bool matches_wildcard(const std::string &pattern, const std::string &s);
 
 namespace network
@@ -0,0 +1,266 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "filter_bytecode.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+using namespace libsinsp::filter;
+
+static const std::vector<std::unique_ptr<ast::expr>>* operands(const ast::expr* e, bool& is_and)
+{
+	if(auto a = dynamic_cast<const ast::and_expr*>(e))
+	{
+		is_and = true;
+		return &a->children;
+	}
+	if(auto o = dynamic_cast<const ast::or_expr*>(e))
+	{
+		is_and = false;
+		return &o->children;
+	}
+	return nullptr;
+}
+
+filter_bytecode::filter_bytecode(const ast::expr* condition, const operand_order* order)
+{
+	lower(condition, order);
+	m_code.push_back({opcode::RETURN, 0});
+}
+
+void filter_bytecode::lower(const ast::expr* e, const operand_order* order)
+{
+	bool is_and = false;
+	auto children = operands(e, is_and);
+	if(children)
+	{
+		const std::vector<uint32_t>* perm = nullptr;
+		if(order)
+		{
+			auto it = order->find(e);
+			if(it != order->end() && it->second.size() == children->size())
+			{
+				perm = &it->second;
+			}
+		}
+
+		// each child but the last one jumps to the end as soon as
+		// its value decides the result, leaving it in the register
+		auto jump = is_and ? opcode::JUMP_IF_FALSE : opcode::JUMP_IF_TRUE;
+		std::vector<size_t> pending;
+		for(size_t i = 0; i < children->size(); i++)
+		{
+			lower((*children)[perm ? (*perm)[i] : i].get(), order);
+			if(i + 1 < children->size())
+			{
+				pending.push_back(m_code.size());
+				m_code.push_back({jump, 0});
+			}
+		}
+		for(auto p : pending)
+		{
+			m_code[p].arg = m_code.size();
+		}
+		return;
+	}
+
+	auto not_e = dynamic_cast<const ast::not_expr*>(e);
+	if(not_e)
+	{
+		lower(not_e->child.get(), order);
+		m_code.push_back({opcode::NOT, 0});
+		return;
+	}
+
+	m_code.push_back({opcode::LOAD, (uint32_t) m_leaves.size()});
+	m_leaves.push_back(e);
+}
+
+bytecode_filter::bytecode_filter(
+	std::shared_ptr<sinsp_filter_factory> factory,
+	const ast::expr* condition,
+	std::shared_ptr<sinsp_filter_cache_factory> cache_factory):
+	m_condition(condition),
+	m_program(condition),
+	m_sampling_period(0),
+	m_sampling_countdown(0),
+	m_samples_per_update(0),
+	m_samples(0),
+	m_num_reorders(0)
+{
+	for(const auto* leaf : m_program.leaves())
+	{
+		sinsp_filter_compiler compiler(factory, leaf, cache_factory);
+		m_owned_leaves.emplace_back(compiler.compile());
+		m_leaf_filters[leaf] = m_owned_leaves.back().get();
+		m_leaves.push_back(m_owned_leaves.back().get());
+	}
+}
+
+void bytecode_filter::set_adaptive(uint32_t sampling_period, uint32_t samples_per_update)
+{
+	m_sampling_period = sampling_period;
+	m_sampling_countdown = sampling_period;
+	m_samples_per_update = std::max<uint32_t>(samples_per_update, 1);
+	m_samples = 0;
+	m_stats.clear();
+}
+
+bool bytecode_filter::run_profiled(sinsp_evt* evt)
+{
+	m_sampling_countdown = m_sampling_period;
+	bool res = profile(m_condition, evt);
+	if(++m_samples >= m_samples_per_update)
+	{
+		auto order = best_order(m_condition, m_stats, m_order);
+		if(order != m_order)
+		{
+			rebuild(order);
+		}
+		m_samples = 0;
+		m_stats.clear();
+	}
+	return res;
+}
+
+bool bytecode_filter::profile(const ast::expr* e, sinsp_evt* evt)
+{
+	bool is_and = false;
+	auto children = operands(e, is_and);
+	if(children)
+	{
+		auto it = m_order.find(e);
+		const std::vector<uint32_t>* perm = it != m_order.end() ? &it->second : nullptr;
+		for(size_t i = 0; i < children->size(); i++)
+		{
+			const ast::expr* child = (*children)[perm ? (*perm)[i] : i].get();
+			auto start = std::chrono::steady_clock::now();
+			bool res = profile(child, evt);
+			auto& st = m_stats[child];
+			st.cost_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count();
+			st.evals++;
+			st.passes += res ? 1 : 0;
+			if(res != is_and)
+			{
+				return res;
+			}
+		}
+		return is_and;
+	}
+
+	auto not_e = dynamic_cast<const ast::not_expr*>(e);
+	if(not_e)
+	{
+		return !profile(not_e->child.get(), evt);
+	}
+
+	return m_leaf_filters.at(e)->run(evt);
+}
+
+void bytecode_filter::rebuild(const filter_bytecode::operand_order& order)
+{
+	// leaves are shared across programs, only their indexes change
+	filter_bytecode program(m_condition, &order);
+	std::vector<sinsp_filter*> leaves;
+	leaves.reserve(program.leaves().size());
+	for(const auto* leaf : program.leaves())
+	{
+		leaves.push_back(m_leaf_filters.at(leaf));
+	}
+	m_program = std::move(program);
+	m_leaves = std::move(leaves);
+	m_order = order;
+	m_num_reorders++;
+}
+
+static void best_order_rec(
+	const ast::expr* e,
+	const bytecode_filter::operand_stats_map& stats,
+	const filter_bytecode::operand_order& current,
+	filter_bytecode::operand_order& out)
+{
+	bool is_and = false;
+	auto children = operands(e, is_and);
+	if(!children)
+	{
+		auto not_e = dynamic_cast<const ast::not_expr*>(e);
+		if(not_e)
+		{
+			best_order_rec(not_e->child.get(), stats, current, out);
+		}
+		return;
+	}
+
+	std::vector<uint32_t> perm;
+	auto it = current.find(e);
+	if(it != current.end() && it->second.size() == children->size())
+	{
+		perm = it->second;
+	}
+	else
+	{
+		for(uint32_t i = 0; i < children->size(); i++)
+		{
+			perm.push_back(i);
+		}
+	}
+
+	// expected cost spent before deciding the result of the node, with
+	// a smoothed probability for the operand to decide it
+	std::vector<double> rank(children->size(), std::numeric_limits<double>::infinity());
+	for(uint32_t i = 0; i < children->size(); i++)
+	{
+		const ast::expr* child = (*children)[i].get();
+		auto st = stats.find(child);
+		if(st != stats.end() && st->second.evals > 0)
+		{
+			double pass = (st->second.passes + 1.0) / (st->second.evals + 2.0);
+			double decisive = is_and ? 1.0 - pass : pass;
+			double cost = (double) st->second.cost_ns / st->second.evals;
+			rank[i] = cost / decisive;
+		}
+		best_order_rec(child, stats, current, out);
+	}
+
+	std::stable_sort(perm.begin(), perm.end(), [&rank](uint32_t a, uint32_t b)
+	{
+		return rank[a] < rank[b];
+	});
+
+	bool identity = true;
+	for(uint32_t i = 0; i < perm.size(); i++)
+	{
+		identity = identity && perm[i] == i;
+	}
+	if(!identity)
+	{
+		out[e] = std::move(perm);
+	}
+}
+
+filter_bytecode::operand_order bytecode_filter::best_order(
+	const ast::expr* condition,
+	const operand_stats_map& stats,
+	const filter_bytecode::operand_order& current)
+{
+	filter_bytecode::operand_order out;
+	best_order_rec(condition, stats, current, out);
+	return out;
+}
@@ -0,0 +1,241 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <libsinsp/filter/ast.h>
+#include <libsinsp/filter.h>
+#include <libsinsp/filter_cache.h>
+#include <libsinsp/event.h>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/*!
+	\brief A rule condition lowered into a flat sequence of instructions
+	operating on a single boolean register. and/or/not nodes become
+	short-circuit jumps, and every other node of the resolved AST
+	(field checks, in practice) becomes a leaf that is loaded into the
+	register. The evaluation of leaves is delegated to the caller, so
+	that the control flow is independent from the filterchecks.
+*/
+class filter_bytecode
+{
+public:
+	enum class opcode : uint8_t
+	{
+		// reg = leaf[arg]
+		LOAD = 0,
+		// reg = !reg
+		NOT = 1,
+		// if (!reg) goto arg
+		JUMP_IF_FALSE = 2,
+		// if (reg) goto arg
+		JUMP_IF_TRUE = 3,
+		// return reg
+		RETURN = 4,
+	};
+
+	struct instruction
+	{
+		opcode op;
+		uint32_t arg;
+	};
+
+	// The order in which the children of and/or nodes are evaluated,
+	// as a permutation of their indexes. Missing nodes keep the
+	// order in which the children appear in the AST.
+	using operand_order = std::unordered_map<const libsinsp::filter::ast::expr*, std::vector<uint32_t>>;
+
+	/*!
+		\brief Lowers the given resolved condition. All macros must
+		have already been resolved.
+		\param order If not null, the order of the operands of and/or
+		nodes. Since filterchecks have no side effects, this changes
+		the cost of the evaluation but not its result.
+	*/
+	explicit filter_bytecode(
+		const libsinsp::filter::ast::expr* condition,
+		const operand_order* order = nullptr);
+
+	/*!
+		\brief Returns the leaf nodes of the condition, in the order of
+		their indexes. Pointers refer to the AST passed in the constructor.
+	*/
+	inline const std::vector<const libsinsp::filter::ast::expr*>& leaves() const
+	{
+		return m_leaves;
+	}
+
+	inline const std::vector<instruction>& code() const
+	{
+		return m_code;
+	}
+
+	/*!
+		\brief Executes the program, calling load(idx) for each leaf
+		that needs to be evaluated
+	*/
+	template<typename F>
+	inline bool run(F&& load) const
+	{
+		bool reg = false;
+		const instruction* code = m_code.data();
+		for(uint32_t pc = 0; ; pc++)
+		{
+			const auto& i = code[pc];
+			switch(i.op)
+			{
+			case opcode::LOAD:
+				reg = load(i.arg);
+				break;
+			case opcode::NOT:
+				reg = !reg;
+				break;
+			case opcode::JUMP_IF_FALSE:
+				if(!reg)
+				{
+					pc = i.arg - 1;
+				}
+				break;
+			case opcode::JUMP_IF_TRUE:
+				if(reg)
+				{
+					pc = i.arg - 1;
+				}
+				break;
+			case opcode::RETURN:
+				return reg;
+			}
+		}
+	}
+
+private:
+	void lower(const libsinsp::filter::ast::expr* e, const operand_order* order);
+
+	std::vector<instruction> m_code;
+	std::vector<const libsinsp::filter::ast::expr*> m_leaves;
+};
+
+/*!
+	\brief A compiled rule condition evaluated through a filter_bytecode
+	program, in which each leaf is a sinsp_filter compiled on its own.
+	Leaves are stored contiguously and evaluated only when reached by
+	the program, so it produces the same result of the sinsp_filter
+	compiled from the whole condition.
+	Optionally, the filter can profile a sample of its evaluations and
+	periodically reorder the operands of and/or nodes so that the
+	cheapest and most decisive ones are evaluated first.
+	This class is not thread-safe.
+*/
+class bytecode_filter
+{
+public:
+	// Sampled runtime statistics of an operand of an and/or node
+	struct operand_stats
+	{
+		uint64_t evals = 0;
+		uint64_t passes = 0;
+		uint64_t cost_ns = 0;
+	};
+
+	using operand_stats_map = std::unordered_map<const libsinsp::filter::ast::expr*, operand_stats>;
+
+	/*!
+		\brief Compiles the given resolved condition. Throws a
+		sinsp_exception if any of the leaves can't be compiled.
+		The condition must outlive this object.
+		\param cache_factory If not null, used to compile the leaves so
+		that they share the extraction and comparison caches of the
+		other filters compiled with it
+	*/
+	bytecode_filter(
+		std::shared_ptr<sinsp_filter_factory> factory,
+		const libsinsp::filter::ast::expr* condition,
+		std::shared_ptr<sinsp_filter_cache_factory> cache_factory = nullptr);
+
+	/*!
+		\brief Enables the adaptive reordering of operands: one
+		evaluation every sampling_period is profiled, and the program
+		is rebuilt after every samples_per_update profiled evaluations.
+		A sampling_period of 0 disables it.
+	*/
+	void set_adaptive(uint32_t sampling_period, uint32_t samples_per_update);
+
+	inline bool run(sinsp_evt* evt)
+	{
+		if(m_sampling_period != 0 && --m_sampling_countdown == 0)
+		{
+			return run_profiled(evt);
+		}
+
+		sinsp_filter* const* leaves = m_leaves.data();
+		return m_program.run([evt, leaves](uint32_t idx)
+		{
+			return leaves[idx]->run(evt);
+		});
+	}
+
+	inline const filter_bytecode& program() const
+	{
+		return m_program;
+	}
+
+	inline const filter_bytecode::operand_order& order() const
+	{
+		return m_order;
+	}
+
+	inline uint64_t num_reorders() const
+	{
+		return m_num_reorders;
+	}
+
+	/*!
+		\brief Returns the order of the operands of each and/or node in
+		the condition that minimizes the expected evaluation cost,
+		given their statistics. Operands of and nodes are sorted by
+		cost / P(false), and the ones of or nodes by cost / P(true).
+		Operands without statistics are evaluated last, and ties keep
+		the current order.
+	*/
+	static filter_bytecode::operand_order best_order(
+		const libsinsp::filter::ast::expr* condition,
+		const operand_stats_map& stats,
+		const filter_bytecode::operand_order& current);
+
+private:
+	bool run_profiled(sinsp_evt* evt);
+	bool profile(const libsinsp::filter::ast::expr* e, sinsp_evt* evt);
+	void rebuild(const filter_bytecode::operand_order& order);
+
+	const libsinsp::filter::ast::expr* m_condition;
+	filter_bytecode m_program;
+	std::vector<std::unique_ptr<sinsp_filter>> m_owned_leaves;
+	std::unordered_map<const libsinsp::filter::ast::expr*, sinsp_filter*> m_leaf_filters;
+	std::vector<sinsp_filter*> m_leaves;
+
+	filter_bytecode::operand_order m_order;
+	operand_stats_map m_stats;
+	uint32_t m_sampling_period;
+	uint32_t m_sampling_countdown;
+	uint32_t m_samples_per_update;
+	uint32_t m_samples;
+	uint64_t m_num_reorders;
+};
@@ -17,6 +17,8 @@ limitations under the License.
 
 #include "filter_ruleset.h"
 
+#include <algorithm>
+
 void filter_ruleset::set_engine_state(const filter_ruleset::engine_state_funcs& engine_state)
 {
 	m_engine_state = engine_state;
@@ -26,3 +28,59 @@ filter_ruleset::engine_state_funcs& filter_ruleset::get_engine_state()
 {
 	return m_engine_state;
 }
+
+bool filter_ruleset::run_rulesets(
+	sinsp_evt *evt,
+	std::vector<std::pair<falco_rule, uint64_t>>& matches,
+	uint64_t ruleset_mask)
+{
+	bool match_found = false;
+	std::vector<falco_rule> ruleset_matches;
+	for(uint16_t id = 0; id < 64; id++)
+	{
+		uint64_t bit = 1ULL << id;
+		if(!(ruleset_mask & bit))
+		{
+			continue;
+		}
+
+		ruleset_matches.clear();
+		if(!run(evt, ruleset_matches, id))
+		{
+			continue;
+		}
+
+		match_found = true;
+		for(auto& rule : ruleset_matches)
+		{
+			auto it = std::find_if(matches.begin(), matches.end(),
+				[&rule](const std::pair<falco_rule, uint64_t>& m) { return m.first.id == rule.id; });
+			if(it != matches.end())
+			{
+				it->second |= bit;
+			}
+			else
+			{
+				matches.emplace_back(std::move(rule), bit);
+			}
+		}
+	}
+	return match_found;
+}
+
+void filter_ruleset::run_profiled(
+	sinsp_evt *evt,
+	uint16_t ruleset_id,
+	const profile_callback_t& on_rule)
+{
+	std::vector<falco_rule> matches;
+	if(!run(evt, matches, ruleset_id))
+	{
+		return;
+	}
+
+	for(const auto& rule : matches)
+	{
+		on_rule(rule, true, 0);
+	}
+}
@@ -21,6 +21,7 @@ limitations under the License.
 #include "rule_loader_compile_output.h"
 #include <libsinsp/filter/ast.h>
 #include <libsinsp/filter.h>
+#include <libsinsp/filter_cache.h>
 #include <libsinsp/event.h>
 #include <libsinsp/events/sinsp_events.h>
 
@@ -37,8 +38,14 @@ public:
 	struct engine_state_funcs
 	{
 		using ruleset_retriever_func_t = std::function<bool(const std::string &, std::shared_ptr<filter_ruleset> &ruleset)>;
+		using filter_cache_factory_retriever_func_t = std::function<std::shared_ptr<sinsp_filter_cache_factory>(const std::string &source)>;
 
 		ruleset_retriever_func_t get_ruleset;
+
+		// Returns the cache factory used to compile the rule conditions
+		// of the given source, if any, so that the filters compiled by
+		// the ruleset share the same caches
+		filter_cache_factory_retriever_func_t get_filter_cache_factory;
 	};
 
 	enum class match_type {
@@ -134,6 +141,47 @@ public:
 		std::vector<falco_rule>& matches,
 		uint16_t ruleset_id) = 0;
 
+	/*!
+		\brief Processes an event against several rulesets at once, and
+		finds all the rules that match it in any of them. The default
+		implementation runs each ruleset separately and merges the
+		results, but can be overridden to evaluate each rule only once.
+		\return true if a match is found, false otherwise
+		\param evt The event to be processed
+		\param matches If true is returned, this is filled-out with all
+		the rules that matched the event, each paired with the mask of
+		the selected rulesets in which it is enabled
+		\param ruleset_mask The rulesets to be used, where bit i stands
+		for the ruleset with id i. Only the first 64 ids can be selected.
+	*/
+	virtual bool run_rulesets(
+		sinsp_evt *evt,
+		std::vector<std::pair<falco_rule, uint64_t>>& matches,
+		uint64_t ruleset_mask);
+
+	/*!
+		\brief Invoked by run_profiled() for each evaluated rule, with
+		whether the rule matched and the time spent evaluating it in
+		nanoseconds.
+	*/
+	using profile_callback_t = std::function<void(const falco_rule &rule, bool matched, uint64_t cost_ns)>;
+
+	/*!
+		\brief Processes an event and evaluates every candidate rule of
+		a given ruleset in isolation, measuring the cost of each. This
+		does not share any work across rules, so it is meant for
+		profiling only and is much slower than run(). The default
+		implementation relies on run() and only reports the rules that
+		matched, with no cost, but can be overridden.
+		\param evt The event to be processed
+		\param ruleset_id The id of the ruleset to be used
+		\param on_rule Invoked once for each evaluated rule
+	*/
+	virtual void run_profiled(
+		sinsp_evt *evt,
+		uint16_t ruleset_id,
+		const profile_callback_t& on_rule);
+
 	/*!
 		\brief Returns the number of rules enabled in a given ruleset
 		\param ruleset_id The id of the ruleset to be used
@@ -15,10 +15,11 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
-#include <json/json.h>
-
 #include "formats.h"
 #include "falco_engine.h"
+#include "json_writer.h"
+
+#include <string_view>
 
 falco_formats::falco_formats(std::shared_ptr<const falco_engine> engine,
 			     bool json_include_output_property,
@@ -48,84 +49,53 @@ std::string falco_formats::format_event(sinsp_evt *evt, const std::string &rule,
 
 	if(formatter->get_output_format() == sinsp_evt_formatter::OF_JSON)
 	{
-		std::string json_line;
+		// Scratch buffer for the formatted fields, reused across events
+		static thread_local std::string json_line;
+		json_line.clear();
 
 		// Format the event into a json object with all fields resolved
 		formatter->tostring(evt, json_line);
 
-		// The formatted string might have a leading newline. If it does, remove it.
-		if(json_line[0] == '\n')
+		// The formatted string might have a leading newline. If it does, skip it.
+		std::string_view output_fields = json_line;
+		if(!output_fields.empty() && output_fields[0] == '\n')
 		{
-			json_line.erase(0, 1);
+			output_fields.remove_prefix(1);
 		}
 
 		// For JSON output, the formatter returned a json-as-text
 		// object containing all the fields in the original format
 		// message as well as the event time in ns. Use this to build
 		// a more detailed object containing the event time, rule,
-		// severity, full output, and fields.
-		Json::Value event;
-		Json::Value rule_tags;
-		Json::FastWriter writer;
+		// severity, full output, and fields. The object is streamed
+		// straight into the result, and the formatted fields are
+		// grafted as they are, without parsing them.
 		std::string full_line;
-		unsigned int rule_tags_idx = 0;
-
-		// Convert the time-as-nanoseconds to a more json-friendly ISO8601.
-		time_t evttime = evt->get_ts() / 1000000000;
-		char time_sec[20]; // sizeof "YYYY-MM-DDTHH:MM:SS"
-		char time_ns[12];  // sizeof ".sssssssssZ"
-		std::string iso8601evttime;
-
-		strftime(time_sec, sizeof(time_sec), "%FT%T", gmtime(&evttime));
-		snprintf(time_ns, sizeof(time_ns), ".%09luZ", evt->get_ts() % 1000000000);
-		iso8601evttime = time_sec;
-		iso8601evttime += time_ns;
-		event["time"] = iso8601evttime;
-		event["rule"] = rule;
-		event["priority"] = level;
-		event["source"] = source;
-		event["hostname"] = hostname;
-
+		full_line.reserve(output_fields.size() + line.size() + rule.size() + hostname.size() + 256);
+		falco::json_writer w(full_line);
+		w.begin_object();
+		w.key("hostname").value(hostname);
 		if(m_json_include_output_property)
 		{
 			// This is the filled-in output line.
-			event["output"] = line;
+			w.key("output").value(line);
 		}
-
+		w.key("priority").value(level);
+		w.key("rule").value(rule);
+		w.key("source").value(source);
 		if(m_json_include_tags_property)
 		{
-			if (tags.size() == 0)
-			{
-				// This sets an empty array
-				rule_tags = Json::arrayValue;
-			}
-			else
+			w.key("tags").begin_array();
+			for (const auto &tag : tags)
 			{
-				for (const auto &tag : tags)
-				{
-					rule_tags[rule_tags_idx++] = tag;
-				}
+				w.value(tag);
 			}
-			event["tags"] = rule_tags;
+			w.end_array();
 		}
-
-		full_line = writer.write(event);
-
-		// Json::FastWriter may add a trailing newline. If it
-		// does, remove it.
-		if(full_line[full_line.length() - 1] == '\n')
-		{
-			full_line.resize(full_line.length() - 1);
-		}
-
-		// Cheat-graft the output from the formatter into this
-		// string. Avoids an unnecessary json parse just to
-		// merge the formatted fields at the object level.
-		full_line.pop_back();
-		full_line.append(", \"output_fields\": ");
-		full_line.append(json_line);
-		full_line.append("}");
-		line = full_line;
+		w.key("time").time(evt->get_ts());
+		w.key("output_fields").raw(output_fields.empty() ? "{}" : output_fields);
+		w.end_object();
+		line = std::move(full_line);
 	}
 
 	return line;
@@ -27,6 +27,7 @@ limitations under the License.
 
 #include "falco_utils.h"
 #include "filter_ruleset.h"
+#include "falco_usdt.h"
 
 #include <libsinsp/sinsp.h>
 #include <libsinsp/filter.h>
@@ -57,6 +58,7 @@ public:
 			m_rulesets[i] = std::make_shared<ruleset_filters>(i);
 		}
 		m_filters.clear();
+		m_version++;
 	}
 
 	uint64_t enabled_count(uint16_t ruleset_id) override
@@ -139,7 +141,10 @@ public:
 			return false;
 		}
 
-		return m_rulesets[ruleset_id]->run(*this, evt, match);
+		FALCO_USDT3(ruleset_run, evt->get_ts(), evt->get_type(), ruleset_id);
+		bool res = m_rulesets[ruleset_id]->run(*this, evt, match);
+		FALCO_USDT2(ruleset_run_done, evt->get_ts(), res);
+		return res;
 	}
 
 	bool run(sinsp_evt *evt, std::vector<falco_rule> &matches, uint16_t ruleset_id) override
@@ -149,7 +154,10 @@ public:
 			return false;
 		}
 
-		return m_rulesets[ruleset_id]->run(*this, evt, matches);
+		FALCO_USDT3(ruleset_run, evt->get_ts(), evt->get_type(), ruleset_id);
+		bool res = m_rulesets[ruleset_id]->run(*this, evt, matches);
+		FALCO_USDT2(ruleset_run_done, evt->get_ts(), res);
+		return res;
 	}
 
 	typedef std::list<std::shared_ptr<filter_wrapper>>
@@ -160,6 +168,7 @@ public:
 	void add_wrapper(std::shared_ptr<filter_wrapper> wrap)
 	{
 		m_filters.insert(wrap);
+		m_version++;
 	}
 
 	// If a subclass needs to iterate over all filters, they can
@@ -191,6 +200,33 @@ public:
 	virtual bool run_wrappers(sinsp_evt *evt, filter_wrapper_list &wrappers, uint16_t ruleset_id, std::vector<falco_rule> &matches) = 0;
 	virtual bool run_wrappers(sinsp_evt *evt, filter_wrapper_list &wrappers, uint16_t ruleset_id, falco_rule &match) = 0;
 
+protected:
+	// Returns a counter that changes every time a filter is added or
+	// any ruleset gets filters enabled or disabled. Subclasses can use
+	// it to know when data derived from the enabled filters is outdated.
+	inline uint64_t version() const
+	{
+		return m_version;
+	}
+
+	inline size_t num_rulesets() const
+	{
+		return m_rulesets.size();
+	}
+
+	// Return the filters enabled for a given ruleset, indexed by
+	// event type, and the ones that run for all event types. These
+	// are the same filters passed to run_wrappers() by run().
+	inline const std::vector<filter_wrapper_list> &wrappers_by_event_type(uint16_t ruleset_id) const
+	{
+		return m_rulesets[ruleset_id]->get_filters_by_event_type();
+	}
+
+	inline const filter_wrapper_list &wrappers_all_event_types(uint16_t ruleset_id) const
+	{
+		return m_rulesets[ruleset_id]->get_filters_all_event_types();
+	}
+
 private:
 	// Helper used by enable()/disable()
 	void enable_disable(
@@ -203,6 +239,7 @@ private:
 		{
 			m_rulesets.emplace_back(std::make_shared<ruleset_filters>(m_rulesets.size()));
 		}
+		m_version++;
 
 		for(const auto &wrap : m_filters)
 		{
@@ -252,6 +289,7 @@ private:
 		{
 			m_rulesets.emplace_back(std::make_shared<ruleset_filters>(m_rulesets.size()));
 		}
+		m_version++;
 
 		for(const auto &wrap : m_filters)
 		{
@@ -337,6 +375,16 @@ private:
 			return m_filters;
 		}
 
+		inline const std::vector<filter_wrapper_list> &get_filters_by_event_type() const
+		{
+			return m_filter_by_event_type;
+		}
+
+		inline const filter_wrapper_list &get_filters_all_event_types() const
+		{
+			return m_filter_all_event_types;
+		}
+
 		// Evaluate an event against the ruleset and return the first rule
 		// that matched.
 		bool run(indexable_ruleset &ruleset, sinsp_evt *evt, falco_rule &match)
@@ -451,4 +499,6 @@ private:
 
 	// All filters added. The set of enabled filters is held in m_rulesets
 	std::set<std::shared_ptr<filter_wrapper>> m_filters;
+
+	uint64_t m_version = 0;
 };
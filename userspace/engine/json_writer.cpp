@@ -0,0 +1,267 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "json_writer.h"
+#include "falco_utils.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace falco;
+
+static const char s_hex[] = "0123456789abcdef";
+
+// Returns the position of the first byte that can't be copied as is,
+// that is a quote, a backslash, a control character or a non-ASCII byte
+static inline size_t find_special(const char* s, size_t pos, size_t len)
+{
+#if defined(__SSE2__)
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i space = _mm_set1_epi8(0x20);
+	while(pos + 16 <= len)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*) (s + pos));
+		__m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash));
+		// in a signed comparison non-ASCII bytes are negative, so this
+		// catches them together with the control characters
+		m = _mm_or_si128(m, _mm_cmplt_epi8(v, space));
+		int mask = _mm_movemask_epi8(m);
+		if(mask != 0)
+		{
+			return pos + __builtin_ctz(mask);
+		}
+		pos += 16;
+	}
+#endif
+	for(; pos < len; pos++)
+	{
+		unsigned char c = s[pos];
+		if(c < 0x20 || c >= 0x80 || c == '"' || c == '\\')
+		{
+			break;
+		}
+	}
+	return pos;
+}
+
+// Returns the length of the valid UTF-8 sequence starting at pos, or 0
+static inline size_t utf8_sequence_len(const unsigned char* s, size_t pos, size_t len)
+{
+	unsigned char c = s[pos];
+	size_t n = 0;
+	unsigned char lo = 0x80, hi = 0xBF;
+	if(c >= 0xC2 && c <= 0xDF)
+	{
+		n = 2;
+	}
+	else if(c >= 0xE0 && c <= 0xEF)
+	{
+		n = 3;
+		// no overlong encodings and no surrogates
+		lo = c == 0xE0 ? 0xA0 : 0x80;
+		hi = c == 0xED ? 0x9F : 0xBF;
+	}
+	else if(c >= 0xF0 && c <= 0xF4)
+	{
+		n = 4;
+		// no overlong encodings and nothing above U+10FFFF
+		lo = c == 0xF0 ? 0x90 : 0x80;
+		hi = c == 0xF4 ? 0x8F : 0xBF;
+	}
+	if(n == 0 || pos + n > len || s[pos + 1] < lo || s[pos + 1] > hi)
+	{
+		return 0;
+	}
+	for(size_t i = 2; i < n; i++)
+	{
+		if(s[pos + i] < 0x80 || s[pos + i] > 0xBF)
+		{
+			return 0;
+		}
+	}
+	return n;
+}
+
+void json_writer::append_string(std::string& out, std::string_view s)
+{
+	const char* data = s.data();
+	size_t len = s.size();
+	size_t pos = 0;
+	out += '"';
+	while(pos < len)
+	{
+		size_t next = find_special(data, pos, len);
+		out.append(data + pos, next - pos);
+		pos = next;
+		if(pos == len)
+		{
+			break;
+		}
+
+		unsigned char c = data[pos];
+		if(c >= 0x80)
+		{
+			size_t n = utf8_sequence_len((const unsigned char*) data, pos, len);
+			if(n == 0)
+			{
+				out.append("\\ufffd");
+				pos++;
+			}
+			else
+			{
+				out.append(data + pos, n);
+				pos += n;
+			}
+			continue;
+		}
+
+		switch(c)
+		{
+		case '"':
+			out.append("\\\"");
+			break;
+		case '\\':
+			out.append("\\\\");
+			break;
+		case '\b':
+			out.append("\\b");
+			break;
+		case '\f':
+			out.append("\\f");
+			break;
+		case '\n':
+			out.append("\\n");
+			break;
+		case '\r':
+			out.append("\\r");
+			break;
+		case '\t':
+			out.append("\\t");
+			break;
+		default:
+			out.append("\\u00");
+			out += s_hex[c >> 4];
+			out += s_hex[c & 0xF];
+			break;
+		}
+		pos++;
+	}
+	out += '"';
+}
+
+void json_writer::append_uint(std::string& out, uint64_t v)
+{
+	char buf[20];
+	size_t i = sizeof(buf);
+	do
+	{
+		buf[--i] = '0' + (v % 10);
+		v /= 10;
+	} while(v != 0);
+	out.append(buf + i, sizeof(buf) - i);
+}
+
+void json_writer::append_int(std::string& out, int64_t v)
+{
+	if(v < 0)
+	{
+		out += '-';
+		// negating in unsigned arithmetic also works for INT64_MIN
+		append_uint(out, 0 - (uint64_t) v);
+		return;
+	}
+	append_uint(out, (uint64_t) v);
+}
+
+void json_writer::append_double(std::string& out, double v)
+{
+	if(!std::isfinite(v))
+	{
+		out.append("null");
+		return;
+	}
+
+	// most values round-trip with 15 digits, which avoids printing
+	// representation noise such as 0.10000000000000001. The others need
+	// 17 digits, even if fewer might do: printing the shortest
+	// representation would require std::to_chars for doubles, which is
+	// not available with all the supported toolchains
+	char buf[32];
+	int len = snprintf(buf, sizeof(buf), "%.15g", v);
+	if(strtod(buf, nullptr) != v)
+	{
+		len = snprintf(buf, sizeof(buf), "%.17g", v);
+	}
+	out.append(buf, len);
+
+	// keep integral values recognizable as floating point ones
+	if(strpbrk(buf, ".e") == nullptr)
+	{
+		out.append(".0");
+	}
+}
+
+json_writer& json_writer::value(const nlohmann::json& v)
+{
+	switch(v.type())
+	{
+	case nlohmann::json::value_t::object:
+		begin_object();
+		for(auto it = v.begin(); it != v.end(); ++it)
+		{
+			key(it.key());
+			value(it.value());
+		}
+		return end_object();
+	case nlohmann::json::value_t::array:
+		begin_array();
+		for(const auto& item : v)
+		{
+			value(item);
+		}
+		return end_array();
+	case nlohmann::json::value_t::string:
+		return value(std::string_view(v.get_ref<const std::string&>()));
+	case nlohmann::json::value_t::boolean:
+		return value(v.get<bool>());
+	case nlohmann::json::value_t::number_integer:
+		return value(v.get<int64_t>());
+	case nlohmann::json::value_t::number_unsigned:
+		return value(v.get<uint64_t>());
+	case nlohmann::json::value_t::number_float:
+		return value(v.get<double>());
+	default:
+		return null();
+	}
+}
+
+json_writer& json_writer::time(uint64_t ts_ns)
+{
+	separator();
+	m_out += '"';
+	falco::utils::append_iso8601(m_out, ts_ns);
+	m_out += '"';
+	m_need_comma = true;
+	return *this;
+}
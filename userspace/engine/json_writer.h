@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <nlohmann/json.hpp>
+
+namespace falco
+{
+
+/*!
+	\brief Streams JSON text into a caller-owned buffer, without building
+	any intermediate document. Commas and colons are emitted as needed, so
+	that a document is written as a plain sequence of calls, and the
+	buffer can be reused across documents to avoid allocations. Strings
+	are escaped as per RFC 8259, and invalid UTF-8 sequences are replaced
+	with U+FFFD. The writer does not check that calls are well nested.
+*/
+class json_writer
+{
+public:
+	explicit json_writer(std::string& out): m_out(out) { }
+
+	json_writer& begin_object()
+	{
+		separator();
+		m_out += '{';
+		m_need_comma = false;
+		return *this;
+	}
+
+	json_writer& end_object()
+	{
+		m_out += '}';
+		m_need_comma = true;
+		return *this;
+	}
+
+	json_writer& begin_array()
+	{
+		separator();
+		m_out += '[';
+		m_need_comma = false;
+		return *this;
+	}
+
+	json_writer& end_array()
+	{
+		m_out += ']';
+		m_need_comma = true;
+		return *this;
+	}
+
+	json_writer& key(std::string_view k)
+	{
+		separator();
+		append_string(m_out, k);
+		m_out += ':';
+		m_need_comma = false;
+		return *this;
+	}
+
+	json_writer& value(std::string_view v)
+	{
+		separator();
+		append_string(m_out, v);
+		m_need_comma = true;
+		return *this;
+	}
+
+	json_writer& value(const char* v)
+	{
+		return value(std::string_view(v));
+	}
+
+	json_writer& value(const std::string& v)
+	{
+		return value(std::string_view(v));
+	}
+
+	json_writer& value(bool v)
+	{
+		return raw(v ? "true" : "false");
+	}
+
+	template<typename T, typename std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value, int> = 0>
+	json_writer& value(T v)
+	{
+		separator();
+		if(std::is_signed<T>::value)
+		{
+			append_int(m_out, (int64_t) v);
+		}
+		else
+		{
+			append_uint(m_out, (uint64_t) v);
+		}
+		m_need_comma = true;
+		return *this;
+	}
+
+	json_writer& value(double v)
+	{
+		separator();
+		append_double(m_out, v);
+		m_need_comma = true;
+		return *this;
+	}
+
+	/*!
+		\brief Writes a document built with nlohmann::json
+	*/
+	json_writer& value(const nlohmann::json& v);
+
+	json_writer& null()
+	{
+		return raw("null");
+	}
+
+	/*!
+		\brief Writes the ISO 8601 representation of a timestamp in
+		nanoseconds as a string, with nanoseconds precision
+	*/
+	json_writer& time(uint64_t ts_ns);
+
+	/*!
+		\brief Writes a value that is already serialized as JSON
+	*/
+	json_writer& raw(std::string_view json)
+	{
+		separator();
+		m_out.append(json.data(), json.size());
+		m_need_comma = true;
+		return *this;
+	}
+
+	/*!
+		\brief Appends a quoted and escaped JSON string
+	*/
+	static void append_string(std::string& out, std::string_view s);
+
+	static void append_int(std::string& out, int64_t v);
+
+	static void append_uint(std::string& out, uint64_t v);
+
+	/*!
+		\brief Appends a representation that parses back to the same
+		value, with 15 significant digits if enough and 17 otherwise.
+		This is not always the shortest one, e.g. 1.0 / 3 is written
+		as 0.33333333333333331 instead of 0.3333333333333333. Non-finite values are written as null.
+	*/
+	static void append_double(std::string& out, double v);
+
+private:
+	inline void separator()
+	{
+		if(m_need_comma)
+		{
+			m_out += ',';
+		}
+	}
+
+	std::string& m_out;
+	bool m_need_comma = false;
+};
+
+} // namespace falco
@@ -0,0 +1,330 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <cstring>
+
+#include <libsinsp/filter.h>
+#include <libsinsp/filter/parser.h>
+
+#include "rule_bundle.h"
+#include "falco_common.h"
+
+static const char s_bundle_magic[8] = {'F', 'A', 'L', 'C', 'O', 'R', 'B', '\0'};
+
+namespace
+{
+	class bundle_writer
+	{
+	public:
+		explicit bundle_writer(std::ostream& out): m_out(out) { }
+
+		void u8(uint8_t v)
+		{
+			m_out.put((char) v);
+		}
+
+		void u32(uint32_t v)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				u8((uint8_t) (v >> (8 * i)));
+			}
+		}
+
+		void str(const std::string& v)
+		{
+			u32((uint32_t) v.size());
+			m_out.write(v.data(), v.size());
+		}
+
+		template <typename C>
+		void strs(const C& v)
+		{
+			u32((uint32_t) v.size());
+			for (const auto& s : v)
+			{
+				str(s);
+			}
+		}
+
+	private:
+		std::ostream& m_out;
+	};
+
+	class bundle_reader
+	{
+	public:
+		explicit bundle_reader(const std::string& content): m_data(content), m_pos(0) { }
+
+		void need(size_t len)
+		{
+			if (m_data.size() - m_pos < len)
+			{
+				throw falco_exception("Invalid rules bundle: unexpected end of content");
+			}
+		}
+
+		uint8_t u8()
+		{
+			need(1);
+			return (uint8_t) m_data[m_pos++];
+		}
+
+		uint32_t u32()
+		{
+			uint32_t v = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				v |= ((uint32_t) u8()) << (8 * i);
+			}
+			return v;
+		}
+
+		std::string str()
+		{
+			auto len = u32();
+			need(len);
+			std::string v = m_data.substr(m_pos, len);
+			m_pos += len;
+			return v;
+		}
+
+		template <typename C>
+		void strs(C& v)
+		{
+			auto len = u32();
+			for (uint32_t i = 0; i < len; i++)
+			{
+				v.insert(v.end(), str());
+			}
+		}
+
+		void magic()
+		{
+			need(sizeof(s_bundle_magic));
+			if (memcmp(m_data.data(), s_bundle_magic, sizeof(s_bundle_magic)) != 0)
+			{
+				throw falco_exception("Invalid rules bundle: bad magic");
+			}
+			m_pos += sizeof(s_bundle_magic);
+		}
+
+		bool done() const
+		{
+			return m_pos == m_data.size();
+		}
+
+	private:
+		const std::string& m_data;
+		size_t m_pos;
+	};
+};
+
+static std::shared_ptr<libsinsp::filter::ast::expr> parse_condition(const std::string& cond)
+{
+	libsinsp::filter::parser p(cond);
+	p.set_max_depth(1000);
+	try
+	{
+		return std::shared_ptr<libsinsp::filter::ast::expr>(p.parse());
+	}
+	catch (const sinsp_exception& e)
+	{
+		throw falco_exception("Invalid rules bundle: can't parse condition '" + cond + "': " + e.what());
+	}
+}
+
+static rule_loader::bundle::header read_bundle_header(bundle_reader& r)
+{
+	r.magic();
+	auto version = r.u32();
+	if (version != rule_loader::bundle::format_version)
+	{
+		throw falco_exception("Invalid rules bundle: unsupported format version " + std::to_string(version));
+	}
+
+	rule_loader::bundle::header hdr;
+	hdr.engine_version = r.str();
+	hdr.rules_key = r.str();
+	hdr.output_extra = r.str();
+	hdr.replace_output_container_info = r.u8() != 0;
+
+	auto num_reqs = r.u32();
+	for (uint32_t i = 0; i < num_reqs; i++)
+	{
+		rule_loader::plugin_version_info::requirement_alternatives alternatives;
+		auto num_alternatives = r.u32();
+		for (uint32_t j = 0; j < num_alternatives; j++)
+		{
+			auto name = r.str();
+			auto version = r.str();
+			alternatives.emplace_back(name, version);
+		}
+		hdr.required_plugin_versions.push_back(std::move(alternatives));
+	}
+	return hdr;
+}
+
+void rule_loader::bundle::write(
+	std::ostream& out,
+	const header& hdr,
+	const compile_output& compiled,
+	const std::function<bool(const falco_rule&)>& is_enabled)
+{
+	bundle_writer w(out);
+
+	out.write(s_bundle_magic, sizeof(s_bundle_magic));
+	w.u32(format_version);
+	w.str(hdr.engine_version);
+	w.str(hdr.rules_key);
+	w.str(hdr.output_extra);
+	w.u8(hdr.replace_output_container_info ? 1 : 0);
+
+	w.u32((uint32_t) hdr.required_plugin_versions.size());
+	for (const auto& alternatives : hdr.required_plugin_versions)
+	{
+		w.u32((uint32_t) alternatives.size());
+		for (const auto& req : alternatives)
+		{
+			w.str(req.name);
+			w.str(req.version);
+		}
+	}
+
+	w.u32((uint32_t) compiled.lists.size());
+	for (const auto& l : compiled.lists)
+	{
+		w.str(l.name);
+		w.u8(l.used ? 1 : 0);
+		w.strs(l.items);
+	}
+
+	w.u32((uint32_t) compiled.macros.size());
+	for (const auto& m : compiled.macros)
+	{
+		w.str(m.name);
+		w.u8(m.used ? 1 : 0);
+		w.str(libsinsp::filter::ast::as_string(m.condition.get()));
+	}
+
+	w.u32((uint32_t) compiled.rules.size());
+	for (const auto& r : compiled.rules)
+	{
+		w.str(r.name);
+		w.str(r.source);
+		w.str(r.description);
+		w.str(r.output);
+		w.strs(r.tags);
+		w.strs(r.exception_fields);
+		w.u8((uint8_t) r.priority);
+		w.u8(is_enabled(r) ? 1 : 0);
+		w.str(libsinsp::filter::ast::as_string(r.condition.get()));
+	}
+
+	if (!out.good())
+	{
+		throw falco_exception("Could not write rules bundle");
+	}
+}
+
+rule_loader::bundle::header rule_loader::bundle::read_header(const std::string& content)
+{
+	bundle_reader r(content);
+	return read_bundle_header(r);
+}
+
+rule_loader::bundle::header rule_loader::bundle::read(
+	const std::string& content,
+	const indexed_vector<falco_source>& sources,
+	compile_output& out,
+	std::set<std::string>& disabled_rules)
+{
+	bundle_reader r(content);
+	auto hdr = read_bundle_header(r);
+
+	auto num_lists = r.u32();
+	for (uint32_t i = 0; i < num_lists; i++)
+	{
+		falco_list l;
+		l.name = r.str();
+		l.used = r.u8() != 0;
+		r.strs(l.items);
+		auto id = out.lists.insert(l, l.name);
+		out.lists.at(id)->id = id;
+	}
+
+	auto num_macros = r.u32();
+	for (uint32_t i = 0; i < num_macros; i++)
+	{
+		falco_macro m;
+		m.name = r.str();
+		m.used = r.u8() != 0;
+		m.condition = parse_condition(r.str());
+		auto id = out.macros.insert(m, m.name);
+		out.macros.at(id)->id = id;
+	}
+
+	auto num_rules = r.u32();
+	for (uint32_t i = 0; i < num_rules; i++)
+	{
+		falco_rule rule;
+		rule.name = r.str();
+		rule.source = r.str();
+		rule.description = r.str();
+		rule.output = r.str();
+		r.strs(rule.tags);
+		r.strs(rule.exception_fields);
+		auto priority = r.u8();
+		if (priority > falco_common::PRIORITY_DEBUG)
+		{
+			throw falco_exception("Invalid rules bundle: bad priority for rule " + rule.name);
+		}
+		rule.priority = (falco_common::priority_type) priority;
+		bool enabled = r.u8() != 0;
+		rule.condition = parse_condition(r.str());
+
+		auto source = sources.at(rule.source);
+		if (!source)
+		{
+			throw falco_exception("Invalid rules bundle: unknown source " + rule.source + " for rule " + rule.name);
+		}
+
+		try
+		{
+			sinsp_filter_compiler compiler(source->filter_factory, rule.condition.get(), source->filter_cache_factory);
+			rule.filter = compiler.compile();
+		}
+		catch (const sinsp_exception& e)
+		{
+			throw falco_exception("Invalid rules bundle: can't compile condition of rule " + rule.name + ": " + e.what());
+		}
+
+		if (!enabled)
+		{
+			disabled_rules.insert(rule.name);
+		}
+		auto id = out.rules.insert(rule, rule.name);
+		out.rules.at(id)->id = id;
+	}
+
+	if (!r.done())
+	{
+		throw falco_exception("Invalid rules bundle: trailing content");
+	}
+
+	return hdr;
+}
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "falco_source.h"
+#include "indexed_vector.h"
+#include "rule_loader.h"
+#include "rule_loader_compile_output.h"
+
+namespace rule_loader
+{
+	/*!
+		\brief A precompiled rules bundle: a versioned binary serialization
+		of the resolved and validated definitions of a compile_output.
+		Conditions are stored with all macros and lists already resolved,
+		so that loading a bundle skips YAML parsing, the collector, and
+		macro/list resolution, only requiring each rule's filter to be
+		compiled once again for the engine's filter factories.
+		A bundle is keyed by the version of the engine that produced it
+		and by an opaque key describing the rules content it was produced
+		from (e.g. a sha256 digest), and must be discarded if any of them
+		does not match.
+	*/
+	class bundle
+	{
+	public:
+		/*!
+			\brief Version of the binary layout. This must be bumped
+			any time the layout changes.
+		*/
+		static constexpr uint32_t format_version = 2;
+
+		/*!
+			\brief Information used to check whether a bundle can be
+			reused with the current engine and rules content.
+		*/
+		struct header
+		{
+			std::string engine_version;
+			std::string rules_key;
+			std::string output_extra;
+			bool replace_output_container_info = false;
+			// Plugin requirements of the rules files the bundle has
+			// been produced from, which are not compared as they must
+			// be checked against the loaded plugins instead
+			std::vector<plugin_version_info::requirement_alternatives> required_plugin_versions;
+
+			bool operator==(const header& o) const
+			{
+				return engine_version == o.engine_version
+					&& rules_key == o.rules_key
+					&& output_extra == o.output_extra
+					&& replace_output_container_info == o.replace_output_container_info;
+			}
+
+			bool operator!=(const header& o) const
+			{
+				return !(*this == o);
+			}
+		};
+
+		/*!
+			\brief Serializes the given compile output and header into
+			a bundle. The is_enabled function is invoked on every rule
+			to know whether it is enabled by default or not.
+		*/
+		static void write(
+			std::ostream& out,
+			const header& hdr,
+			const compile_output& compiled,
+			const std::function<bool(const falco_rule&)>& is_enabled);
+
+		/*!
+			\brief Reads only the header of a bundle. Throws a
+			falco_exception if the content is not a valid bundle.
+		*/
+		static header read_header(const std::string& content);
+
+		/*!
+			\brief Reads a bundle and rebuilds its compile output. Each
+			rule condition gets compiled into a filter by using the filter
+			factory of its source. The name of each rule that is disabled
+			by default is added to disabled_rules. Throws a falco_exception
+			if the content is not a valid bundle, if a rule refers to a
+			source not present in the given ones, or if any condition can't
+			be compiled.
+		*/
+		static header read(
+			const std::string& content,
+			const indexed_vector<falco_source>& sources,
+			compile_output& out,
+			std::set<std::string>& disabled_rules);
+	};
+};
@@ -419,7 +419,8 @@ bool rule_loader::compiler::compile_condition(
 	bool allow_unknown_fields,
 	indexed_vector<falco_macro>& macros_out,
 	std::shared_ptr<libsinsp::filter::ast::expr>& ast_out,
-	std::shared_ptr<sinsp_filter>& filter_out) const
+	std::shared_ptr<sinsp_filter>& filter_out,
+	std::shared_ptr<sinsp_filter_cache_factory> cache_factory) const
 {
 	std::set<falco::load_result::load_result::warning_code> warn_codes;
 	filter_warning_resolver warn_resolver;
@@ -435,9 +436,31 @@ bool rule_loader::compiler::compile_condition(
 		}
 	}
 
+	// reuse the filter compiled for the same resolved condition by a
+	// previous compilation, unless already used by another rule in the
+	// current one, so that filters are never shared across rules
+	auto resolved = libsinsp::filter::ast::as_string(ast_out.get());
+	auto cached = m_filter_cache.find(resolved);
+	if (cached != m_filter_cache.end()
+		&& cached->second.factory == filter_factory
+		&& cached->second.generation != m_generation)
+	{
+		cached->second.generation = m_generation;
+		filter_out = cached->second.filter;
+		for (const auto &w : cached->second.warnings)
+		{
+			rule_loader::context ctx(w.first, condition, cond_ctx);
+			cfg.res->add_warning(
+				falco::load_result::load_result::LOAD_COMPILE_CONDITION,
+				w.second,
+				ctx);
+		}
+		return true;
+	}
+
 	// validate the rule's condition: we compile it into a sinsp filter
 	// on-the-fly and we throw an exception with details on failure
-	sinsp_filter_compiler compiler(filter_factory, ast_out.get());
+	sinsp_filter_compiler compiler(filter_factory, ast_out.get(), cache_factory);
 	try
 	{
 		filter_out = compiler.compile();
@@ -461,6 +484,11 @@ bool rule_loader::compiler::compile_condition(
 			err,
 			ctx);
 	}
+
+	compiled_filter entry;
+	entry.factory = filter_factory;
+	entry.filter = filter_out;
+	entry.generation = m_generation;
 	for (const auto &w : compiler.get_warnings())
 	{
 		rule_loader::context ctx(w.pos, condition, cond_ctx);
@@ -468,6 +496,15 @@ bool rule_loader::compiler::compile_condition(
 			falco::load_result::load_result::LOAD_COMPILE_CONDITION,
 			w.msg,
 			ctx);
+		entry.warnings.push_back({w.pos, w.msg});
+	}
+	if (cached == m_filter_cache.end())
+	{
+		m_filter_cache.emplace(std::move(resolved), std::move(entry));
+	}
+	else if (cached->second.generation != m_generation)
+	{
+		cached->second = std::move(entry);
 	}
 
 	return true;
@@ -549,7 +586,8 @@ void rule_loader::compiler::compile_rule_infos(
 				  r.skip_if_unknown_filter,
 				  macros,
 				  rule.condition,
-				  rule.filter))
+				  rule.filter,
+				  source->filter_cache_factory))
 		{
 			continue;
 		}
@@ -589,6 +627,7 @@ void rule_loader::compiler::compile(
 		compile_output& out) const
 {
 	// expand all lists, macros, and rules
+	m_generation++;
 	try
 	{
 		compile_list_infos(cfg, col, out.lists);
@@ -601,6 +640,19 @@ void rule_loader::compiler::compile(
 		return;
 	}
 
+	// drop the filters of the conditions that are not present anymore
+	for (auto it = m_filter_cache.begin(); it != m_filter_cache.end(); )
+	{
+		if (it->second.generation != m_generation)
+		{
+			it = m_filter_cache.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
 	// print info on any dangling lists or macros that were not used anywhere
 	for (const auto &m : out.macros)
 	{
@@ -24,6 +24,8 @@ limitations under the License.
 #include "indexed_vector.h"
 #include "falco_rule.h"
 
+#include <unordered_map>
+
 namespace rule_loader
 {
 
@@ -72,9 +74,25 @@ protected:
 		bool allow_unknown_fields,
 		indexed_vector<falco_macro>& macros_out,
 		std::shared_ptr<libsinsp::filter::ast::expr>& ast_out,
-		std::shared_ptr<sinsp_filter>& filter_out) const;
+		std::shared_ptr<sinsp_filter>& filter_out,
+		std::shared_ptr<sinsp_filter_cache_factory> cache_factory = nullptr) const;
 
 private:
+	/*!
+		\brief A filter compiled by a previous compile() invocation,
+		indexed by its resolved condition. Since macros and lists are
+		already expanded in the resolved condition, a cached filter is
+		still valid as long as none of the definitions the condition
+		transitively depends on has changed.
+	*/
+	struct compiled_filter
+	{
+		std::shared_ptr<sinsp_filter_factory> factory;
+		std::shared_ptr<sinsp_filter> filter;
+		std::vector<std::pair<libsinsp::filter::ast::pos_info, std::string>> warnings;
+		uint64_t generation = 0;
+	};
+
 	void compile_list_infos(
 		configuration& cfg,
 		const collector& col,
@@ -92,6 +110,12 @@ private:
 		indexed_vector<falco_list>& lists,
 		indexed_vector<falco_macro>& macros,
 		indexed_vector<falco_rule>& out) const;
+
+	// Filters compiled by previous compile() invocations. This allows
+	// recompiling only the conditions that were affected by changes to
+	// the rules, macros, or lists, and reusing the others.
+	mutable std::unordered_map<std::string, compiled_filter> m_filter_cache;
+	mutable uint64_t m_generation = 0;
 };
 
 }; // namespace rule_loader
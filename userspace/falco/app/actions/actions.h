@@ -27,6 +27,7 @@ namespace actions {
 falco::app::run_result configure_interesting_sets(falco::app::state& s);
 falco::app::run_result configure_syscall_buffer_size(falco::app::state& s);
 falco::app::run_result configure_syscall_buffer_num(const falco::app::state& s);
+falco::app::run_result configure_thread_affinity(const falco::app::state& s);
 falco::app::run_result create_requested_paths(falco::app::state& s);
 falco::app::run_result create_signal_handlers(falco::app::state& s);
 falco::app::run_result pidfile(const falco::app::state& s);
@@ -38,6 +39,7 @@ falco::app::run_result list_plugins(const falco::app::state& s);
 falco::app::run_result load_config(const falco::app::state& s);
 falco::app::run_result load_plugins(falco::app::state& s);
 falco::app::run_result load_rules_files(falco::app::state& s);
+falco::app::run_result reload_rules_files(falco::app::state& s);
 falco::app::run_result print_config_schema(falco::app::state& s);
 falco::app::run_result print_generated_gvisor_config(falco::app::state& s);
 falco::app::run_result print_help(falco::app::state& s);
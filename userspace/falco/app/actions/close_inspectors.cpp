@@ -34,9 +34,17 @@ falco::app::run_result falco::app::actions::close_inspectors(falco::app::state&
 	{
 		auto src_info = s.source_infos.at(src);
 
+		// a run of the syscall buffer ends when its inspector gets closed,
+		// and not when rules are reloaded in-place
+		if (src == falco_common::syscall_source && src_info->opened && s.buffer_autotune != nullptr)
+		{
+			s.buffer_autotune->complete_run();
+		}
+
 		if (src_info->inspector != nullptr)
 		{
 			src_info->inspector->close();
+			src_info->opened = false;
 		}
 	}
 
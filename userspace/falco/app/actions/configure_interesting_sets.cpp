@@ -61,7 +61,20 @@ static void check_for_rules_unsupported_events(falco::app::state& s, const libsi
 	std::cerr << "If syscalls in rules include high volume syscalls (-> activate via `-A` flag), else syscalls may have been removed via base_syscalls option or might be associated with syscalls undefined on your architecture (https://marcin.juszkiewicz.com.pl/download/tables/syscalls.html)" << std::endl;
 }
 
-static void select_event_set(falco::app::state& s, const libsinsp::events::set<ppm_sc_code>& rules_sc_set)
+libsinsp::events::set<ppm_sc_code> falco::app::actions::rules_sc_set(const falco::app::state& s)
+{
+	auto res = s.engine->sc_codes_for_ruleset(falco_common::syscall_source);
+	if (std::atomic_load(&s.shadow_rules) != nullptr)
+	{
+		res = res.merge(s.shadow_engine->sc_codes_for_ruleset(falco_common::syscall_source));
+	}
+	return res;
+}
+
+void falco::app::actions::select_event_set(
+		const falco::app::state& s,
+		const libsinsp::events::set<ppm_sc_code>& rules_sc_set,
+		libsinsp::events::set<ppm_sc_code>& selected_sc_set)
 {
 	/* PPM syscall codes (sc) can be viewed as condensed libsinsp lookup table
 	 * to map a system call name to it's actual system syscall id (as defined
@@ -113,9 +126,9 @@ static void select_event_set(falco::app::state& s, const libsinsp::events::set<p
 
 	// selected events are the union of the rules events set and the
 	// base events set (either the default or the user-defined one)
-	s.selected_sc_set = rules_sc_set.merge(base_sc_set);
+	selected_sc_set = rules_sc_set.merge(base_sc_set);
 
-	/* REPLACE DEFAULT STATE, nothing else. Need to override s.selected_sc_set and have a separate logic block. */
+	/* REPLACE DEFAULT STATE, nothing else. Need to override selected_sc_set and have a separate logic block. */
 	if (s.config->m_base_syscalls_repair && user_positive_sc_set.empty())
 	{
 		/* If `base_syscalls.repair` is specified, but `base_syscalls.custom_set` is empty we are replacing
@@ -125,14 +138,14 @@ static void select_event_set(falco::app::state& s, const libsinsp::events::set<p
 		 * on the current rules configuration. */
 
 		// returned set already has rules_sc_set merged
-		s.selected_sc_set = libsinsp::events::sinsp_repair_state_sc_set(rules_sc_set);
+		selected_sc_set = libsinsp::events::sinsp_repair_state_sc_set(rules_sc_set);
 	}
 
 	auto user_negative_sc_set_names = libsinsp::events::sc_set_to_event_names(user_negative_sc_set);
 	if (!user_negative_sc_set.empty())
 	{
 		/* Remove negative base_syscalls events. */
-		s.selected_sc_set = s.selected_sc_set.diff(user_negative_sc_set);
+		selected_sc_set = selected_sc_set.diff(user_negative_sc_set);
 
 		// we re-transform from sc_set to names to make
 		// sure that bad user inputs are ignored
@@ -150,7 +163,7 @@ static void select_event_set(falco::app::state& s, const libsinsp::events::set<p
 	/* Derive the diff between the additional syscalls added via libsinsp state
 	enforcement and the syscalls from each Falco rule. We avoid printing
 	this in case the user specified a custom set of base syscalls */
-	auto non_rules_sc_set = s.selected_sc_set.diff(rules_sc_set);
+	auto non_rules_sc_set = selected_sc_set.diff(rules_sc_set);
 	if (!non_rules_sc_set.empty() && user_positive_sc_set.empty())
 	{
 		auto non_rules_sc_set_names = libsinsp::events::sc_set_to_event_names(non_rules_sc_set);
@@ -167,8 +180,8 @@ static void select_event_set(falco::app::state& s, const libsinsp::events::set<p
 	if(!s.options.all_events)
 	{
 		auto ignored_sc_set = falco::app::ignored_sc_set();
-		auto erased_sc_set = s.selected_sc_set.intersect(ignored_sc_set);
-		s.selected_sc_set = s.selected_sc_set.diff(ignored_sc_set);
+		auto erased_sc_set = selected_sc_set.intersect(ignored_sc_set);
+		selected_sc_set = selected_sc_set.diff(ignored_sc_set);
 		if (!erased_sc_set.empty())
 		{
 			auto erased_sc_set_names = libsinsp::events::sc_set_to_event_names(erased_sc_set);
@@ -186,9 +199,9 @@ static void select_event_set(falco::app::state& s, const libsinsp::events::set<p
 		 * This approach is an alternative to the default `sinsp_state_sc_set()` state enforcement
 		 * and only activates additional syscalls Falco needs beyond the syscalls defined in the
 		 * Falco rules that are absolutely necessary based on the current rules configuration. */
-		auto selected_sc_set = s.selected_sc_set;
-		s.selected_sc_set = libsinsp::events::sinsp_repair_state_sc_set(s.selected_sc_set);
-		auto repaired_sc_set = s.selected_sc_set.diff(selected_sc_set);
+		auto unrepaired_sc_set = selected_sc_set;
+		selected_sc_set = libsinsp::events::sinsp_repair_state_sc_set(selected_sc_set);
+		auto repaired_sc_set = selected_sc_set.diff(unrepaired_sc_set);
 		if (!repaired_sc_set.empty())
 		{
 			auto repaired_sc_set_names = libsinsp::events::sc_set_to_event_names(repaired_sc_set);
@@ -202,11 +215,11 @@ static void select_event_set(falco::app::state& s, const libsinsp::events::set<p
 	 * -> sched_process_exit trace point activation (procexit event)
 	 * is necessary for continuous state engine cleanup,
 	 * else memory would grow rapidly and linearly over time. */
-	s.selected_sc_set.insert(ppm_sc_code::PPM_SC_SCHED_PROCESS_EXIT);
+	selected_sc_set.insert(ppm_sc_code::PPM_SC_SCHED_PROCESS_EXIT);
 
-	if (!s.selected_sc_set.empty())
+	if (!selected_sc_set.empty())
 	{
-		auto selected_sc_set_names = libsinsp::events::sc_set_to_event_names(s.selected_sc_set);
+		auto selected_sc_set_names = libsinsp::events::sc_set_to_event_names(selected_sc_set);
 		falco_logger::log(falco_logger::level::DEBUG, "(" + std::to_string(selected_sc_set_names.size())
 			+ ") syscalls selected in total (final set): "
 			+ concat_set_in_order(selected_sc_set_names) + "\n");
@@ -231,9 +244,9 @@ falco::app::run_result falco::app::actions::configure_interesting_sets(falco::ap
 	 * of syscall codes. Those last two sets will be passed down to the
 	 * inspector to instruct the kernel drivers on which kernel event should
 	 * be collected at runtime. */
-	auto rules_sc_set = s.engine->sc_codes_for_ruleset(falco_common::syscall_source);
-	select_event_set(s, rules_sc_set);
-	check_for_rules_unsupported_events(s, rules_sc_set);
+	auto rules_sc = rules_sc_set(s);
+	select_event_set(s, rules_sc, s.selected_sc_set);
+	check_for_rules_unsupported_events(s, rules_sc);
 
 #endif
 	return run_result::ok();
@@ -39,6 +39,24 @@ falco::app::run_result falco::app::actions::configure_syscall_buffer_size(falco:
 		return run_result::fatal("The 'buf_size_preset' value must be between '" + std::to_string(MIN_INDEX) + "' and '" + std::to_string(MAX_INDEX) + "'\n");
 	}
 
+	if(s.config->m_syscall_buffer_autotune.enabled && !s.options.dry_run)
+	{
+		auto profile = s.config->m_syscall_buffer_autotune.profile;
+		if(profile.empty())
+		{
+			if(s.is_modern_ebpf())
+			{
+				profile = syscall_buffer_autotune::host_profile("modern_ebpf", s.config->m_modern_ebpf.m_cpus_for_each_buffer);
+			}
+			else
+			{
+				profile = syscall_buffer_autotune::host_profile(s.is_ebpf() ? "ebpf" : "kmod");
+			}
+		}
+		s.buffer_autotune = std::make_shared<syscall_buffer_autotune>(s.config->m_syscall_buffer_autotune, profile);
+		index = s.buffer_autotune->select_preset(index);
+	}
+
 	/* Sizes from `1 MB` to `512 MB`. The index `0` is reserved, users cannot use it! */
 	std::vector<uint32_t> vect{0, 1 << 20, 1 << 21, 1 << 22, DEFAULT_BYTE_SIZE, 1 << 24, 1 << 25, 1 << 26, 1 << 27, 1 << 28, 1 << 29};
 
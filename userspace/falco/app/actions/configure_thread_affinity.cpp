@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "actions.h"
+#include "../thread_affinity.h"
+
+using namespace falco::app;
+using namespace falco::app::actions;
+
+#ifdef __linux__
+static bool sources_auto_cpus(const falco::app::state& s, falco::threads::cpu_set& cpus)
+{
+	uint32_t cpus_for_each_buffer = 1;
+	if(s.is_modern_ebpf())
+	{
+		cpus_for_each_buffer = s.config->m_modern_ebpf.m_cpus_for_each_buffer;
+	}
+	else if(!s.is_kmod() && !s.is_ebpf())
+	{
+		falco_logger::log(falco_logger::level::WARNING, "'thread_affinity.sources' is 'auto' but no syscall driver is enabled, source threads will not be pinned\n");
+		return false;
+	}
+
+	auto nodes = falco::threads::numa_nodes();
+	if(nodes.empty())
+	{
+		falco_logger::log(falco_logger::level::WARNING, "'thread_affinity.sources' is 'auto' but the NUMA topology is unknown, source threads will not be pinned\n");
+		return false;
+	}
+	cpus = falco::threads::ring_buffers_numa_cpus(nodes, falco::threads::online_cpus(), cpus_for_each_buffer);
+	return true;
+}
+#endif
+
+falco::app::run_result falco::app::actions::configure_thread_affinity(const falco::app::state& s)
+{
+#ifdef __linux__
+	if(s.options.dry_run)
+	{
+		return run_result::ok();
+	}
+
+	const auto& cfg = s.config->m_thread_affinity;
+	const std::vector<std::pair<falco::threads::kind, std::pair<std::string, std::string>>> classes = {
+		{falco::threads::kind::SOURCE, {"sources", cfg.m_sources}},
+		{falco::threads::kind::OUTPUTS, {"outputs", cfg.m_outputs}},
+		{falco::threads::kind::STATS, {"stats", cfg.m_stats}},
+		{falco::threads::kind::GRPC, {"grpc", cfg.m_grpc}},
+		{falco::threads::kind::WEBSERVER, {"webserver", cfg.m_webserver}},
+	};
+
+	auto online = falco::threads::online_cpus();
+	for(const auto& c : classes)
+	{
+		const auto& name = c.second.first;
+		const auto& list = c.second.second;
+		falco::threads::cpu_set cpus;
+		if(list == "auto")
+		{
+			sources_auto_cpus(s, cpus);
+		}
+		else if(!list.empty())
+		{
+			std::string err;
+			if(!falco::threads::parse_cpu_list(list, cpus, err))
+			{
+				return run_result::fatal("invalid 'thread_affinity." + name + "': " + err);
+			}
+		}
+
+		if(!cpus.empty() && !online.empty())
+		{
+			falco::threads::cpu_set requested = cpus;
+			cpus.clear();
+			for(auto cpu : requested)
+			{
+				if(online.find(cpu) != online.end())
+				{
+					cpus.insert(cpu);
+				}
+			}
+			if(cpus.empty())
+			{
+				return run_result::fatal("none of the CPUs of 'thread_affinity." + name + "' (" + falco::threads::to_cpu_list(requested) + ") is online");
+			}
+		}
+
+		falco::threads::configure(c.first, cpus);
+		if(!cpus.empty())
+		{
+			falco_logger::log(falco_logger::level::INFO, "Pinning " + name + " threads to CPUs " + falco::threads::to_cpu_list(cpus) + "\n");
+		}
+	}
+#endif
+	return run_result::ok();
+}
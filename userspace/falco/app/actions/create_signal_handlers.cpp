@@ -18,6 +18,7 @@ limitations under the License.
 #include <functional>
 
 #include "actions.h"
+#include "helpers.h"
 #include "../app.h"
 #include "../signals.h"
 
@@ -140,6 +141,13 @@ falco::app::run_result falco::app::actions::create_signal_handlers(falco::app::s
 			err = "unknown error";
 		}
 
+		// if the configuration is unchanged, only the rules files need
+		// to be reloaded and the event sources can be kept open
+		if (success)
+		{
+			s.restart_rules_only.store(is_rules_only_restart(*s.config, *tmp_state.config));
+		}
+
 		if (!success && s.outputs != nullptr)
 		{
 			std::string rule = "Falco internal: hot restart failure";
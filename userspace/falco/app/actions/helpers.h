@@ -22,6 +22,8 @@ limitations under the License.
 
 #include <nlohmann/json.hpp>
 
+#include <functional>
+
 namespace falco {
 namespace app {
 namespace actions {
@@ -30,6 +32,15 @@ bool check_rules_plugin_requirements(falco::app::state& s, std::string& err);
 void print_enabled_event_sources(falco::app::state& s);
 void activate_interesting_kernel_tracepoints(falco::app::state& s, std::unique_ptr<sinsp>& inspector);
 void check_for_ignored_events(falco::app::state& s);
+// Compute the set of syscalls used by the enabled rules, including the
+// shadow ones, which are measured on the same events as the active ones
+libsinsp::events::set<ppm_sc_code> rules_sc_set(const falco::app::state& s);
+// Compute the set of syscalls to collect given the ones used by the rules,
+// as per the base_syscalls config and the -A option
+void select_event_set(
+    const falco::app::state& s,
+    const libsinsp::events::set<ppm_sc_code>& rules_sc_set,
+    libsinsp::events::set<ppm_sc_code>& selected_sc_set);
 void format_plugin_info(std::shared_ptr<sinsp_plugin> p, std::ostream& os);
 void format_described_rules_as_text(const nlohmann::json& v, std::ostream& os);
 
@@ -38,6 +49,21 @@ falco::app::run_result open_live_inspector(
     falco::app::state& s,
     std::shared_ptr<sinsp> inspector,
     const std::string& source);
+// Make an opened live inspector collect the syscalls of to_sc_set instead
+// of the ones of from_sc_set, by only changing the ones that differ
+void apply_sc_set_delta(
+    std::shared_ptr<sinsp> inspector,
+    const libsinsp::events::set<ppm_sc_code>& from_sc_set,
+    const libsinsp::events::set<ppm_sc_code>& to_sc_set);
+// Same as above, calling mark(sc, false) for each syscall to stop
+// collecting and mark(sc, true) for each one to start collecting
+void apply_sc_set_delta(
+    const libsinsp::events::set<ppm_sc_code>& from_sc_set,
+    const libsinsp::events::set<ppm_sc_code>& to_sc_set,
+    const std::function<void(ppm_sc_code, bool)>& mark);
+// Whether restarting with the next configuration only requires reloading
+// the rules files, i.e. the configuration itself is unchanged
+bool is_rules_only_restart(falco_configuration& current, falco_configuration& next);
 
 template<class InputIterator>
 void read_files(InputIterator begin, InputIterator end,
@@ -146,3 +146,8 @@ void falco::app::actions::format_described_rules_as_text(const nlohmann::json& v
 		format_two_columns(os, r["info"]["name"], str);
 	}
 }
+
+bool falco::app::actions::is_rules_only_restart(falco_configuration& current, falco_configuration& next)
+{
+	return current.dump() == next.dump();
+}
@@ -132,3 +132,29 @@ falco::app::run_result falco::app::actions::open_live_inspector(
 
 	return run_result::ok();
 }
+
+void falco::app::actions::apply_sc_set_delta(
+		std::shared_ptr<sinsp> inspector,
+		const libsinsp::events::set<ppm_sc_code>& from_sc_set,
+		const libsinsp::events::set<ppm_sc_code>& to_sc_set)
+{
+	apply_sc_set_delta(from_sc_set, to_sc_set, [&inspector](ppm_sc_code sc, bool enable)
+	{
+		inspector->mark_ppm_sc_of_interest(sc, enable);
+	});
+}
+
+void falco::app::actions::apply_sc_set_delta(
+		const libsinsp::events::set<ppm_sc_code>& from_sc_set,
+		const libsinsp::events::set<ppm_sc_code>& to_sc_set,
+		const std::function<void(ppm_sc_code, bool)>& mark)
+{
+	for (const auto& sc : from_sc_set.diff(to_sc_set))
+	{
+		mark(sc, false);
+	}
+	for (const auto& sc : to_sc_set.diff(from_sc_set))
+	{
+		mark(sc, true);
+	}
+}
@@ -78,10 +78,28 @@ void add_source_to_engine(falco::app::state& s, const std::string& src)
 	}
 
 	src_info->engine_idx = s.engine->add_source(src, filter_factory, formatter_factory);
+
+	// the shadow engine shares the source indexes of the active one
+	if(s.shadow_engine != nullptr)
+	{
+		s.shadow_engine->add_source(src, filter_factory, formatter_factory);
+	}
 }
 
 falco::app::run_result falco::app::actions::init_falco_engine(falco::app::state& s)
 {
+	if(s.config->m_shadow_rules.enabled)
+	{
+		s.shadow_engine = std::make_shared<falco_engine>();
+	}
+
+	// must be set before adding sources, as it's used to create their rulesets
+	s.engine->set_condition_backend(s.config->m_rule_condition_backend);
+	if(s.shadow_engine != nullptr)
+	{
+		s.shadow_engine->set_condition_backend(s.config->m_rule_condition_backend);
+	}
+
 	// add syscall as first source, this is also what each inspector do
 	// in their own list of registered event sources
 	add_source_to_engine(s, falco_common::syscall_source);
@@ -124,6 +142,19 @@ falco::app::run_result falco::app::actions::init_falco_engine(falco::app::state&
 
 	configure_output_format(s);
 	s.engine->set_min_priority(s.config->m_min_priority);
+	if(s.shadow_engine != nullptr)
+	{
+		s.shadow_engine->set_min_priority(s.config->m_min_priority);
+	}
+
+	const auto& sampling = s.config->m_event_sampling;
+	s.engine->set_sampling_ratio(sampling.m_ratio);
+	s.engine->set_sampling_multiplier(sampling.m_ratio > 1 ? 1 : 0);
+	s.engine->set_sampling_mode(sampling.m_mode, sampling.m_min_evts_per_type, sampling.m_window_evts);
+	if(sampling.m_has_seed)
+	{
+		s.engine->set_sampling_seed(sampling.m_seed);
+	}
 
 	return run_result::ok();
 }
@@ -69,6 +69,10 @@ falco::app::run_result falco::app::actions::init_outputs(falco::app::state& s)
 		s.config->m_output_timeout,
 		s.config->m_buffered_outputs,
 		s.config->m_outputs_queue_capacity,
+		s.config->m_outputs_queue_reserved_capacity,
+		s.config->m_outputs_queue_reserved_priority,
+		s.config->m_memory_soft_limits.subsystems[(size_t)falco::memory::subsystem::OUTPUTS_QUEUE],
+		s.config->m_outputs_spool,
 		s.config->m_time_format_iso_8601,
 		hostname);
 
@@ -53,6 +53,7 @@ falco::app::run_result falco::app::actions::load_config(const falco::app::state&
 
 	// log after config init because config determines where logs go
 	falco_logger::set_time_format_iso_8601(s.config->m_time_format_iso_8601);
+	falco::memory::set_soft_limits(s.config->m_memory_soft_limits);
 	falco_logger::log(falco_logger::level::INFO, "Falco version: " + std::string(FALCO_VERSION) + " (" + std::string(FALCO_TARGET_ARCH) + ")\n");
 	if (!s.cmdline.empty())
 	{
@@ -21,11 +21,139 @@ limitations under the License.
 
 #include <libsinsp/plugin_manager.h>
 
+#include <fstream>
 #include <unordered_set>
 
 using namespace falco::app;
 using namespace falco::app::actions;
 
+// Returns a key that uniquely identifies the content of the loaded rules
+// files from their sha256 digests, or an empty string if this is not
+// supported in the current build. At least one rules file must be loaded
+static std::string rules_bundle_key(falco::app::state& s)
+{
+	std::string key;
+#if defined(__linux__) and !defined(MINIMAL_BUILD) and !defined(__EMSCRIPTEN__)
+	for(const auto &filename : s.config->m_loaded_rules_filenames)
+	{
+		key += filename + ":" + s.config->m_loaded_rules_filenames_sha256sum.at(filename) + "\n";
+	}
+#endif
+	return key;
+}
+
+static bool load_rules_bundle(falco::app::state& s, const std::string& key)
+{
+	const auto& filename = s.config->m_rules_bundle;
+	std::ifstream f(filename, std::ios::binary);
+	if(!f.is_open())
+	{
+		falco_logger::log(falco_logger::level::INFO, "Rules bundle " + filename + " not found, loading rules files\n");
+		return false;
+	}
+
+	std::string content((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+	try
+	{
+		if(!s.engine->load_rules_bundle(content, key))
+		{
+			falco_logger::log(falco_logger::level::INFO, "Rules bundle " + filename + " is outdated, loading rules files\n");
+			return false;
+		}
+	}
+	catch(falco_exception& e)
+	{
+		falco_logger::log(falco_logger::level::WARNING, "Could not load rules bundle " + filename + ": " + e.what() + ", loading rules files\n");
+		return false;
+	}
+
+	falco_logger::log(falco_logger::level::INFO, "Loaded rules from bundle " + filename + "\n");
+	return true;
+}
+
+static bool write_rules_bundle(falco::app::state& s, const std::string& filename, const std::string& key, std::string& err)
+{
+	std::ofstream f(filename, std::ios::binary | std::ios::trunc);
+	if(!f.is_open())
+	{
+		err = "Could not open rules bundle " + filename + " for writing";
+		return false;
+	}
+
+	try
+	{
+		s.engine->write_rules_bundle(f, key);
+	}
+	catch(falco_exception& e)
+	{
+		err = e.what();
+		return false;
+	}
+	return true;
+}
+
+// Loads the shadow rules in the shadow engine, applying the same rules
+// selection as the active ones. The shadow rules must not prevent Falco
+// from running, so failures are logged and leave them disabled
+static void load_shadow_rules_files(falco::app::state& s)
+{
+	// the metrics are served concurrently with rules reloads
+	std::atomic_store(&s.shadow_rules, std::shared_ptr<shadow_ruleset>());
+	s.shadow_engine->clear_rules();
+
+	std::list<std::string> filenames;
+	std::list<std::string> folders;
+	std::vector<std::string> rules_contents;
+	falco::load_result::rules_contents_t rc;
+
+	std::string err;
+	try
+	{
+		for(const auto &path : s.config->m_shadow_rules.rules_files)
+		{
+			falco_configuration::read_rules_file_directory(path, filenames, folders);
+		}
+		read_files(filenames.begin(), filenames.end(), rules_contents, rc);
+
+		for(const auto &filename : filenames)
+		{
+			falco_logger::log(falco_logger::level::INFO, "Loading shadow rules from file " + filename + "\n");
+			auto res = s.shadow_engine->load_rules(rc.at(filename), filename);
+			if(!res->successful())
+			{
+				err = res->as_string(true, rc);
+				break;
+			}
+		}
+	}
+	catch(falco_exception& e)
+	{
+		err = e.what();
+	}
+
+	if(!err.empty())
+	{
+		falco_logger::log(falco_logger::level::ERR, "Could not load the shadow rules, they will not be evaluated: " + err + "\n");
+		return;
+	}
+
+	for(const auto& sel : s.config->m_rules_selection)
+	{
+		bool enable = sel.m_op == falco_configuration::rule_selection_operation::enable;
+		if(sel.m_rule != "")
+		{
+			s.shadow_engine->enable_rule_wildcard(sel.m_rule, enable);
+		}
+		if(sel.m_tag != "")
+		{
+			s.shadow_engine->enable_rule_by_tag(std::set<std::string>{sel.m_tag}, enable);
+		}
+	}
+
+	std::atomic_store(&s.shadow_rules, std::make_shared<shadow_ruleset>(s.engine, s.shadow_engine,
+		s.source_infos.size(), s.config->m_shadow_rules.sampling_ratio));
+}
+
 falco::app::run_result falco::app::actions::load_rules_files(falco::app::state& s)
 {
 	std::string all_rules;
@@ -65,28 +193,73 @@ falco::app::run_result falco::app::actions::load_rules_files(falco::app::state&
 		return run_result::fatal(e.what());
 	}
 
-	std::string err = "";
-	for(auto &filename : s.config->m_loaded_rules_filenames)
+#if defined(__linux__) and !defined(MINIMAL_BUILD) and !defined(__EMSCRIPTEN__)
+	// computed once, for both the rules bundle key and the metrics
+	std::unordered_map<std::string, std::string> sha256sums;
+	for(const auto &filename : s.config->m_loaded_rules_filenames)
 	{
-		falco_logger::log(falco_logger::level::INFO, "Loading rules from file " + filename + "\n");
-		std::unique_ptr<falco::load_result> res;
-
-		res = s.engine->load_rules(rc.at(filename), filename);
+		sha256sums.insert({filename, falco::utils::calculate_file_sha256sum(filename)});
+	}
+	{
+		std::lock_guard<std::mutex> lk(s.config->m_loaded_rules_filenames_sha256sum_mtx);
+		s.config->m_loaded_rules_filenames_sha256sum = std::move(sha256sums);
+	}
+#endif
 
-		if(!res->successful())
+	std::string bundle_key;
+	bool use_bundle = !s.config->m_rules_bundle.empty() || !s.options.compile_rules_filename.empty();
+	if(use_bundle && s.config->m_loaded_rules_filenames.empty())
+	{
+		if(!s.options.compile_rules_filename.empty())
+		{
+			return run_result::fatal("No rules files to bundle, the configured rules files and directories contain none");
+		}
+		falco_logger::log(falco_logger::level::WARNING, "No rules files to bundle, ignoring 'rules_bundle'\n");
+		use_bundle = false;
+	}
+	if(use_bundle)
+	{
+		bundle_key = rules_bundle_key(s);
+		if(bundle_key.empty())
 		{
-			// Return the summary version as the error
-			err = res->as_string(true, rc);
-			break;
+			if(!s.options.compile_rules_filename.empty())
+			{
+				return run_result::fatal("Precompiled rules bundles are not supported in this build");
+			}
+			falco_logger::log(falco_logger::level::WARNING, "Precompiled rules bundles are not supported in this build, ignoring 'rules_bundle'\n");
+			use_bundle = false;
 		}
+	}
 
-		if(res->has_warnings())
+	// rules descriptions are only available when loading from rules files
+	bool describe_rules = s.options.describe_all_rules || !s.options.describe_rule.empty();
+	bool loaded_from_bundle = use_bundle
+		&& s.options.compile_rules_filename.empty()
+		&& !describe_rules
+		&& load_rules_bundle(s, bundle_key);
+
+	std::string err = "";
+	for(auto &filename : s.config->m_loaded_rules_filenames)
+	{
+		if(!loaded_from_bundle)
 		{
-			falco_logger::log(falco_logger::level::WARNING,res->as_string(true, rc) + "\n");
+			falco_logger::log(falco_logger::level::INFO, "Loading rules from file " + filename + "\n");
+			std::unique_ptr<falco::load_result> res;
+
+			res = s.engine->load_rules(rc.at(filename), filename);
+
+			if(!res->successful())
+			{
+				// Return the summary version as the error
+				err = res->as_string(true, rc);
+				break;
+			}
+
+			if(res->has_warnings())
+			{
+				falco_logger::log(falco_logger::level::WARNING,res->as_string(true, rc) + "\n");
+			}
 		}
-#if defined(__linux__) and !defined(MINIMAL_BUILD) and !defined(__EMSCRIPTEN__)
-		s.config->m_loaded_rules_filenames_sha256sum.insert({filename, falco::utils::calculate_file_sha256sum(filename)});
-#endif
 	}
 
 	// note: we have an egg-and-chicken problem here. We would like to check
@@ -131,6 +304,25 @@ falco::app::run_result falco::app::actions::load_rules_files(falco::app::state&
 		return run_result::fatal(err);
 	}
 
+	if (!s.options.compile_rules_filename.empty())
+	{
+		if (!write_rules_bundle(s, s.options.compile_rules_filename, bundle_key, err))
+		{
+			return run_result::fatal(err);
+		}
+		falco_logger::log(falco_logger::level::INFO, "Rules bundle written to " + s.options.compile_rules_filename + "\n");
+		return run_result::exit();
+	}
+
+	if (use_bundle && !loaded_from_bundle && !describe_rules)
+	{
+		// refresh the bundle so that the next startup can use it
+		if (!write_rules_bundle(s, s.config->m_rules_bundle, bundle_key, err))
+		{
+			falco_logger::log(falco_logger::level::WARNING, "Could not refresh rules bundle: " + err + "\n");
+		}
+	}
+
 	for(const auto& sel : s.config->m_rules_selection)
 	{
 		bool enable = sel.m_op == falco_configuration::rule_selection_operation::enable;
@@ -153,7 +345,7 @@ falco::app::run_result falco::app::actions::load_rules_files(falco::app::state&
 	}
 
 	// printout of `-L` option
-	if (s.options.describe_all_rules || !s.options.describe_rule.empty())
+	if (describe_rules)
 	{
 		std::string* rptr = !s.options.describe_rule.empty() ? &(s.options.describe_rule) : nullptr;
 		const auto& plugins = s.offline_inspector->get_plugin_manager()->plugins();
@@ -171,5 +363,20 @@ falco::app::run_result falco::app::actions::load_rules_files(falco::app::state&
 		return run_result::exit();
 	}
 
+	if (s.shadow_engine != nullptr)
+	{
+		load_shadow_rules_files(s);
+	}
+
+	auto mem = s.engine->get_rules_memory_usage();
+	if (s.shadow_rules != nullptr)
+	{
+		auto shadow_mem = s.shadow_engine->get_rules_memory_usage();
+		mem.rules += shadow_mem.rules;
+		mem.filters += shadow_mem.filters;
+	}
+	falco::memory::set(falco::memory::subsystem::RULES, mem.rules);
+	falco::memory::set(falco::memory::subsystem::FILTERS, mem.filters);
+
 	return run_result::ok();
 }
@@ -25,6 +25,7 @@ limitations under the License.
 #include <unordered_map>
 
 #include "falco_utils.h"
+#include "falco_usdt.h"
 
 #include "actions.h"
 #include "helpers.h"
@@ -34,6 +35,7 @@ limitations under the License.
 #include "../../stats_writer.h"
 #include "../../falco_outputs.h"
 #include "../../event_drops.h"
+#include "../../thread_affinity.h"
 
 #include <libsinsp/plugin_manager.h>
 
@@ -156,8 +158,51 @@ static falco::app::run_result do_inspect(
 				s.config->m_syscall_evt_drop_rate,
 				s.config->m_syscall_evt_drop_max_burst,
 				s.config->m_syscall_evt_simulate_drops);
+
+		// note: steps are applied by this thread, which is the only one
+		// running rules of the syscall source and using its inspector
+		if (!is_capture_mode && s.config->m_syscall_evt_drop_actions.count(syscall_evt_drop_action::SHED))
+		{
+			std::vector<std::set<std::string>> disabled_rules(s.config->m_syscall_evt_drop_shedding.steps.size());
+			auto apply_step = [&s, inspector, source_engine_idx, disabled_rules](size_t step, bool shed) mutable
+			{
+				const auto& cfg = s.config->m_syscall_evt_drop_shedding.steps[step];
+				syscall_evt_drop_shedding_result res;
+				if (shed)
+				{
+					disabled_rules[step] = s.engine->disable_source_rules(source_engine_idx, cfg.rules, cfg.tags);
+					res.rules = disabled_rules[step];
+				}
+				else
+				{
+					s.engine->enable_source_rules(source_engine_idx, disabled_rules[step]);
+					res.rules = std::move(disabled_rules[step]);
+					disabled_rules[step].clear();
+				}
+
+				// select the syscalls to collect as we would have done if the
+				// rules had been disabled at startup
+				libsinsp::events::set<ppm_sc_code> new_sc_set;
+				select_event_set(s, rules_sc_set(s), new_sc_set);
+				apply_sc_set_delta(inspector, s.selected_sc_set, new_sc_set);
+				auto changed_sc_set = shed ? s.selected_sc_set.diff(new_sc_set) : new_sc_set.diff(s.selected_sc_set);
+				auto changed_names = libsinsp::events::sc_set_to_event_names(changed_sc_set);
+				res.syscalls.insert(changed_names.begin(), changed_names.end());
+				s.selected_sc_set = new_sc_set;
+				return res;
+			};
+			sdropmgr.init_load_shedding(s.config->m_syscall_evt_drop_shedding, apply_step);
+		}
+
+		if (!is_capture_mode && s.buffer_autotune != nullptr)
+		{
+			sdropmgr.init_buffer_autotune(s.buffer_autotune);
+		}
 	}
 
+	// the shadow rules are only replaced while no event is processed
+	auto shadow_rules = std::atomic_load(&s.shadow_rules);
+
 	//
 	// Start capture
 	//
@@ -239,6 +284,8 @@ static falco::app::run_result do_inspect(
 			return run_result::fatal(inspector->getlasterr());
 		}
 
+		FALCO_USDT2(event_receive, ev->get_ts(), ev->get_type());
+
 		// if we are in live mode, we already have the right source engine idx
 		if (is_capture_mode)
 		{
@@ -302,6 +349,23 @@ static falco::app::run_result do_inspect(
 			return run_result::fatal("Drop manager internal error");
 		}
 
+		// A sample of the events, including the ones skipped below, is
+		// also evaluated with the shadow rules to measure them, with
+		// no effect on the alerts
+		if(shadow_rules != nullptr && shadow_rules->sample(source_engine_idx))
+		{
+			shadow_rules->evaluate(source_engine_idx, ev);
+		}
+
+		// Events of types for which no rule is enabled (e.g. the ones
+		// collected only for state tracking purposes) can't match,
+		// so there's no need to pass them to the falco engine.
+		if(s.engine->skip_event_type(source_engine_idx, ev->get_type()))
+		{
+			num_evts++;
+			continue;
+		}
+
 		// As the inspector has no filter at its level, all
 		// events are returned here. Pass them to the falco
 		// engine, which will match the event against the set
@@ -434,9 +498,13 @@ falco::app::run_result falco::app::actions::process_events(falco::app::state& s)
 {
 	// Notify engine that we finished loading and enabling all rules
 	s.engine->complete_rule_loading();
+	if(s.shadow_rules != nullptr)
+	{
+		s.shadow_engine->complete_rule_loading();
+	}
 
 	// Initialize stats writer
-	auto statsw = std::make_shared<stats_writer>(s.outputs, s.config, s.engine);
+	auto statsw = std::make_shared<stats_writer>(s.outputs, s.config, s.engine, s.buffer_autotune);
 	auto res = init_stats_writer(statsw, s.config, s.options.dry_run);
 
 	if (s.options.dry_run)
@@ -497,14 +565,24 @@ falco::app::run_result falco::app::actions::process_events(falco::app::state& s)
 			{
 				falco_logger::log(falco_logger::level::DEBUG, "Opening event source '" + source + "'\n");
 				termination_sem.acquire();
-				res = open_live_inspector(s, src_info->inspector, source);
-				if (!res.success)
+				// sources are opened from the CPUs their events get consumed
+				// on, so that the memory allocated meanwhile is local to them.
+				// The main thread is not renamed, as on Linux that renames
+				// the process as seen by ps, pgrep and killall
+				falco::threads::init_current(falco::threads::kind::SOURCE);
+				// inspectors are already open if rules have been reloaded in-place
+				if (!src_info->opened)
 				{
-					// note: we don't return here because we need to reach
-					// the thread termination loop below to make sure all
-					// already-spawned threads get terminated gracefully
-					ctx.sync->finish();
-					break;
+					res = open_live_inspector(s, src_info->inspector, source);
+					if (!res.success)
+					{
+						// note: we don't return here because we need to reach
+						// the thread termination loop below to make sure all
+						// already-spawned threads get terminated gracefully
+						ctx.sync->finish();
+						break;
+					}
+					src_info->opened = true;
 				}
 
 				if (s.enabled_sources.size() == 1)
@@ -517,6 +595,7 @@ falco::app::run_result falco::app::actions::process_events(falco::app::state& s)
 					auto res_ptr = &ctx.res;
 					auto sync_ptr = ctx.sync.get();
 					ctx.thread = std::make_unique<std::thread>([&s, src_info, &statsw, source, sync_ptr, res_ptr]() {
+						falco::threads::init_current(falco::threads::kind::SOURCE, "falco-" + source);
 						process_inspector_events(s, src_info->inspector, statsw, source, sync_ptr, res_ptr);
 					});
 				}
@@ -531,6 +610,7 @@ falco::app::run_result falco::app::actions::process_events(falco::app::state& s)
 				break;
 			}
 		}
+		falco::threads::reset_current();
 
 		// wait for event processing to terminate for all sources
 		// if a thread terminates with an error, we trigger the app termination
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "actions.h"
+#include "helpers.h"
+
+using namespace falco::app;
+using namespace falco::app::actions;
+
+falco::app::run_result falco::app::actions::reload_rules_files(falco::app::state& s)
+{
+	falco_logger::log(falco_logger::level::INFO, "Rules files changed, reloading rules without reopening event sources\n");
+
+	// forget the rules files loaded so far, they might have been added or removed
+	s.config->m_loaded_rules_filenames.clear();
+	s.config->m_loaded_rules_folders.clear();
+	s.engine->clear_rules();
+
+	auto res = load_rules_files(s);
+	if (!res.proceed)
+	{
+		return res;
+	}
+
+	auto prev_sc_set = s.selected_sc_set;
+	res = configure_interesting_sets(s);
+	if (!res.proceed)
+	{
+		return res;
+	}
+
+	// only kernel drivers support changing the collected syscalls while
+	// the capture is open, other event sources collect everything anyways
+	bool syscall_driver = s.is_kmod() || s.is_ebpf() || s.is_modern_ebpf();
+	if (syscall_driver && s.is_source_enabled(falco_common::syscall_source))
+	{
+		auto inspector = s.source_infos.at(falco_common::syscall_source)->inspector;
+		apply_sc_set_delta(inspector, prev_sc_set, s.selected_sc_set);
+		falco_logger::log(falco_logger::level::INFO, "Updated the syscalls of interest: "
+			+ std::to_string(s.selected_sc_set.diff(prev_sc_set).size()) + " added, "
+			+ std::to_string(prev_sc_set.diff(s.selected_sc_set).size()) + " removed\n");
+	}
+
+	return run_result::ok();
+}
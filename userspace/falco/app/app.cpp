@@ -80,6 +80,7 @@ bool falco::app::run(falco::app::state& s, bool& restart, std::string& errstr)
 		falco::app::actions::validate_rules_files,
 		falco::app::actions::load_rules_files,
 		falco::app::actions::print_support,
+		falco::app::actions::configure_thread_affinity,
 		falco::app::actions::init_outputs,
 		falco::app::actions::create_signal_handlers,
 		falco::app::actions::create_requested_paths,
@@ -92,6 +93,19 @@ bool falco::app::run(falco::app::state& s, bool& restart, std::string& errstr)
 		falco::app::actions::process_events,
 	};
 
+	// Steps used to apply changes to the rules files without
+	// reopening the event sources, when nothing else has changed.
+	// The webserver is stopped while the rules are reloaded, because
+	// its /metrics endpoint reads the rules and stats of the engine.
+	std::list<app_action> reload_steps = {
+		falco::app::actions::unregister_signal_handlers,
+		falco::app::actions::stop_webserver,
+		falco::app::actions::reload_rules_files,
+		falco::app::actions::create_signal_handlers,
+		falco::app::actions::start_webserver,
+		falco::app::actions::process_events,
+	};
+
 	std::list<app_action> teardown_steps = {
 		falco::app::actions::unregister_signal_handlers,
 		falco::app::actions::stop_grpc_server,
@@ -109,6 +123,20 @@ bool falco::app::run(falco::app::state& s, bool& restart, std::string& errstr)
 		}
 	}
 
+	while (res.proceed && s.restart && s.restart_rules_only)
+	{
+		s.restart = false;
+		s.restart_rules_only = false;
+		for (const auto &func : reload_steps)
+		{
+			res = falco::app::run_result::merge(res, func(s));
+			if(!res.proceed)
+			{
+				break;
+			}
+		}
+	}
+
 	for (const auto &func : teardown_steps)
 	{
 		res = falco::app::run_result::merge(res, func(s));
@@ -114,6 +114,7 @@ void options::define(cxxopts::Options& opts)
 #else
 		("c",                             "Configuration file. If not specified tries " FALCO_SOURCE_CONF_FILE ", " FALCO_INSTALL_CONF_FILE ".", cxxopts::value(conf_filename), "<path>")
 #endif
+		("compile-rules",                 "Load and validate the rules files, write their compiled definitions into a precompiled rules bundle at <bundle_file>, and exit. The bundle can then be configured with the 'rules_bundle' config key to skip rules parsing at startup as long as the rules files and the Falco version do not change.", cxxopts::value(compile_rules_filename), "<bundle_file>")
 		("config-schema",                 "Print the config json schema and exit.", cxxopts::value(print_config_schema)->default_value("false"))
 		("A",                             "Monitor all events supported by Falco and defined in rules and configs. Some events are ignored by default when -A is not specified (the -i option lists these events ignored). Using -A can impact performance. This option has no effect when reproducing events from a capture file.", cxxopts::value(all_events)->default_value("false"))
 		("b,print-base64",                "Print data buffers in base64. This is useful for encoding binary data that needs to be used over media designed to consume this format.")
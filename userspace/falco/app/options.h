@@ -73,6 +73,7 @@ public:
 	bool print_version_info = false;
 	bool print_page_size = false;
 	bool dry_run = false;
+	std::string compile_rules_filename;
 
 	bool parse(int argc, char **argv, std::string &errstr);
 
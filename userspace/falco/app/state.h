@@ -61,6 +61,9 @@ struct state
         // source is a plugin one, the assigned inspector must have that
         // plugin registered in its plugin manager
         std::shared_ptr<sinsp> inspector;
+        // Whether the inspector has already been opened. Live inspectors
+        // are kept open across in-place rules reloads
+        bool opened = false;
     };
 
     state():
@@ -79,12 +82,22 @@ struct state
     std::string cmdline;
     falco::app::options options;
     std::atomic<bool> restart = false;
+    // Set along with restart when only the loaded rules files changed,
+    // in which case rules can be reloaded without reopening the inspectors
+    std::atomic<bool> restart_rules_only = false;
 
 
     std::shared_ptr<falco_configuration> config;
     std::shared_ptr<falco_outputs> outputs;
     std::shared_ptr<falco_engine> engine;
 
+    // Engine holding the shadow rules, and the helper evaluating them
+    // on a sample of the events, both null unless shadow_rules is enabled.
+    // shadow_rules is null if the shadow rules could not be loaded, and
+    // must be accessed atomically by threads other than the main one
+    std::shared_ptr<falco_engine> shadow_engine;
+    std::shared_ptr<shadow_ruleset> shadow_rules;
+
     // The set of loaded event sources (by default, the syscall event
     // source plus all event sources coming from the loaded plugins).
     // note: this has to be a vector to preserve the loading order,
@@ -113,6 +126,10 @@ struct state
     // Dimension of the syscall buffer in bytes.
     uint64_t syscall_buffer_bytes_size = DEFAULT_DRIVER_BUFFER_BYTES_DIM;
 
+    // Recommends the syscall buffer size from the drops observed across
+    // runs, null unless syscall_buffer_autotune is enabled
+    std::shared_ptr<syscall_buffer_autotune> buffer_autotune;
+
     // Helper responsible for watching of handling hot application restarts
     std::shared_ptr<restart_handler> restarter;
 
@@ -34,6 +34,7 @@ limitations under the License.
 #include "falco_utils.h"
 
 #include "configuration.h"
+#include "thread_affinity.h"
 #include "logger.h"
 
 #include <re2/re2.h>
@@ -53,16 +54,19 @@ static re2::RE2 ip_address_re("((^\\s*((([0-9]|[1-9][0-9]|1[0-9]{2}|2[0-4][0-9]|
 // https://learn.microsoft.com/en-us/cpp/cpp/string-and-character-literals-cpp?view=msvc-170#size-of-string-literals
 // Just use any available online tool, eg: https://jsonformatter.org/json-minify
 // to format the json, add the new fields, and then minify it again.
-static const std::string schema_json_string = R"({"$schema":"http://json-schema.org/draft-06/schema#","$ref":"#/definitions/FalcoConfig","definitions":{"FalcoConfig":{"type":"object","additionalProperties":false,"properties":{"config_files":{"type":"array","items":{"type":"string"}},"watch_config_files":{"type":"boolean"},"rules_files":{"type":"array","items":{"type":"string"}},"rule_files":{"type":"array","items":{"type":"string"}},"rules":{"type":"array","items":{"$ref":"#/definitions/Rule"}},"engine":{"$ref":"#/definitions/Engine"},"load_plugins":{"type":"array","items":{"type":"string"}},"plugins":{"type":"array","items":{"$ref":"#/definitions/Plugin"}},"time_format_iso_8601":{"type":"boolean"},"priority":{"type":"string"},"json_output":{"type":"boolean"},"json_include_output_property":{"type":"boolean"},"json_include_tags_property":{"type":"boolean"},"buffered_outputs":{"type":"boolean"},"rule_matching":{"type":"string"},"outputs_queue":{"$ref":"#/definitions/OutputsQueue"},"stdout_output":{"$ref":"#/definitions/Output"},"syslog_output":{"$ref":"#/definitions/Output"},"file_output":{"$ref":"#/definitions/FileOutput"},"http_output":{"$ref":"#/definitions/HTTPOutput"},"program_output":{"$ref":"#/definitions/ProgramOutput"},"grpc_output":{"$ref":"#/definitions/Output"},"grpc":{"$ref":"#/definitions/Grpc"},"webserver":{"$ref":"#/definitions/Webserver"},"log_stderr":{"type":"boolean"},"log_syslog":{"type":"boolean"},"log_level":{"type":"string"},"libs_logger":{"$ref":"#/definitions/LibsLogger"},"output_timeout":{"type":"integer"},"syscall_event_timeouts":{"$ref":"#/definitions/SyscallEventTimeouts"},"syscall_event_drops":{"$ref":"#/definitions/SyscallEventDrops"},"metrics":{"$ref":"#/definitions/Metrics"},"base_syscalls":{"$ref":"#/definitions/BaseSyscalls"},"falco_libs":{"$ref":"#/definitions/FalcoLibs"},"container_engines":{"type":"object","additionalProperties":false,"properties":{"docker":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"}}},"cri":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"sockets":{"type":"array","items":{"type":"string"}},"disable_async":{"type":"boolean"}}},"podman":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"}}},"lxc":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"}}},"libvirt_lxc":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"}}},"bpm":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"}}}}}},"title":"FalcoConfig"},"BaseSyscalls":{"type":"object","additionalProperties":false,"properties":{"custom_set":{"type":"array","items":{"type":"string"}},"repair":{"type":"boolean"}},"minProperties":1,"title":"BaseSyscalls"},"Engine":{"type":"object","additionalProperties":false,"properties":{"kind":{"type":"string"},"kmod":{"$ref":"#/definitions/Kmod"},"ebpf":{"$ref":"#/definitions/Ebpf"},"modern_ebpf":{"$ref":"#/definitions/ModernEbpf"},"replay":{"$ref":"#/definitions/Replay"},"gvisor":{"$ref":"#/definitions/Gvisor"}},"required":["kind"],"title":"Engine"},"Ebpf":{"type":"object","additionalProperties":false,"properties":{"probe":{"type":"string"},"buf_size_preset":{"type":"integer"},"drop_failed_exit":{"type":"boolean"}},"required":["probe"],"title":"Ebpf"},"Gvisor":{"type":"object","additionalProperties":false,"properties":{"config":{"type":"string"},"root":{"type":"string"}},"required":["config","root"],"title":"Gvisor"},"Kmod":{"type":"object","additionalProperties":false,"properties":{"buf_size_preset":{"type":"integer"},"drop_failed_exit":{"type":"boolean"}},"minProperties":1,"title":"Kmod"},"ModernEbpf":{"type":"object","additionalProperties":false,"properties":{"cpus_for_each_buffer":{"type":"integer"},"buf_size_preset":{"type":"integer"},"drop_failed_exit":{"type":"boolean"}},"title":"ModernEbpf"},"Replay":{"type":"object","additionalProperties":false,"properties":{"capture_file":{"type":"string"}},"required":["capture_file"],"title":"Replay"},"FalcoLibs":{"type":"object","additionalProperties":false,"properties":{"thread_table_size":{"type":"integer"}},"minProperties":1,"title":"FalcoLibs"},"FileOutput":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"keep_alive":{"type":"boolean"},"filename":{"type":"string"}},"minProperties":1,"title":"FileOutput"},"Grpc":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"bind_address":{"type":"string"},"threadiness":{"type":"integer"}},"minProperties":1,"title":"Grpc"},"Output":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"}},"minProperties":1,"title":"Output"},"HTTPOutput":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"url":{"type":"string","format":"uri","qt-uri-protocols":["http"]},"user_agent":{"type":"string"},"insecure":{"type":"boolean"},"ca_cert":{"type":"string"},"ca_bundle":{"type":"string"},"ca_path":{"type":"string"},"mtls":{"type":"boolean"},"client_cert":{"type":"string"},"client_key":{"type":"string"},"echo":{"type":"boolean"},"compress_uploads":{"type":"boolean"},"keep_alive":{"type":"boolean"}},"minProperties":1,"title":"HTTPOutput"},"LibsLogger":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"severity":{"type":"string"}},"minProperties":1,"title":"LibsLogger"},"Metrics":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"interval":{"type":"string"},"output_rule":{"type":"boolean"},"output_file":{"type":"string"},"rules_counters_enabled":{"type":"boolean"},"resource_utilization_enabled":{"type":"boolean"},"state_counters_enabled":{"type":"boolean"},"kernel_event_counters_enabled":{"type":"boolean"},"libbpf_stats_enabled":{"type":"boolean"},"plugins_metrics_enabled":{"type":"boolean"},"convert_memory_to_mb":{"type":"boolean"},"include_empty_values":{"type":"boolean"}},"minProperties":1,"title":"Metrics"},"OutputsQueue":{"type":"object","additionalProperties":false,"properties":{"capacity":{"type":"integer"}},"minProperties":1,"title":"OutputsQueue"},"Plugin":{"type":"object","additionalProperties":false,"properties":{"name":{"type":"string"},"library_path":{"type":"string"},"init_config":{"type":"string"},"open_params":{"type":"string"}},"required":["library_path","name"],"title":"Plugin"},"ProgramOutput":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"keep_alive":{"type":"boolean"},"program":{"type":"string"}},"required":["program"],"title":"ProgramOutput"},"Rule":{"type":"object","additionalProperties":false,"properties":{"disable":{"$ref":"#/definitions/Able"},"enable":{"$ref":"#/definitions/Able"}},"minProperties":1,"title":"Rule"},"Able":{"type":"object","additionalProperties":false,"properties":{"rule":{"type":"string"},"tag":{"type":"string"}},"minProperties":1,"title":"Able"},"SyscallEventDrops":{"type":"object","additionalProperties":false,"properties":{"threshold":{"type":"number"},"actions":{"type":"array","items":{"type":"string"}},"rate":{"type":"number"},"max_burst":{"type":"integer"},"simulate_drops":{"type":"boolean"}},"minProperties":1,"title":"SyscallEventDrops"},"SyscallEventTimeouts":{"type":"object","additionalProperties":false,"properties":{"max_consecutives":{"type":"integer"}},"minProperties":1,"title":"SyscallEventTimeouts"},"Webserver":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"threadiness":{"type":"integer"},"listen_port":{"type":"integer"},"listen_address":{"type":"string"},"k8s_healthz_endpoint":{"type":"string"},"prometheus_metrics_enabled":{"type":"boolean"},"ssl_enabled":{"type":"boolean"},"ssl_certificate":{"type":"string"}},"minProperties":1,"title":"Webserver"}}})";
+static const std::string schema_json_string = R"({"$schema":"http://json-schema.org/draft-06/schema#","$ref":"#/definitions/FalcoConfig","definitions":{"FalcoConfig":{"type":"object","additionalProperties":false,"properties":{"config_files":{"type":"array","items":{"type":"string"}},"watch_config_files":{"type":"boolean"},"rules_files":{"type":"array","items":{"type":"string"}},"rule_files":{"type":"array","items":{"type":"string"}},"rules_bundle":{"type":"string"},"rules":{"type":"array","items":{"$ref":"#/definitions/Rule"}},"engine":{"$ref":"#/definitions/Engine"},"load_plugins":{"type":"array","items":{"type":"string"}},"plugins":{"type":"array","items":{"$ref":"#/definitions/Plugin"}},"time_format_iso_8601":{"type":"boolean"},"priority":{"type":"string"},"json_output":{"type":"boolean"},"json_include_output_property":{"type":"boolean"},"json_include_tags_property":{"type":"boolean"},"buffered_outputs":{"type":"boolean"},"rule_matching":{"type":"string"},"rule_condition_backend":{"type":"string"},"outputs_queue":{"$ref":"#/definitions/OutputsQueue"},"outputs_spool":{"$ref":"#/definitions/OutputsSpool"},"stdout_output":{"$ref":"#/definitions/Output"},"syslog_output":{"$ref":"#/definitions/SyslogOutput"},"file_output":{"$ref":"#/definitions/FileOutput"},"http_output":{"$ref":"#/definitions/HTTPOutput"},"program_output":{"$ref":"#/definitions/ProgramOutput"},"grpc_output":{"$ref":"#/definitions/Output"},"shm_output":{"$ref":"#/definitions/ShmOutput"},"grpc":{"$ref":"#/definitions/Grpc"},"webserver":{"$ref":"#/definitions/Webserver"},"log_stderr":{"type":"boolean"},"log_syslog":{"type":"boolean"},"log_level":{"type":"string"},"libs_logger":{"$ref":"#/definitions/LibsLogger"},"output_timeout":{"type":"integer"},"syscall_event_timeouts":{"$ref":"#/definitions/SyscallEventTimeouts"},"syscall_event_drops":{"$ref":"#/definitions/SyscallEventDrops"},"metrics":{"$ref":"#/definitions/Metrics"},"base_syscalls":{"$ref":"#/definitions/BaseSyscalls"},"falco_libs":{"$ref":"#/definitions/FalcoLibs"},"container_engines":{"type":"object","additionalProperties":false,"properties":{"docker":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"}}},"cri":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"sockets":{"type":"array","items":{"type":"string"}},"disable_async":{"type":"boolean"}}},"podman":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"}}},"lxc":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"}}},"libvirt_lxc":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"}}},"bpm":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"}}}}},"syscall_buffer_autotune":{"$ref":"#/definitions/SyscallBufferAutotune"},"thread_affinity":{"$ref":"#/definitions/ThreadAffinity"},"memory_soft_limits":{"$ref":"#/definitions/MemorySoftLimits"},"shadow_rules":{"$ref":"#/definitions/ShadowRules"},"event_sampling":{"$ref":"#/definitions/EventSampling"}},"title":"FalcoConfig"},"BaseSyscalls":{"type":"object","additionalProperties":false,"properties":{"custom_set":{"type":"array","items":{"type":"string"}},"repair":{"type":"boolean"}},"minProperties":1,"title":"BaseSyscalls"},"Engine":{"type":"object","additionalProperties":false,"properties":{"kind":{"type":"string"},"kmod":{"$ref":"#/definitions/Kmod"},"ebpf":{"$ref":"#/definitions/Ebpf"},"modern_ebpf":{"$ref":"#/definitions/ModernEbpf"},"replay":{"$ref":"#/definitions/Replay"},"gvisor":{"$ref":"#/definitions/Gvisor"}},"required":["kind"],"title":"Engine"},"Ebpf":{"type":"object","additionalProperties":false,"properties":{"probe":{"type":"string"},"buf_size_preset":{"type":"integer"},"drop_failed_exit":{"type":"boolean"}},"required":["probe"],"title":"Ebpf"},"Gvisor":{"type":"object","additionalProperties":false,"properties":{"config":{"type":"string"},"root":{"type":"string"}},"required":["config","root"],"title":"Gvisor"},"Kmod":{"type":"object","additionalProperties":false,"properties":{"buf_size_preset":{"type":"integer"},"drop_failed_exit":{"type":"boolean"}},"minProperties":1,"title":"Kmod"},"ModernEbpf":{"type":"object","additionalProperties":false,"properties":{"cpus_for_each_buffer":{"type":"integer"},"buf_size_preset":{"type":"integer"},"drop_failed_exit":{"type":"boolean"}},"title":"ModernEbpf"},"Replay":{"type":"object","additionalProperties":false,"properties":{"capture_file":{"type":"string"}},"required":["capture_file"],"title":"Replay"},"FalcoLibs":{"type":"object","additionalProperties":false,"properties":{"thread_table_size":{"type":"integer"}},"minProperties":1,"title":"FalcoLibs"},"FileOutput":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"keep_alive":{"type":"boolean"},"filename":{"type":"string"}},"minProperties":1,"title":"FileOutput"},"Grpc":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"bind_address":{"type":"string"},"threadiness":{"type":"integer"}},"minProperties":1,"title":"Grpc"},"Output":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"}},"minProperties":1,"title":"Output"},"HTTPOutput":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"url":{"type":"string","format":"uri","qt-uri-protocols":["http"]},"user_agent":{"type":"string"},"insecure":{"type":"boolean"},"ca_cert":{"type":"string"},"ca_bundle":{"type":"string"},"ca_path":{"type":"string"},"mtls":{"type":"boolean"},"client_cert":{"type":"string"},"client_key":{"type":"string"},"echo":{"type":"boolean"},"compress_uploads":{"type":"boolean"},"keep_alive":{"type":"boolean"}},"minProperties":1,"title":"HTTPOutput"},"LibsLogger":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"severity":{"type":"string"}},"minProperties":1,"title":"LibsLogger"},"Metrics":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"interval":{"type":"string"},"output_rule":{"type":"boolean"},"output_file":{"type":"string"},"rules_counters_enabled":{"type":"boolean"},"resource_utilization_enabled":{"type":"boolean"},"state_counters_enabled":{"type":"boolean"},"kernel_event_counters_enabled":{"type":"boolean"},"libbpf_stats_enabled":{"type":"boolean"},"plugins_metrics_enabled":{"type":"boolean"},"convert_memory_to_mb":{"type":"boolean"},"include_empty_values":{"type":"boolean"}},"minProperties":1,"title":"Metrics"},"OutputsQueue":{"type":"object","additionalProperties":false,"properties":{"capacity":{"type":"integer"},"reserved_capacity":{"type":"integer"},"reserved_priority":{"type":"string"}},"minProperties":1,"title":"OutputsQueue"},"OutputsSpool":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"directory":{"type":"string"},"segment_size_mb":{"type":"integer"},"max_size_mb":{"type":"integer"},"high_watermark":{"type":"integer"}},"minProperties":1,"title":"OutputsSpool"},"Plugin":{"type":"object","additionalProperties":false,"properties":{"name":{"type":"string"},"library_path":{"type":"string"},"init_config":{"type":"string"},"open_params":{"type":"string"}},"required":["library_path","name"],"title":"Plugin"},"ProgramOutput":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"keep_alive":{"type":"boolean"},"program":{"type":"string"}},"required":["program"],"title":"ProgramOutput"},"ShmOutput":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"path":{"type":"string"},"size_mb":{"type":"integer"}},"minProperties":1,"title":"ShmOutput"},"SyslogOutput":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"endpoint":{"type":"string"},"facility":{"type":"string"},"batch_size":{"type":"integer"},"backlog_size":{"type":"integer"}},"minProperties":1,"title":"SyslogOutput"},"Rule":{"type":"object","additionalProperties":false,"properties":{"disable":{"$ref":"#/definitions/Able"},"enable":{"$ref":"#/definitions/Able"}},"minProperties":1,"title":"Rule"},"Able":{"type":"object","additionalProperties":false,"properties":{"rule":{"type":"string"},"tag":{"type":"string"}},"minProperties":1,"title":"Able"},"SyscallEventDrops":{"type":"object","additionalProperties":false,"properties":{"threshold":{"type":"number"},"actions":{"type":"array","items":{"type":"string"}},"rate":{"type":"number"},"max_burst":{"type":"integer"},"simulate_drops":{"type":"boolean"},"load_shedding":{"$ref":"#/definitions/LoadShedding"}},"minProperties":1,"title":"SyscallEventDrops"},"SyscallEventTimeouts":{"type":"object","additionalProperties":false,"properties":{"max_consecutives":{"type":"integer"}},"minProperties":1,"title":"SyscallEventTimeouts"},"Webserver":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"threadiness":{"type":"integer"},"listen_port":{"type":"integer"},"listen_address":{"type":"string"},"k8s_healthz_endpoint":{"type":"string"},"prometheus_metrics_enabled":{"type":"boolean"},"prometheus_metrics_max_age":{"type":"integer"},"prometheus_metrics_gzip":{"type":"boolean"},"ssl_enabled":{"type":"boolean"},"ssl_certificate":{"type":"string"}},"minProperties":1,"title":"Webserver"},"LoadShedding":{"type":"object","additionalProperties":false,"properties":{"steps":{"type":"array","items":{"$ref":"#/definitions/LoadSheddingStep"}},"step_seconds":{"type":"integer"},"recovery_threshold":{"type":"number"},"recovery_seconds":{"type":"integer"}},"minProperties":1,"title":"LoadShedding"},"LoadSheddingStep":{"type":"object","additionalProperties":false,"properties":{"rules":{"type":"array","items":{"type":"string"}},"tags":{"type":"array","items":{"type":"string"}}},"minProperties":1,"title":"LoadSheddingStep"},"SyscallBufferAutotune":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"state_file":{"type":"string"},"profile":{"type":"string"},"min_buf_size_preset":{"type":"integer"},"max_buf_size_preset":{"type":"integer"},"grow_drop_ratio":{"type":"number"},"max_lag_ms":{"type":"integer"},"shrink_after_runs":{"type":"integer"},"min_run_seconds":{"type":"integer"}},"minProperties":1,"title":"SyscallBufferAutotune"},"ThreadAffinity":{"type":"object","additionalProperties":false,"properties":{"sources":{"type":"string"},"outputs":{"type":"string"},"stats":{"type":"string"},"grpc":{"type":"string"},"webserver":{"type":"string"}},"minProperties":1,"title":"ThreadAffinity"},"MemorySoftLimits":{"type":"object","additionalProperties":false,"properties":{"total_mb":{"type":"integer"},"outputs_queue_mb":{"type":"integer"},"grpc_queue_mb":{"type":"integer"},"thread_table_mb":{"type":"integer"}},"minProperties":1,"title":"MemorySoftLimits"},"ShadowRules":{"type":"object","additionalProperties":false,"properties":{"enabled":{"type":"boolean"},"rules_files":{"type":"array","items":{"type":"string"}},"sampling_ratio":{"type":"integer"}},"minProperties":1,"title":"ShadowRules"},"EventSampling":{"type":"object","additionalProperties":false,"properties":{"ratio":{"type":"integer"},"seed":{"type":"integer"},"mode":{"type":"string","enum":["uniform","stratified"]},"min_evts_per_type":{"type":"integer"},"window_evts":{"type":"integer"}},"minProperties":1,"title":"EventSampling"}}})";
 
 falco_configuration::falco_configuration():
 	m_json_output(false),
 	m_json_include_output_property(true),
 	m_json_include_tags_property(true),
 	m_rule_matching(falco_common::rule_matching::FIRST),
+	m_rule_condition_backend(falco_common::condition_backend::TREE),
 	m_watch_config_files(true),
 	m_buffered_outputs(false),
 	m_outputs_queue_capacity(DEFAULT_OUTPUTS_QUEUE_CAPACITY_UNBOUNDED_MAX_LONG_VALUE),
+	m_outputs_queue_reserved_capacity(0),
+	m_outputs_queue_reserved_priority(falco_common::PRIORITY_CRITICAL),
 	m_time_format_iso_8601(false),
 	m_output_timeout(2000),
 	m_grpc_enabled(false),
@@ -313,6 +317,8 @@ void falco_configuration::load_yaml(const std::string& config_name)
 		}
 	}
 
+	m_rules_bundle = m_config.get_scalar<std::string>("rules_bundle", "");
+
 	m_json_output = m_config.get_scalar<bool>("json_output", false);
 	m_json_include_output_property = m_config.get_scalar<bool>("json_include_output_property", true);
 	m_json_include_tags_property = m_config.get_scalar<bool>("json_include_tags_property", true);
@@ -347,6 +353,11 @@ void falco_configuration::load_yaml(const std::string& config_name)
 	syslog_output.name = "syslog";
 	if(m_config.get_scalar<bool>("syslog_output.enabled", false))
 	{
+		syslog_output.options["endpoint"] = m_config.get_scalar<std::string>("syslog_output.endpoint", "");
+		syslog_output.options["facility"] = m_config.get_scalar<std::string>("syslog_output.facility", "user");
+		syslog_output.options["batch_size"] = std::to_string(m_config.get_scalar<uint32_t>("syslog_output.batch_size", 64));
+		syslog_output.options["backlog_size"] = std::to_string(m_config.get_scalar<uint32_t>("syslog_output.backlog_size", 10000));
+
 		m_outputs.push_back(syslog_output);
 	}
 
@@ -428,6 +439,29 @@ void falco_configuration::load_yaml(const std::string& config_name)
 		m_outputs.push_back(http_output);
 	}
 
+	falco::outputs::config shm_output;
+	shm_output.name = "shm";
+	if(m_config.get_scalar<bool>("shm_output.enabled", false))
+	{
+		std::string path;
+		path = m_config.get_scalar<std::string>("shm_output.path", "/dev/shm/falco_alerts");
+		if(path == std::string(""))
+		{
+			throw std::logic_error("Error reading config file (" + config_name + "): shm output enabled but no path in configuration block");
+		}
+		shm_output.options["path"] = path;
+
+		uint32_t size_mb;
+		size_mb = m_config.get_scalar<uint32_t>("shm_output.size_mb", 8);
+		if(size_mb == 0)
+		{
+			throw std::logic_error("Error reading config file (" + config_name + "): shm_output.size_mb must be greater than 0");
+		}
+		shm_output.options["size_mb"] = std::to_string(size_mb);
+
+		m_outputs.push_back(shm_output);
+	}
+
 	m_grpc_enabled = m_config.get_scalar<bool>("grpc.enabled", false);
 	m_grpc_bind_address = m_config.get_scalar<std::string>("grpc.bind_address", "0.0.0.0:5060");
 	m_grpc_threadiness = m_config.get_scalar<uint32_t>("grpc.threadiness", 0);
@@ -456,6 +490,33 @@ void falco_configuration::load_yaml(const std::string& config_name)
 		throw std::logic_error("Unknown rule matching strategy \"" + rule_matching + "\"--must be one of first, all");
 	}
 
+	std::string rule_condition_backend = m_config.get_scalar<std::string>("rule_condition_backend", "tree");
+	if (!falco_common::parse_condition_backend(rule_condition_backend, m_rule_condition_backend))
+	{
+		throw std::logic_error("Unknown rule condition backend \"" + rule_condition_backend + "\"--must be one of tree, bytecode, adaptive");
+	}
+
+	m_event_sampling = {};
+	m_event_sampling.m_ratio = m_config.get_scalar<uint32_t>("event_sampling.ratio", 1);
+	m_event_sampling.m_has_seed = m_config.is_defined("event_sampling.seed");
+	m_event_sampling.m_seed = m_config.get_scalar<uint64_t>("event_sampling.seed", 0);
+	std::string event_sampling_mode = m_config.get_scalar<std::string>("event_sampling.mode", "uniform");
+	if (event_sampling_mode == "stratified")
+	{
+		m_event_sampling.m_mode = event_sampler::mode::STRATIFIED;
+	}
+	else if (event_sampling_mode != "uniform")
+	{
+		throw std::logic_error("Error reading config file (" + config_name + "): unknown event_sampling.mode \"" + event_sampling_mode + "\"--must be one of uniform, stratified");
+	}
+	m_event_sampling.m_min_evts_per_type = m_config.get_scalar<uint32_t>("event_sampling.min_evts_per_type", 16);
+	m_event_sampling.m_window_evts = m_config.get_scalar<uint64_t>("event_sampling.window_evts", 100000);
+	if (m_event_sampling.m_ratio == 0 || m_event_sampling.m_min_evts_per_type == 0
+		|| m_event_sampling.m_window_evts < m_event_sampling.m_min_evts_per_type)
+	{
+		throw std::logic_error("Error reading config file (" + config_name + "): event_sampling requires a ratio > 0, a min_evts_per_type > 0 and a window_evts >= min_evts_per_type");
+	}
+
 	std::string priority = m_config.get_scalar<std::string>("priority", "debug");
 	if (!falco_common::parse_priority(priority, m_min_priority))
 	{
@@ -469,6 +530,26 @@ void falco_configuration::load_yaml(const std::string& config_name)
 	{
 		m_outputs_queue_capacity = DEFAULT_OUTPUTS_QUEUE_CAPACITY_UNBOUNDED_MAX_LONG_VALUE;
 	}
+	m_outputs_queue_reserved_capacity = m_config.get_scalar<size_t>("outputs_queue.reserved_capacity", 0);
+	if (m_outputs_queue_reserved_capacity > m_outputs_queue_capacity)
+	{
+		throw std::logic_error("Error reading config file (" + config_name + "): outputs_queue.reserved_capacity must not exceed outputs_queue.capacity");
+	}
+	std::string reserved_priority = m_config.get_scalar<std::string>("outputs_queue.reserved_priority", "critical");
+	if (!falco_common::parse_priority(reserved_priority, m_outputs_queue_reserved_priority))
+	{
+		throw std::logic_error("Unknown outputs_queue.reserved_priority \"" + reserved_priority + "\"--must be one of emergency, alert, critical, error, warning, notice, informational, debug");
+	}
+
+	m_outputs_spool.enabled = m_config.get_scalar<bool>("outputs_spool.enabled", false);
+	m_outputs_spool.directory = m_config.get_scalar<std::string>("outputs_spool.directory", "/var/lib/falco/spool");
+	m_outputs_spool.segment_size = m_config.get_scalar<uint64_t>("outputs_spool.segment_size_mb", 16) * 1024 * 1024;
+	m_outputs_spool.max_size = m_config.get_scalar<uint64_t>("outputs_spool.max_size_mb", 1024) * 1024 * 1024;
+	m_outputs_spool.high_watermark = m_config.get_scalar<size_t>("outputs_spool.high_watermark", 10000);
+	if (m_outputs_spool.enabled && (m_outputs_spool.segment_size == 0 || m_outputs_spool.max_size < m_outputs_spool.segment_size))
+	{
+		throw std::logic_error("Error reading config file (" + config_name + "): outputs_spool.segment_size_mb must be greater than 0 and must not exceed outputs_spool.max_size_mb");
+	}
 
 	m_time_format_iso_8601 = m_config.get_scalar<bool>("time_format_iso_8601", false);
 
@@ -489,6 +570,8 @@ void falco_configuration::load_yaml(const std::string& config_name)
 		m_webserver_config.m_threadiness = falco::utils::hardware_concurrency();
 	}
 	m_webserver_config.m_prometheus_metrics_enabled = m_config.get_scalar<bool>("webserver.prometheus_metrics_enabled", false);
+	m_webserver_config.m_prometheus_metrics_max_age = m_config.get_scalar<uint32_t>("webserver.prometheus_metrics_max_age", 1000);
+	m_webserver_config.m_prometheus_metrics_gzip = m_config.get_scalar<bool>("webserver.prometheus_metrics_gzip", true);
 
 	std::list<std::string> syscall_event_drop_acts;
 	m_config.get_sequence(syscall_event_drop_acts, "syscall_event_drops.actions");
@@ -520,9 +603,17 @@ void falco_configuration::load_yaml(const std::string& config_name)
 		{
 			m_syscall_evt_drop_actions.insert(syscall_evt_drop_action::EXIT);
 		}
+		else if(act == "shed")
+		{
+			if(m_syscall_evt_drop_actions.count(syscall_evt_drop_action::DISREGARD))
+			{
+				throw std::logic_error("Error reading config file (" + config_name + "): syscall event drop action \"" + act + "\" does not make sense with the \"ignore\" action");
+			}
+			m_syscall_evt_drop_actions.insert(syscall_evt_drop_action::SHED);
+		}
 		else
 		{
-			throw std::logic_error("Error reading config file (" + config_name + "): available actions for syscall event drops are \"ignore\", \"log\", \"alert\", and \"exit\"");
+			throw std::logic_error("Error reading config file (" + config_name + "): available actions for syscall event drops are \"ignore\", \"log\", \"alert\", \"exit\", and \"shed\"");
 		}
 	}
 
@@ -540,6 +631,23 @@ void falco_configuration::load_yaml(const std::string& config_name)
 	m_syscall_evt_drop_max_burst = m_config.get_scalar<double>("syscall_event_drops.max_burst", 1);
 	m_syscall_evt_simulate_drops = m_config.get_scalar<bool>("syscall_event_drops.simulate_drops", false);
 
+	m_syscall_evt_drop_shedding = {};
+	m_config.get_sequence<std::vector<syscall_evt_drop_shedding_step>>(m_syscall_evt_drop_shedding.steps, "syscall_event_drops.load_shedding.steps");
+	m_syscall_evt_drop_shedding.step_seconds = m_config.get_scalar<uint32_t>("syscall_event_drops.load_shedding.step_seconds", 5);
+	m_syscall_evt_drop_shedding.recovery_threshold = m_config.get_scalar<double>("syscall_event_drops.load_shedding.recovery_threshold", 0);
+	m_syscall_evt_drop_shedding.recovery_seconds = m_config.get_scalar<uint32_t>("syscall_event_drops.load_shedding.recovery_seconds", 30);
+	if(m_syscall_evt_drop_actions.count(syscall_evt_drop_action::SHED))
+	{
+		if(m_syscall_evt_drop_shedding.steps.empty())
+		{
+			throw std::logic_error("Error reading config file (" + config_name + "): syscall event drop action \"shed\" requires at least one step in syscall_event_drops.load_shedding.steps");
+		}
+		if(m_syscall_evt_drop_shedding.recovery_threshold < 0 || m_syscall_evt_drop_shedding.recovery_threshold > m_syscall_evt_drop_threshold)
+		{
+			throw std::logic_error("Error reading config file (" + config_name + "): syscall event drops load shedding recovery threshold must be a double in the range [0, threshold]");
+		}
+	}
+
 	m_syscall_evt_timeout_max_consecutives = m_config.get_scalar<uint32_t>("syscall_event_timeouts.max_consecutives", 1000);
 	if(m_syscall_evt_timeout_max_consecutives == 0)
 	{
@@ -552,6 +660,69 @@ void falco_configuration::load_yaml(const std::string& config_name)
 	m_config.get_sequence<std::unordered_set<std::string>>(m_base_syscalls_custom_set, std::string("base_syscalls.custom_set"));
 	m_base_syscalls_repair = m_config.get_scalar<bool>("base_syscalls.repair", false);
 
+	m_syscall_buffer_autotune.enabled = m_config.get_scalar<bool>("syscall_buffer_autotune.enabled", false);
+	m_syscall_buffer_autotune.state_file = m_config.get_scalar<std::string>("syscall_buffer_autotune.state_file", "/var/lib/falco/syscall_buffer_autotune.json");
+	m_syscall_buffer_autotune.profile = m_config.get_scalar<std::string>("syscall_buffer_autotune.profile", "");
+	m_syscall_buffer_autotune.min_preset = m_config.get_scalar<int16_t>("syscall_buffer_autotune.min_buf_size_preset", 1);
+	m_syscall_buffer_autotune.max_preset = m_config.get_scalar<int16_t>("syscall_buffer_autotune.max_buf_size_preset", 7);
+	m_syscall_buffer_autotune.grow_drop_ratio = m_config.get_scalar<double>("syscall_buffer_autotune.grow_drop_ratio", 0);
+	m_syscall_buffer_autotune.max_lag_ns = m_config.get_scalar<uint64_t>("syscall_buffer_autotune.max_lag_ms", 100) * 1000000;
+	m_syscall_buffer_autotune.shrink_after_runs = m_config.get_scalar<uint32_t>("syscall_buffer_autotune.shrink_after_runs", 5);
+	m_syscall_buffer_autotune.min_run_seconds = m_config.get_scalar<uint32_t>("syscall_buffer_autotune.min_run_seconds", 600);
+	if(m_syscall_buffer_autotune.enabled)
+	{
+		const auto& at = m_syscall_buffer_autotune;
+		if(at.min_preset < 1 || at.max_preset > 10 || at.min_preset > at.max_preset)
+		{
+			throw std::logic_error("Error reading config file (" + config_name + "): syscall_buffer_autotune buf_size_preset bounds must be in the range [1, 10], with min_buf_size_preset not exceeding max_buf_size_preset");
+		}
+		if(at.grow_drop_ratio < 0 || at.grow_drop_ratio >= 1)
+		{
+			throw std::logic_error("Error reading config file (" + config_name + "): syscall_buffer_autotune.grow_drop_ratio must be a double in the range [0, 1)");
+		}
+		if(at.state_file.empty() || at.shrink_after_runs == 0)
+		{
+			throw std::logic_error("Error reading config file (" + config_name + "): syscall_buffer_autotune requires a state_file and a shrink_after_runs value > 0");
+		}
+	}
+
+	m_thread_affinity.m_sources = m_config.get_scalar<std::string>("thread_affinity.sources", "");
+	m_thread_affinity.m_outputs = m_config.get_scalar<std::string>("thread_affinity.outputs", "");
+	m_thread_affinity.m_stats = m_config.get_scalar<std::string>("thread_affinity.stats", "");
+	m_thread_affinity.m_grpc = m_config.get_scalar<std::string>("thread_affinity.grpc", "");
+	m_thread_affinity.m_webserver = m_config.get_scalar<std::string>("thread_affinity.webserver", "");
+	for (const auto& [key, list] : std::vector<std::pair<std::string, std::string>>{
+		{"sources", m_thread_affinity.m_sources},
+		{"outputs", m_thread_affinity.m_outputs},
+		{"stats", m_thread_affinity.m_stats},
+		{"grpc", m_thread_affinity.m_grpc},
+		{"webserver", m_thread_affinity.m_webserver}})
+	{
+		falco::threads::cpu_set cpus;
+		std::string err;
+		if ((key != "sources" || list != "auto") && !falco::threads::parse_cpu_list(list, cpus, err))
+		{
+			throw std::logic_error("Error reading config file (" + config_name + "): thread_affinity." + key + ": " + err);
+		}
+	}
+
+	m_memory_soft_limits = {};
+	m_memory_soft_limits.total = m_config.get_scalar<uint64_t>("memory_soft_limits.total_mb", 0) * 1024 * 1024;
+	for (auto s : {falco::memory::subsystem::OUTPUTS_QUEUE, falco::memory::subsystem::GRPC_QUEUE, falco::memory::subsystem::THREAD_TABLE})
+	{
+		auto key = std::string("memory_soft_limits.") + falco::memory::to_string(s) + "_mb";
+		m_memory_soft_limits.subsystems[(size_t)s] = m_config.get_scalar<uint64_t>(key, 0) * 1024 * 1024;
+	}
+
+	m_shadow_rules = {};
+	m_shadow_rules.enabled = m_config.get_scalar<bool>("shadow_rules.enabled", false);
+	m_config.get_sequence<std::list<std::string>>(m_shadow_rules.rules_files, "shadow_rules.rules_files");
+	m_shadow_rules.sampling_ratio = m_config.get_scalar<uint32_t>("shadow_rules.sampling_ratio", 100);
+	if (m_shadow_rules.enabled && (m_shadow_rules.rules_files.empty() || m_shadow_rules.sampling_ratio == 0))
+	{
+		throw std::logic_error("Error reading config file (" + config_name + "): shadow_rules requires at least one entry in rules_files and a sampling_ratio > 0");
+	}
+
 	m_metrics_enabled = m_config.get_scalar<bool>("metrics.enabled", false);
 	m_metrics_interval_str = m_config.get_scalar<std::string>("metrics.interval", "5000");
 	m_metrics_interval = falco::utils::parse_prometheus_interval(m_metrics_interval_str);
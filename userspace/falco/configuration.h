@@ -31,11 +31,16 @@ limitations under the License.
 #include <set>
 #include <iostream>
 #include <fstream>
+#include <mutex>
 
 #include "config_falco.h"
 #include "yaml_helper.h"
 #include "event_drops.h"
 #include "falco_outputs.h"
+#include "syscall_buffer_autotune.h"
+#include "memory_accounting.h"
+#include "shadow_ruleset.h"
+#include "event_sampler.h"
 
 enum class engine_kind_t : uint8_t
 {
@@ -94,6 +99,28 @@ public:
 		bool m_ssl_enabled = false;
 		std::string m_ssl_certificate;
 		bool m_prometheus_metrics_enabled = false;
+		uint32_t m_prometheus_metrics_max_age = 1000;
+		bool m_prometheus_metrics_gzip = true;
+	};
+
+	// CPU lists in the kernel format, empty to not pin the threads
+	struct thread_affinity_config {
+		std::string m_sources;
+		std::string m_outputs;
+		std::string m_stats;
+		std::string m_grpc;
+		std::string m_webserver;
+	};
+
+	// Sampling of the events evaluated against the rules, disabled
+	// with a ratio of 1
+	struct event_sampling_config {
+		uint32_t m_ratio = 1;
+		bool m_has_seed = false;
+		uint64_t m_seed = 0;
+		event_sampler::mode m_mode = event_sampler::mode::UNIFORM;
+		uint32_t m_min_evts_per_type = 16;
+		uint64_t m_window_evts = 100000;
 	};
 
 	enum class rule_selection_operation {
@@ -128,12 +155,17 @@ public:
 	std::list<std::string> m_rules_filenames;
 	// Actually loaded rules, with folders inspected
 	std::list<std::string> m_loaded_rules_filenames;
-	// Map with filenames and their sha256 of the loaded rules files
+	// Map with filenames and their sha256 of the loaded rules files. It is
+	// replaced when rules are reloaded in-place, while the metrics may be
+	// reading it: both must hold m_loaded_rules_filenames_sha256sum_mtx
 	std::unordered_map<std::string, std::string> m_loaded_rules_filenames_sha256sum;
+	std::mutex m_loaded_rules_filenames_sha256sum_mtx;
 	// List of loaded rule folders
 	std::list<std::string> m_loaded_rules_folders;
 	// Rule selection options passed by the user
 	std::vector<rule_selection_config> m_rules_selection;
+	// Path of the precompiled rules bundle, empty if not used
+	std::string m_rules_bundle;
 
 	bool m_json_output;
 	bool m_json_include_output_property;
@@ -143,10 +175,15 @@ public:
 
 	falco_common::priority_type m_min_priority;
 	falco_common::rule_matching m_rule_matching;
+	falco_common::condition_backend m_rule_condition_backend;
+	event_sampling_config m_event_sampling;
 
 	bool m_watch_config_files;
 	bool m_buffered_outputs;
 	size_t m_outputs_queue_capacity;
+	size_t m_outputs_queue_reserved_capacity;
+	falco_common::priority_type m_outputs_queue_reserved_priority;
+	falco::outputs::spool_config m_outputs_spool;
 	bool m_time_format_iso_8601;
 	uint32_t m_output_timeout;
 
@@ -164,6 +201,7 @@ public:
 	double m_syscall_evt_drop_threshold;
 	double m_syscall_evt_drop_rate;
 	double m_syscall_evt_drop_max_burst;
+	syscall_evt_drop_shedding_config m_syscall_evt_drop_shedding;
 	// Only used for testing
 	bool m_syscall_evt_simulate_drops;
 
@@ -175,6 +213,14 @@ public:
 	std::unordered_set<std::string> m_base_syscalls_custom_set;
 	bool m_base_syscalls_repair;
 
+	syscall_buffer_autotune_config m_syscall_buffer_autotune;
+
+	thread_affinity_config m_thread_affinity;
+
+	falco::memory::soft_limits m_memory_soft_limits;
+
+	shadow_rules_config m_shadow_rules;
+
 	// metrics configs
 	bool m_metrics_enabled;
 	std::string m_metrics_interval_str;
@@ -304,6 +350,54 @@ namespace YAML {
 		}
 	};
 
+	template<>
+	struct convert<syscall_evt_drop_shedding_step> {
+		static Node encode(const syscall_evt_drop_shedding_step & rhs) {
+			Node node;
+			for(const auto &rule : rhs.rules)
+			{
+				node["rules"].push_back(rule);
+			}
+			for(const auto &tag : rhs.tags)
+			{
+				node["tags"].push_back(tag);
+			}
+			return node;
+		}
+
+		static bool decode(const Node& node, syscall_evt_drop_shedding_step & rhs) {
+			if(!node.IsMap())
+			{
+				return false;
+			}
+
+			auto decode_set = [&node](const char *key, std::set<std::string> &ret)
+			{
+				const Node& values = node[key];
+				if(!values)
+				{
+					return true;
+				}
+				if(!values.IsSequence())
+				{
+					return false;
+				}
+				for(const auto &value : values)
+				{
+					ret.insert(value.as<std::string>());
+				}
+				return true;
+			};
+
+			if(!decode_set("rules", rhs.rules) || !decode_set("tags", rhs.tags))
+			{
+				return false;
+			}
+
+			return !rhs.rules.empty() || !rhs.tags.empty();
+		}
+	};
+
 	template<>
 	struct convert<falco_configuration::plugin_config> {
 
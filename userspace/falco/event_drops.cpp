@@ -17,6 +17,9 @@ limitations under the License.
 
 #include "event_drops.h"
 #include "falco_common.h"
+#include "memory_accounting.h"
+
+#include <chrono>
 
 syscall_evt_drop_mgr::syscall_evt_drop_mgr():
 	m_num_syscall_evt_drops(0),
@@ -25,7 +28,12 @@ syscall_evt_drop_mgr::syscall_evt_drop_mgr():
 	m_outputs(NULL),
 	m_next_check_ts(0),
 	m_simulate_drops(false),
-	m_threshold(0)
+	m_threshold(0),
+	m_num_shed_steps(0),
+	m_last_shedding_ts(0),
+	m_recovery_secs(0),
+	m_num_shedding_transitions(0),
+	m_memory_pressure(false)
 {
 }
 
@@ -49,6 +57,8 @@ void syscall_evt_drop_mgr::init(std::shared_ptr<sinsp> inspector,
 
 	m_inspector->get_capture_stats(&m_last_stats);
 
+	m_memory_pressure = false;
+
 	m_simulate_drops = simulate_drops;
 	if(m_simulate_drops)
 	{
@@ -56,6 +66,20 @@ void syscall_evt_drop_mgr::init(std::shared_ptr<sinsp> inspector,
 	}
 }
 
+void syscall_evt_drop_mgr::init_load_shedding(const syscall_evt_drop_shedding_config &config, shedding_func func)
+{
+	m_shedding = config;
+	m_shedding_func = func;
+	m_num_shed_steps = 0;
+	m_last_shedding_ts = 0;
+	m_recovery_secs = 0;
+}
+
+void syscall_evt_drop_mgr::init_buffer_autotune(std::shared_ptr<syscall_buffer_autotune> autotune)
+{
+	m_buffer_autotune = autotune;
+}
+
 bool syscall_evt_drop_mgr::process_event(std::shared_ptr<sinsp> inspector, sinsp_evt *evt)
 {
 	if(m_next_check_ts == 0)
@@ -97,12 +121,23 @@ bool syscall_evt_drop_mgr::process_event(std::shared_ptr<sinsp> inspector, sinsp
 
 		m_last_stats = stats;
 
+		if(m_buffer_autotune)
+		{
+			// only the drops due to a full buffer tell about its size
+			uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+			uint64_t lag = now > evt->get_ts() ? now - evt->get_ts() : 0;
+			m_buffer_autotune->observe(delta.n_evts, delta.n_drops_buffer, lag);
+		}
+
 		if(m_simulate_drops)
 		{
 			falco_logger::log(falco_logger::level::INFO, "Simulating syscall event drop");
 			delta.n_drops++;
 		}
 
+		update_memory_pressure();
+		update_load_shedding(evt->get_ts(), delta);
+
 		if(delta.n_drops > 0)
 		{
 			double ratio = delta.n_drops;
@@ -138,6 +173,122 @@ void syscall_evt_drop_mgr::print_stats()
 	fprintf(stderr, "Syscall event drop monitoring:\n");
 	fprintf(stderr, "   - event drop detected: %lu occurrences\n", m_num_syscall_evt_drops);
 	fprintf(stderr, "   - num times actions taken: %lu\n", m_num_actions);
+	if(m_shedding_func)
+	{
+		fprintf(stderr, "   - num load shedding transitions: %lu\n", m_num_shedding_transitions);
+	}
+}
+
+void syscall_evt_drop_mgr::update_memory_pressure()
+{
+	// each thread also owns its fd table and a few strings (comm, exe,
+	// args, env, cgroups), which we approximate with a fixed size
+	static const uint64_t thread_heap_bytes = 1024;
+	uint64_t num_threads = m_inspector->m_thread_manager->get_thread_count();
+	falco::memory::set(falco::memory::subsystem::THREAD_TABLE, num_threads * (sizeof(sinsp_threadinfo) + thread_heap_bytes));
+
+	bool pressure = falco::memory::over_total_soft_limit()
+		|| falco::memory::over_soft_limit(falco::memory::subsystem::THREAD_TABLE);
+	if(pressure == m_memory_pressure)
+	{
+		return;
+	}
+
+	m_memory_pressure = pressure;
+	if(pressure)
+	{
+		if(falco::memory::over_soft_limit(falco::memory::subsystem::THREAD_TABLE))
+		{
+			falco::memory::count_limit_hit(falco::memory::subsystem::THREAD_TABLE);
+		}
+		falco_logger::log(falco_logger::level::WARNING, "Memory soft limit exceeded: accounted "
+			+ std::to_string(falco::memory::total()) + " bytes in total, of which "
+			+ std::to_string(falco::memory::get(falco::memory::subsystem::THREAD_TABLE)) + " for the thread table"
+			+ (m_shedding_func ? ", shedding load" : "") + "\n");
+	}
+	else
+	{
+		falco_logger::log(falco_logger::level::INFO, "Memory back below the soft limits\n");
+	}
+}
+
+void syscall_evt_drop_mgr::update_load_shedding(uint64_t now, const scap_stats &delta)
+{
+	if(!m_shedding_func)
+	{
+		return;
+	}
+
+	double ratio = 0;
+	if(delta.n_drops > 0)
+	{
+		// The `n_evts` always contains the `n_drops`.
+		ratio = delta.n_evts > 0 ? (double)delta.n_drops / delta.n_evts : 1;
+	}
+
+	if(ratio > m_threshold || m_memory_pressure)
+	{
+		m_recovery_secs = 0;
+
+		// give each step some time to take effect before applying the next one
+		if(m_num_shed_steps < m_shedding.steps.size()
+			&& (m_num_shed_steps == 0 || now - m_last_shedding_ts >= m_shedding.step_seconds * ONE_SECOND_IN_NS))
+		{
+			size_t step = m_num_shed_steps;
+			auto res = m_shedding_func(step, true);
+			m_num_shed_steps++;
+			m_last_shedding_ts = now;
+			notify_load_shedding(now, delta, step, true, res);
+		}
+		return;
+	}
+
+	// revert steps only once drops stayed below the recovery threshold for
+	// a while, so that we don't keep flapping around the threshold
+	if(ratio <= m_shedding.recovery_threshold)
+	{
+		m_recovery_secs++;
+	}
+	else
+	{
+		m_recovery_secs = 0;
+	}
+
+	if(m_num_shed_steps > 0 && m_recovery_secs >= m_shedding.recovery_seconds)
+	{
+		size_t step = m_num_shed_steps - 1;
+		auto res = m_shedding_func(step, false);
+		m_num_shed_steps--;
+		m_last_shedding_ts = now;
+		m_recovery_secs = 0;
+		notify_load_shedding(now, delta, step, false, res);
+	}
+}
+
+void syscall_evt_drop_mgr::notify_load_shedding(uint64_t now, const scap_stats &delta, size_t step, bool shed,
+						const syscall_evt_drop_shedding_result &res)
+{
+	m_num_shedding_transitions++;
+
+	std::string rule = "Falco internal: load shedding";
+	std::string msg = rule + ". " + (shed ? "Disabled " : "Enabled back ")
+		+ std::to_string(res.rules.size()) + " rules of step " + std::to_string(step + 1)
+		+ "/" + std::to_string(m_shedding.steps.size()) + ", "
+		+ std::to_string(res.syscalls.size()) + " syscalls "
+		+ (shed ? "no longer collected." : "collected again.");
+
+	falco_logger::log(shed ? falco_logger::level::WARNING : falco_logger::level::INFO, msg + "\n");
+
+	nlohmann::json output_fields;
+	output_fields["action"] = shed ? "shed" : "restore";
+	output_fields["step"] = std::to_string(step + 1);
+	output_fields["num_shed_steps"] = std::to_string(m_num_shed_steps);
+	output_fields["rules"] = concat_set_in_order(res.rules);
+	output_fields["syscalls"] = concat_set_in_order(res.syscalls);
+	output_fields["n_evts"] = std::to_string(delta.n_evts);
+	output_fields["n_drops"] = std::to_string(delta.n_drops);
+	output_fields["memory_pressure"] = m_memory_pressure ? "true" : "false";
+	m_outputs->handle_msg(now, shed ? falco_common::PRIORITY_WARNING : falco_common::PRIORITY_NOTICE, msg, rule, output_fields);
 }
 
 bool syscall_evt_drop_mgr::perform_actions(uint64_t now, const scap_stats &delta, bool bpf_enabled)
@@ -199,6 +350,10 @@ bool syscall_evt_drop_mgr::perform_actions(uint64_t now, const scap_stats &delta
 			falco_logger::log(falco_logger::level::CRIT, "Exiting.");
 			return false;
 
+		case syscall_evt_drop_action::SHED:
+			// load shedding is not rate limited, see update_load_shedding()
+			break;
+
 		default:
 			falco_logger::log(falco_logger::level::ERR, "Ignoring unknown action " + std::to_string(int(act)));
 			return true;
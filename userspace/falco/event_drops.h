@@ -16,14 +16,19 @@ limitations under the License.
 */
 #pragma once
 
+#include <functional>
 #include <memory>
+#include <set>
+#include <string>
 #include <unordered_set>
+#include <vector>
 
 #include <libsinsp/sinsp.h>
 #include <libsinsp/token_bucket.h>
 
 #include "logger.h"
 #include "falco_outputs.h"
+#include "syscall_buffer_autotune.h"
 
 // The possible actions that this class can take upon
 // detecting a syscall event drop.
@@ -32,11 +37,41 @@ enum class syscall_evt_drop_action : uint8_t
 	DISREGARD = 0,
 	LOG,
 	ALERT,
-	EXIT
+	EXIT,
+	SHED
 };
 
 using syscall_evt_drop_actions = std::unordered_set<syscall_evt_drop_action>;
 
+// A group of rules that the SHED action disables at once, selected by
+// name (wildcards are supported) or by tag
+struct syscall_evt_drop_shedding_step
+{
+	std::set<std::string> rules;
+	std::set<std::string> tags;
+};
+
+struct syscall_evt_drop_shedding_config
+{
+	// applied in order while drops go on, and reverted in reverse order
+	std::vector<syscall_evt_drop_shedding_step> steps;
+	// minimum number of seconds between two steps being applied
+	uint32_t step_seconds = 5;
+	// drop ratio at or below which drops are considered stopped
+	double recovery_threshold = 0;
+	// number of consecutive seconds without drops before reverting a step
+	uint32_t recovery_seconds = 30;
+};
+
+// What applying or reverting a load shedding step changed
+struct syscall_evt_drop_shedding_result
+{
+	// the rules that were disabled or enabled back
+	std::set<std::string> rules;
+	// the syscalls that stopped or started being collected
+	std::set<std::string> syscalls;
+};
+
 class syscall_evt_drop_mgr
 {
 public:
@@ -58,12 +93,35 @@ public:
 	// Returns whether event processing should continue or stop (with an error).
 	bool process_event(std::shared_ptr<sinsp> inspector, sinsp_evt *evt);
 
+	// Applies (shed is true) or reverts (shed is false) the given
+	// load shedding step.
+	using shedding_func = std::function<syscall_evt_drop_shedding_result(size_t step, bool shed)>;
+
+	// Must be called after init() when the SHED action is configured.
+	// Steps are applied one at a time when drops exceed the threshold,
+	// and reverted one at a time once drops stop, with hysteresis.
+	void init_load_shedding(const syscall_evt_drop_shedding_config &config, shedding_func func);
+
+	// Must be called after init() to report the buffer drops and the
+	// consumer lag of each second to the syscall buffer auto-tuning.
+	void init_buffer_autotune(std::shared_ptr<syscall_buffer_autotune> autotune);
+
 	void print_stats();
 
 protected:
 	// Perform all configured actions.
 	bool perform_actions(uint64_t now, const scap_stats &delta, bool bpf_enabled);
 
+	// Account the memory of the thread table, and check whether Falco
+	// exceeds the memory soft limits that trigger load shedding.
+	void update_memory_pressure();
+
+	// Apply or revert a load shedding step depending on the drops in
+	// the last second and on the memory pressure, if needed.
+	void update_load_shedding(uint64_t now, const scap_stats &delta);
+	void notify_load_shedding(uint64_t now, const scap_stats &delta, size_t step, bool shed,
+				  const syscall_evt_drop_shedding_result &res);
+
 	uint64_t m_num_syscall_evt_drops;
 	uint64_t m_num_actions;
 	std::shared_ptr<sinsp> m_inspector;
@@ -74,4 +132,12 @@ protected:
 	scap_stats m_last_stats;
 	bool m_simulate_drops;
 	double m_threshold;
+	syscall_evt_drop_shedding_config m_shedding;
+	shedding_func m_shedding_func;
+	size_t m_num_shed_steps;
+	uint64_t m_last_shedding_ts;
+	uint32_t m_recovery_secs;
+	uint64_t m_num_shedding_transitions;
+	bool m_memory_pressure;
+	std::shared_ptr<syscall_buffer_autotune> m_buffer_autotune;
 };
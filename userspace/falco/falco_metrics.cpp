@@ -18,17 +18,24 @@ limitations under the License.
 #include "falco_metrics.h"
 
 #include "falco_utils.h"
+#include "memory_accounting.h"
 
 #include "app/state.h"
 
 #include <libsinsp/sinsp.h>
 
+#include <zlib.h>
+
 namespace fs = std::filesystem;
 
 /*!
 	\class falco_metrics
 	\brief This class is used to convert the metrics provided by the application
 	and falco libs into a string to be return by the metrics endpoint.
+
+	The series that never change during the lifetime of the application are
+	rendered only once, and each rendering is shared by all the requests
+	received until it's older than the configured max age.
 */
 
 /*!
@@ -40,114 +47,256 @@ namespace fs = std::filesystem;
 */
 const std::string falco_metrics::content_type = "text/plain; version=0.0.4";
 
-
 /*!
-	\brief this method takes an application \c state and returns a textual representation of
-	its configured metrics.
-
-	The current implementation returns a Prometheus exposition formatted string.
+	\brief renders the alert latency histograms as Prometheus histograms,
+	with buckets at every power of 4 nanoseconds from ~1us to ~17s
 */
-std::string falco_metrics::to_text(const falco::app::state& state)
+static std::string alert_latency_to_text(const std::vector<falco_outputs::alert_latency>& latencies)
 {
-	static const char* all_driver_engines[] = {
-		BPF_ENGINE, KMOD_ENGINE, MODERN_BPF_ENGINE,
-		SOURCE_PLUGIN_ENGINE, NODRIVER_ENGINE, GVISOR_ENGINE };
-
-	std::vector<std::shared_ptr<sinsp>> inspectors;
-	std::vector<libs::metrics::libs_metrics_collector> metrics_collectors;
+	static const std::string name = "falcosecurity_falco_alert_latency_seconds";
+	static const unsigned max_bucket_exp = 34;
 
-	for (const auto& source: state.enabled_sources)
+	std::string text = "# HELP " + name + " https://falco.org/docs/metrics/\n";
+	text += "# TYPE " + name + " histogram\n";
+	char buf[32];
+	for (const auto& latency : latencies)
 	{
-		auto source_info = state.source_infos.at(source);
-		auto source_inspector = source_info->inspector;
-		inspectors.emplace_back(source_inspector);
-		metrics_collectors.emplace_back(libs::metrics::libs_metrics_collector(source_inspector.get(), state.config->m_metrics_flags));
-	}
-	libs::metrics::prometheus_metrics_converter prometheus_metrics_converter;
-	std::string prometheus_text;
+		std::string labels = "stage=\"" + latency.stage + "\"";
+		if (!latency.output.empty())
+		{
+			labels += ",output=\"" + latency.output + "\"";
+		}
 
-	for (auto inspector: inspectors)
-	{
-		// Falco wrapper metrics
-		//
-		for (size_t i = 0; i < sizeof(all_driver_engines) / sizeof(const char*); i++)
+		for (unsigned exp = falco::latency_histogram::min_exp; exp <= max_bucket_exp; exp += 2)
 		{
-			if (inspector->check_current_engine(all_driver_engines[i]))
-			{
-				prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("engine_name", "falcosecurity", "scap", {{"engine_name", all_driver_engines[i]}});
-				break;
-			}
+			uint64_t bound = (uint64_t) 1 << exp;
+			snprintf(buf, sizeof(buf), "%.9g", (double) bound / ONE_SECOND_IN_NS);
+			text += name + "_bucket{" + labels + ",le=\"" + buf + "\"} " + std::to_string(latency.histogram.count_below(bound)) + "\n";
 		}
+		// consistent with the buckets, even if values were recorded meanwhile
+		auto count = std::to_string(latency.histogram.count_below(UINT64_MAX));
+		text += name + "_bucket{" + labels + ",le=\"+Inf\"} " + count + "\n";
+		snprintf(buf, sizeof(buf), "%.9g", (double) latency.histogram.sum / ONE_SECOND_IN_NS);
+		text += name + "_sum{" + labels + "} " + buf + "\n";
+		text += name + "_count{" + labels + "} " + count + "\n";
+	}
+	return text;
+}
 
 
-		const scap_agent_info* agent_info = inspector->get_agent_info();
-		const scap_machine_info* machine_info = inspector->get_machine_info();
-		libs::metrics::libs_metrics_collector libs_metrics_collector(inspector.get(), 0);
-		prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("version", "falcosecurity", "falco", {{"version", FALCO_VERSION}});
+falco_metrics::falco_metrics(const falco::app::state& state, std::chrono::milliseconds max_age, bool gzip):
+	m_state(state),
+	m_max_age(max_age),
+	m_gzip(gzip),
+	m_accounted_bytes(0)
+{
+}
 
-		// Not all scap engines report agent and machine infos.
-		if (agent_info)
-		{
-			prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("kernel_release", "falcosecurity", "falco", {{"kernel_release", agent_info->uname_r}});
-		}
-		if (machine_info)
+falco_metrics::~falco_metrics()
+{
+	falco::memory::add(falco::memory::subsystem::METRICS, -(int64_t)m_accounted_bytes);
+}
+
+/*!
+	\brief returns the metrics in Prometheus text format, and its gzip
+	compressed version if enabled, rendering them again only if the last
+	rendering is older than the max age
+*/
+falco_metrics::snapshot falco_metrics::get()
+{
+	std::lock_guard<std::mutex> lk(m_mtx);
+	auto now = std::chrono::steady_clock::now();
+	if (m_snapshot.text == nullptr || now - m_rendered_at >= m_max_age)
+	{
+		snapshot s;
+		s.text = std::make_shared<const std::string>(to_text());
+		if (m_gzip)
 		{
-			prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("hostname", "falcosecurity", "evt", {{"hostname", machine_info->hostname}});
+			s.gzip = std::make_shared<const std::string>(compress_gzip(*s.text));
 		}
+		m_snapshot = s;
+		m_rendered_at = now;
 
-#if defined(__linux__) and !defined(MINIMAL_BUILD) and !defined(__EMSCRIPTEN__)
-		// Distinguish between config and rules files using labels, following Prometheus best practices: https://prometheus.io/docs/practices/naming/#labels
-		for (const auto& item : state.config.get()->m_loaded_rules_filenames_sha256sum)
+		// the snapshot is kept until the next rendering
+		size_t bytes = s.text->capacity() + (s.gzip ? s.gzip->capacity() : 0);
+		for (const auto& text : m_static_text)
 		{
-			fs::path fs_path = item.first;
-			prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("falco_sha256_rules_files", "falcosecurity", "falco", {{"file_name", fs_path.filename().stem()}, {"sha256", item.second}});
+			bytes += text.capacity();
 		}
+		falco::memory::add(falco::memory::subsystem::METRICS, (int64_t)bytes - (int64_t)m_accounted_bytes);
+		m_accounted_bytes = bytes;
+	}
+	return m_snapshot;
+}
 
-		for (const auto& item : state.config.get()->m_loaded_configs_filenames_sha256sum)
+std::string falco_metrics::compress_gzip(const std::string& data)
+{
+	z_stream zs = {};
+	// 16 selects the gzip format
+	if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		throw falco_exception("failed to initialize gzip compression");
+	}
+	std::string res;
+	res.resize(deflateBound(&zs, data.size()));
+	zs.next_in = (Bytef*) data.data();
+	zs.avail_in = data.size();
+	zs.next_out = (Bytef*) res.data();
+	zs.avail_out = res.size();
+	int ret = deflate(&zs, Z_FINISH);
+	deflateEnd(&zs);
+	if (ret != Z_STREAM_END)
+	{
+		throw falco_exception("failed to gzip metrics");
+	}
+	res.resize(zs.total_out);
+	return res;
+}
+
+/*!
+	\brief this method renders the series of an inspector that don't change
+	during the lifetime of the application
+*/
+std::string falco_metrics::static_to_text(const std::shared_ptr<sinsp>& inspector) const
+{
+	static const char* all_driver_engines[] = {
+		BPF_ENGINE, KMOD_ENGINE, MODERN_BPF_ENGINE,
+		SOURCE_PLUGIN_ENGINE, NODRIVER_ENGINE, GVISOR_ENGINE };
+
+	libs::metrics::prometheus_metrics_converter prometheus_metrics_converter;
+	std::string prometheus_text;
+
+	// Falco wrapper metrics
+	//
+	for (size_t i = 0; i < sizeof(all_driver_engines) / sizeof(const char*); i++)
+	{
+		if (inspector->check_current_engine(all_driver_engines[i]))
 		{
-			fs::path fs_path = item.first;
-			prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("falco_sha256_config_files", "falcosecurity", "falco", {{"file_name", fs_path.filename().stem()}, {"sha256", item.second}});
+			prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("engine_name", "falcosecurity", "scap", {{"engine_name", all_driver_engines[i]}});
+			break;
 		}
+	}
+
+	const scap_agent_info* agent_info = inspector->get_agent_info();
+	const scap_machine_info* machine_info = inspector->get_machine_info();
+	prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("version", "falcosecurity", "falco", {{"version", FALCO_VERSION}});
+
+	// Not all scap engines report agent and machine infos.
+	if (agent_info)
+	{
+		prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("kernel_release", "falcosecurity", "falco", {{"kernel_release", agent_info->uname_r}});
+	}
+	if (machine_info)
+	{
+		prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("hostname", "falcosecurity", "evt", {{"hostname", machine_info->hostname}});
+	}
 
-		static std::string ifinfo_json_escaped;
-		auto ipv4list = inspector->get_ifaddr_list().get_ipv4_list();
-		auto ipv6list = inspector->get_ifaddr_list().get_ipv6_list();
-		nlohmann::json ipv4_json;
-		nlohmann::json ipv6_json;
-		if(ipv4list)
+#if defined(__linux__) and !defined(MINIMAL_BUILD) and !defined(__EMSCRIPTEN__)
+	// Distinguish between config and rules files using labels, following Prometheus best practices: https://prometheus.io/docs/practices/naming/#labels
+	// The rules files can change with in-place rules reloads, see rules_sha256_to_text()
+	for (const auto& item : m_state.config.get()->m_loaded_configs_filenames_sha256sum)
+	{
+		fs::path fs_path = item.first;
+		prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("falco_sha256_config_files", "falcosecurity", "falco", {{"file_name", fs_path.filename().stem()}, {"sha256", item.second}});
+	}
+
+	auto ipv4list = inspector->get_ifaddr_list().get_ipv4_list();
+	auto ipv6list = inspector->get_ifaddr_list().get_ipv6_list();
+	nlohmann::json ipv4_json;
+	nlohmann::json ipv6_json;
+	if(ipv4list)
+	{
+		for (const auto& item : *ipv4list)
 		{
-			for (const auto& item : *ipv4list)
+			if(item.m_name == "lo")
 			{
-				if(item.m_name == "lo")
-				{
-					continue;
-				}
-				ipv4_json[item.m_name] = item.addr_to_string();
+				continue;
 			}
+			ipv4_json[item.m_name] = item.addr_to_string();
 		}
+	}
 
-		if(ipv6list)
+	if(ipv6list)
+	{
+		for (const auto& item : *ipv6list)
 		{
-			for (const auto& item : *ipv6list)
+			if(item.m_name == "lo")
 			{
-				if(item.m_name == "lo")
-				{
-					continue;
-				}
-				ipv6_json[item.m_name] = item.addr_to_string();
+				continue;
 			}
+			ipv6_json[item.m_name] = item.addr_to_string();
 		}
-		nlohmann::json ifinfo_json;
-		ifinfo_json["ipv4"] = ipv4_json;
-		ifinfo_json["ipv6"] = ipv6_json;
-		ifinfo_json_escaped = ifinfo_json.dump();
-		prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("host_ifinfo_json", "falcosecurity", "falco", {{"host_ifinfo_json", ifinfo_json_escaped}});
+	}
+	nlohmann::json ifinfo_json;
+	ifinfo_json["ipv4"] = ipv4_json;
+	ifinfo_json["ipv6"] = ipv6_json;
+	std::string ifinfo_json_escaped = ifinfo_json.dump();
+	prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("host_ifinfo_json", "falcosecurity", "falco", {{"host_ifinfo_json", ifinfo_json_escaped}});
 #endif
 
-		for (const std::string& source: inspector->event_sources())
+	for (const std::string& source: inspector->event_sources())
+	{
+		prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("evt_source", "falcosecurity", "falco", {{"evt_source", source}});
+	}
+	return prometheus_text;
+}
+
+/*!
+	\brief this method renders the sha256 of the loaded rules files, which
+	change when rules are reloaded in-place
+*/
+std::string falco_metrics::rules_sha256_to_text() const
+{
+	std::string prometheus_text;
+#if defined(__linux__) and !defined(MINIMAL_BUILD) and !defined(__EMSCRIPTEN__)
+	libs::metrics::prometheus_metrics_converter prometheus_metrics_converter;
+	auto& config = *m_state.config;
+	std::lock_guard<std::mutex> lk(config.m_loaded_rules_filenames_sha256sum_mtx);
+	for (const auto& item : config.m_loaded_rules_filenames_sha256sum)
+	{
+		fs::path fs_path = item.first;
+		prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("falco_sha256_rules_files", "falcosecurity", "falco", {{"file_name", fs_path.filename().stem()}, {"sha256", item.second}});
+	}
+#endif
+	return prometheus_text;
+}
+
+/*!
+	\brief this method returns a textual representation of the configured
+	metrics of the application state.
+
+	The current implementation returns a Prometheus exposition formatted string.
+*/
+std::string falco_metrics::to_text()
+{
+	const auto& state = m_state;
+
+	// inspectors and their static series don't change once the
+	// application is running
+	if (m_inspectors.empty())
+	{
+		for (const auto& source: state.enabled_sources)
 		{
-			prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus("evt_source", "falcosecurity", "falco", {{"evt_source", source}});
+			auto source_info = state.source_infos.at(source);
+			auto source_inspector = source_info->inspector;
+			m_inspectors.emplace_back(source_inspector);
+			m_static_text.emplace_back(static_to_text(source_inspector));
+			m_metrics_collectors.emplace_back(libs::metrics::libs_metrics_collector(source_inspector.get(), state.config->m_metrics_flags));
 		}
+	}
+
+	libs::metrics::prometheus_metrics_converter prometheus_metrics_converter;
+	std::string prometheus_text;
+	std::string rules_sha256_text = rules_sha256_to_text();
+
+	for (size_t inspector_idx = 0; inspector_idx < m_inspectors.size(); inspector_idx++)
+	{
+		const auto& inspector = m_inspectors[inspector_idx];
+		prometheus_text += m_static_text[inspector_idx];
+		prometheus_text += rules_sha256_text;
+
+		const scap_agent_info* agent_info = inspector->get_agent_info();
+		const scap_machine_info* machine_info = inspector->get_machine_info();
 		std::vector<metrics_v2> additional_wrapper_metrics;
 
 		if (agent_info)
@@ -180,6 +329,65 @@ std::string falco_metrics::to_text(const falco::app::state& state)
 												METRIC_VALUE_UNIT_COUNT,
 												METRIC_VALUE_METRIC_TYPE_MONOTONIC,
 												state.outputs->get_outputs_queue_num_drops()));
+		if (state.config->m_outputs_spool.enabled)
+		{
+			additional_wrapper_metrics.emplace_back(libs::metrics::libsinsp_metrics::new_metric("outputs_spool_num_msgs",
+													METRICS_V2_MISC,
+													METRIC_VALUE_TYPE_U64,
+													METRIC_VALUE_UNIT_COUNT,
+													METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+													state.outputs->get_outputs_spool_num_msgs()));
+			additional_wrapper_metrics.emplace_back(libs::metrics::libsinsp_metrics::new_metric("outputs_spool_num_drops",
+													METRICS_V2_MISC,
+													METRIC_VALUE_TYPE_U64,
+													METRIC_VALUE_UNIT_COUNT,
+													METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+													state.outputs->get_outputs_spool_num_drops()));
+			additional_wrapper_metrics.emplace_back(libs::metrics::libsinsp_metrics::new_metric("outputs_spool_num_rejected",
+													METRICS_V2_MISC,
+													METRIC_VALUE_TYPE_U64,
+													METRIC_VALUE_UNIT_COUNT,
+													METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+													state.outputs->get_outputs_spool_num_rejected()));
+		}
+		if (state.outputs->has_syslog_endpoint())
+		{
+			additional_wrapper_metrics.emplace_back(libs::metrics::libsinsp_metrics::new_metric("outputs_syslog_num_drops",
+													METRICS_V2_MISC,
+													METRIC_VALUE_TYPE_U64,
+													METRIC_VALUE_UNIT_COUNT,
+													METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+													state.outputs->get_syslog_num_drops()));
+			additional_wrapper_metrics.emplace_back(libs::metrics::libsinsp_metrics::new_metric("outputs_syslog_backlog",
+													METRICS_V2_MISC,
+													METRIC_VALUE_TYPE_U64,
+													METRIC_VALUE_UNIT_COUNT,
+													METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
+													state.outputs->get_syslog_backlog()));
+		}
+		additional_wrapper_metrics.emplace_back(libs::metrics::libsinsp_metrics::new_metric("num_evts_skipped_no_rules",
+												METRICS_V2_MISC,
+												METRIC_VALUE_TYPE_U64,
+												METRIC_VALUE_UNIT_COUNT,
+												METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+												state.engine->get_num_skipped_events()));
+
+		auto filter_cache_metrics = state.engine->get_filter_cache_metrics();
+		std::vector<std::pair<std::string, uint64_t>> filter_cache_values = {
+			{"filter_cache_num_extract", filter_cache_metrics.m_num_extract},
+			{"filter_cache_num_extract_cache", filter_cache_metrics.m_num_extract_cache},
+			{"filter_cache_num_compare", filter_cache_metrics.m_num_compare},
+			{"filter_cache_num_compare_cache", filter_cache_metrics.m_num_compare_cache},
+		};
+		for (const auto& value : filter_cache_values)
+		{
+			additional_wrapper_metrics.emplace_back(libs::metrics::libsinsp_metrics::new_metric(value.first.c_str(),
+												METRICS_V2_MISC,
+												METRIC_VALUE_TYPE_U64,
+												METRIC_VALUE_UNIT_COUNT,
+												METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+												value.second));
+		}
 
 		if (agent_info)
 		{
@@ -198,6 +406,38 @@ std::string falco_metrics::to_text(const falco::app::state& state)
 			prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus(metric, "falcosecurity", "falco");
 		}
 
+		// Distinguish the outputs queue drops by priority and by rule using labels
+		auto drops_by_priority = state.outputs->get_outputs_queue_num_drops_by_priority();
+		for (size_t i = 0; i < drops_by_priority.size(); i++)
+		{
+			auto metric = libs::metrics::libsinsp_metrics::new_metric("outputs_queue_num_drops_by_priority",
+									METRICS_V2_MISC,
+									METRIC_VALUE_TYPE_U64,
+									METRIC_VALUE_UNIT_COUNT,
+									METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+									drops_by_priority[i]);
+			prometheus_metrics_converter.convert_metric_to_unit_convention(metric);
+			const std::map<std::string, std::string>& const_labels = {
+				{"priority", std::to_string(i)}
+			};
+			prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus(metric, "falcosecurity", "falco", const_labels);
+		}
+		for (const auto& drops : state.outputs->get_outputs_queue_num_drops_by_rule())
+		{
+			auto metric = libs::metrics::libsinsp_metrics::new_metric("outputs_queue_num_drops_by_rule",
+									METRICS_V2_MISC,
+									METRIC_VALUE_TYPE_U64,
+									METRIC_VALUE_UNIT_COUNT,
+									METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+									drops.second.second);
+			prometheus_metrics_converter.convert_metric_to_unit_convention(metric);
+			const std::map<std::string, std::string>& const_labels = {
+				{"rule_name", drops.first},
+				{"priority", std::to_string(drops.second.first)}
+			};
+			prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus(metric, "falcosecurity", "falco", const_labels);
+		}
+
 		// Falco metrics categories
 		//
 		// rules_counters_enabled
@@ -232,13 +472,194 @@ std::string falco_metrics::to_text(const falco::app::state& state)
 		}
 	}
 
+	prometheus_text += alert_latency_to_text(state.outputs->get_alert_latency());
+
+	if (state.buffer_autotune != nullptr)
+	{
+		// Distinguish the host profile using labels. The last decision
+		// is a gauge of its own rather than a label, which would start
+		// new series every time it changes
+		const auto& autotune = state.buffer_autotune;
+		const std::map<std::string, std::string> const_labels = {
+			{"profile", autotune->profile()}
+		};
+		std::vector<metrics_v2> autotune_metrics = {
+			libs::metrics::libsinsp_metrics::new_metric("syscall_buffer_autotune_preset",
+								METRICS_V2_MISC,
+								METRIC_VALUE_TYPE_U64,
+								METRIC_VALUE_UNIT_COUNT,
+								METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
+								(uint64_t)autotune->preset()),
+			libs::metrics::libsinsp_metrics::new_metric("syscall_buffer_autotune_recommended_preset",
+								METRICS_V2_MISC,
+								METRIC_VALUE_TYPE_U64,
+								METRIC_VALUE_UNIT_COUNT,
+								METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
+								(uint64_t)autotune->recommended_preset()),
+			libs::metrics::libsinsp_metrics::new_metric("syscall_buffer_autotune_decision",
+								METRICS_V2_MISC,
+								METRIC_VALUE_TYPE_U64,
+								METRIC_VALUE_UNIT_COUNT,
+								METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
+								(uint64_t)autotune->last_decision()),
+			libs::metrics::libsinsp_metrics::new_metric("syscall_buffer_autotune_drop_seconds",
+								METRICS_V2_MISC,
+								METRIC_VALUE_TYPE_U64,
+								METRIC_VALUE_UNIT_COUNT,
+								METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
+								autotune->drop_seconds()),
+			libs::metrics::libsinsp_metrics::new_metric("syscall_buffer_autotune_max_lag_ns",
+								METRICS_V2_MISC,
+								METRIC_VALUE_TYPE_U64,
+								METRIC_VALUE_UNIT_TIME_NS,
+								METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
+								autotune->max_lag_ns()),
+		};
+		for (auto metric : autotune_metrics)
+		{
+			prometheus_metrics_converter.convert_metric_to_unit_convention(metric);
+			prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus(metric, "falcosecurity", "falco", const_labels);
+		}
+	}
+
+	// the shadow rules are replaced when reloading the rules
+	auto shadow_rules = std::atomic_load(&state.shadow_rules);
+	if (shadow_rules != nullptr)
+	{
+		auto metric = libs::metrics::libsinsp_metrics::new_metric("shadow_rules_sampled_events",
+							METRICS_V2_MISC,
+							METRIC_VALUE_TYPE_U64,
+							METRIC_VALUE_UNIT_COUNT,
+							METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+							shadow_rules->num_sampled());
+		prometheus_metrics_converter.convert_metric_to_unit_convention(metric);
+		prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus(metric, "falcosecurity", "falco");
+
+		// Distinguish the rules and the active and shadow rulesets using labels,
+		// skipping the rules that have never been evaluated in either
+		for (const auto& rule : shadow_rules->get_rule_stats())
+		{
+			if (rule.active.evaluations == 0 && rule.shadow.evaluations == 0)
+			{
+				continue;
+			}
+
+			for (const auto& [ruleset, counters] : {
+				std::make_pair("active", rule.active),
+				std::make_pair("shadow", rule.shadow)})
+			{
+				if (!counters.defined)
+				{
+					continue;
+				}
+				std::vector<metrics_v2> rule_metrics = {
+					libs::metrics::libsinsp_metrics::new_metric("shadow_rules_evaluations",
+										METRICS_V2_MISC,
+										METRIC_VALUE_TYPE_U64,
+										METRIC_VALUE_UNIT_COUNT,
+										METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+										counters.evaluations),
+					libs::metrics::libsinsp_metrics::new_metric("shadow_rules_matches",
+										METRICS_V2_MISC,
+										METRIC_VALUE_TYPE_U64,
+										METRIC_VALUE_UNIT_COUNT,
+										METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+										counters.matches),
+					libs::metrics::libsinsp_metrics::new_metric("shadow_rules_cost_ns",
+										METRICS_V2_MISC,
+										METRIC_VALUE_TYPE_U64,
+										METRIC_VALUE_UNIT_TIME_NS,
+										METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+										counters.cost_ns),
+				};
+				const std::map<std::string, std::string> const_labels = {
+					{"rule_name", rule.name},
+					{"source", rule.source},
+					{"ruleset", ruleset}
+				};
+				for (auto metric : rule_metrics)
+				{
+					prometheus_metrics_converter.convert_metric_to_unit_convention(metric);
+					prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus(metric, "falcosecurity", "falco", const_labels);
+				}
+			}
+
+			// The difference of the shadow ruleset versus the active one,
+			// where a rule not defined in a ruleset counts as zero
+			std::vector<metrics_v2> delta_metrics = {
+				libs::metrics::libsinsp_metrics::new_metric("shadow_rules_matches_delta",
+									METRICS_V2_MISC,
+									METRIC_VALUE_TYPE_S64,
+									METRIC_VALUE_UNIT_COUNT,
+									METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
+									(int64_t)(rule.shadow.matches - rule.active.matches)),
+				libs::metrics::libsinsp_metrics::new_metric("shadow_rules_cost_ns_delta",
+									METRICS_V2_MISC,
+									METRIC_VALUE_TYPE_S64,
+									METRIC_VALUE_UNIT_TIME_NS,
+									METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
+									(int64_t)(rule.shadow.cost_ns - rule.active.cost_ns)),
+			};
+			const std::map<std::string, std::string> const_labels = {
+				{"rule_name", rule.name},
+				{"source", rule.source}
+			};
+			for (auto metric : delta_metrics)
+			{
+				prometheus_metrics_converter.convert_metric_to_unit_convention(metric);
+				prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus(metric, "falcosecurity", "falco", const_labels);
+			}
+		}
+	}
+
+	// Distinguish the memory accounting subsystems using labels
+	for (size_t i = 0; i <= (size_t)falco::memory::subsystem::MAX; i++)
+	{
+		bool is_total = i == (size_t)falco::memory::subsystem::MAX;
+		auto subsystem = (falco::memory::subsystem)i;
+		std::vector<metrics_v2> memory_metrics;
+		if (!is_total)
+		{
+			memory_metrics.push_back(libs::metrics::libsinsp_metrics::new_metric("memory_accounted",
+								METRICS_V2_MISC,
+								METRIC_VALUE_TYPE_U64,
+								METRIC_VALUE_UNIT_MEMORY_BYTES,
+								METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
+								falco::memory::get(subsystem)));
+			memory_metrics.push_back(libs::metrics::libsinsp_metrics::new_metric("memory_soft_limit_hits",
+								METRICS_V2_MISC,
+								METRIC_VALUE_TYPE_U64,
+								METRIC_VALUE_UNIT_COUNT,
+								METRIC_VALUE_METRIC_TYPE_MONOTONIC,
+								falco::memory::limit_hits(subsystem)));
+		}
+		auto limit = is_total ? falco::memory::total_soft_limit() : falco::memory::soft_limit(subsystem);
+		if (limit > 0)
+		{
+			memory_metrics.push_back(libs::metrics::libsinsp_metrics::new_metric("memory_soft_limit",
+								METRICS_V2_MISC,
+								METRIC_VALUE_TYPE_U64,
+								METRIC_VALUE_UNIT_MEMORY_BYTES,
+								METRIC_VALUE_METRIC_TYPE_NON_MONOTONIC_CURRENT,
+								limit));
+		}
+		const std::map<std::string, std::string> const_labels = {
+			{"subsystem", is_total ? "total" : falco::memory::to_string(subsystem)}
+		};
+		for (auto metric : memory_metrics)
+		{
+			prometheus_metrics_converter.convert_metric_to_unit_convention(metric);
+			prometheus_text += prometheus_metrics_converter.convert_metric_to_text_prometheus(metric, "falcosecurity", "falco", const_labels);
+		}
+	}
+
 	// Libs metrics categories
 	//
 	// resource_utilization_enabled
 	// state_counters_enabled
 	// kernel_event_counters_enabled
 	// libbpf_stats_enabled
-	for (auto metrics_collector: metrics_collectors)
+	for (auto& metrics_collector: m_metrics_collectors)
 	{
 		metrics_collector.snapshot();
 		auto metrics_snapshot = metrics_collector.get_metrics();
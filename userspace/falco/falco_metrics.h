@@ -20,6 +20,10 @@ limitations under the License.
 
 #include <libsinsp/sinsp.h>
 
+#include <chrono>
+#include <memory>
+#include <mutex>
+
 namespace falco::app {
 	struct state;
 }
@@ -28,5 +32,37 @@ class falco_metrics
 {
 public:
 	static const std::string content_type;
-	static std::string to_text(const falco::app::state& state);
+
+	struct snapshot
+	{
+		std::shared_ptr<const std::string> text;
+		// null if gzip compression is disabled
+		std::shared_ptr<const std::string> gzip;
+	};
+
+	falco_metrics(const falco::app::state& state, std::chrono::milliseconds max_age, bool gzip);
+	~falco_metrics();
+
+	snapshot get();
+
+	static std::string compress_gzip(const std::string& data);
+
+private:
+	std::string to_text();
+	std::string static_to_text(const std::shared_ptr<sinsp>& inspector) const;
+	std::string rules_sha256_to_text() const;
+
+	const falco::app::state& m_state;
+	std::chrono::milliseconds m_max_age;
+	bool m_gzip;
+
+	std::vector<std::shared_ptr<sinsp>> m_inspectors;
+	std::vector<std::string> m_static_text;
+	std::vector<libs::metrics::libs_metrics_collector> m_metrics_collectors;
+
+	std::mutex m_mtx;
+	std::chrono::steady_clock::time_point m_rendered_at;
+	snapshot m_snapshot;
+	// bytes of the snapshot and of the static series, as accounted
+	size_t m_accounted_bytes;
 };
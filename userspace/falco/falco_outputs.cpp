@@ -21,9 +21,13 @@ limitations under the License.
 
 #include "falco_outputs.h"
 #include "config_falco.h"
+#include "falco_usdt.h"
 
 #include "formats.h"
+#include "json_writer.h"
 #include "logger.h"
+#include "memory_accounting.h"
+#include "thread_affinity.h"
 #include "watchdog.h"
 
 #include "outputs_file.h"
@@ -36,9 +40,60 @@ limitations under the License.
 #include "outputs_http.h"
 #include "outputs_grpc.h"
 #endif
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#include "outputs_shm.h"
+#endif
 
 static const char* s_internal_source = "internal";
 
+// how long the outputs worker waits before retrying to deliver spooled
+// messages, when none of the outputs is accepting them
+static const std::chrono::milliseconds s_spool_retry_interval(1000);
+
+static inline uint64_t steady_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifndef __EMSCRIPTEN__
+// approximate bytes of a queued message, including its heap allocations
+static size_t json_bytes(const nlohmann::json& j)
+{
+	size_t res = sizeof(nlohmann::json);
+	if(j.is_string())
+	{
+		res += j.get_ref<const std::string&>().capacity();
+	}
+	else if(j.is_object())
+	{
+		for(const auto& item : j.items())
+		{
+			res += item.key().capacity() + json_bytes(item.value());
+		}
+	}
+	else if(j.is_array())
+	{
+		for(const auto& item : j)
+		{
+			res += json_bytes(item);
+		}
+	}
+	return res;
+}
+
+static size_t message_bytes(const falco::outputs::message& msg)
+{
+	// rule, source and tags are interned and shared with other messages
+	return msg.msg.capacity() + json_bytes(msg.fields);
+}
+#endif
+
+// comparable with event timestamps
+static inline uint64_t epoch_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
 falco_outputs::falco_outputs(
 	std::shared_ptr<falco_engine> engine,
 	const std::vector<falco::outputs::config>& outputs,
@@ -48,6 +103,10 @@ falco_outputs::falco_outputs(
 	uint32_t timeout,
 	bool buffered,
 	size_t outputs_queue_capacity,
+	size_t outputs_queue_reserved_capacity,
+	falco_common::priority_type outputs_queue_reserved_priority,
+	size_t outputs_queue_max_bytes,
+	const falco::outputs::spool_config& outputs_spool,
 	bool time_format_iso_8601,
 	const std::string& hostname)
 	: m_formats(std::make_unique<falco_formats>(engine, json_include_output_property, json_include_tags_property)),
@@ -56,14 +115,47 @@ falco_outputs::falco_outputs(
 	  m_time_format_iso_8601(time_format_iso_8601),
 	  m_timeout(std::chrono::milliseconds(timeout)),
 	  m_hostname(hostname)
+#ifndef __EMSCRIPTEN__
+	  , m_queue(falco_common::PRIORITY_DEBUG + 1,
+		outputs_queue_capacity,
+		outputs_queue_reserved_capacity,
+		(size_t) outputs_queue_reserved_priority + 1,
+		[this](const ctrl_msg& cmsg, size_t) { on_drop(cmsg); },
+		outputs_queue_max_bytes,
+		[](const ctrl_msg& cmsg) { return sizeof(ctrl_msg) + message_bytes(cmsg); })
+#endif
+	  , m_queue_max_bytes(outputs_queue_max_bytes)
+	  , m_spool_config(outputs_spool)
 {
 	for(const auto& output : outputs)
 	{
 		add_output(output);
 	}
+	for(size_t i = 0; i < m_outputs.size(); i++)
+	{
+		m_output_latency.push_back(std::make_unique<falco::latency_histogram>());
+		m_total_latency.push_back(std::make_unique<falco::latency_histogram>());
+		m_needs_fields = m_needs_fields || m_outputs[i]->needs_fields();
+	}
 
 #ifndef __EMSCRIPTEN__
-	m_queue.set_capacity(outputs_queue_capacity);
+	if(m_spool_config.enabled)
+	{
+		std::vector<std::string> sinks;
+		for(const auto& o : m_outputs)
+		{
+			sinks.push_back(o->get_name());
+		}
+		m_spool = std::make_unique<falco::outputs::spool>(m_spool_config, sinks);
+
+		// deliver what was left in the spool by a previous run first
+		if(!m_spool->empty())
+		{
+			m_spooling = true;
+			push_ctrl(ctrl_msg_type::CTRL_MSG_SPOOL);
+		}
+	}
+
 	m_worker_thread = std::thread(&falco_outputs::worker, this);
 #endif
 }
@@ -109,6 +201,12 @@ void falco_outputs::add_output(const falco::outputs::config &oc)
 	{
 		oo = std::make_unique<falco::outputs::output_grpc>();
 	}
+#endif
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+	else if(oc.name == "shm")
+	{
+		oo = std::make_unique<falco::outputs::output_shm>();
+	}
 #endif
 	else
 	{
@@ -118,6 +216,12 @@ void falco_outputs::add_output(const falco::outputs::config &oc)
 	std::string init_err;
 	if (oo->init(oc, m_buffered, m_hostname, m_json_output, init_err))
 	{
+#ifndef _WIN32
+		if(oc.name == "syslog")
+		{
+			m_syslog = static_cast<falco::outputs::output_syslog*>(oo.get());
+		}
+#endif
 		m_outputs.push_back(std::move(oo));
 	}
 	else
@@ -129,6 +233,15 @@ void falco_outputs::add_output(const falco::outputs::config &oc)
 void falco_outputs::handle_event(sinsp_evt *evt, const std::string &rule, const std::string &source,
 				 falco_common::priority_type priority, const std::string &format, std::set<std::string> &tags)
 {
+	// the event has just been evaluated by the engine
+	uint64_t now = epoch_ns();
+	if(now > evt->get_ts())
+	{
+		m_match_latency.record(now - evt->get_ts());
+	}
+	uint64_t format_start = steady_ns();
+	FALCO_USDT3(format, evt->get_ts(), (int)priority, rule.c_str());
+
 	falco_outputs::ctrl_msg cmsg = {};
 	cmsg.ts = evt->get_ts();
 	cmsg.priority = priority;
@@ -159,11 +272,17 @@ void falco_outputs::handle_event(sinsp_evt *evt, const std::string &rule, const
 	cmsg.msg = m_formats->format_event(
 		evt, rule, source, falco_common::format_priority(priority), sformat, tags, m_hostname
 	);
-	cmsg.fields = m_formats->get_field_values(evt, source, sformat);
-	cmsg.tags.insert(tags.begin(), tags.end());
+	if(m_needs_fields)
+	{
+		cmsg.fields = m_formats->get_field_values(evt, source, sformat);
+	}
+	cmsg.tags = tags;
 
 	cmsg.type = ctrl_msg_type::CTRL_MSG_OUTPUT;
-	this->push(cmsg);
+	cmsg.queued_ns = steady_ns();
+	m_format_latency.record(cmsg.queued_ns - format_start);
+	FALCO_USDT1(format_done, evt->get_ts());
+	this->push(std::move(cmsg));
 }
 
 void falco_outputs::handle_msg(uint64_t ts,
@@ -186,28 +305,17 @@ void falco_outputs::handle_msg(uint64_t ts,
 
 	if(m_json_output)
 	{
-		nlohmann::json jmsg;
-
-		// Convert the time-as-nanoseconds to a more json-friendly ISO8601.
-		time_t evttime = ts / 1000000000;
-		char time_sec[20]; // sizeof "YYYY-MM-DDTHH:MM:SS"
-		char time_ns[12];  // sizeof ".sssssssssZ"
-		std::string iso8601evttime;
-
-		strftime(time_sec, sizeof(time_sec), "%FT%T", gmtime(&evttime));
-		snprintf(time_ns, sizeof(time_ns), ".%09luZ", ts % 1000000000);
-		iso8601evttime = time_sec;
-		iso8601evttime += time_ns;
-
-		jmsg["output"] = msg;
-		jmsg["priority"] = falco_common::format_priority(priority);
-		jmsg["rule"] = rule;
-		jmsg["time"] = iso8601evttime;
-		jmsg["output_fields"] = output_fields;
-		jmsg["hostname"] = m_hostname;
-		jmsg["source"] = s_internal_source;
-
-		cmsg.msg = jmsg.dump();
+		// same keys and order as the ones of a serialized nlohmann::json
+		falco::json_writer w(cmsg.msg);
+		w.begin_object();
+		w.key("hostname").value(m_hostname);
+		w.key("output").value(msg);
+		w.key("output_fields").value(output_fields);
+		w.key("priority").value(falco_common::format_priority(priority));
+		w.key("rule").value(rule);
+		w.key("source").value(s_internal_source);
+		w.key("time").time(ts);
+		w.end_object();
 	}
 	else
 	{
@@ -236,7 +344,8 @@ void falco_outputs::handle_msg(uint64_t ts,
 	}
 
 	cmsg.type = ctrl_msg_type::CTRL_MSG_OUTPUT;
-	this->push(cmsg);
+	cmsg.queued_ns = steady_ns();
+	this->push(std::move(cmsg));
 }
 
 void falco_outputs::cleanup_outputs()
@@ -261,6 +370,8 @@ void falco_outputs::stop_worker()
 	});
 	wd.set_timeout(m_timeout, nullptr);
 
+	// spooled messages that are still pending are delivered on the next run
+	m_stopping = true;
 	this->push_ctrl(falco_outputs::ctrl_msg_type::CTRL_MSG_STOP);
 	if(m_worker_thread.joinable())
 	{
@@ -272,24 +383,36 @@ inline void falco_outputs::push_ctrl(ctrl_msg_type cmt)
 {
 	falco_outputs::ctrl_msg cmsg = {};
 	cmsg.type = cmt;
-	this->push(cmsg);
+	this->push(std::move(cmsg));
 }
 
-inline void falco_outputs::push(const ctrl_msg& cmsg)
+inline void falco_outputs::push(ctrl_msg&& cmsg)
 {
 #ifndef __EMSCRIPTEN__
-	if (!m_queue.try_push(cmsg))
+	if(m_spool && cmsg.type == ctrl_msg_type::CTRL_MSG_OUTPUT
+		&& (m_spooling || m_queue.size() >= m_spool_config.high_watermark)
+		&& spool_msg(cmsg))
 	{
-		if(m_outputs_queue_num_drops.load() == 0)
-		{
-			falco_logger::log(falco_logger::level::ERR, "Outputs queue out of memory. Drop event and continue on ...");
-		}
-		m_outputs_queue_num_drops++;
+		return;
 	}
+
+	if(m_queue_max_bytes > 0 && m_queue.bytes() >= m_queue_max_bytes)
+	{
+		falco::memory::count_limit_hit(falco::memory::subsystem::OUTPUTS_QUEUE);
+	}
+
+	// control messages are never dropped, and when the queue is full
+	// output messages evict the ones with lower priority, if any
+	// the message is moved into the queue, which leaves its scalar members untouched
+	m_queue.push(std::move(cmsg), cmsg.priority, cmsg.type != ctrl_msg_type::CTRL_MSG_OUTPUT);
+	falco::memory::set(falco::memory::subsystem::OUTPUTS_QUEUE, m_queue.bytes());
+	// size() takes the queue lock, while bytes() doesn't
+	FALCO_USDT2(queue_push, cmsg.ts, m_queue.bytes());
 #else
 	for (const auto& o : m_outputs)
 	{
 		process_msg(o.get(), cmsg);
+		o->flush();
 	}
 #endif
 }
@@ -299,6 +422,8 @@ inline void falco_outputs::push(const ctrl_msg& cmsg)
 // we still need to improve the error reporting since some inner functions can throw exceptions.
 void falco_outputs::worker() noexcept
 {
+	falco::threads::init_current(falco::threads::kind::OUTPUTS, "falco-outputs");
+
 	watchdog<std::string> wd;
 	wd.start([&](const std::string& payload) -> void {
 		falco_logger::log(falco_logger::level::CRIT, "\"" + payload + "\" output timeout, all output channels are blocked\n");
@@ -307,29 +432,97 @@ void falco_outputs::worker() noexcept
 	auto timeout = m_timeout;
 
 	falco_outputs::ctrl_msg cmsg;
+	bool spool_retry = false;
 	do
 	{
 		// Block until a message becomes available.
 #ifndef __EMSCRIPTEN__
-		m_queue.pop(cmsg);
+		if(!spool_retry)
+		{
+			m_queue.pop(cmsg);
+		}
+		else if(!m_queue.pop_for(cmsg, s_spool_retry_interval))
+		{
+			// the outputs were not accepting the spooled messages,
+			// retry once no other message arrived for a while
+			cmsg = {};
+			cmsg.type = ctrl_msg_type::CTRL_MSG_SPOOL;
+		}
+		falco::memory::set(falco::memory::subsystem::OUTPUTS_QUEUE, m_queue.bytes());
 #endif
 
-		for(const auto& o : m_outputs)
+		if(cmsg.type == ctrl_msg_type::CTRL_MSG_SPOOL)
+		{
+			spool_retry = drain_spool(wd);
+			continue;
+		}
+
+		if(cmsg.type == ctrl_msg_type::CTRL_MSG_OUTPUT && cmsg.queued_ns != 0)
 		{
-			wd.set_timeout(timeout, o->get_name());
+			FALCO_USDT1(queue_pop, cmsg.ts);
+			m_queue_latency.record(steady_ns() - cmsg.queued_ns);
+		}
+
+		for(size_t i = 0; i < m_outputs.size(); i++)
+		{
+			wd.set_timeout(timeout, m_outputs[i]->get_name());
 			try
 			{
-				process_msg(o.get(), cmsg);
+				output_msg(i, cmsg);
 			}
 			catch(const std::exception &e)
 			{
-				falco_logger::log(falco_logger::level::ERR, o->get_name() + ": " + std::string(e.what()) + "\n");
+				falco_logger::log(falco_logger::level::ERR, m_outputs[i]->get_name() + ": " + std::string(e.what()) + "\n");
 			}
 		}
+
+#ifndef __EMSCRIPTEN__
+		// let outputs batch messages while there are more to come
+		if(cmsg.type == ctrl_msg_type::CTRL_MSG_OUTPUT && m_queue.size() == 0)
+		{
+			flush_outputs(wd);
+		}
+#endif
 		wd.cancel_timeout();
 	} while(cmsg.type != ctrl_msg_type::CTRL_MSG_STOP);
 }
 
+void falco_outputs::flush_outputs(watchdog<std::string>& wd)
+{
+	for(const auto& o : m_outputs)
+	{
+		wd.set_timeout(m_timeout, o->get_name());
+		try
+		{
+			o->flush();
+		}
+		catch(const std::exception &e)
+		{
+			falco_logger::log(falco_logger::level::ERR, o->get_name() + ": " + std::string(e.what()) + "\n");
+		}
+	}
+}
+
+void falco_outputs::output_msg(size_t i, const ctrl_msg& cmsg)
+{
+	if(cmsg.type != ctrl_msg_type::CTRL_MSG_OUTPUT)
+	{
+		process_msg(m_outputs[i].get(), cmsg);
+		return;
+	}
+
+	FALCO_USDT2(output, cmsg.ts, m_outputs[i]->get_name().c_str());
+	uint64_t start = steady_ns();
+	process_msg(m_outputs[i].get(), cmsg);
+	m_output_latency[i]->record(steady_ns() - start);
+	FALCO_USDT2(output_done, cmsg.ts, m_outputs[i]->get_name().c_str());
+	uint64_t now = epoch_ns();
+	if(now > cmsg.ts)
+	{
+		m_total_latency[i]->record(now - cmsg.ts);
+	}
+}
+
 inline void falco_outputs::process_msg(falco::outputs::abstract_output* o, const ctrl_msg& cmsg)
 {
 	switch(cmsg.type)
@@ -349,7 +542,207 @@ inline void falco_outputs::process_msg(falco::outputs::abstract_output* o, const
 	}
 }
 
+#ifndef __EMSCRIPTEN__
+bool falco_outputs::spool_msg(const ctrl_msg& cmsg)
+{
+	std::lock_guard<std::mutex> lk(m_spool_mtx);
+
+	// the worker may have drained the spool in the meantime
+	if(!m_spooling && m_queue.size() < m_spool_config.high_watermark)
+	{
+		return false;
+	}
+
+	try
+	{
+		auto discarded = m_spool->append(cmsg);
+		if(discarded > 0)
+		{
+			if(m_outputs_spool_num_drops.load() == 0)
+			{
+				falco_logger::log(falco_logger::level::ERR, "Outputs spool is full. Discard oldest events and continue on ...");
+			}
+			m_outputs_spool_num_drops += discarded;
+		}
+	}
+	catch(const falco_exception& e)
+	{
+		falco_logger::log(falco_logger::level::ERR, std::string(e.what()) + "\n");
+		return false;
+	}
+
+	m_outputs_spool_num_msgs++;
+	if(!m_spooling)
+	{
+		m_spooling = true;
+		push_ctrl(ctrl_msg_type::CTRL_MSG_SPOOL);
+	}
+	return true;
+}
+#endif
+
+bool falco_outputs::drain_spool(watchdog<std::string>& wd)
+{
+	// spooled messages that are still pending are delivered on the next run
+	if(m_stopping)
+	{
+		std::lock_guard<std::mutex> lk(m_spool_mtx);
+		m_spool->flush();
+		return false;
+	}
+
+	// deliver spooled messages to each output independently, so that
+	// an unavailable output does not hold back the other ones
+	bool progress = false;
+	for(size_t i = 0; i < m_outputs.size(); i++)
+	{
+		ctrl_msg cmsg = {};
+		cmsg.type = ctrl_msg_type::CTRL_MSG_OUTPUT;
+		wd.set_timeout(m_timeout, m_outputs[i]->get_name());
+		try
+		{
+			// peeking writes the messages appended by the event
+			// thread to disk first, which the event thread waits
+			// for if it's spooling a message in the meantime
+			{
+				std::lock_guard<std::mutex> lk(m_spool_mtx);
+				if(!m_spool->peek(i, cmsg))
+				{
+					continue;
+				}
+			}
+
+			// outputs throw when they fail to deliver a message,
+			// which is then retried instead of being acknowledged
+			output_msg(i, cmsg);
+			std::lock_guard<std::mutex> lk(m_spool_mtx);
+			m_spool->ack(i);
+			progress = true;
+		}
+		catch(const falco::outputs::rejected_message &e)
+		{
+			// skip the messages that would be retried forever
+			falco_logger::log(falco_logger::level::ERR, m_outputs[i]->get_name() + ": " + std::string(e.what()) + ", skipping it\n");
+			std::lock_guard<std::mutex> lk(m_spool_mtx);
+			m_spool->ack(i);
+			m_outputs_spool_num_rejected++;
+			progress = true;
+		}
+		catch(const std::exception &e)
+		{
+			falco_logger::log(falco_logger::level::ERR, m_outputs[i]->get_name() + ": " + std::string(e.what()) + "\n");
+		}
+	}
+	flush_outputs(wd);
+	wd.cancel_timeout();
+
+	{
+		std::lock_guard<std::mutex> lk(m_spool_mtx);
+		if(m_spool->empty())
+		{
+			m_spool->flush();
+			m_spooling = false;
+			return false;
+		}
+	}
+
+	// go back to the queue between passes, so that control messages
+	// (e.g. reopening the outputs) are not held back by the spool
+	if(progress)
+	{
+		push_ctrl(ctrl_msg_type::CTRL_MSG_SPOOL);
+	}
+	return !progress;
+}
+
+void falco_outputs::on_drop(const ctrl_msg& cmsg)
+{
+	if(m_outputs_queue_num_drops.load() == 0)
+	{
+		falco_logger::log(falco_logger::level::ERR, "Outputs queue out of memory. Drop event and continue on ...");
+	}
+	m_outputs_queue_num_drops++;
+	m_outputs_queue_num_drops_by_priority[cmsg.priority]++;
+
+	std::lock_guard<std::mutex> lk(m_outputs_queue_drops_by_rule_mtx);
+	auto& drops = m_outputs_queue_num_drops_by_rule[cmsg.rule.get()];
+	drops.first = cmsg.priority;
+	drops.second++;
+}
+
 uint64_t falco_outputs::get_outputs_queue_num_drops()
 {
 	return m_outputs_queue_num_drops.load();
 }
+
+std::array<uint64_t, falco_common::PRIORITY_DEBUG + 1> falco_outputs::get_outputs_queue_num_drops_by_priority()
+{
+	std::array<uint64_t, falco_common::PRIORITY_DEBUG + 1> res;
+	for(size_t i = 0; i < res.size(); i++)
+	{
+		res[i] = m_outputs_queue_num_drops_by_priority[i].load();
+	}
+	return res;
+}
+
+std::map<std::string, std::pair<falco_common::priority_type, uint64_t>> falco_outputs::get_outputs_queue_num_drops_by_rule()
+{
+	std::lock_guard<std::mutex> lk(m_outputs_queue_drops_by_rule_mtx);
+	return m_outputs_queue_num_drops_by_rule;
+}
+
+uint64_t falco_outputs::get_outputs_spool_num_msgs()
+{
+	return m_outputs_spool_num_msgs.load();
+}
+
+uint64_t falco_outputs::get_outputs_spool_num_drops()
+{
+	return m_outputs_spool_num_drops.load();
+}
+
+uint64_t falco_outputs::get_outputs_spool_num_rejected()
+{
+	return m_outputs_spool_num_rejected.load();
+}
+
+bool falco_outputs::has_syslog_endpoint()
+{
+#ifndef _WIN32
+	return m_syslog != nullptr && m_syslog->has_endpoint();
+#else
+	return false;
+#endif
+}
+
+uint64_t falco_outputs::get_syslog_num_drops()
+{
+#ifndef _WIN32
+	return m_syslog != nullptr ? m_syslog->get_num_drops() : 0;
+#else
+	return 0;
+#endif
+}
+
+uint64_t falco_outputs::get_syslog_backlog()
+{
+#ifndef _WIN32
+	return m_syslog != nullptr ? m_syslog->get_backlog() : 0;
+#else
+	return 0;
+#endif
+}
+
+std::vector<falco_outputs::alert_latency> falco_outputs::get_alert_latency() const
+{
+	std::vector<alert_latency> res;
+	res.push_back({"match", "", m_match_latency.get()});
+	res.push_back({"format", "", m_format_latency.get()});
+	res.push_back({"queue", "", m_queue_latency.get()});
+	for(size_t i = 0; i < m_outputs.size(); i++)
+	{
+		res.push_back({"output", m_outputs[i]->get_name(), m_output_latency[i]->get()});
+		res.push_back({"total", m_outputs[i]->get_name(), m_total_latency[i]->get()});
+	}
+	return res;
+}
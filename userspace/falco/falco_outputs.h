@@ -17,16 +17,27 @@ limitations under the License.
 
 #pragma once
 
+#include <array>
 #include <memory>
 #include <map>
+#include <mutex>
 
 #include "falco_common.h"
 #include "falco_engine.h"
 #include "outputs.h"
+#include "outputs_queue.h"
+#include "outputs_spool.h"
 #include "formats.h"
-#ifndef __EMSCRIPTEN__
-#include "tbb/concurrent_queue.h"
-#endif
+#include "latency_histogram.h"
+#include "watchdog.h"
+
+namespace falco
+{
+namespace outputs
+{
+class output_syslog;
+} // namespace outputs
+} // namespace falco
 
 /*!
 	\brief This class acts as the primary interface between a program and the
@@ -35,7 +46,10 @@ limitations under the License.
 
 	All methods in this class are thread-safe. The output framework supports
 	a multi-producer model where messages are stored in a queue and consumed
-	by each configured output asynchronously.
+	by each configured output asynchronously. When the queue is full, alerts
+	with a lower priority are dropped first. Optionally, once the queue
+	grows past a watermark, alerts are spooled to disk and delivered to
+	each output as soon as it is able to accept them.
 */
 class falco_outputs
 {
@@ -49,6 +63,10 @@ public:
 		uint32_t timeout,
 		bool buffered,
 		size_t outputs_queue_capacity,
+		size_t outputs_queue_reserved_capacity,
+		falco_common::priority_type outputs_queue_reserved_priority,
+		size_t outputs_queue_max_bytes,
+		const falco::outputs::spool_config& outputs_spool,
 		bool time_format_iso_8601,
 		const std::string& hostname);
 
@@ -90,6 +108,73 @@ public:
 	*/
 	uint64_t get_outputs_queue_num_drops();
 
+	/*!
+		\brief Return the number of messages dropped from the outputs queue,
+		indexed by falco_common::priority_type
+	*/
+	std::array<uint64_t, falco_common::PRIORITY_DEBUG + 1> get_outputs_queue_num_drops_by_priority();
+
+	/*!
+		\brief Return the number of messages dropped from the outputs queue
+		for each rule that had at least one, paired with the rule priority
+	*/
+	std::map<std::string, std::pair<falco_common::priority_type, uint64_t>> get_outputs_queue_num_drops_by_rule();
+
+	/*!
+		\brief Return the number of messages written to the outputs spool
+	*/
+	uint64_t get_outputs_spool_num_msgs();
+
+	/*!
+		\brief Return the number of messages discarded from the outputs spool
+		before being delivered to all outputs, due to its maximum size
+	*/
+	uint64_t get_outputs_spool_num_drops();
+
+	/*!
+		\brief Return the number of spooled messages skipped by an output
+		that rejected them, instead of retrying their delivery
+	*/
+	uint64_t get_outputs_spool_num_rejected();
+
+	/*!
+		\brief Return true if the syslog output sends messages to an
+		endpoint, in which case the two methods below report its state
+	*/
+	bool has_syslog_endpoint();
+
+	/*!
+		\brief Return the number of frames dropped by the syslog output
+		because its backlog was full or they could not be sent
+	*/
+	uint64_t get_syslog_num_drops();
+
+	/*!
+		\brief Return the number of frames in the backlog of the syslog
+		output, waiting to be sent
+	*/
+	uint64_t get_syslog_backlog();
+
+	/*!
+		\brief Latency of the alerts at one stage of their processing
+	*/
+	struct alert_latency
+	{
+		// "match" (from the event timestamp to the rule match),
+		// "format", "queue" (time spent in the outputs queue),
+		// "output" (time spent in an output) or "total" (from the
+		// event timestamp to the alert leaving an output)
+		std::string stage;
+		// the output name for the "output" and "total" stages
+		std::string output;
+		falco::latency_histogram::snapshot histogram;
+	};
+
+	/*!
+		\brief Return the latency histograms of all the alert processing stages
+	*/
+	std::vector<alert_latency> get_alert_latency() const;
+
 private:
 	std::unique_ptr<falco_formats> m_formats;
 
@@ -98,6 +183,8 @@ private:
 	bool m_buffered;
 	bool m_json_output;
 	bool m_time_format_iso_8601;
+	// whether any output uses the fields of the messages
+	bool m_needs_fields = false;
 	std::chrono::milliseconds m_timeout;
 	std::string m_hostname;
 
@@ -107,22 +194,63 @@ private:
 		CTRL_MSG_OUTPUT = 1,
 		CTRL_MSG_CLEANUP = 2,
 		CTRL_MSG_REOPEN = 3,
+		CTRL_MSG_SPOOL = 4,
 	};
 
 	struct ctrl_msg : falco::outputs::message
 	{
 		ctrl_msg_type type;
+		// steady clock time at which the message was queued, if any
+		uint64_t queued_ns;
 	};
 
+	falco::latency_histogram m_match_latency;
+	falco::latency_histogram m_format_latency;
+	falco::latency_histogram m_queue_latency;
+	// indexed like m_outputs
+	std::vector<std::unique_ptr<falco::latency_histogram>> m_output_latency;
+	std::vector<std::unique_ptr<falco::latency_histogram>> m_total_latency;
+
 #ifndef __EMSCRIPTEN__
-	typedef tbb::concurrent_bounded_queue<ctrl_msg> falco_outputs_cbq;
-	falco_outputs_cbq m_queue;
+	// Output messages are queued at the level of their priority, while
+	// control messages are never dropped
+	typedef falco::outputs::priority_queue<ctrl_msg> falco_outputs_pq;
+	falco_outputs_pq m_queue;
 #endif
+	size_t m_queue_max_bytes;
 
 	std::atomic<uint64_t> m_outputs_queue_num_drops = 0;
+	std::array<std::atomic<uint64_t>, falco_common::PRIORITY_DEBUG + 1> m_outputs_queue_num_drops_by_priority = {};
+	std::mutex m_outputs_queue_drops_by_rule_mtx;
+	std::map<std::string, std::pair<falco_common::priority_type, uint64_t>> m_outputs_queue_num_drops_by_rule;
+
+	// While spooling, all the output messages go through the spool
+	// (and not only the ones past the watermark), so that each output
+	// receives them in order
+	falco::outputs::spool_config m_spool_config;
+	std::unique_ptr<falco::outputs::spool> m_spool;
+	std::mutex m_spool_mtx;
+	std::atomic<bool> m_spooling = false;
+	std::atomic<bool> m_stopping = false;
+	std::atomic<uint64_t> m_outputs_spool_num_msgs = 0;
+	std::atomic<uint64_t> m_outputs_spool_num_drops = 0;
+	std::atomic<uint64_t> m_outputs_spool_num_rejected = 0;
+
+	// owned by m_outputs, if any
+	falco::outputs::output_syslog* m_syslog = nullptr;
+
 	std::thread m_worker_thread;
-	inline void push(const ctrl_msg& cmsg);
+	inline void push(ctrl_msg&& cmsg);
+#ifndef __EMSCRIPTEN__
+	bool spool_msg(const ctrl_msg& cmsg);
+#endif
+	// Delivers the spooled messages once to each output, returns true if
+	// some are still pending and none could be delivered
+	bool drain_spool(watchdog<std::string>& wd);
+	void flush_outputs(watchdog<std::string>& wd);
+	void output_msg(size_t i, const ctrl_msg& cmsg);
 	inline void push_ctrl(ctrl_msg_type cmt);
+	void on_drop(const ctrl_msg& cmsg);
 	void worker() noexcept;
 	void stop_worker();
 	void add_output(const falco::outputs::config& oc);
@@ -19,6 +19,7 @@ limitations under the License.
 
 #include "outputs.pb.h"
 #include "tbb/concurrent_queue.h"
+#include "memory_accounting.h"
 
 namespace falco
 {
@@ -37,12 +38,28 @@ public:
 
 	bool try_pop(outputs::response& res)
 	{
-		return m_queue.try_pop(res);
+		if(!m_queue.try_pop(res))
+		{
+			return false;
+		}
+		falco::memory::add(falco::memory::subsystem::GRPC_QUEUE, -(int64_t)res.ByteSizeLong());
+		return true;
 	}
 
-	void push(outputs::response& res)
+	// Returns false if the response has been dropped because the queue
+	// exceeds its memory soft limit
+	bool push(outputs::response& res)
 	{
+		auto limit = falco::memory::soft_limit(falco::memory::subsystem::GRPC_QUEUE);
+		auto bytes = res.ByteSizeLong();
+		if(limit > 0 && falco::memory::get(falco::memory::subsystem::GRPC_QUEUE) + bytes > limit)
+		{
+			falco::memory::count_limit_hit(falco::memory::subsystem::GRPC_QUEUE);
+			return false;
+		}
+		falco::memory::add(falco::memory::subsystem::GRPC_QUEUE, (int64_t)bytes);
 		m_queue.push(res);
+		return true;
 	}
 
 private:
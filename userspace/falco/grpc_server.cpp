@@ -29,6 +29,7 @@ limitations under the License.
 #include "grpc_queue.h"
 #include "grpc_request_context.h"
 #include "falco_utils.h"
+#include "thread_affinity.h"
 
 #define REGISTER_STREAM(req, res, svc, rpc, impl, num)                          \
 	std::vector<request_stream_context<svc, req, res>> rpc##_contexts(num); \
@@ -81,6 +82,8 @@ static void gpr_log_dispatcher_func(gpr_log_func_args* args)
 
 void falco::grpc::server::thread_process(int thread_index)
 {
+	falco::threads::init_current(falco::threads::kind::GRPC, "falco-grpc");
+
 	void* tag = nullptr;
 	bool event_read_success = false;
 	while(m_completion_queue->Next(&tag, &event_read_success))
@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <type_traits>
+#include <utility>
+
+namespace falco
+{
+
+/**
+ * @brief An immutable value that is shared by all the handles created
+ * from equal values, so that copying a handle never copies the value.
+ * Values that are no longer referenced by any handle are released when
+ * the table of interned values grows. The default handle refers to an
+ * empty value.
+ */
+template<typename T>
+class interned
+{
+public:
+	interned() = default;
+
+	template<typename U, typename = std::enable_if_t<
+		!std::is_same<std::decay_t<U>, interned>::value
+		&& std::is_constructible<T, U&&>::value>>
+	interned(U&& value): m_value(intern(as_value(std::forward<U>(value)))) { }
+
+	interned(std::initializer_list<typename T::value_type> values): m_value(intern(T(values))) { }
+
+	const T& get() const
+	{
+		return m_value ? *m_value : empty();
+	}
+
+	operator const T&() const
+	{
+		return get();
+	}
+
+	const T* operator->() const
+	{
+		return &get();
+	}
+
+	/**
+	 * @brief Returns an identifier that is equal for all the handles to
+	 * equal values, and that is null for empty handles
+	 */
+	const void* id() const
+	{
+		return m_value.get();
+	}
+
+	bool operator==(const interned& other) const
+	{
+		return m_value == other.m_value || get() == other.get();
+	}
+
+	bool operator!=(const interned& other) const
+	{
+		return !(*this == other);
+	}
+
+	template<typename U, typename = std::enable_if_t<!std::is_same<U, interned>::value>>
+	friend bool operator==(const interned& a, const U& b)
+	{
+		return a.get() == b;
+	}
+
+	template<typename U, typename = std::enable_if_t<!std::is_same<U, interned>::value>>
+	friend bool operator!=(const interned& a, const U& b)
+	{
+		return !(a.get() == b);
+	}
+
+	/**
+	 * @brief Returns the number of values in the table
+	 */
+	static size_t table_size()
+	{
+		auto& t = table();
+		std::lock_guard<std::mutex> lk(t.mtx);
+		return t.values.size();
+	}
+
+private:
+	using value_ptr = std::shared_ptr<const T>;
+
+	struct value_less
+	{
+		using is_transparent = void;
+		bool operator()(const value_ptr& a, const value_ptr& b) const { return *a < *b; }
+		bool operator()(const value_ptr& a, const T& b) const { return *a < b; }
+		bool operator()(const T& a, const value_ptr& b) const { return a < *b; }
+	};
+
+	struct intern_table
+	{
+		std::mutex mtx;
+		std::set<value_ptr, value_less> values;
+		size_t purge_size = 64;
+	};
+
+	static intern_table& table()
+	{
+		static intern_table t;
+		return t;
+	}
+
+	static const T& empty()
+	{
+		static const T e{};
+		return e;
+	}
+
+	// values are only copied or converted when they are not interned yet
+
+	static const T& as_value(const T& value)
+	{
+		return value;
+	}
+
+	static T&& as_value(T&& value)
+	{
+		return std::move(value);
+	}
+
+	template<typename U, typename = std::enable_if_t<!std::is_same<std::decay_t<U>, T>::value>>
+	static T as_value(U&& value)
+	{
+		return T(std::forward<U>(value));
+	}
+
+	template<typename V>
+	static value_ptr intern(V&& value)
+	{
+		if(value == empty())
+		{
+			return nullptr;
+		}
+
+		auto& t = table();
+		std::lock_guard<std::mutex> lk(t.mtx);
+		auto it = t.values.find(value);
+		if(it != t.values.end())
+		{
+			return *it;
+		}
+
+		if(t.values.size() >= t.purge_size)
+		{
+			// a value referenced only by the table can't be referenced
+			// again without holding the lock
+			for(auto v = t.values.begin(); v != t.values.end();)
+			{
+				v = v->use_count() == 1 ? t.values.erase(v) : std::next(v);
+			}
+			t.purge_size = std::max<size_t>(64, t.values.size() * 2);
+		}
+
+		auto res = std::make_shared<const T>(std::forward<V>(value));
+		t.values.insert(res);
+		return res;
+	}
+
+	value_ptr m_value;
+};
+
+} // namespace falco
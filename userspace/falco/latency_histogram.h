@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace falco
+{
+
+/**
+ * @brief A lock-free histogram of latencies in nanoseconds, in the style of
+ * HDR histograms: each power of 2 is split in 4 linear sub-buckets, so that
+ * any value is known with a relative error of at most 25% with a fixed and
+ * small number of buckets. Values below 2^min_exp ns share the first bucket,
+ * and values from 2^max_exp ns share the last one.
+ * Recording a value costs a few relaxed atomic operations and can be done
+ * concurrently from multiple threads.
+ */
+class latency_histogram
+{
+public:
+	static constexpr unsigned sub_bucket_bits = 2;
+	static constexpr unsigned min_exp = 10;
+	static constexpr unsigned max_exp = 40;
+	static constexpr size_t num_buckets = (max_exp - min_exp) * (1 << sub_bucket_bits) + 2;
+
+	/**
+	 * @brief A consistent-enough copy of the histogram counters
+	 */
+	struct snapshot
+	{
+		std::array<uint64_t, num_buckets> counts = {};
+		uint64_t count = 0;
+		uint64_t sum = 0;
+		uint64_t max = 0;
+
+		/**
+		 * @brief Returns the number of values lower than the given bound,
+		 * which is exact when the bound is a power of 2
+		 */
+		uint64_t count_below(uint64_t bound) const
+		{
+			uint64_t res = 0;
+			for(size_t i = 0; i < num_buckets && bucket_upper_bound(i) <= bound; i++)
+			{
+				res += counts[i];
+			}
+			return res;
+		}
+
+		/**
+		 * @brief Returns an upper bound of the given percentile, in [0, 1]
+		 */
+		uint64_t percentile(double q) const
+		{
+			uint64_t total = 0;
+			for(auto c : counts)
+			{
+				total += c;
+			}
+			if(total == 0)
+			{
+				return 0;
+			}
+
+			uint64_t target = (uint64_t) (q * total);
+			target = target == 0 ? 1 : target;
+			uint64_t seen = 0;
+			for(size_t i = 0; i < num_buckets; i++)
+			{
+				seen += counts[i];
+				if(seen >= target)
+				{
+					uint64_t bound = bucket_upper_bound(i);
+					return bound < max ? bound : max;
+				}
+			}
+			return max;
+		}
+	};
+
+	/**
+	 * @brief Returns the bucket of a value
+	 */
+	static size_t bucket_index(uint64_t ns)
+	{
+		if(ns < ((uint64_t) 1 << min_exp))
+		{
+			return 0;
+		}
+		unsigned exp = 63 - __builtin_clzll(ns);
+		if(exp >= max_exp)
+		{
+			return num_buckets - 1;
+		}
+		uint64_t sub = (ns >> (exp - sub_bucket_bits)) & ((1 << sub_bucket_bits) - 1);
+		return 1 + ((exp - min_exp) << sub_bucket_bits) + sub;
+	}
+
+	/**
+	 * @brief Returns the exclusive upper bound of the values in a bucket
+	 */
+	static uint64_t bucket_upper_bound(size_t i)
+	{
+		if(i == 0)
+		{
+			return (uint64_t) 1 << min_exp;
+		}
+		if(i >= num_buckets - 1)
+		{
+			return UINT64_MAX;
+		}
+		unsigned exp = min_exp + ((i - 1) >> sub_bucket_bits);
+		uint64_t sub = (i - 1) & ((1 << sub_bucket_bits) - 1);
+		return ((uint64_t) 1 << exp) + ((sub + 1) << (exp - sub_bucket_bits));
+	}
+
+	void record(uint64_t ns)
+	{
+		m_counts[bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+		m_count.fetch_add(1, std::memory_order_relaxed);
+		m_sum.fetch_add(ns, std::memory_order_relaxed);
+		uint64_t max = m_max.load(std::memory_order_relaxed);
+		while(ns > max && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	snapshot get() const
+	{
+		snapshot res;
+		for(size_t i = 0; i < num_buckets; i++)
+		{
+			res.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+		}
+		res.count = m_count.load(std::memory_order_relaxed);
+		res.sum = m_sum.load(std::memory_order_relaxed);
+		res.max = m_max.load(std::memory_order_relaxed);
+		return res;
+	}
+
+private:
+	std::array<std::atomic<uint64_t>, num_buckets> m_counts = {};
+	std::atomic<uint64_t> m_count = 0;
+	std::atomic<uint64_t> m_sum = 0;
+	std::atomic<uint64_t> m_max = 0;
+};
+
+} // namespace falco
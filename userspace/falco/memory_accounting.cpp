@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "memory_accounting.h"
+
+#include <atomic>
+
+using namespace falco::memory;
+
+static std::array<std::atomic<int64_t>, (size_t)subsystem::MAX> s_bytes = {};
+static std::array<std::atomic<uint64_t>, (size_t)subsystem::MAX> s_limit_hits = {};
+static std::array<std::atomic<uint64_t>, (size_t)subsystem::MAX> s_limits = {};
+static std::atomic<uint64_t> s_total_limit = 0;
+
+const char* falco::memory::to_string(subsystem s)
+{
+	switch(s)
+	{
+	case subsystem::RULES:
+		return "rules";
+	case subsystem::FILTERS:
+		return "filters";
+	case subsystem::OUTPUTS_QUEUE:
+		return "outputs_queue";
+	case subsystem::GRPC_QUEUE:
+		return "grpc_queue";
+	case subsystem::THREAD_TABLE:
+		return "thread_table";
+	case subsystem::METRICS:
+		return "metrics";
+	default:
+		return "unknown";
+	}
+}
+
+void falco::memory::add(subsystem s, int64_t bytes)
+{
+	s_bytes[(size_t)s].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void falco::memory::set(subsystem s, uint64_t bytes)
+{
+	s_bytes[(size_t)s].store((int64_t)bytes, std::memory_order_relaxed);
+}
+
+uint64_t falco::memory::get(subsystem s)
+{
+	// concurrent updates of the same subsystem can be briefly observed
+	// out of order, so we never report a negative value
+	auto bytes = s_bytes[(size_t)s].load(std::memory_order_relaxed);
+	return bytes > 0 ? (uint64_t)bytes : 0;
+}
+
+uint64_t falco::memory::total()
+{
+	uint64_t res = 0;
+	for(size_t i = 0; i < (size_t)subsystem::MAX; i++)
+	{
+		res += get((subsystem)i);
+	}
+	return res;
+}
+
+void falco::memory::set_soft_limits(const soft_limits& limits)
+{
+	for(size_t i = 0; i < (size_t)subsystem::MAX; i++)
+	{
+		s_limits[i].store(limits.subsystems[i], std::memory_order_relaxed);
+	}
+	s_total_limit.store(limits.total, std::memory_order_relaxed);
+}
+
+uint64_t falco::memory::soft_limit(subsystem s)
+{
+	return s_limits[(size_t)s].load(std::memory_order_relaxed);
+}
+
+uint64_t falco::memory::total_soft_limit()
+{
+	return s_total_limit.load(std::memory_order_relaxed);
+}
+
+bool falco::memory::over_soft_limit(subsystem s)
+{
+	auto limit = soft_limit(s);
+	return limit > 0 && get(s) > limit;
+}
+
+bool falco::memory::over_total_soft_limit()
+{
+	auto limit = total_soft_limit();
+	return limit > 0 && total() > limit;
+}
+
+void falco::memory::count_limit_hit(subsystem s)
+{
+	s_limit_hits[(size_t)s].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t falco::memory::limit_hits(subsystem s)
+{
+	return s_limit_hits[(size_t)s].load(std::memory_order_relaxed);
+}
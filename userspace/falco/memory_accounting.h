@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace falco
+{
+namespace memory
+{
+
+/**
+ * @brief The subsystems whose memory is accounted
+ */
+enum class subsystem : uint8_t
+{
+	RULES = 0,
+	FILTERS,
+	OUTPUTS_QUEUE,
+	GRPC_QUEUE,
+	THREAD_TABLE,
+	METRICS,
+	MAX
+};
+
+/**
+ * @brief Soft limits in bytes for each subsystem and for their total,
+ * where 0 means no limit
+ */
+struct soft_limits
+{
+	std::array<uint64_t, (size_t)subsystem::MAX> subsystems = {};
+	uint64_t total = 0;
+};
+
+/**
+ * @brief Returns the name of a subsystem as used in metrics
+ */
+const char* to_string(subsystem s);
+
+/**
+ * @brief Adds a (possibly negative) number of bytes to a subsystem.
+ * This is thread-safe and lock-free.
+ */
+void add(subsystem s, int64_t bytes);
+
+/**
+ * @brief Sets the number of bytes of a subsystem
+ */
+void set(subsystem s, uint64_t bytes);
+
+/**
+ * @brief Returns the number of bytes of a subsystem
+ */
+uint64_t get(subsystem s);
+
+/**
+ * @brief Returns the number of bytes of all the subsystems
+ */
+uint64_t total();
+
+/**
+ * @brief Sets the soft limits, which the subsystems check on their own
+ */
+void set_soft_limits(const soft_limits& limits);
+
+/**
+ * @brief Returns the soft limit of a subsystem, 0 if unlimited
+ */
+uint64_t soft_limit(subsystem s);
+
+/**
+ * @brief Returns the soft limit of all the subsystems, 0 if unlimited
+ */
+uint64_t total_soft_limit();
+
+/**
+ * @brief Returns true if the given subsystem, or all of them together,
+ * exceed their soft limit
+ */
+bool over_soft_limit(subsystem s);
+bool over_total_soft_limit();
+
+/**
+ * @brief Records that a subsystem shed memory because of its soft limit
+ * (e.g. by dropping a message), and returns how many times it did so
+ */
+void count_limit_hit(subsystem s);
+uint64_t limit_hits(subsystem s);
+
+}; // namespace memory
+}; // namespace falco
@@ -19,8 +19,10 @@ limitations under the License.
 
 #include <string>
 #include <map>
+#include <set>
 
 #include "falco_common.h"
+#include "interned.h"
 #include <nlohmann/json.hpp>
 
 namespace falco
@@ -42,16 +44,28 @@ struct config
 // The message to be outputted. It can either refer to:
 //  - an event that has matched some rule,
 //  - or a generic message (e.g., a drop alert).
+// Rule, source and tags repeat across messages and are interned, so that
+// building and queueing a message doesn't copy them. Fields are only
+// extracted when at least one output needs them.
 //
 struct message
 {
 	uint64_t ts;
 	falco_common::priority_type priority;
 	std::string msg;
-	std::string rule;
-	std::string source;
+	falco::interned<std::string> rule;
+	falco::interned<std::string> source;
 	nlohmann::json fields;
-	std::set<std::string> tags;
+	falco::interned<std::set<std::string>> tags;
+};
+
+//
+// Thrown by an output that refused a message for good (e.g. a client
+// error reported by the server), so that it's not retried when spooled.
+//
+struct rejected_message : falco_exception
+{
+	using falco_exception::falco_exception;
 };
 
 //
@@ -76,20 +90,29 @@ public:
 	}
 
 	// Return the output's name as per its configuration.
-	const std::string get_name() const
+	const std::string& get_name() const
 	{
 		return m_oc.name;
 	}
 
-	// Output a message.
+	// Output a message. Throws if the message could not be delivered,
+	// so that it can be retried when spooled, or rejected_message if
+	// retrying would not help.
 	virtual void output(const message *msg) = 0;
 
+	// Whether the output uses the fields of the messages.
+	virtual bool needs_fields() const { return false; }
+
 	// Possibly close the output and open it again.
 	virtual void reopen() {}
 
 	// Possibly flush the output.
 	virtual void cleanup() {}
 
+	// Send the messages that the output buffered to send them in batches,
+	// if any. Called when there are no more messages to output.
+	virtual void flush() {}
+
 protected:
 	config m_oc;
 	bool m_buffered;
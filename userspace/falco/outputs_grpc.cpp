@@ -45,7 +45,7 @@ void falco::outputs::output_grpc::output(const message *msg)
 
 	// rule
 	auto r = grpc_res.mutable_rule();
-	*r = msg->rule;
+	*r = msg->rule.get();
 
 	// source_deprecated (maintained for backward compatibility)
 	// Setting this as reserved would cause old clients to receive the
@@ -55,7 +55,7 @@ void falco::outputs::output_grpc::output(const message *msg)
 	// enum entry instead. 
 	// todo(jasondellaluce): remove source_deprecated and reserve its number
 	falco::schema::source s = falco::schema::source::SYSCALL;
-	if(!falco::schema::source_Parse(msg->source, &s))
+	if(!falco::schema::source_Parse(msg->source.get(), &s))
 	{
 		// unknown source names are expected to come from plugins
 		s = falco::schema::source::PLUGIN;
@@ -69,7 +69,7 @@ void falco::outputs::output_grpc::output(const message *msg)
 	falco::schema::priority p = falco::schema::priority::EMERGENCY;
 	if(!falco::schema::priority_Parse(falco_common::format_priority(msg->priority), &p))
 	{
-		throw falco_exception("Unknown priority passed to output_grpc::output()");
+		throw rejected_message("Unknown priority passed to output_grpc::output()");
 	}
 	grpc_res.set_priority(p);
 
@@ -83,7 +83,7 @@ void falco::outputs::output_grpc::output(const message *msg)
 	{
 		if (!kv.value().is_primitive())
 		{
-			throw falco_exception("output_grpc: output fields must be key-value maps");
+			throw rejected_message("output_grpc: output fields must be key-value maps");
 		}
 		fields[kv.key()] = (kv.value().is_string())
 			? kv.value().get<std::string>()
@@ -96,11 +96,16 @@ void falco::outputs::output_grpc::output(const message *msg)
 
 	// tags
 	auto tags = grpc_res.mutable_tags();
-	*tags = {msg->tags.begin(), msg->tags.end()};
+	*tags = {msg->tags->begin(), msg->tags->end()};
 
 	// source
 	auto source = grpc_res.mutable_source();
-	*source = msg->source;
+	*source = msg->source.get();
 
-	falco::grpc::queue::get().push(grpc_res);
+	// the queue only fills up when no client is consuming it, in which
+	// case retrying would just hold back the spool
+	if(!falco::grpc::queue::get().push(grpc_res))
+	{
+		throw rejected_message("output_grpc: queue exceeds its memory limit");
+	}
 }
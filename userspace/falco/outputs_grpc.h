@@ -27,6 +27,7 @@ namespace outputs
 class output_grpc : public abstract_output
 {
 	void output(const message *msg) override;
+	bool needs_fields() const override { return true; }
 };
 
 } // namespace outputs
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include "outputs_http.h"
 #include "logger.h"
+#include "falco_common.h"
 
 #define CHECK_RES(fn) res = res == CURLE_OK ? fn : res
 
@@ -121,7 +122,20 @@ void falco::outputs::output_http::output(const message *msg)
 	CHECK_RES(curl_easy_perform(m_curl));
 	if(res != CURLE_OK)
 	{
-		falco_logger::log(falco_logger::level::ERR, "libcurl failed to perform call: " + std::string(curl_easy_strerror(res)));
+		throw falco_exception("libcurl failed to perform call: " + std::string(curl_easy_strerror(res)));
+	}
+
+	// the message is not delivered if the server refused it, and client
+	// errors other than timeouts and rate limiting are not worth a retry
+	long code = 0;
+	curl_easy_getinfo(m_curl, CURLINFO_RESPONSE_CODE, &code);
+	if(code >= 400 && code < 500 && code != 408 && code != 429)
+	{
+		throw rejected_message("server rejected the message with HTTP status " + std::to_string(code));
+	}
+	if(code >= 400)
+	{
+		throw falco_exception("server replied with HTTP status " + std::to_string(code));
 	}
 }
 
@@ -16,6 +16,7 @@ limitations under the License.
 */
 
 #include "outputs_program.h"
+#include "falco_common.h"
 #include <stdio.h>
 
 void falco::outputs::output_program::open_pfile()
@@ -24,7 +25,7 @@ void falco::outputs::output_program::open_pfile()
 	{
 		m_pfile = popen(m_oc.options["program"].c_str(), "w");
 
-		if(!m_buffered)
+		if(m_pfile != nullptr && !m_buffered)
 		{
 			setvbuf(m_pfile, NULL, _IONBF, 0);
 		}
@@ -34,12 +35,25 @@ void falco::outputs::output_program::open_pfile()
 void falco::outputs::output_program::output(const message *msg)
 {
 	open_pfile();
+	if(m_pfile == nullptr)
+	{
+		throw falco_exception("failed to run program " + m_oc.options["program"]);
+	}
 
-	fprintf(m_pfile, "%s\n", msg->msg.c_str());
+	bool written = fprintf(m_pfile, "%s\n", msg->msg.c_str()) >= 0;
 
 	if(m_oc.options["keep_alive"] != "true")
+	{
+		// the program exiting with an error counts as a failed delivery
+		int status = pclose(m_pfile);
+		m_pfile = nullptr;
+		written = written && status == 0;
+	}
+
+	if(!written)
 	{
 		cleanup();
+		throw falco_exception("failed to write to program " + m_oc.options["program"]);
 	}
 }
 
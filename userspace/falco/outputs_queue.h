@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace falco
+{
+namespace outputs
+{
+
+/**
+ * @brief A bounded multi-producer queue in which items are partitioned
+ * into levels, where level 0 is the most important one. Items are popped
+ * in the same order in which they were pushed, regardless of their level.
+ * When the queue is full, pushing an item evicts the oldest item of the
+ * least important level that is less important than the pushed one, or
+ * drops the pushed item if there is none. Optionally, part of the capacity
+ * can be reserved for the first levels, and the queue can be bounded by
+ * the approximate bytes of its items too. Items pushed with force are never
+ * dropped or evicted, and are not subject to the capacity.
+ */
+template<typename T>
+class priority_queue
+{
+public:
+	using drop_callback_t = std::function<void(const T& item, size_t level)>;
+	using item_bytes_t = std::function<size_t(const T& item)>;
+
+	/**
+	 * @brief Creates a queue with the given number of levels
+	 * @param capacity The maximum number of items in the queue
+	 * @param reserved_capacity The part of the capacity that can only be
+	 * used by items with a level lower than reserved_levels
+	 * @param on_drop Invoked for every item that is dropped or evicted,
+	 * while holding the queue lock
+	 * @param max_bytes The maximum bytes of the items in the queue, as
+	 * returned by item_bytes, or 0 for no limit. An item is always accepted
+	 * when the queue is empty, regardless of its bytes.
+	 * @param item_bytes Returns the approximate bytes of an item
+	 */
+	priority_queue(
+		size_t num_levels,
+		size_t capacity,
+		size_t reserved_capacity,
+		size_t reserved_levels,
+		drop_callback_t on_drop,
+		size_t max_bytes = 0,
+		item_bytes_t item_bytes = nullptr):
+		m_levels(num_levels + 1),
+		m_capacity(capacity),
+		m_reserved_capacity(reserved_capacity < capacity ? reserved_capacity : capacity),
+		m_reserved_levels(reserved_levels),
+		m_on_drop(on_drop),
+		m_max_bytes(item_bytes ? max_bytes : 0),
+		m_item_bytes(item_bytes),
+		m_size(0),
+		m_bytes(0),
+		m_next_seq(0) { }
+
+	/**
+	 * @brief Pushes an item. Returns false if the item, or another item to
+	 * make room for it, has been dropped.
+	 */
+	bool push(const T& item, size_t level, bool force = false)
+	{
+		return emplace(item, level, force);
+	}
+
+	/**
+	 * @brief Pushes an item by moving it into the queue, which leaves the
+	 * item untouched if it is dropped. Returns false if the item, or
+	 * another item to make room for it, has been dropped.
+	 */
+	bool push(T&& item, size_t level, bool force = false)
+	{
+		return emplace(std::move(item), level, force);
+	}
+
+	/**
+	 * @brief Pops the oldest item, blocking until one is available
+	 */
+	void pop(T& item)
+	{
+		std::unique_lock<std::mutex> lk(m_mtx);
+		size_t level = 0;
+		m_cv.wait(lk, [this, &level] { return find_oldest(level); });
+		take(level, item);
+	}
+
+	/**
+	 * @brief Pops the oldest item, blocking until one is available or
+	 * the timeout expires. Returns false if the timeout expired.
+	 */
+	template<typename Rep, typename Period>
+	bool pop_for(T& item, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		std::unique_lock<std::mutex> lk(m_mtx);
+		size_t level = 0;
+		if(!m_cv.wait_for(lk, timeout, [this, &level] { return find_oldest(level); }))
+		{
+			return false;
+		}
+		take(level, item);
+		return true;
+	}
+
+	/**
+	 * @brief Removes all the items, without invoking the drop callback
+	 */
+	void clear()
+	{
+		std::lock_guard<std::mutex> lk(m_mtx);
+		for(auto& l : m_levels)
+		{
+			l.clear();
+		}
+		m_size = 0;
+		m_bytes.store(0, std::memory_order_relaxed);
+	}
+
+	size_t size()
+	{
+		std::lock_guard<std::mutex> lk(m_mtx);
+		return m_size;
+	}
+
+	/**
+	 * @brief Returns the bytes of the items in the queue, without locking
+	 */
+	size_t bytes() const
+	{
+		return m_bytes.load(std::memory_order_relaxed);
+	}
+
+private:
+	template<typename U>
+	bool emplace(U&& item, size_t level, bool force)
+	{
+		bool dropped = false;
+		size_t bytes = m_item_bytes ? m_item_bytes(item) : 0;
+		{
+			std::lock_guard<std::mutex> lk(m_mtx);
+			if(force)
+			{
+				level = m_levels.size() - 1;
+			}
+			else
+			{
+				if(level >= m_levels.size() - 1)
+				{
+					level = m_levels.size() - 2;
+				}
+
+				size_t limit = level < m_reserved_levels
+					? m_capacity
+					: m_capacity - m_reserved_capacity;
+				while(m_size >= limit
+					|| (m_max_bytes > 0 && m_size > 0 && m_bytes + bytes > m_max_bytes))
+				{
+					dropped = true;
+					if(!evict_below(level))
+					{
+						m_on_drop(item, level);
+						return false;
+					}
+				}
+			}
+
+			m_levels[level].push_back({m_next_seq++, std::forward<U>(item), bytes});
+			m_size += force ? 0 : 1;
+			m_bytes.store(m_bytes + bytes, std::memory_order_relaxed);
+		}
+		m_cv.notify_one();
+		return !dropped;
+	}
+
+	struct entry
+	{
+		uint64_t seq;
+		T item;
+		size_t bytes;
+	};
+
+	// Moves out the oldest item of the given level
+	inline void take(size_t level, T& item)
+	{
+		item = std::move(m_levels[level].front().item);
+		m_bytes.store(m_bytes - m_levels[level].front().bytes, std::memory_order_relaxed);
+		m_levels[level].pop_front();
+		m_size -= (level == m_levels.size() - 1) ? 0 : 1;
+	}
+
+	// Evicts the oldest item of the least important level below the
+	// given one, returning false if there is none
+	inline bool evict_below(size_t level)
+	{
+		for(size_t l = m_levels.size() - 1; l-- > level + 1;)
+		{
+			if(!m_levels[l].empty())
+			{
+				m_on_drop(m_levels[l].front().item, l);
+				m_bytes.store(m_bytes - m_levels[l].front().bytes, std::memory_order_relaxed);
+				m_levels[l].pop_front();
+				m_size--;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline bool find_oldest(size_t& level) const
+	{
+		bool found = false;
+		uint64_t seq = 0;
+		for(size_t l = 0; l < m_levels.size(); l++)
+		{
+			if(!m_levels[l].empty() && (!found || m_levels[l].front().seq < seq))
+			{
+				found = true;
+				seq = m_levels[l].front().seq;
+				level = l;
+			}
+		}
+		return found;
+	}
+
+	std::mutex m_mtx;
+	std::condition_variable m_cv;
+	// the last level holds forced items
+	std::vector<std::deque<entry>> m_levels;
+	size_t m_capacity;
+	size_t m_reserved_capacity;
+	size_t m_reserved_levels;
+	drop_callback_t m_on_drop;
+	size_t m_max_bytes;
+	item_bytes_t m_item_bytes;
+	size_t m_size;
+	// only changed with the lock held, but readable without it
+	std::atomic<size_t> m_bytes;
+	uint64_t m_next_seq;
+};
+
+} // namespace outputs
+} // namespace falco
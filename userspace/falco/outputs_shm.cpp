@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "outputs_shm.h"
+#include "logger.h"
+
+bool falco::outputs::output_shm::init(const config& oc, bool buffered, const std::string& hostname, bool json_output, std::string &err)
+{
+	if(!falco::outputs::abstract_output::init(oc, buffered, hostname, json_output, err))
+	{
+		return false;
+	}
+
+	try
+	{
+		m_ring = std::make_unique<falco::shm_ring::producer>(
+			m_oc.options["path"],
+			std::stoull(m_oc.options["size_mb"]) * 1024 * 1024);
+	}
+	catch(const std::exception& e)
+	{
+		err = e.what();
+		return false;
+	}
+	return true;
+}
+
+void falco::outputs::output_shm::output(const message *msg)
+{
+	// the consumer is not supposed to slow down Falco, so alerts are
+	// dropped when the ring is full
+	bool written = m_ring->write(msg->ts, msg->priority, msg->rule.get(), msg->source.get(), msg->msg);
+	if(!written && !m_dropping)
+	{
+		falco_logger::log(falco_logger::level::ERR, "shm output: ring is full, dropping alerts until the consumer catches up\n");
+	}
+	m_dropping = !written;
+}
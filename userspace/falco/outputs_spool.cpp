@@ -0,0 +1,434 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "outputs_spool.h"
+#include "falco_common.h"
+#include "json_writer.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+static const std::string s_segment_prefix = "segment.";
+static const std::string s_segment_suffix = ".log";
+static const std::string s_cursor_prefix = "cursor.";
+
+// cursors are persisted after this many acknowledgements, and whenever
+// they move to another segment. On a crash, the messages acknowledged
+// in between are delivered again.
+static const uint64_t s_acks_per_flush = 256;
+
+// appended messages are buffered in memory up to this size before being
+// written to the segment file, unless synced earlier by the reader
+static const size_t s_write_buffer_size = 64 * 1024;
+
+static std::string serialize(const falco::outputs::message& msg)
+{
+	std::string res;
+	res.reserve(msg.msg.size() + 256);
+	falco::json_writer w(res);
+	w.begin_object();
+	w.key("ts").value(msg.ts);
+	w.key("priority").value((int) msg.priority);
+	w.key("rule").value(msg.rule.get());
+	w.key("source").value(msg.source.get());
+	w.key("msg").value(msg.msg);
+	w.key("fields").value(msg.fields);
+	w.key("tags").begin_array();
+	for(const auto& tag : msg.tags.get())
+	{
+		w.value(tag);
+	}
+	w.end_array();
+	w.end_object();
+	return res;
+}
+
+static bool deserialize(const std::string& line, falco::outputs::message& msg)
+{
+	try
+	{
+		auto j = nlohmann::json::parse(line);
+		msg.ts = j.at("ts").get<uint64_t>();
+		msg.priority = (falco_common::priority_type) j.at("priority").get<int>();
+		msg.rule = j.at("rule").get<std::string>();
+		msg.source = j.at("source").get<std::string>();
+		msg.msg = j.at("msg").get<std::string>();
+		msg.fields = j.at("fields");
+		msg.tags = j.at("tags").get<std::set<std::string>>();
+		return true;
+	}
+	catch(const std::exception&)
+	{
+		// e.g. a partially written line after a crash
+		return false;
+	}
+}
+
+falco::outputs::spool::spool(const spool_config& config, const std::vector<std::string>& sinks):
+	m_config(config)
+{
+	std::error_code ec;
+	fs::create_directories(m_config.directory, ec);
+	if(ec)
+	{
+		throw falco_exception("failed to create outputs spool directory " + m_config.directory + ": " + ec.message());
+	}
+
+	// recover the segments of a previous run
+	for(const auto& entry : fs::directory_iterator(m_config.directory, ec))
+	{
+		auto name = entry.path().filename().string();
+		if(name.size() <= s_segment_prefix.size() + s_segment_suffix.size()
+			|| name.compare(0, s_segment_prefix.size(), s_segment_prefix) != 0
+			|| name.compare(name.size() - s_segment_suffix.size(), s_segment_suffix.size(), s_segment_suffix) != 0)
+		{
+			continue;
+		}
+
+		uint64_t id;
+		try
+		{
+			id = std::stoull(name.substr(s_segment_prefix.size(), name.size() - s_segment_prefix.size() - s_segment_suffix.size()));
+		}
+		catch(const std::exception&)
+		{
+			continue;
+		}
+
+		segment_info info;
+		std::ifstream in(entry.path(), std::ios::binary);
+		std::string line;
+		while(std::getline(in, line))
+		{
+			info.size += line.size() + 1;
+			info.records++;
+		}
+		m_segments[id] = info;
+	}
+	if(ec)
+	{
+		throw falco_exception("failed to read outputs spool directory " + m_config.directory + ": " + ec.message());
+	}
+
+	for(const auto& sink : sinks)
+	{
+		cursor c;
+		c.sink = sink;
+		if(m_segments.empty())
+		{
+			c.pos.segment = 0;
+		}
+		else
+		{
+			// sinks without a persisted cursor replay all the messages
+			c.pos.segment = m_segments.begin()->first;
+		}
+		std::ifstream in(cursor_path(sink));
+		in >> c.pos.segment >> c.pos.offset;
+		c.next = c.pos;
+		m_cursors.push_back(std::move(c));
+	}
+
+	// the last segment may end with a partially written message, so we
+	// always start writing in a new one
+	open_writer(m_segments.empty() ? 0 : m_segments.rbegin()->first + 1);
+	for(auto& c : m_cursors)
+	{
+		clamp(c);
+	}
+	remove_acked_segments();
+}
+
+falco::outputs::spool::~spool()
+{
+	try
+	{
+		flush();
+	}
+	catch(...)
+	{
+	}
+}
+
+std::string falco::outputs::spool::segment_path(uint64_t id) const
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%020" PRIu64, id);
+	return (fs::path(m_config.directory) / (s_segment_prefix + buf + s_segment_suffix)).string();
+}
+
+std::string falco::outputs::spool::cursor_path(const std::string& sink) const
+{
+	return (fs::path(m_config.directory) / (s_cursor_prefix + sink)).string();
+}
+
+void falco::outputs::spool::open_writer(uint64_t id)
+{
+	// closing the previous segment writes what was buffered
+	m_unsynced = false;
+	m_out.close();
+	m_out.clear();
+	m_out_buf.resize(s_write_buffer_size);
+	m_out.rdbuf()->pubsetbuf(m_out_buf.data(), m_out_buf.size());
+	m_out.open(segment_path(id), std::ios::out | std::ios::app | std::ios::binary);
+	if(m_out.fail())
+	{
+		throw falco_exception("failed to open outputs spool segment " + segment_path(id));
+	}
+	m_segments[id];
+}
+
+void falco::outputs::spool::persist(cursor& c)
+{
+	auto path = cursor_path(c.sink);
+	auto tmp = path + ".tmp";
+	{
+		std::ofstream out(tmp, std::ios::out | std::ios::trunc);
+		out << c.pos.segment << " " << c.pos.offset << "\n";
+		if(out.fail())
+		{
+			return;
+		}
+	}
+	std::error_code ec;
+	fs::rename(tmp, path, ec);
+	c.acks_since_flush = 0;
+}
+
+void falco::outputs::spool::clamp(cursor& c)
+{
+	auto first = m_segments.begin();
+	if(c.pos.segment < first->first)
+	{
+		c.pos = {first->first, 0};
+	}
+	else if(c.pos.segment > m_segments.rbegin()->first)
+	{
+		c.pos = {m_segments.rbegin()->first, m_segments.rbegin()->second.size};
+	}
+	c.next = c.pos;
+}
+
+void falco::outputs::spool::remove_segment(uint64_t id)
+{
+	std::error_code ec;
+	fs::remove(segment_path(id), ec);
+	m_segments.erase(id);
+	for(auto& c : m_cursors)
+	{
+		if(c.in_segment == id)
+		{
+			c.in.close();
+			c.in_segment = UINT64_MAX;
+		}
+	}
+}
+
+void falco::outputs::spool::remove_acked_segments()
+{
+	// the segment being written is never removed
+	uint64_t writer = m_segments.rbegin()->first;
+	while(m_segments.begin()->first != writer)
+	{
+		auto oldest = m_segments.begin();
+		for(const auto& c : m_cursors)
+		{
+			if(c.pos.segment < oldest->first
+				|| (c.pos.segment == oldest->first && c.pos.offset < oldest->second.size))
+			{
+				return;
+			}
+		}
+		remove_segment(oldest->first);
+	}
+}
+
+uint64_t falco::outputs::spool::total_size() const
+{
+	uint64_t res = 0;
+	for(const auto& s : m_segments)
+	{
+		res += s.second.size;
+	}
+	return res;
+}
+
+uint64_t falco::outputs::spool::append(const message& msg)
+{
+	auto line = serialize(msg);
+	line += "\n";
+
+	auto writer = m_segments.rbegin();
+	if(writer->second.size > 0 && writer->second.size + line.size() > m_config.segment_size)
+	{
+		open_writer(writer->first + 1);
+		writer = m_segments.rbegin();
+	}
+
+	// the message is buffered here, and written to the segment file by
+	// sync(), or right away when the buffer is full
+	m_out << line;
+	if(m_out.fail())
+	{
+		m_out.clear();
+		throw falco_exception("failed to write outputs spool segment " + segment_path(writer->first));
+	}
+	m_unsynced = true;
+	writer->second.size += line.size();
+	writer->second.records++;
+
+	// drop the oldest segments, acknowledged or not
+	uint64_t discarded = 0;
+	while(total_size() > m_config.max_size && m_segments.size() > 1)
+	{
+		discarded += m_segments.begin()->second.records;
+		remove_segment(m_segments.begin()->first);
+		for(auto& c : m_cursors)
+		{
+			clamp(c);
+		}
+	}
+	return discarded;
+}
+
+bool falco::outputs::spool::pending(size_t sink) const
+{
+	const auto& c = m_cursors[sink];
+	for(auto it = m_segments.lower_bound(c.pos.segment); it != m_segments.end(); it++)
+	{
+		uint64_t consumed = it->first == c.pos.segment ? c.pos.offset : 0;
+		if(it->second.size > consumed)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool falco::outputs::spool::empty() const
+{
+	for(size_t i = 0; i < m_cursors.size(); i++)
+	{
+		if(pending(i))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void falco::outputs::spool::sync()
+{
+	if(!m_unsynced)
+	{
+		return;
+	}
+
+	m_unsynced = false;
+	m_out.flush();
+	if(m_out.fail())
+	{
+		m_out.clear();
+		throw falco_exception("failed to write outputs spool segment " + segment_path(m_segments.rbegin()->first));
+	}
+}
+
+bool falco::outputs::spool::peek(size_t sink, message& msg)
+{
+	sync();
+
+	auto& c = m_cursors[sink];
+	while(true)
+	{
+		// the segment may have been removed once consumed by all sinks
+		auto it = m_segments.lower_bound(c.pos.segment);
+		if(it == m_segments.end())
+		{
+			return false;
+		}
+		if(it->first != c.pos.segment)
+		{
+			c.pos = {it->first, 0};
+		}
+
+		if(c.pos.offset >= it->second.size)
+		{
+			auto next = std::next(it);
+			if(next == m_segments.end())
+			{
+				return false;
+			}
+			c.pos = {next->first, 0};
+			continue;
+		}
+
+		if(c.in_segment != c.pos.segment)
+		{
+			c.in.close();
+			c.in.clear();
+			c.in.open(segment_path(c.pos.segment), std::ios::binary);
+			c.in_segment = c.pos.segment;
+		}
+
+		std::string line;
+		c.in.clear();
+		c.in.seekg(c.pos.offset);
+		if(!std::getline(c.in, line))
+		{
+			return false;
+		}
+
+		position next = {c.pos.segment, c.pos.offset + line.size() + 1};
+		if(!deserialize(line, msg))
+		{
+			c.pos = next;
+			continue;
+		}
+		c.next = next;
+		return true;
+	}
+}
+
+void falco::outputs::spool::ack(size_t sink)
+{
+	auto& c = m_cursors[sink];
+	bool segment_done = c.next.segment == c.pos.segment
+		&& m_segments.count(c.next.segment)
+		&& c.next.offset >= m_segments[c.next.segment].size;
+	c.pos = c.next;
+	if(++c.acks_since_flush >= s_acks_per_flush || segment_done)
+	{
+		persist(c);
+	}
+	if(segment_done)
+	{
+		remove_acked_segments();
+	}
+}
+
+void falco::outputs::spool::flush()
+{
+	sync();
+	for(auto& c : m_cursors)
+	{
+		persist(c);
+	}
+}
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "outputs.h"
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace falco
+{
+namespace outputs
+{
+
+struct spool_config
+{
+	bool enabled = false;
+	std::string directory;
+	uint64_t segment_size = 0;
+	uint64_t max_size = 0;
+	size_t high_watermark = 0;
+};
+
+/**
+ * @brief An on-disk, append-only log of output messages, split in segment
+ * files of bounded size. Each sink has its own cursor in the log, which is
+ * advanced by acknowledging the messages it received, and is persisted in
+ * the spool directory so that unacknowledged messages are replayed after a
+ * restart. Segments are deleted once acknowledged by all sinks, or when the
+ * spool exceeds its maximum size, oldest first.
+ * This class is not thread-safe.
+ */
+class spool
+{
+public:
+	/**
+	 * @brief Opens the spool in the given directory, creating it if needed,
+	 * and recovers the messages and cursors left by a previous run.
+	 * Throws a falco_exception on failure.
+	 */
+	spool(const spool_config& config, const std::vector<std::string>& sinks);
+	~spool();
+
+	spool(const spool&) = delete;
+	spool& operator = (const spool&) = delete;
+
+	/**
+	 * @brief Appends a message to the log. Returns the number of messages
+	 * discarded (i.e. not acknowledged by all sinks) to respect the
+	 * maximum size. Messages are buffered and written to disk in batches
+	 * by sync(), so that most appends don't do I/O: only the ones that
+	 * fill the buffer, start a new segment or discard old ones do.
+	 */
+	uint64_t append(const message& msg);
+
+	/**
+	 * @brief Returns true if the sink with the given index has messages
+	 * that it didn't acknowledge yet
+	 */
+	bool pending(size_t sink) const;
+
+	/**
+	 * @brief Returns true if all sinks acknowledged all the messages
+	 */
+	bool empty() const;
+
+	/**
+	 * @brief Writes the buffered messages to disk. Throws a falco_exception
+	 * on failure.
+	 */
+	void sync();
+
+	/**
+	 * @brief Reads the oldest message not acknowledged by the sink, without
+	 * acknowledging it, after writing the buffered messages to disk.
+	 * Returns false if there is none.
+	 */
+	bool peek(size_t sink, message& msg);
+
+	/**
+	 * @brief Acknowledges the message last returned by peek() for the sink
+	 */
+	void ack(size_t sink);
+
+	/**
+	 * @brief Writes the buffered messages and persists the cursors of
+	 * all sinks
+	 */
+	void flush();
+
+private:
+	struct position
+	{
+		uint64_t segment = 0;
+		uint64_t offset = 0;
+	};
+
+	struct segment_info
+	{
+		uint64_t size = 0;
+		uint64_t records = 0;
+	};
+
+	struct cursor
+	{
+		std::string sink;
+		position pos;
+		position next;
+		uint64_t acks_since_flush = 0;
+		std::ifstream in;
+		uint64_t in_segment = UINT64_MAX;
+	};
+
+	std::string segment_path(uint64_t id) const;
+	std::string cursor_path(const std::string& sink) const;
+	void open_writer(uint64_t id);
+	void persist(cursor& c);
+	void clamp(cursor& c);
+	void remove_segment(uint64_t id);
+	void remove_acked_segments();
+	uint64_t total_size() const;
+
+	spool_config m_config;
+	std::map<uint64_t, segment_info> m_segments;
+	std::vector<cursor> m_cursors;
+	std::ofstream m_out;
+	std::vector<char> m_out_buf;
+	bool m_unsynced = false;
+};
+
+} // namespace outputs
+} // namespace falco
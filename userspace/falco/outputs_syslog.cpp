@@ -1,6 +1,6 @@
 // SPDX-License-Identifier: Apache-2.0
 /*
-Copyright (C) 2023 The Falco Authors
+Copyright (C) 2024 The Falco Authors.
 
 Licensed under the Apache License, Version 2.0 (the "License");
 you may not use this file except in compliance with the License.
@@ -16,10 +16,437 @@ limitations under the License.
 */
 
 #include "outputs_syslog.h"
+#include "logger.h"
+#include "falco_utils.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
 #include <syslog.h>
 
+#include <netdb.h>
+#include <poll.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// how long to wait before connecting again to an unreachable endpoint
+static const std::chrono::seconds s_reconnect_interval(1);
+
+// private enterprise number reserved for documentation by RFC5424,
+// used to name the structured data elements
+static const char* s_sd_alert_id = "falco@32473";
+static const char* s_sd_fields_id = "fields@32473";
+
+static const std::map<std::string, int> s_facilities = {
+	{"kern", 0}, {"user", 1}, {"mail", 2}, {"daemon", 3}, {"auth", 4}, {"syslog", 5},
+	{"lpr", 6}, {"news", 7}, {"uucp", 8}, {"cron", 9}, {"authpriv", 10}, {"ftp", 11},
+	{"local0", 16}, {"local1", 17}, {"local2", 18}, {"local3", 19},
+	{"local4", 20}, {"local5", 21}, {"local6", 22}, {"local7", 23},
+};
+
+// SD-NAME: printable US-ASCII except '=', ' ', ']' and '"', at most 32 chars
+static std::string sd_name(const std::string& s)
+{
+	std::string res = s.substr(0, 32);
+	for(auto& c : res)
+	{
+		if(c <= ' ' || c > '~' || c == '=' || c == ']' || c == '"')
+		{
+			c = '_';
+		}
+	}
+	return res;
+}
+
+// PARAM-VALUE: '"', '\' and ']' must be escaped
+static void sd_value(std::string& out, const std::string& s)
+{
+	out += '"';
+	for(auto c : s)
+	{
+		if(c == '"' || c == '\\' || c == ']')
+		{
+			out += '\\';
+		}
+		out += c;
+	}
+	out += '"';
+}
+
+falco::outputs::output_syslog::~output_syslog()
+{
+	disconnect();
+}
+
+bool falco::outputs::output_syslog::init(const config& oc, bool buffered, const std::string& hostname, bool json_output, std::string &err)
+{
+	if(!falco::outputs::abstract_output::init(oc, buffered, hostname, json_output, err))
+	{
+		return false;
+	}
+
+	const std::string& endpoint = m_oc.options["endpoint"];
+	if(endpoint.empty())
+	{
+		return true;
+	}
+	m_native = true;
+
+	auto facility = s_facilities.find(m_oc.options["facility"]);
+	if(facility == s_facilities.end())
+	{
+		err = "syslog output: unknown facility \"" + m_oc.options["facility"] + "\"";
+		return false;
+	}
+	m_facility = facility->second;
+	m_batch_size = std::max<size_t>(1, std::stoul(m_oc.options["batch_size"]));
+	m_backlog_size = std::max<size_t>(m_batch_size, std::stoul(m_oc.options["backlog_size"]));
+
+	const std::string unix_prefix = "unix://";
+	const std::string udp_prefix = "udp://";
+	const std::string tcp_prefix = "tcp://";
+	if(endpoint.compare(0, unix_prefix.size(), unix_prefix) == 0)
+	{
+		auto path = endpoint.substr(unix_prefix.size());
+		auto addr = (sockaddr_un*) &m_addr;
+		if(path.empty() || path.size() >= sizeof(addr->sun_path))
+		{
+			err = "syslog output: invalid unix socket path \"" + path + "\"";
+			return false;
+		}
+		addr->sun_family = AF_UNIX;
+		strncpy(addr->sun_path, path.c_str(), sizeof(addr->sun_path) - 1);
+		m_addrlen = sizeof(sockaddr_un);
+		m_socktype = SOCK_DGRAM;
+	}
+	else
+	{
+		std::string hostport;
+		if(endpoint.compare(0, udp_prefix.size(), udp_prefix) == 0)
+		{
+			hostport = endpoint.substr(udp_prefix.size());
+			m_socktype = SOCK_DGRAM;
+		}
+		else if(endpoint.compare(0, tcp_prefix.size(), tcp_prefix) == 0)
+		{
+			hostport = endpoint.substr(tcp_prefix.size());
+			m_socktype = SOCK_STREAM;
+		}
+		else
+		{
+			err = "syslog output: unsupported endpoint \"" + endpoint + "\", must start with unix://, udp:// or tcp://";
+			return false;
+		}
+
+		auto sep = hostport.rfind(':');
+		if(sep == std::string::npos)
+		{
+			err = "syslog output: missing port in endpoint \"" + endpoint + "\"";
+			return false;
+		}
+		auto host = hostport.substr(0, sep);
+		auto port = hostport.substr(sep + 1);
+		if(host.size() >= 2 && host.front() == '[' && host.back() == ']')
+		{
+			host = host.substr(1, host.size() - 2);
+		}
+
+		struct addrinfo hints = {};
+		struct addrinfo* res = nullptr;
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = m_socktype;
+		int rc = getaddrinfo(host.c_str(), port.c_str(), &hints, &res);
+		if(rc != 0 || res == nullptr)
+		{
+			err = "syslog output: can't resolve endpoint \"" + endpoint + "\": " + gai_strerror(rc);
+			return false;
+		}
+		memcpy(&m_addr, res->ai_addr, res->ai_addrlen);
+		m_addrlen = res->ai_addrlen;
+		freeaddrinfo(res);
+	}
+
+	// the part of the header that is the same for all the frames
+	m_header_suffix = " " + (m_hostname.empty() ? std::string("-") : sd_name(m_hostname))
+		+ " falco " + std::to_string(getpid()) + " - ";
+
+	// the endpoint may come up later
+	connect_endpoint();
+	return true;
+}
+
+bool falco::outputs::output_syslog::connect_endpoint()
+{
+	if(m_fd >= 0 && !m_connecting)
+	{
+		return true;
+	}
+
+	// the connection is established asynchronously, and checked for
+	// completion each time the backlog is sent
+	if(m_connecting)
+	{
+		struct pollfd pfd = {};
+		pfd.fd = m_fd;
+		pfd.events = POLLOUT;
+		if(poll(&pfd, 1, 0) <= 0)
+		{
+			return false;
+		}
+
+		int err = 0;
+		socklen_t len = sizeof(err);
+		if(getsockopt(m_fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0)
+		{
+			disconnect();
+			return false;
+		}
+		m_connecting = false;
+		return true;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	if(now < m_next_connect)
+	{
+		return false;
+	}
+	m_next_connect = now + s_reconnect_interval;
+
+	m_fd = socket(m_addr.ss_family, m_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if(m_fd < 0)
+	{
+		return false;
+	}
+
+	if(connect(m_fd, (sockaddr*) &m_addr, m_addrlen) != 0)
+	{
+		if(errno != EINPROGRESS)
+		{
+			disconnect();
+			return false;
+		}
+		m_connecting = true;
+		return false;
+	}
+	return true;
+}
+
+void falco::outputs::output_syslog::disconnect()
+{
+	if(m_fd >= 0)
+	{
+		close(m_fd);
+		m_fd = -1;
+	}
+	m_connecting = false;
+
+	// a partially sent frame can't be resumed on another connection
+	if(m_backlog_offset > 0)
+	{
+		drop_front();
+	}
+}
+
+void falco::outputs::output_syslog::drop_front()
+{
+	m_backlog.pop_front();
+	m_backlog_offset = 0;
+	m_backlog_len = m_backlog.size();
+	m_num_drops++;
+}
+
+std::string falco::outputs::output_syslog::format(const message *msg) const
+{
+	std::string frame;
+	frame.reserve(msg->msg.size() + 256);
+	frame += "<" + std::to_string(m_facility * 8 + msg->priority) + ">1 ";
+	falco::utils::append_iso8601(frame, msg->ts, 6);
+	frame += m_header_suffix;
+
+	frame += "[";
+	frame += s_sd_alert_id;
+	frame += " rule=";
+	sd_value(frame, msg->rule.get());
+	frame += " source=";
+	sd_value(frame, msg->source.get());
+	frame += " priority=";
+	sd_value(frame, falco_common::format_priority(msg->priority));
+	if(!msg->tags->empty())
+	{
+		std::string tags;
+		for(const auto& tag : msg->tags.get())
+		{
+			tags += tags.empty() ? tag : "," + tag;
+		}
+		frame += " tags=";
+		sd_value(frame, tags);
+	}
+	frame += "]";
+
+	if(msg->fields.is_object() && !msg->fields.empty())
+	{
+		frame += "[";
+		frame += s_sd_fields_id;
+		for(const auto& field : msg->fields.items())
+		{
+			frame += " " + sd_name(field.key()) + "=";
+			sd_value(frame, field.value().is_string() ? field.value().get<std::string>() : field.value().dump());
+		}
+		frame += "]";
+	}
+
+	frame += " " + msg->msg;
+
+	if(m_socktype == SOCK_STREAM)
+	{
+		frame = std::to_string(frame.size()) + " " + frame;
+	}
+	return frame;
+}
+
 void falco::outputs::output_syslog::output(const message *msg)
 {
-	// Syslog output should not have any trailing newline
-	::syslog(msg->priority, "%s", msg->msg.c_str());
+	if(!m_native)
+	{
+		// Syslog output should not have any trailing newline
+		::syslog(msg->priority, "%s", msg->msg.c_str());
+		return;
+	}
+
+	// frames are refused, rather than silently dropped, when they can't
+	// be handed over to the socket, so that the spool retries them
+	connect_endpoint();
+	if(m_fd < 0)
+	{
+		m_num_drops++;
+		throw falco_exception("syslog output: endpoint is not connected");
+	}
+
+	if(m_backlog.size() >= m_backlog_size)
+	{
+		m_num_drops++;
+		throw falco_exception("syslog output: backlog is full");
+	}
+
+	m_backlog.push_back(format(msg));
+	m_backlog_len = m_backlog.size();
+	if(m_backlog.size() >= m_batch_size)
+	{
+		send_backlog();
+	}
+}
+
+void falco::outputs::output_syslog::send_backlog()
+{
+	while(!m_backlog.empty() && connect_endpoint())
+	{
+		size_t n = std::min(m_backlog.size(), m_batch_size);
+		m_iov.resize(n);
+		for(size_t i = 0; i < n; i++)
+		{
+			m_iov[i].iov_base = (void*) m_backlog[i].data();
+			m_iov[i].iov_len = m_backlog[i].size();
+		}
+
+		if(m_socktype == SOCK_STREAM)
+		{
+			// octet-counted frames are written back to back
+			m_iov[0].iov_base = (char*) m_iov[0].iov_base + m_backlog_offset;
+			m_iov[0].iov_len -= m_backlog_offset;
+
+			struct msghdr mh = {};
+			mh.msg_iov = m_iov.data();
+			mh.msg_iovlen = n;
+			ssize_t sent = sendmsg(m_fd, &mh, MSG_NOSIGNAL);
+			if(sent < 0)
+			{
+				if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				{
+					disconnect();
+				}
+				return;
+			}
+
+			while(sent > 0)
+			{
+				size_t left = m_backlog.front().size() - m_backlog_offset;
+				if((size_t) sent < left)
+				{
+					m_backlog_offset += sent;
+					break;
+				}
+				sent -= left;
+				m_backlog.pop_front();
+				m_backlog_offset = 0;
+			}
+			m_backlog_len = m_backlog.size();
+			if(m_backlog_offset > 0)
+			{
+				return;
+			}
+		}
+		else
+		{
+			// one datagram per frame
+			m_msgs.resize(n);
+			for(size_t i = 0; i < n; i++)
+			{
+				m_msgs[i] = {};
+				m_msgs[i].msg_hdr.msg_iov = &m_iov[i];
+				m_msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+			int sent = sendmmsg(m_fd, m_msgs.data(), n, MSG_NOSIGNAL);
+			if(sent < 0)
+			{
+				int err = errno;
+				if(err == EAGAIN || err == EWOULDBLOCK || err == EINTR)
+				{
+					return;
+				}
+
+				// the frame is sent again once reconnected
+				if(err == ECONNREFUSED || err == ENOTCONN || err == EPIPE || err == ECONNRESET)
+				{
+					disconnect();
+					return;
+				}
+
+				// otherwise the first frame can't be sent, e.g. it's too
+				// large for a datagram: drop it, or it would block all
+				// the other ones
+				if(m_num_drops == 0)
+				{
+					falco_logger::log(falco_logger::level::ERR, "syslog output: failed to send frame, dropping it: " + std::string(strerror(err)) + "\n");
+				}
+				drop_front();
+				continue;
+			}
+			m_backlog.erase(m_backlog.begin(), m_backlog.begin() + sent);
+			m_backlog_len = m_backlog.size();
+		}
+	}
+}
+
+void falco::outputs::output_syslog::flush()
+{
+	if(m_native)
+	{
+		send_backlog();
+	}
+}
+
+void falco::outputs::output_syslog::cleanup()
+{
+	flush();
+}
+
+void falco::outputs::output_syslog::reopen()
+{
+	if(m_native)
+	{
+		disconnect();
+		m_next_connect = {};
+		connect_endpoint();
+	}
 }
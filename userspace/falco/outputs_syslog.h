@@ -1,6 +1,6 @@
 // SPDX-License-Identifier: Apache-2.0
 /*
-Copyright (C) 2023 The Falco Authors.
+Copyright (C) 2024 The Falco Authors.
 
 Licensed under the Apache License, Version 2.0 (the "License");
 you may not use this file except in compliance with the License.
@@ -19,14 +19,78 @@ limitations under the License.
 
 #include "outputs.h"
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
 namespace falco
 {
 namespace outputs
 {
 
+// Without an endpoint, messages are sent through the libc syslog(3). With
+// an endpoint (unix://<path>, udp://<host>:<port> or tcp://<host>:<port>),
+// messages are sent as RFC5424 frames carrying the alert fields as
+// structured data, octet-counted on TCP (RFC6587), over a non-blocking
+// socket. Frames are buffered in a bounded backlog and sent in batches,
+// when the backlog reaches the batch size or the outputs queue is empty.
+// output() throws if the endpoint is not connected or the backlog is full.
 class output_syslog : public abstract_output
 {
+public:
+	~output_syslog();
+
+	bool init(const config& oc, bool buffered, const std::string& hostname, bool json_output, std::string &err) override;
 	void output(const message *msg) override;
+	void flush() override;
+	void cleanup() override;
+	void reopen() override;
+
+	// Only RFC 5424 frames carry the fields as structured data
+	bool needs_fields() const override { return m_native; }
+
+	// Whether messages are sent to an endpoint rather than syslog(3)
+	bool has_endpoint() const { return m_native; }
+
+	// Number of frames refused because the endpoint was not connected or
+	// the backlog was full, or dropped because they could not be sent.
+	// Can be called from any thread.
+	uint64_t get_num_drops() const { return m_num_drops.load(); }
+
+	// Number of frames waiting to be sent. Can be called from any thread.
+	size_t get_backlog() const { return m_backlog_len.load(); }
+
+private:
+	bool connect_endpoint();
+	void disconnect();
+	void send_backlog();
+	void drop_front();
+	std::string format(const message *msg) const;
+
+	bool m_native = false;
+	int m_socktype = 0;
+	sockaddr_storage m_addr = {};
+	socklen_t m_addrlen = 0;
+	int m_fd = -1;
+	// true while a non-blocking connect is in progress on m_fd
+	bool m_connecting = false;
+	std::chrono::steady_clock::time_point m_next_connect;
+
+	int m_facility = 1;
+	size_t m_batch_size = 0;
+	size_t m_backlog_size = 0;
+	std::string m_header_suffix;
+
+	std::deque<std::string> m_backlog;
+	size_t m_backlog_offset = 0;
+	std::atomic<size_t> m_backlog_len = 0;
+	std::atomic<uint64_t> m_num_drops = 0;
+	std::vector<struct iovec> m_iov;
+	std::vector<struct mmsghdr> m_msgs;
 };
 
 } // namespace outputs
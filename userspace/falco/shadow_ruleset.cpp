@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "shadow_ruleset.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+shadow_ruleset::shadow_ruleset(std::shared_ptr<falco_engine> active,
+			       std::shared_ptr<falco_engine> shadow,
+			       std::size_t num_sources,
+			       uint32_t sampling_ratio)
+	: m_sampling_ratio(std::max<uint32_t>(sampling_ratio, 1)),
+	  m_sample_counters(num_sources, 0)
+{
+	m_active.engine = active;
+	m_shadow.engine = shadow;
+
+	// rules with the same name share the same slot in both rulesets
+	std::unordered_map<std::string, uint32_t> slots_by_name;
+	for(auto* rs : {&m_active, &m_shadow})
+	{
+		for(const auto& rule : rs->engine->get_rules())
+		{
+			auto it = slots_by_name.find(rule.name);
+			if(it == slots_by_name.end())
+			{
+				it = slots_by_name.emplace(rule.name, (uint32_t)m_rules.size()).first;
+				m_rules.emplace_back(rule.name, rule.source);
+			}
+			if(rule.id >= rs->slots.size())
+			{
+				rs->slots.resize(rule.id + 1, 0);
+			}
+			rs->slots[rule.id] = it->second;
+		}
+	}
+
+	for(auto* rs : {&m_active, &m_shadow})
+	{
+		rs->defined.assign(m_rules.size(), false);
+		for(const auto& rule : rs->engine->get_rules())
+		{
+			rs->defined[rs->slots[rule.id]] = true;
+		}
+		rs->counters = std::make_unique<atomic_counters[]>(m_rules.size());
+	}
+}
+
+void shadow_ruleset::evaluate(std::size_t source_idx, sinsp_evt* evt)
+{
+	if(m_num_sampled.fetch_add(1, std::memory_order_relaxed) % 2 == 0)
+	{
+		evaluate(m_active, source_idx, evt);
+		evaluate(m_shadow, source_idx, evt);
+	}
+	else
+	{
+		evaluate(m_shadow, source_idx, evt);
+		evaluate(m_active, source_idx, evt);
+	}
+}
+
+void shadow_ruleset::evaluate(ruleset_state& rs, std::size_t source_idx, sinsp_evt* evt)
+{
+	// the values cached by the filters while evaluating an event, shared
+	// across rules by the per-source filter cache, are only valid for the
+	// number of that event. Giving the event a number never used before
+	// times each ruleset with cold caches, no matter what evaluated the
+	// event already. Note: rules using evt.num see that number.
+	uint64_t evtnum = evt->get_num();
+	evt->set_num(m_cold_evtnum.fetch_sub(1, std::memory_order_relaxed));
+	rs.engine->profile_event(source_idx, evt,
+		[&rs](const falco_rule& rule, bool matched, uint64_t cost_ns)
+		{
+			auto& c = rs.counters[rs.slots[rule.id]];
+			c.evaluations.fetch_add(1, std::memory_order_relaxed);
+			c.cost_ns.fetch_add(cost_ns, std::memory_order_relaxed);
+			if(matched)
+			{
+				c.matches.fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+	evt->set_num(evtnum);
+}
+
+std::vector<shadow_ruleset::rule_stats> shadow_ruleset::get_rule_stats() const
+{
+	auto load = [](const ruleset_state& rs, size_t slot)
+	{
+		counters ret;
+		ret.defined = rs.defined[slot];
+		ret.evaluations = rs.counters[slot].evaluations.load(std::memory_order_relaxed);
+		ret.matches = rs.counters[slot].matches.load(std::memory_order_relaxed);
+		ret.cost_ns = rs.counters[slot].cost_ns.load(std::memory_order_relaxed);
+		return ret;
+	};
+
+	std::vector<rule_stats> ret(m_rules.size());
+	for(size_t i = 0; i < m_rules.size(); i++)
+	{
+		ret[i].name = m_rules[i].first;
+		ret[i].source = m_rules[i].second;
+		ret[i].active = load(m_active, i);
+		ret[i].shadow = load(m_shadow, i);
+	}
+	return ret;
+}
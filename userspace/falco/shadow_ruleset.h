@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "falco_engine.h"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct shadow_rules_config
+{
+	bool enabled = false;
+	// rules files and directories loaded in the shadow ruleset
+	std::list<std::string> rules_files;
+	// one event out of sampling_ratio is evaluated with both rulesets
+	uint32_t sampling_ratio = 100;
+};
+
+/**
+ * @brief Evaluates a sample of the events with both the active ruleset and
+ * a shadow ruleset loaded in a separate engine, and accounts for the number
+ * of evaluations, the matches and the evaluation cost of each rule in both.
+ * The shadow ruleset never produces alerts and doesn't affect the active
+ * one, so it can be used to measure a new version of the rules on real
+ * traffic before promoting it. sample() and evaluate() inherit the
+ * thread-safety guarantees of falco_engine::process_event(), while the
+ * getters can be called by any thread.
+ */
+class shadow_ruleset
+{
+public:
+	/**
+	 * @brief The counters of a rule in one of the two rulesets
+	 */
+	struct counters
+	{
+		// false if the rule is not defined in the ruleset
+		bool defined = false;
+		uint64_t evaluations = 0;
+		uint64_t matches = 0;
+		uint64_t cost_ns = 0;
+	};
+
+	/**
+	 * @brief The counters of a rule in both rulesets, rules are
+	 * matched across the two rulesets by name
+	 */
+	struct rule_stats
+	{
+		std::string name;
+		std::string source;
+		counters active;
+		counters shadow;
+	};
+
+	/**
+	 * @brief Both engines must have the same event sources, added in the
+	 * same order, and must have completed loading their rules
+	 */
+	shadow_ruleset(std::shared_ptr<falco_engine> active,
+		       std::shared_ptr<falco_engine> shadow,
+		       std::size_t num_sources,
+		       uint32_t sampling_ratio);
+
+	/**
+	 * @brief Returns true if the next event of the given source must be
+	 * passed to evaluate()
+	 */
+	inline bool sample(std::size_t source_idx)
+	{
+		auto& counter = m_sample_counters[source_idx];
+		if(++counter < m_sampling_ratio)
+		{
+			return false;
+		}
+		counter = 0;
+		return true;
+	}
+
+	/**
+	 * @brief Evaluates each candidate rule of both rulesets on the event
+	 * in isolation, and updates their counters. Each ruleset is evaluated
+	 * with cold filter caches, and the rulesets are evaluated in
+	 * alternating order, so that neither of them consistently benefits
+	 * from the inspector state warmed up by the other.
+	 */
+	void evaluate(std::size_t source_idx, sinsp_evt* evt);
+
+	/**
+	 * @brief Returns the counters of all the rules defined in at least
+	 * one of the two rulesets
+	 */
+	std::vector<rule_stats> get_rule_stats() const;
+
+	inline uint64_t num_sampled() const { return m_num_sampled.load(std::memory_order_relaxed); }
+	inline uint32_t sampling_ratio() const { return m_sampling_ratio; }
+
+private:
+	struct atomic_counters
+	{
+		std::atomic<uint64_t> evaluations = 0;
+		std::atomic<uint64_t> matches = 0;
+		std::atomic<uint64_t> cost_ns = 0;
+	};
+
+	// One of the two rulesets, where slots maps the id of each rule in
+	// the engine to its slot in m_rules, defined and counters
+	struct ruleset_state
+	{
+		std::shared_ptr<falco_engine> engine;
+		std::vector<uint32_t> slots;
+		std::vector<bool> defined;
+		std::unique_ptr<atomic_counters[]> counters;
+	};
+
+	void evaluate(ruleset_state& rs, std::size_t source_idx, sinsp_evt* evt);
+
+	uint32_t m_sampling_ratio;
+	std::vector<uint32_t> m_sample_counters;
+	std::atomic<uint64_t> m_num_sampled = 0;
+	// event numbers used to evaluate with cold caches, counting down
+	// from far above the ones assigned by the inspectors
+	std::atomic<uint64_t> m_cold_evtnum = UINT64_MAX - 1;
+	// name and source of the rules of both rulesets, by slot
+	std::vector<std::pair<std::string, std::string>> m_rules;
+	ruleset_state m_active;
+	ruleset_state m_shadow;
+};
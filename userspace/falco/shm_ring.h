@@ -0,0 +1,377 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+// Shared-memory ring used by the "shm" output to publish alerts to
+// co-located consumers. This header has no dependencies besides the C++17
+// standard library and Linux system headers, so that consumers can include
+// it as-is.
+//
+// The ring is a single-producer single-consumer queue stored in a file
+// (usually in /dev/shm) with the following layout, in host byte order:
+//
+//   offset  size  field
+//   0       4     magic, SHM_RING_MAGIC ("FLCR")
+//   4       4     version, SHM_RING_VERSION
+//   8       8     capacity of the data area in bytes, a power of 2
+//   64      8     head: total bytes written by the producer
+//   128     8     tail: total bytes consumed by the consumer
+//   192     4     seq: incremented at each write, used as futex word
+//   196     4     waiting: non-zero while the consumer sleeps on seq
+//   200     8     num_drops: records dropped because the ring was full
+//   256     -     data area
+//
+// Records start at offset (position % capacity) of the data area, are
+// 8-byte aligned and never wrap around its end:
+//
+//   0       4     size of the record in bytes, header and padding included
+//   4       4     type: SHM_RING_RECORD_ALERT, or SHM_RING_RECORD_PADDING to
+//                 skip to the beginning of the data area
+//   8       8     timestamp of the alert, in nanoseconds
+//   16      4     priority (0 = emergency ... 7 = debug)
+//   20      4     length of the rule name
+//   24      4     length of the event source
+//   28      4     length of the output message
+//   32      -     rule name, event source and output message, not terminated
+//
+// The producer never blocks: when the ring is full, records are dropped
+// and counted in num_drops. When the producer restarts it replaces the
+// ring file, so consumers must reopen it.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace falco
+{
+namespace shm_ring
+{
+
+constexpr uint32_t SHM_RING_MAGIC = 0x52434c46;
+constexpr uint32_t SHM_RING_VERSION = 1;
+constexpr uint32_t SHM_RING_RECORD_PADDING = 0;
+constexpr uint32_t SHM_RING_RECORD_ALERT = 1;
+
+struct header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t capacity;
+	alignas(64) std::atomic<uint64_t> head;
+	alignas(64) std::atomic<uint64_t> tail;
+	alignas(64) std::atomic<uint32_t> seq;
+	std::atomic<uint32_t> waiting;
+	std::atomic<uint64_t> num_drops;
+	alignas(64) uint8_t data[];
+};
+
+struct record
+{
+	uint32_t size;
+	uint32_t type;
+	uint64_t ts;
+	uint32_t priority;
+	uint32_t rule_len;
+	uint32_t source_len;
+	uint32_t msg_len;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory atomics must be lock-free");
+static_assert(offsetof(header, head) == 64 && offsetof(header, tail) == 128 && offsetof(header, seq) == 192
+	&& offsetof(header, num_drops) == 200 && offsetof(header, data) == 256, "unexpected ring header layout");
+static_assert(sizeof(record) == 32, "unexpected ring record layout");
+
+/**
+ * @brief An alert read from the ring. The views point into the shared
+ * memory and are valid until the alert is released.
+ */
+struct alert
+{
+	uint64_t ts;
+	uint32_t priority;
+	std::string_view rule;
+	std::string_view source;
+	std::string_view msg;
+};
+
+inline uint64_t align(uint64_t size)
+{
+	return (size + 7) & ~(uint64_t) 7;
+}
+
+inline void futex_wake(std::atomic<uint32_t>* addr)
+{
+	syscall(SYS_futex, (uint32_t*) addr, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+inline void futex_wait(std::atomic<uint32_t>* addr, uint32_t val, std::chrono::nanoseconds timeout)
+{
+	struct timespec ts;
+	ts.tv_sec = timeout.count() / 1000000000;
+	ts.tv_nsec = timeout.count() % 1000000000;
+	syscall(SYS_futex, (uint32_t*) addr, FUTEX_WAIT, val, &ts, nullptr, 0);
+}
+
+/**
+ * @brief Maps a ring file in memory, base class of producer and consumer.
+ */
+class mapping
+{
+public:
+	mapping() = default;
+	mapping(const mapping&) = delete;
+	mapping& operator = (const mapping&) = delete;
+
+	virtual ~mapping()
+	{
+		if(m_hdr != nullptr)
+		{
+			munmap(m_hdr, m_size);
+		}
+	}
+
+	/**
+	 * @brief Returns the number of records dropped by the producer
+	 */
+	uint64_t num_drops() const
+	{
+		return m_hdr->num_drops.load(std::memory_order_relaxed);
+	}
+
+protected:
+	void map(int fd, size_t size)
+	{
+		void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if(addr == MAP_FAILED)
+		{
+			throw std::runtime_error("failed to map shared-memory ring: " + std::string(strerror(errno)));
+		}
+		m_hdr = (header*) addr;
+		m_size = size;
+	}
+
+	header* m_hdr = nullptr;
+	size_t m_size = 0;
+};
+
+/**
+ * @brief Writing end of the ring, creates the ring file.
+ */
+class producer : public mapping
+{
+public:
+	/**
+	 * @brief Creates the ring file at the given path, replacing any
+	 * existing one, with a data area of the largest power of 2 not
+	 * exceeding size bytes. Throws std::runtime_error on failure.
+	 */
+	producer(const std::string& path, uint64_t size)
+	{
+		uint64_t capacity = 4096;
+		while(capacity * 2 <= size)
+		{
+			capacity *= 2;
+		}
+
+		// consumers of a previous ring keep their mapping
+		unlink(path.c_str());
+		int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+		if(fd < 0)
+		{
+			throw std::runtime_error("failed to create shared-memory ring " + path + ": " + strerror(errno));
+		}
+		size_t total = sizeof(header) + capacity;
+		if(ftruncate(fd, total) != 0)
+		{
+			int err = errno;
+			close(fd);
+			throw std::runtime_error("failed to size shared-memory ring " + path + ": " + strerror(err));
+		}
+		map(fd, total);
+
+		// the file is zero-filled, the magic is set last so that consumers
+		// never see a partially initialized header
+		m_hdr->version = SHM_RING_VERSION;
+		m_hdr->capacity = capacity;
+		std::atomic_thread_fence(std::memory_order_release);
+		__atomic_store_n(&m_hdr->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+	}
+
+	/**
+	 * @brief Writes an alert in the ring and wakes up the consumer.
+	 * Returns false if the alert was dropped because the ring is full.
+	 */
+	bool write(uint64_t ts, uint32_t priority, std::string_view rule, std::string_view source, std::string_view msg)
+	{
+		uint64_t capacity = m_hdr->capacity;
+		uint64_t size = align(sizeof(record) + rule.size() + source.size() + msg.size());
+		uint64_t head = m_hdr->head.load(std::memory_order_relaxed);
+		uint64_t tail = m_hdr->tail.load(std::memory_order_acquire);
+		uint64_t offset = head & (capacity - 1);
+		uint64_t padding = capacity - offset < size ? capacity - offset : 0;
+		if(size > capacity || head + padding + size - tail > capacity)
+		{
+			m_hdr->num_drops.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		if(padding > 0)
+		{
+			auto pad = (record*) &m_hdr->data[offset];
+			pad->size = padding;
+			pad->type = SHM_RING_RECORD_PADDING;
+			offset = 0;
+		}
+
+		auto rec = (record*) &m_hdr->data[offset];
+		rec->size = size;
+		rec->type = SHM_RING_RECORD_ALERT;
+		rec->ts = ts;
+		rec->priority = priority;
+		rec->rule_len = rule.size();
+		rec->source_len = source.size();
+		rec->msg_len = msg.size();
+		char* payload = (char*) (rec + 1);
+		memcpy(payload, rule.data(), rule.size());
+		memcpy(payload + rule.size(), source.data(), source.size());
+		memcpy(payload + rule.size() + source.size(), msg.data(), msg.size());
+
+		m_hdr->head.store(head + padding + size, std::memory_order_seq_cst);
+		m_hdr->seq.fetch_add(1, std::memory_order_seq_cst);
+		if(m_hdr->waiting.load(std::memory_order_seq_cst) != 0)
+		{
+			futex_wake(&m_hdr->seq);
+		}
+		return true;
+	}
+};
+
+/**
+ * @brief Reading end of the ring, opens an existing ring file. Only one
+ * consumer can be attached to a ring at a time.
+ */
+class consumer : public mapping
+{
+public:
+	/**
+	 * @brief Opens the ring file at the given path.
+	 * Throws std::runtime_error on failure.
+	 */
+	explicit consumer(const std::string& path)
+	{
+		int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+		if(fd < 0)
+		{
+			throw std::runtime_error("failed to open shared-memory ring " + path + ": " + strerror(errno));
+		}
+		struct stat st;
+		if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(header))
+		{
+			close(fd);
+			throw std::runtime_error("invalid shared-memory ring " + path);
+		}
+		map(fd, st.st_size);
+
+		if(__atomic_load_n(&m_hdr->magic, __ATOMIC_ACQUIRE) != SHM_RING_MAGIC
+			|| m_hdr->version != SHM_RING_VERSION
+			|| sizeof(header) + m_hdr->capacity > m_size)
+		{
+			throw std::runtime_error("invalid shared-memory ring " + path);
+		}
+	}
+
+	/**
+	 * @brief Returns the next alert without copying it, waiting at most
+	 * for the given timeout if the ring is empty. Returns false on timeout.
+	 * The alert stays in the ring until release() is called.
+	 */
+	bool next(alert& a, std::chrono::nanoseconds timeout)
+	{
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+		uint64_t capacity = m_hdr->capacity;
+		uint64_t tail = m_hdr->tail.load(std::memory_order_relaxed);
+		while(true)
+		{
+			uint32_t seq = m_hdr->seq.load(std::memory_order_seq_cst);
+			uint64_t head = m_hdr->head.load(std::memory_order_seq_cst);
+			if(head == tail)
+			{
+				auto now = std::chrono::steady_clock::now();
+				if(now >= deadline)
+				{
+					return false;
+				}
+				m_hdr->waiting.store(1, std::memory_order_seq_cst);
+				if(m_hdr->head.load(std::memory_order_seq_cst) == tail)
+				{
+					futex_wait(&m_hdr->seq, seq, deadline - now);
+				}
+				m_hdr->waiting.store(0, std::memory_order_relaxed);
+				continue;
+			}
+
+			auto rec = (const record*) &m_hdr->data[tail & (capacity - 1)];
+			if(rec->type == SHM_RING_RECORD_PADDING)
+			{
+				tail += rec->size;
+				m_hdr->tail.store(tail, std::memory_order_release);
+				continue;
+			}
+
+			const char* payload = (const char*) (rec + 1);
+			a.ts = rec->ts;
+			a.priority = rec->priority;
+			a.rule = std::string_view(payload, rec->rule_len);
+			a.source = std::string_view(payload + rec->rule_len, rec->source_len);
+			a.msg = std::string_view(payload + rec->rule_len + rec->source_len, rec->msg_len);
+			m_pending = rec->size;
+			return true;
+		}
+	}
+
+	/**
+	 * @brief Releases the alert last returned by next(), making room for
+	 * the producer. Its views must not be used afterwards.
+	 */
+	void release()
+	{
+		m_hdr->tail.fetch_add(m_pending, std::memory_order_release);
+		m_pending = 0;
+	}
+
+private:
+	uint64_t m_pending = 0;
+};
+
+} // namespace shm_ring
+} // namespace falco
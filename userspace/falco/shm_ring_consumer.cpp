@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Example consumer of the shm output: prints the alerts published by Falco
+// in the shared-memory ring at the given path.
+//
+// Usage: falco_shm_ring_consumer [path]
+
+#include "shm_ring.h"
+
+#include <cstdio>
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+	std::string path = argc > 1 ? argv[1] : "/dev/shm/falco_alerts";
+	try
+	{
+		falco::shm_ring::consumer ring(path);
+		falco::shm_ring::alert alert;
+		uint64_t drops = 0;
+		while(true)
+		{
+			if(!ring.next(alert, std::chrono::seconds(1)))
+			{
+				continue;
+			}
+			fwrite(alert.msg.data(), 1, alert.msg.size(), stdout);
+			fputc('\n', stdout);
+			fflush(stdout);
+			ring.release();
+
+			if(ring.num_drops() != drops)
+			{
+				drops = ring.num_drops();
+				std::cerr << "alerts dropped by the producer: " << drops << std::endl;
+			}
+		}
+	}
+	catch(const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -21,6 +21,7 @@ limitations under the License.
 #include <ctime>
 #include <csignal>
 #include <atomic>
+#include <algorithm>
 
 #include <nlohmann/json.hpp>
 
@@ -29,6 +30,9 @@ limitations under the License.
 #include "logger.h"
 #include "config_falco.h"
 #include "falco_utils.h"
+#include "json_writer.h"
+#include "memory_accounting.h"
+#include "thread_affinity.h"
 #include <libscap/strl.h>
 #include <libscap/scap_vtable.h>
 
@@ -172,8 +176,9 @@ stats_writer::ticker_t stats_writer::get_ticker()
 stats_writer::stats_writer(
 		const std::shared_ptr<falco_outputs>& outputs,
 		const std::shared_ptr<const falco_configuration>& config,
-		const std::shared_ptr<const falco_engine>& engine)
-	: m_config(config), m_engine(engine)
+		const std::shared_ptr<const falco_engine>& engine,
+		const std::shared_ptr<const syscall_buffer_autotune>& buffer_autotune)
+	: m_config(config), m_engine(engine), m_buffer_autotune(buffer_autotune)
 {
 	if (config->m_metrics_enabled)
 	{
@@ -251,7 +256,10 @@ inline void stats_writer::push(const stats_writer::msg& m)
 
 void stats_writer::worker() noexcept
 {
+	falco::threads::init_current(falco::threads::kind::STATS, "falco-stats");
+
 	stats_writer::msg m;
+	std::string line;
 	bool use_outputs = m_config->m_metrics_stats_rule_enabled;
 	bool use_file = !m_config->m_metrics_output_file.empty();
 	auto tick = stats_writer::get_ticker();
@@ -290,10 +298,14 @@ void stats_writer::worker() noexcept
 
 				if (use_file)
 				{
-					nlohmann::json jmsg;
-					jmsg["sample"] = m_total_samples;
-					jmsg["output_fields"] = m.output_fields;
-					m_file_output << jmsg.dump() << std::endl;
+					// the line buffer is reused across samples
+					line.clear();
+					falco::json_writer w(line);
+					w.begin_object();
+					w.key("output_fields").value(m.output_fields);
+					w.key("sample").value(m_total_samples);
+					w.end_object();
+					m_file_output << line << std::endl;
 				}
 			}
 			catch(const std::exception &e)
@@ -340,14 +352,92 @@ void stats_writer::collector::get_metrics_output_fields_wrapper(
 		output_fields["falco.host_num_cpus"] = machine_info->num_cpus;
 	}
 	output_fields["falco.outputs_queue_num_drops"] = m_writer->m_outputs->get_outputs_queue_num_drops();
+	auto drops_by_priority = m_writer->m_outputs->get_outputs_queue_num_drops_by_priority();
+	for (size_t i = 0; i < drops_by_priority.size(); i++)
+	{
+		if (drops_by_priority[i] == 0 && !m_writer->m_config->m_metrics_include_empty_values)
+		{
+			continue;
+		}
+		auto priority = falco_common::format_priority((falco_common::priority_type) i, true);
+		std::transform(priority.begin(), priority.end(), priority.begin(), ::tolower);
+		output_fields["falco.outputs_queue_num_drops." + priority] = drops_by_priority[i];
+	}
+	for (const auto& drops : m_writer->m_outputs->get_outputs_queue_num_drops_by_rule())
+	{
+		output_fields["falco.outputs_queue_num_drops.rules." + falco::utils::sanitize_metric_name(drops.first)] = drops.second.second;
+	}
+	if (m_writer->m_config->m_outputs_spool.enabled)
+	{
+		output_fields["falco.outputs_spool_num_msgs"] = m_writer->m_outputs->get_outputs_spool_num_msgs();
+		output_fields["falco.outputs_spool_num_drops"] = m_writer->m_outputs->get_outputs_spool_num_drops();
+		output_fields["falco.outputs_spool_num_rejected"] = m_writer->m_outputs->get_outputs_spool_num_rejected();
+	}
+	if (m_writer->m_outputs->has_syslog_endpoint())
+	{
+		output_fields["falco.outputs_syslog_num_drops"] = m_writer->m_outputs->get_syslog_num_drops();
+		output_fields["falco.outputs_syslog_backlog"] = m_writer->m_outputs->get_syslog_backlog();
+	}
+	for (const auto& latency : m_writer->m_outputs->get_alert_latency())
+	{
+		if (latency.histogram.count == 0 && !m_writer->m_config->m_metrics_include_empty_values)
+		{
+			continue;
+		}
+		std::string prefix = "falco.alert_latency." + latency.stage + ".";
+		if (!latency.output.empty())
+		{
+			prefix += latency.output + ".";
+		}
+		output_fields[prefix + "count"] = latency.histogram.count;
+		output_fields[prefix + "p50_ns"] = latency.histogram.percentile(0.5);
+		output_fields[prefix + "p99_ns"] = latency.histogram.percentile(0.99);
+		output_fields[prefix + "max_ns"] = latency.histogram.max;
+	}
+	if (m_writer->m_buffer_autotune != nullptr)
+	{
+		const auto& autotune = m_writer->m_buffer_autotune;
+		output_fields["falco.syscall_buffer_autotune.profile"] = autotune->profile();
+		output_fields["falco.syscall_buffer_autotune.preset"] = autotune->preset();
+		output_fields["falco.syscall_buffer_autotune.recommended_preset"] = autotune->recommended_preset();
+		output_fields["falco.syscall_buffer_autotune.decision"] = syscall_buffer_autotune::decision_to_string(autotune->last_decision());
+		output_fields["falco.syscall_buffer_autotune.drop_seconds"] = autotune->drop_seconds();
+		output_fields["falco.syscall_buffer_autotune.max_lag_ns"] = autotune->max_lag_ns();
+	}
+	for (size_t i = 0; i < (size_t)falco::memory::subsystem::MAX; i++)
+	{
+		auto subsystem = (falco::memory::subsystem)i;
+		std::string prefix = std::string("falco.memory.") + falco::memory::to_string(subsystem);
+		output_fields[prefix + "_bytes"] = falco::memory::get(subsystem);
+		if (falco::memory::soft_limit(subsystem) > 0)
+		{
+			output_fields[prefix + "_soft_limit_bytes"] = falco::memory::soft_limit(subsystem);
+			output_fields[prefix + "_soft_limit_hits"] = falco::memory::limit_hits(subsystem);
+		}
+	}
+	output_fields["falco.memory.total_bytes"] = falco::memory::total();
+	if (falco::memory::total_soft_limit() > 0)
+	{
+		output_fields["falco.memory.total_soft_limit_bytes"] = falco::memory::total_soft_limit();
+	}
+	output_fields["falco.num_evts_skipped_no_rules"] = m_writer->m_engine->get_num_skipped_events();
+	auto filter_cache_metrics = m_writer->m_engine->get_filter_cache_metrics();
+	output_fields["falco.filter_cache.num_extract"] = filter_cache_metrics.m_num_extract;
+	output_fields["falco.filter_cache.num_extract_cache"] = filter_cache_metrics.m_num_extract_cache;
+	output_fields["falco.filter_cache.num_compare"] = filter_cache_metrics.m_num_compare;
+	output_fields["falco.filter_cache.num_compare_cache"] = filter_cache_metrics.m_num_compare_cache;
 
 #if defined(__linux__) and !defined(MINIMAL_BUILD) and !defined(__EMSCRIPTEN__)
-	for (const auto& item : m_writer->m_config->m_loaded_rules_filenames_sha256sum)
 	{
-		fs::path fs_path = item.first;
-		std::string metric_name_file_sha256 = fs_path.filename().stem();
-		metric_name_file_sha256 = "falco.sha256_rules_file." + falco::utils::sanitize_metric_name(metric_name_file_sha256);
-		output_fields[metric_name_file_sha256] = item.second;
+		// rules can be reloaded in-place meanwhile
+		std::lock_guard<std::mutex> lk(m_writer->m_config->m_loaded_rules_filenames_sha256sum_mtx);
+		for (const auto& item : m_writer->m_config->m_loaded_rules_filenames_sha256sum)
+		{
+			fs::path fs_path = item.first;
+			std::string metric_name_file_sha256 = fs_path.filename().stem();
+			metric_name_file_sha256 = "falco.sha256_rules_file." + falco::utils::sanitize_metric_name(metric_name_file_sha256);
+			output_fields[metric_name_file_sha256] = item.second;
+		}
 	}
 
 	for (const auto& item : m_writer->m_config->m_loaded_configs_filenames_sha256sum)
@@ -98,7 +98,8 @@ public:
 	*/
 	stats_writer(const std::shared_ptr<falco_outputs>& outputs,
 		const std::shared_ptr<const falco_configuration>& config,
-		const std::shared_ptr<const falco_engine>& engine);
+		const std::shared_ptr<const falco_engine>& engine,
+		const std::shared_ptr<const syscall_buffer_autotune>& buffer_autotune = nullptr);
 
 	/*!
 		\brief Returns true if the writer is configured with a valid output.
@@ -155,6 +156,7 @@ private:
 	std::shared_ptr<falco_outputs> m_outputs;
 	std::shared_ptr<const falco_configuration> m_config;
 	std::shared_ptr<const falco_engine> m_engine;
+	std::shared_ptr<const syscall_buffer_autotune> m_buffer_autotune;
 	// note: in this way, only collectors can push into the queue
 	friend class stats_writer::collector;
 };
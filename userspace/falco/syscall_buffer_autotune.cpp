@@ -0,0 +1,303 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "syscall_buffer_autotune.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#include <nlohmann/json.hpp>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+syscall_buffer_autotune::syscall_buffer_autotune(const syscall_buffer_autotune_config& config, const std::string& profile)
+	: m_config(config), m_profile(profile)
+{
+}
+
+std::string syscall_buffer_autotune::host_profile(const std::string& engine, uint32_t cpus_for_each_buffer)
+{
+	long cpus = 0;
+	uint64_t mem_gib = 0;
+#ifdef __linux__
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	long pages = sysconf(_SC_PHYS_PAGES);
+	long page_size = sysconf(_SC_PAGESIZE);
+	if(pages > 0 && page_size > 0)
+	{
+		// rounded to the closest GiB, hosts of the same kind don't
+		// always report the exact same amount of memory
+		mem_gib = ((uint64_t)pages * (uint64_t)page_size + (1ULL << 29)) >> 30;
+	}
+#endif
+	std::string profile = engine + "/cpus=" + std::to_string(cpus) + "/mem_gib=" + std::to_string(mem_gib);
+	if(cpus_for_each_buffer > 0)
+	{
+		profile += "/cpus_for_each_buffer=" + std::to_string(cpus_for_each_buffer);
+	}
+	return profile;
+}
+
+const char* syscall_buffer_autotune::decision_to_string(decision d)
+{
+	switch(d)
+	{
+	case decision::GROW:
+		return "grow";
+	case decision::SHRINK:
+		return "shrink";
+	default:
+		return "keep";
+	}
+}
+
+syscall_buffer_autotune::profile_state syscall_buffer_autotune::recommend(
+		const syscall_buffer_autotune_config& config,
+		const profile_state& state,
+		int16_t open_preset,
+		const observation& obs,
+		bool run_completed)
+{
+	profile_state next = state;
+	next.last_decision = decision::KEEP;
+	if(run_completed)
+	{
+		next.runs++;
+	}
+
+	if(obs.drop_seconds > 0)
+	{
+		next.clean_runs = 0;
+		int16_t grown = std::min<int16_t>(open_preset + 1, config.max_preset);
+		next.min_safe_preset = std::max(next.min_safe_preset, grown);
+		if(grown > next.preset)
+		{
+			next.preset = grown;
+		}
+		if(next.preset > open_preset)
+		{
+			next.last_decision = decision::GROW;
+		}
+		return next;
+	}
+
+	// short runs don't tell much about the host workload
+	if(!run_completed || obs.seconds < config.min_run_seconds)
+	{
+		return next;
+	}
+
+	// a lagging consumer means that the buffer is busy even if it didn't drop
+	if(config.max_lag_ns > 0 && obs.max_lag_ns > config.max_lag_ns)
+	{
+		next.clean_runs = 0;
+		return next;
+	}
+
+	next.clean_runs++;
+	int16_t shrunk = open_preset - 1;
+	if(next.clean_runs >= config.shrink_after_runs
+		&& next.preset <= open_preset
+		&& shrunk >= std::max(config.min_preset, next.min_safe_preset))
+	{
+		next.preset = shrunk;
+		next.clean_runs = 0;
+		next.last_decision = decision::SHRINK;
+	}
+	return next;
+}
+
+int16_t syscall_buffer_autotune::select_preset(int16_t configured_preset)
+{
+	profile_state state;
+	bool found = load(state) && state.preset > 0;
+	if(!found)
+	{
+		state = profile_state();
+		state.preset = configured_preset;
+		state.min_safe_preset = m_config.min_preset;
+	}
+	state.preset = std::clamp(state.preset, m_config.min_preset, m_config.max_preset);
+	state.min_safe_preset = std::clamp(state.min_safe_preset, m_config.min_preset, m_config.max_preset);
+
+	if(found)
+	{
+		falco_logger::log(falco_logger::level::INFO, "Using the syscall buffer preset '" + std::to_string(state.preset)
+			+ "' recommended for host profile '" + m_profile + "' (configured: '" + std::to_string(configured_preset) + "')\n");
+	}
+	else
+	{
+		falco_logger::log(falco_logger::level::INFO, "No syscall buffer preset recommended yet for host profile '" + m_profile
+			+ "', using preset '" + std::to_string(state.preset) + "'\n");
+	}
+
+	m_state = state;
+	m_obs = observation();
+	m_persisted_preset = state.preset;
+	m_preset.store(state.preset, std::memory_order_relaxed);
+	m_recommended_preset.store(state.preset, std::memory_order_relaxed);
+	m_decision.store(state.last_decision, std::memory_order_relaxed);
+	return state.preset;
+}
+
+void syscall_buffer_autotune::observe(uint64_t n_evts, uint64_t n_drops_buffer, uint64_t lag_ns)
+{
+	m_obs.seconds++;
+	m_obs.n_evts += n_evts;
+	m_obs.n_drops_buffer += n_drops_buffer;
+	m_obs.max_lag_ns = std::max(m_obs.max_lag_ns, lag_ns);
+	if(n_drops_buffer > 0 && n_evts > 0)
+	{
+		double ratio = (double)n_drops_buffer / (double)n_evts;
+		m_obs.max_drop_ratio = std::max(m_obs.max_drop_ratio, ratio);
+		if(ratio > m_config.grow_drop_ratio)
+		{
+			m_obs.drop_seconds++;
+		}
+	}
+	m_drop_seconds.store(m_obs.drop_seconds, std::memory_order_relaxed);
+	m_max_lag_ns.store(m_obs.max_lag_ns, std::memory_order_relaxed);
+
+	// persist right away, so that the recommendation survives a crash
+	auto next = update(false);
+	if(next.preset != m_persisted_preset)
+	{
+		falco_logger::log(falco_logger::level::WARNING, "Syscall buffer drops detected, recommending preset '"
+			+ std::to_string(next.preset) + "' at the next start for host profile '" + m_profile + "'\n");
+		persist(next);
+		m_persisted_preset = next.preset;
+	}
+}
+
+void syscall_buffer_autotune::complete_run()
+{
+	auto next = update(true);
+	persist(next);
+	m_persisted_preset = next.preset;
+	if(next.last_decision == decision::SHRINK)
+	{
+		falco_logger::log(falco_logger::level::INFO, "No syscall buffer drops in the last "
+			+ std::to_string(m_config.shrink_after_runs) + " runs, recommending preset '"
+			+ std::to_string(next.preset) + "' at the next start for host profile '" + m_profile + "'\n");
+	}
+
+	// the inspector keeps its buffer until it gets reopened
+	m_state = next;
+	m_obs = observation();
+	m_drop_seconds.store(0, std::memory_order_relaxed);
+	m_max_lag_ns.store(0, std::memory_order_relaxed);
+}
+
+syscall_buffer_autotune::profile_state syscall_buffer_autotune::update(bool run_completed)
+{
+	auto next = recommend(m_config, m_state, m_preset.load(std::memory_order_relaxed), m_obs, run_completed);
+	m_recommended_preset.store(next.preset, std::memory_order_relaxed);
+	m_decision.store(next.last_decision, std::memory_order_relaxed);
+	return next;
+}
+
+static nlohmann::json read_state_file(const std::string& path)
+{
+	std::ifstream in(path);
+	if(!in.is_open())
+	{
+		return nlohmann::json::object();
+	}
+	auto j = nlohmann::json::parse(in, nullptr, false);
+	if(j.is_discarded() || !j.is_object())
+	{
+		falco_logger::log(falco_logger::level::WARNING, "Ignoring malformed syscall buffer autotune state file " + path + "\n");
+		return nlohmann::json::object();
+	}
+	return j;
+}
+
+bool syscall_buffer_autotune::load(profile_state& state) const
+{
+	auto j = read_state_file(m_config.state_file);
+	if(!j.contains("profiles") || !j["profiles"].is_object() || !j["profiles"].contains(m_profile))
+	{
+		return false;
+	}
+
+	const auto& p = j["profiles"][m_profile];
+	try
+	{
+		state.preset = p.value("preset", (int16_t)0);
+		state.min_safe_preset = p.value("min_safe_preset", (int16_t)0);
+		state.clean_runs = p.value("clean_runs", (uint32_t)0);
+		state.runs = p.value("runs", (uint64_t)0);
+		auto d = p.value("last_decision", std::string());
+		state.last_decision = d == "grow" ? decision::GROW : d == "shrink" ? decision::SHRINK : decision::KEEP;
+	}
+	catch(const nlohmann::json::exception& e)
+	{
+		falco_logger::log(falco_logger::level::WARNING, "Ignoring malformed syscall buffer autotune state for host profile '"
+			+ m_profile + "': " + e.what() + "\n");
+		return false;
+	}
+	return true;
+}
+
+void syscall_buffer_autotune::persist(const profile_state& state) const
+{
+	// other profiles may share the same file
+	auto j = read_state_file(m_config.state_file);
+	if(!j.contains("profiles") || !j["profiles"].is_object())
+	{
+		j["profiles"] = nlohmann::json::object();
+	}
+
+	auto& p = j["profiles"][m_profile];
+	p["preset"] = state.preset;
+	p["min_safe_preset"] = state.min_safe_preset;
+	p["clean_runs"] = state.clean_runs;
+	p["runs"] = state.runs;
+	p["last_decision"] = decision_to_string(state.last_decision);
+	p["last_max_drop_ratio"] = m_obs.max_drop_ratio;
+	p["last_max_lag_ns"] = m_obs.max_lag_ns;
+
+	std::error_code ec;
+	auto parent = fs::path(m_config.state_file).parent_path();
+	if(!parent.empty())
+	{
+		fs::create_directories(parent, ec);
+	}
+
+	auto tmp = m_config.state_file + ".tmp";
+	{
+		std::ofstream out(tmp, std::ios::out | std::ios::trunc);
+		out << j.dump(2) << "\n";
+		if(out.fail())
+		{
+			falco_logger::log(falco_logger::level::WARNING, "Could not write the syscall buffer autotune state file " + tmp + "\n");
+			return;
+		}
+	}
+	fs::rename(tmp, m_config.state_file, ec);
+	if(ec)
+	{
+		falco_logger::log(falco_logger::level::WARNING, "Could not write the syscall buffer autotune state file "
+			+ m_config.state_file + ": " + ec.message() + "\n");
+	}
+}
@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+struct syscall_buffer_autotune_config
+{
+	bool enabled = false;
+	// file where the recommended buffer sizes are persisted across runs
+	std::string state_file;
+	// identifies the kind of host the recommendation applies to,
+	// derived from the host resources when empty
+	std::string profile;
+	// bounds of the recommended buf_size_preset values
+	int16_t min_preset = 1;
+	int16_t max_preset = 7;
+	// ratio of events dropped because of a full buffer in one second above
+	// which the buffer is considered too small
+	double grow_drop_ratio = 0;
+	// consumer lag above which the buffer is considered busy, and is not shrunk
+	uint64_t max_lag_ns = 0;
+	// number of consecutive runs without drops before shrinking the buffer
+	uint32_t shrink_after_runs = 5;
+	// minimum duration of a run for it to count as one without drops
+	uint32_t min_run_seconds = 600;
+};
+
+/**
+ * @brief Recommends the syscall buffer size (as a buf_size_preset index)
+ * to use for a given host profile, based on the buffer drops and the
+ * consumer lag observed while running with the current one. The
+ * recommendation is persisted in a state file and applied the next time
+ * the inspector is opened. The buffer grows one preset per run with drops,
+ * and shrinks one preset after a number of long enough runs without drops
+ * and with a low consumer lag, but never back to a preset that dropped.
+ * observe() and complete_run() must not be called concurrently, while
+ * the metrics getters can be called by any thread.
+ */
+class syscall_buffer_autotune
+{
+public:
+	// the values are exported in the metrics, so they must not change
+	enum class decision : uint8_t
+	{
+		KEEP = 0,
+		GROW = 1,
+		SHRINK = 2
+	};
+
+	/**
+	 * @brief What has been observed since the start of the run
+	 */
+	struct observation
+	{
+		uint64_t seconds = 0;
+		uint64_t n_evts = 0;
+		uint64_t n_drops_buffer = 0;
+		// number of seconds with a drop ratio above grow_drop_ratio
+		uint64_t drop_seconds = 0;
+		double max_drop_ratio = 0;
+		uint64_t max_lag_ns = 0;
+	};
+
+	/**
+	 * @brief What is persisted for each host profile
+	 */
+	struct profile_state
+	{
+		// the preset to use at the next inspector open
+		int16_t preset = 0;
+		// presets below this one dropped events in the past
+		int16_t min_safe_preset = 0;
+		uint32_t clean_runs = 0;
+		uint64_t runs = 0;
+		decision last_decision = decision::KEEP;
+	};
+
+	syscall_buffer_autotune(const syscall_buffer_autotune_config& config, const std::string& profile);
+
+	/**
+	 * @brief Returns a profile name for the current host, describing the
+	 * driver in use and the host resources
+	 */
+	static std::string host_profile(const std::string& engine, uint32_t cpus_for_each_buffer = 0);
+
+	/**
+	 * @brief Returns the buf_size_preset to open the inspector with: the
+	 * persisted recommendation for the profile if any, or the configured
+	 * one otherwise. Must be called once, before observing the run.
+	 */
+	int16_t select_preset(int16_t configured_preset);
+
+	/**
+	 * @brief Accounts for one second of capture, with its number of events,
+	 * of events dropped because the buffer was full, and the delay between
+	 * the last event timestamp and the current time. The recommendation is
+	 * persisted as soon as it changes.
+	 */
+	void observe(uint64_t n_evts, uint64_t n_drops_buffer, uint64_t lag_ns);
+
+	/**
+	 * @brief Persists the recommendation at the end of a run, i.e. when the
+	 * inspector gets closed, and starts a new one with the same preset
+	 */
+	void complete_run();
+
+	/**
+	 * @brief Returns the next state of a profile, given its current state,
+	 * the preset the inspector has been opened with, and what has been
+	 * observed since then. Shrinking is only considered once the run is
+	 * completed.
+	 */
+	static profile_state recommend(const syscall_buffer_autotune_config& config,
+				       const profile_state& state,
+				       int16_t open_preset,
+				       const observation& obs,
+				       bool run_completed);
+
+	static const char* decision_to_string(decision d);
+
+	inline const std::string& profile() const { return m_profile; }
+	inline int16_t preset() const { return m_preset.load(std::memory_order_relaxed); }
+	inline int16_t recommended_preset() const { return m_recommended_preset.load(std::memory_order_relaxed); }
+	inline decision last_decision() const { return m_decision.load(std::memory_order_relaxed); }
+	inline uint64_t drop_seconds() const { return m_drop_seconds.load(std::memory_order_relaxed); }
+	inline uint64_t max_lag_ns() const { return m_max_lag_ns.load(std::memory_order_relaxed); }
+
+private:
+	bool load(profile_state& state) const;
+	void persist(const profile_state& state) const;
+	profile_state update(bool run_completed);
+
+	syscall_buffer_autotune_config m_config;
+	std::string m_profile;
+	profile_state m_state;
+	observation m_obs;
+	int16_t m_persisted_preset = 0;
+
+	std::atomic<int16_t> m_preset = 0;
+	std::atomic<int16_t> m_recommended_preset = 0;
+	std::atomic<decision> m_decision = decision::KEEP;
+	std::atomic<uint64_t> m_drop_seconds = 0;
+	std::atomic<uint64_t> m_max_lag_ns = 0;
+};
@@ -0,0 +1,283 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "thread_affinity.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static std::mutex s_mtx;
+static std::array<falco::threads::cpu_set, (size_t)falco::threads::kind::MAX> s_cpus;
+static falco::threads::cpu_set s_available;
+static bool s_configured = false;
+
+bool falco::threads::parse_cpu_list(const std::string& list, cpu_set& cpus, std::string& err)
+{
+	cpus.clear();
+	size_t pos = 0;
+	while (pos < list.size())
+	{
+		auto end = list.find(',', pos);
+		if (end == std::string::npos)
+		{
+			end = list.size();
+		}
+		auto item = list.substr(pos, end - pos);
+		item.erase(0, item.find_first_not_of(" \t\n"));
+		item.erase(item.find_last_not_of(" \t\n") + 1);
+		pos = end + 1;
+		if (item.empty())
+		{
+			continue;
+		}
+
+		auto dash = item.find('-');
+		auto first = item.substr(0, dash);
+		auto last = dash == std::string::npos ? first : item.substr(dash + 1);
+		auto is_number = [](const std::string& s)
+		{
+			return !s.empty() && s.size() < 6 && std::all_of(s.begin(), s.end(), ::isdigit);
+		};
+		if (!is_number(first) || !is_number(last) || std::stoul(first) > std::stoul(last))
+		{
+			err = "invalid CPU list item '" + item + "'";
+			return false;
+		}
+		for (auto cpu = std::stoul(first); cpu <= std::stoul(last); cpu++)
+		{
+			cpus.insert(cpu);
+		}
+	}
+	return true;
+}
+
+std::string falco::threads::to_cpu_list(const cpu_set& cpus)
+{
+	std::string res;
+	for (auto it = cpus.begin(); it != cpus.end();)
+	{
+		auto first = *it;
+		auto last = first;
+		while (++it != cpus.end() && *it == last + 1)
+		{
+			last = *it;
+		}
+		res += (res.empty() ? "" : ",") + std::to_string(first);
+		if (last != first)
+		{
+			res += "-" + std::to_string(last);
+		}
+	}
+	return res;
+}
+
+static bool read_cpu_list_file(const fs::path& path, falco::threads::cpu_set& cpus)
+{
+	std::ifstream f(path);
+	std::string line, err;
+	return f.is_open() && std::getline(f, line) && falco::threads::parse_cpu_list(line, cpus, err);
+}
+
+falco::threads::cpu_set falco::threads::online_cpus()
+{
+	cpu_set cpus;
+	if (!read_cpu_list_file("/sys/devices/system/cpu/online", cpus))
+	{
+		cpus.clear();
+	}
+	return cpus;
+}
+
+std::map<uint32_t, falco::threads::cpu_set> falco::threads::numa_nodes()
+{
+	std::map<uint32_t, cpu_set> nodes;
+	std::error_code ec;
+	for (const auto& entry : fs::directory_iterator("/sys/devices/system/node", ec))
+	{
+		auto name = entry.path().filename().string();
+		if (name.rfind("node", 0) != 0 || name.size() == 4
+			|| !std::all_of(name.begin() + 4, name.end(), ::isdigit))
+		{
+			continue;
+		}
+		cpu_set cpus;
+		if (read_cpu_list_file(entry.path() / "cpulist", cpus) && !cpus.empty())
+		{
+			nodes[std::stoul(name.substr(4))] = cpus;
+		}
+	}
+	return nodes;
+}
+
+falco::threads::cpu_set falco::threads::ring_buffers_numa_cpus(
+		const std::map<uint32_t, cpu_set>& nodes,
+		const cpu_set& online,
+		uint32_t cpus_for_each_buffer)
+{
+	if (nodes.empty())
+	{
+		return online;
+	}
+
+	std::map<uint32_t, uint32_t> buffers_per_node;
+	uint32_t idx = 0;
+	for (auto cpu : online)
+	{
+		// the first CPU of each group owns the buffer
+		if (cpus_for_each_buffer == 0 ? idx == 0 : idx % cpus_for_each_buffer == 0)
+		{
+			for (const auto& node : nodes)
+			{
+				if (node.second.count(cpu))
+				{
+					buffers_per_node[node.first]++;
+					break;
+				}
+			}
+		}
+		idx++;
+	}
+
+	auto best = nodes.begin()->first;
+	uint32_t best_count = 0;
+	for (const auto& count : buffers_per_node)
+	{
+		if (count.second > best_count)
+		{
+			best = count.first;
+			best_count = count.second;
+		}
+	}
+
+	cpu_set res;
+	for (auto cpu : nodes.at(best))
+	{
+		if (online.empty() || online.count(cpu))
+		{
+			res.insert(cpu);
+		}
+	}
+	return res;
+}
+
+#ifdef __linux__
+static void set_current_name(const std::string& name)
+{
+	if (name.empty())
+	{
+		return;
+	}
+	// the kernel limits thread names to 16 bytes, including the terminator
+	pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+}
+
+static void set_current_cpus(const falco::threads::cpu_set& cpus)
+{
+	if (cpus.empty())
+	{
+		return;
+	}
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (auto cpu : cpus)
+	{
+		if (cpu < CPU_SETSIZE)
+		{
+			CPU_SET(cpu, &set);
+		}
+	}
+	int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (err != 0)
+	{
+		falco_logger::log(falco_logger::level::WARNING, "Could not pin thread to CPUs "
+			+ falco::threads::to_cpu_list(cpus) + ": " + std::string(strerror(err)) + "\n");
+	}
+}
+
+static falco::threads::cpu_set get_current_cpus()
+{
+	falco::threads::cpu_set cpus;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+	{
+		for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		{
+			if (CPU_ISSET(cpu, &set))
+			{
+				cpus.insert(cpu);
+			}
+		}
+	}
+	return cpus;
+}
+#else
+static void set_current_name(const std::string&) {}
+static void set_current_cpus(const falco::threads::cpu_set&) {}
+static falco::threads::cpu_set get_current_cpus() { return {}; }
+#endif
+
+void falco::threads::configure(kind k, const cpu_set& cpus)
+{
+	std::lock_guard<std::mutex> lock(s_mtx);
+	if (!s_configured)
+	{
+		s_available = get_current_cpus();
+		s_configured = true;
+	}
+	s_cpus[(size_t)k] = cpus;
+}
+
+void falco::threads::init_current(kind k, const std::string& name)
+{
+	cpu_set cpus;
+	{
+		std::lock_guard<std::mutex> lock(s_mtx);
+		if (!s_configured)
+		{
+			set_current_name(name);
+			return;
+		}
+		cpus = s_cpus[(size_t)k].empty() ? s_available : s_cpus[(size_t)k];
+	}
+	set_current_name(name);
+	set_current_cpus(cpus);
+}
+
+void falco::threads::reset_current()
+{
+	cpu_set cpus;
+	{
+		std::lock_guard<std::mutex> lock(s_mtx);
+		cpus = s_available;
+	}
+	set_current_cpus(cpus);
+}
@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: Apache-2.0
+/*
+Copyright (C) 2024 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+
+namespace falco
+{
+namespace threads
+{
+
+/**
+ * @brief The classes of threads that can be pinned to their own CPUs
+ */
+enum class kind : uint8_t
+{
+	SOURCE = 0,
+	OUTPUTS,
+	STATS,
+	GRPC,
+	WEBSERVER,
+	MAX
+};
+
+using cpu_set = std::set<uint32_t>;
+
+/**
+ * @brief Parses a CPU list in the kernel format (e.g. "0-3,8,10-11").
+ * Returns false and sets err if the list is malformed.
+ */
+bool parse_cpu_list(const std::string& list, cpu_set& cpus, std::string& err);
+
+/**
+ * @brief Formats a CPU set as a CPU list in the kernel format
+ */
+std::string to_cpu_list(const cpu_set& cpus);
+
+/**
+ * @brief Returns the online CPUs, or an empty set if unknown
+ */
+cpu_set online_cpus();
+
+/**
+ * @brief Returns the CPUs of each NUMA node, or an empty map if unknown
+ */
+std::map<uint32_t, cpu_set> numa_nodes();
+
+/**
+ * @brief Returns the CPUs of the NUMA node holding most of the syscall
+ * ring buffers, where each buffer is shared by cpus_for_each_buffer
+ * consecutive online CPUs (all of them if 0) and belongs to the node of
+ * the first of them. Ties are broken in favor of the lowest node.
+ */
+cpu_set ring_buffers_numa_cpus(
+	const std::map<uint32_t, cpu_set>& nodes,
+	const cpu_set& online,
+	uint32_t cpus_for_each_buffer);
+
+/**
+ * @brief Sets the CPUs the given class of threads gets pinned to, all
+ * the available ones if empty. The first call also records the CPUs the
+ * calling thread can run on as the available ones.
+ */
+void configure(kind k, const cpu_set& cpus);
+
+/**
+ * @brief Names the calling thread (truncated to 15 characters) and pins it
+ * to the CPUs configured for its class, so that threads don't inherit the
+ * placement of the thread that spawned them. An empty name leaves the
+ * name untouched, which the main thread relies on since its name is
+ * the one of the process.
+ */
+void init_current(kind k, const std::string& name = "");
+
+/**
+ * @brief Lets the calling thread run on all the available CPUs
+ */
+void reset_current();
+
+}; // namespace threads
+}; // namespace falco
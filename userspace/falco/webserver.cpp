@@ -20,6 +20,7 @@ limitations under the License.
 #include "falco_metrics.h"
 #include "app/state.h"
 #include "versions_info.h"
+#include "thread_affinity.h"
 #include <atomic>
 
 falco_webserver::~falco_webserver()
@@ -67,9 +68,23 @@ void falco_webserver::start(
 
     if (state.config->m_metrics_enabled && webserver_config.m_prometheus_metrics_enabled)
     {
+        auto metrics = std::make_shared<falco_metrics>(
+            state,
+            std::chrono::milliseconds(webserver_config.m_prometheus_metrics_max_age),
+            webserver_config.m_prometheus_metrics_gzip);
         m_server->Get("/metrics",
-            [&state](const httplib::Request &, httplib::Response &res) {
-                res.set_content(falco_metrics::to_text(state), falco_metrics::content_type);
+            [metrics](const httplib::Request &req, httplib::Response &res) {
+                // scrapes within the max age share the same rendering
+                auto snapshot = metrics->get();
+                if (snapshot.gzip != nullptr && req.get_header_value("Accept-Encoding").find("gzip") != std::string::npos)
+                {
+                    res.set_header("Content-Encoding", "gzip");
+                    res.set_content(*snapshot.gzip, falco_metrics::content_type);
+                }
+                else
+                {
+                    res.set_content(*snapshot.text, falco_metrics::content_type);
+                }
             });
     }
     // run server in a separate thread
@@ -83,6 +98,8 @@ void falco_webserver::start(
     failed.store(false, std::memory_order_release);
     m_server_thread = std::thread([this, webserver_config, &failed]
     {
+        // the pool threads of the server inherit the placement of this one
+        falco::threads::init_current(falco::threads::kind::WEBSERVER, "falco-webserver");
         try
         {
             this->m_server->listen(webserver_config.m_listen_address, webserver_config.m_listen_port);